@@ -9,7 +9,8 @@ class ConfigException(Exception):
 class Config:
     def __init__(self, snapshot_first, snapshot_second, show_diff,
                  output_llvm_ir, control_flow_only, print_asm_diffs,
-                 verbosity, use_ffi, semdiff_tool):
+                 verbosity, use_ffi, semdiff_tool, semdiff_jobs=None,
+                 simpll_memory_limit=None, simpll_inline_wrappers=None):
         """
         Store configuration of DiffKemp
         :param snapshot_first: First snapshot representation.
@@ -18,6 +19,14 @@ class Config:
         :param control_flow_only: Check only for control-flow differences.
         :param verbosity: Verbosity level (currently boolean).
         :param semdiff_tool: Tool to use for semantic diff
+        :param semdiff_jobs: Maximal number of function pairs compared by the
+                             semantic diff tool in parallel (defaults to the
+                             number of CPUs).
+        :param simpll_memory_limit: Limit of memory used by a single run of
+                                    SimpLL (in MiB).
+        :param simpll_inline_wrappers: Maximal size (in instructions) of simple
+                                       wrappers that SimpLL inlines before
+                                       comparing functions.
         """
         self.snapshot_first = snapshot_first
         self.snapshot_second = snapshot_second
@@ -27,11 +36,27 @@ class Config:
         self.print_asm_diffs = print_asm_diffs
         self.verbosity = verbosity
         self.use_ffi = use_ffi
+        self.simpll_memory_limit = simpll_memory_limit
+        self.simpll_inline_wrappers = simpll_inline_wrappers
+
+        # Global variables w.r.t. which each function pair is yet to be
+        # simplified, indexed by tuples (first LLVM file, second LLVM file,
+        # first function, second function). All the variables of a pair are
+        # handled by a single run of SimpLL.
+        self.simpll_pending_vars = dict()
+        # Results of SimpLL for the variables handled by an earlier run,
+        # indexed by the above tuples extended by the variable name.
+        self.simpll_var_results = dict()
 
         # Semantic diff tool configuration
         self.semdiff_tool = semdiff_tool
         if semdiff_tool == "llreve":
             self.timeout = 10
+            self.semdiff_jobs = semdiff_jobs if semdiff_jobs \
+                else os.cpu_count()
+            # Results of semantic diffs of simplified function pairs indexed
+            # by digests of the pairs
+            self.semdiff_cache = dict()
             if not os.path.isfile("build/llreve/reve/reve/llreve"):
                 raise ConfigException("LLReve not built, try to re-run CMake \
                                        with -DBUILD_LLREVE=ON")
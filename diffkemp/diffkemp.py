@@ -36,6 +36,12 @@ def __make_argument_parser():
     generate_ap.add_argument("--sysctl", action="store_true",
                              help="function list is a list of function "
                                   "parameters")
+    generate_ap.add_argument("--jobs", "-j", type=int,
+                             help="number of sources built in parallel "
+                                  "(defaults to the number of CPUs)")
+    generate_ap.add_argument("--llvm-cache-dir",
+                             help="directory to cache built LLVM IR in "
+                                  "(shared among kernel trees)")
     generate_ap.set_defaults(func=generate)
 
     # "compare" sub-command
@@ -76,6 +82,9 @@ def __make_argument_parser():
     compare_ap.add_argument("--semdiff-tool",
                             help=SUPPRESS,
                             choices=["llreve"])
+    compare_ap.add_argument("--semdiff-jobs",
+                            help=SUPPRESS,
+                            type=int)
     compare_ap.add_argument("--show-errors",
                             help="show functions that are either unknown or \
                             ended with an error in statistics",
@@ -83,6 +92,16 @@ def __make_argument_parser():
     compare_ap.add_argument("--enable-simpll-ffi",
                             help="calls SimpLL through FFI",
                             action="store_true")
+    compare_ap.add_argument("--simpll-memory-limit",
+                            help="limit of memory used by a single run of \
+                            SimpLL (in MiB); functions whose comparison \
+                            exceeds it end with an error",
+                            type=int)
+    compare_ap.add_argument("--simpll-inline-wrappers",
+                            help="inline simple wrappers having at most the \
+                            given number of instructions that were added or \
+                            removed before comparing functions in SimpLL",
+                            type=int)
     compare_ap.set_defaults(func=compare)
     return ap
 
@@ -105,9 +124,18 @@ def generate(args):
     """
     # Create a new snapshot from the source directory.
     snapshot = Snapshot.create_from_source(args.kernel_dir, args.output_dir,
-                                           "sysctl" if args.sysctl else None)
+                                           "sysctl" if args.sysctl else None,
+                                           build_jobs=args.jobs,
+                                           llvm_cache_dir=args.llvm_cache_dir)
     source = snapshot.kernel_source
 
+    # Build sources of the listed functions in parallel in advance, so that
+    # they need not be compiled one by one below.
+    if not args.sysctl:
+        with open(args.functions_list, "r") as fun_list_file:
+            source.build_sources_for_symbols(
+                [line.strip() for line in fun_list_file.readlines()])
+
     # Build sources for symbols from the list into LLVM IR
     with open(args.functions_list, "r") as fun_list_file:
         for line in fun_list_file.readlines():
@@ -230,10 +258,23 @@ def compare(args):
     config = Config(old_snapshot, new_snapshot, args.show_diff,
                     args.output_llvm_ir, args.control_flow_only,
                     args.print_asm_diffs, args.verbose, args.enable_simpll_ffi,
-                    args.semdiff_tool)
+                    args.semdiff_tool, args.semdiff_jobs,
+                    args.simpll_memory_limit, args.simpll_inline_wrappers)
     result = Result(Result.Kind.NONE, args.snapshot_dir_old,
                     args.snapshot_dir_old)
 
+    # Register all global variables w.r.t. which each function is compared
+    # so that SimpLL can handle all of them at once.
+    for group_name, group in old_snapshot.fun_groups.items():
+        for fun, old_fun_desc in group.functions.items():
+            new_fun_desc = new_snapshot.get_by_name(fun, group_name)
+            if (old_fun_desc.glob_var is None or new_fun_desc is None or
+                    old_fun_desc.mod is None or new_fun_desc.mod is None):
+                continue
+            config.simpll_pending_vars.setdefault(
+                (old_fun_desc.mod.llvm, new_fun_desc.mod.llvm, fun, fun),
+                set()).add(old_fun_desc.glob_var)
+
     for group_name, group in sorted(old_snapshot.fun_groups.items()):
         group_printed = False
 
@@ -1,8 +1,11 @@
 """
 Building kernel module into LLVM IR.
 """
+from concurrent.futures import ThreadPoolExecutor
+import hashlib
 import os
 from subprocess import CalledProcessError, check_call, check_output
+from tempfile import mkstemp
 
 
 class BuildException(Exception):
@@ -12,9 +15,21 @@ class BuildException(Exception):
 class LlvmKernelBuilder:
     """
     Building kernel modules into LLVM IR.
+    Built LLVM IR files are stored in a content-addressed cache shared among
+    all kernel trees, so that unchanged sources are compiled only once.
     """
-    def __init__(self, kernel_dir):
+    # Placeholder replacing the kernel directory inside cached LLVM IR files.
+    cache_kernel_dir = "@DIFFKEMP_KERNEL_DIR@"
+    # Version of Clang (is a part of the cache keys).
+    clang_version = None
+
+    def __init__(self, kernel_dir, jobs=None, cache_dir=None):
         self.kernel_dir = os.path.abspath(kernel_dir)
+        # Maximal number of translation units being built in parallel
+        self.jobs = jobs if jobs else os.cpu_count()
+        # Directory with the cache of built LLVM IR files
+        self.cache_dir = os.path.abspath(
+            cache_dir if cache_dir else self.default_cache_dir())
         # Compiler headers (containing 'asm goto' constructions)
         self.compiler_headers = [os.path.join(self.kernel_dir, h) for h in
                                  ["include/linux/compiler-gcc.h",
@@ -24,6 +39,17 @@ class LlvmKernelBuilder:
         # Caching built modules to reuse them
         self.built_modules = dict()
 
+    @staticmethod
+    def default_cache_dir():
+        """
+        Default location of the LLVM IR cache. Can be changed by setting the
+        DIFFKEMP_CACHE_DIR environment variable.
+        """
+        if "DIFFKEMP_CACHE_DIR" in os.environ:
+            return os.path.join(os.environ["DIFFKEMP_CACHE_DIR"], "llvm")
+        return os.path.join(os.path.expanduser("~"), ".cache", "diffkemp",
+                            "llvm")
+
     def initialize(self):
         """
         Prepare kernel so that it can be compiled into LLVM IR.
@@ -178,6 +204,129 @@ class LlvmKernelBuilder:
         except CalledProcessError:
             raise BuildException("Running opt failed")
 
+    @staticmethod
+    def _get_clang_version():
+        """Get version string of the used Clang (computed just once)."""
+        if LlvmKernelBuilder.clang_version is None:
+            try:
+                LlvmKernelBuilder.clang_version = check_output(
+                    ["clang", "--version"]).decode("utf-8")
+            except (CalledProcessError, OSError):
+                LlvmKernelBuilder.clang_version = ""
+        return LlvmKernelBuilder.clang_version
+
+    @staticmethod
+    def _normalise_clang_command(command):
+        """
+        Remove parameters specifying output files (the target object and the
+        dependency file) from a Clang command so that it only describes how
+        the source is compiled.
+        """
+        result = []
+        skip_next = False
+        for param in command:
+            if skip_next:
+                skip_next = False
+                continue
+            if param == "-o":
+                skip_next = True
+                continue
+            if param.startswith("-Wp,-MD") or param.startswith("-Wp,-MMD"):
+                continue
+            result.append(param)
+        return result
+
+    def _cache_key(self, command, optimise):
+        """
+        Compute the cache key of a Clang command. The key is a digest of the
+        preprocessed source, of the normalised command, and of the Clang
+        version.
+        :param command: Clang command compiling a source into LLVM IR.
+        :param optimise: Whether opt is run on the result.
+        :return Hexadecimal digest or None if the source cannot be
+                preprocessed.
+        """
+        normalised = self._normalise_clang_command(command)
+        preprocess = [p for p in normalised if p not in ["-S", "-emit-llvm"]]
+        preprocess.extend(["-E", "-o", "-"])
+        try:
+            with open(os.devnull, "w") as devnull:
+                preprocessed = check_output(preprocess, cwd=self.kernel_dir,
+                                            stderr=devnull)
+        except CalledProcessError:
+            return None
+
+        digest = hashlib.sha256()
+        digest.update(self._get_clang_version().encode("utf-8"))
+        digest.update("\0".join(normalised).encode("utf-8"))
+        digest.update(b"\0opt\0" if optimise else b"\0")
+        digest.update(preprocessed)
+        return digest.hexdigest()
+
+    def _cache_file(self, key):
+        """Path to the cached LLVM IR file for the given key."""
+        return os.path.join(self.cache_dir, key[:2], "{}.ll".format(key[2:]))
+
+    def _fetch_from_cache(self, key, llvm_file):
+        """
+        Copy LLVM IR from the cache into llvm_file. The kernel directory
+        placeholder is replaced by the directory of this kernel.
+        :return True if the cache contained the key.
+        """
+        cache_file = self._cache_file(key)
+        if not os.path.isfile(cache_file):
+            return False
+        with open(cache_file, "r") as cached:
+            llvm = cached.read()
+        with open(llvm_file, "w") as target:
+            target.write(llvm.replace(self.cache_kernel_dir, self.kernel_dir))
+        return True
+
+    def _store_to_cache(self, key, llvm_file):
+        """
+        Store LLVM IR into the cache. Absolute paths to the kernel directory
+        (stored in debug info) are replaced by a placeholder so that the IR
+        can be reused by other kernel trees.
+        The file is written atomically to allow concurrent builds to share
+        the cache.
+        """
+        cache_file = self._cache_file(key)
+        cache_subdir = os.path.dirname(cache_file)
+        try:
+            os.makedirs(cache_subdir, exist_ok=True)
+            with open(llvm_file, "r") as built:
+                llvm = built.read()
+            fd, tmp_file = mkstemp(dir=cache_subdir, suffix=".tmp")
+            with os.fdopen(fd, "w") as tmp:
+                tmp.write(llvm.replace(self.kernel_dir, self.cache_kernel_dir))
+            os.rename(tmp_file, cache_file)
+        except OSError:
+            # Caching is only an optimisation, failure is not an error.
+            pass
+
+    def _run_clang(self, command, optimise=False):
+        """
+        Run a Clang command compiling a single source into LLVM IR. If the
+        result is already in the cache, it is only copied to the target file.
+        :param command: Clang command (as created by gcc_to_llvm).
+        :param optimise: Run opt_llvm on the created file.
+        """
+        llvm_file = os.path.join(self.kernel_dir,
+                                 self._get_build_object(command))
+        key = self._cache_key(command, optimise)
+        if key and self._fetch_from_cache(key, llvm_file):
+            return
+
+        with open(os.devnull, "w") as stderr:
+            try:
+                check_call(command, cwd=self.kernel_dir, stderr=stderr)
+            except CalledProcessError:
+                raise BuildException("Could not build {}".format(llvm_file))
+        if optimise:
+            self.opt_llvm(llvm_file)
+        if key:
+            self._store_to_cache(key, llvm_file)
+
     @staticmethod
     def _clean_object(obj):
         """Clean an object file"""
@@ -238,18 +387,14 @@ class LlvmKernelBuilder:
         :returns GCC command used for the compilation. This is the last
                  command starting with 'gcc' that was run by make
         """
-        cwd = os.getcwd()
-        os.chdir(self.kernel_dir)
-        self._clean_object(object_file)
+        self._clean_object(os.path.join(self.kernel_dir, object_file))
         with open(os.devnull, "w") as stderr:
             try:
                 output = check_output(
-                    ["make", "V=1", object_file,
-                     "--just-print"], stderr=stderr).decode("utf-8")
+                    ["make", "V=1", object_file, "--just-print"],
+                    cwd=self.kernel_dir, stderr=stderr).decode("utf-8")
             except CalledProcessError:
                 raise BuildException("Error compiling {}".format(object_file))
-            finally:
-                os.chdir(cwd)
 
         for c in reversed(output.splitlines()):
             command = self._extract_gcc_command(c)
@@ -304,34 +449,40 @@ class LlvmKernelBuilder:
         Build C source file into LLVM IR.
         Gets the Kbuild command that is used for building an object file,
         transforms it into the corresponding Clang command, and runs it.
+        The built LLVM IR is taken from the cache if possible.
+        Does not change the working directory, hence multiple sources may be
+        built concurrently.
         :param source_file: C source to build
         :param llvm_file: Target LLVM IR file to create
         """
+        source_file = os.path.join(self.kernel_dir, source_file)
+        llvm_file = os.path.join(self.kernel_dir, llvm_file)
         if (not os.path.isfile(llvm_file) or os.path.getmtime(llvm_file) <
                 os.path.getmtime(source_file)):
-            cwd = os.getcwd()
-            os.chdir(self.kernel_dir)
-
             name = os.path.relpath(source_file, self.kernel_dir)[:-2]
+            # Get GCC command for building the .o file
+            command = self.kbuild_object_command("{}.o".format(name))
+            # Convert the GCC command to a corresponding Clang command and
+            # run it together with opt
+            self._run_clang(self.gcc_to_llvm(command), optimise=True)
+
+    def build_sources_to_llvm(self, sources):
+        """
+        Build multiple C source files into LLVM IR in parallel. The number of
+        concurrently built sources is limited by the jobs parameter.
+        :param sources: List of pairs (C source, target LLVM IR file).
+        :return List of LLVM IR files that were successfully built.
+        """
+        def build(source):
             try:
-                # Get GCC command for building the .o file
-                command = self.kbuild_object_command("{}.o".format(name))
-                # Convert the GCC command to a corresponding Clang command
-                command = self.gcc_to_llvm(command)
-                # Run the Clang command
-                with open(os.devnull, "w") as stderr:
-                    try:
-                        check_call(command, stderr=stderr)
-                    except CalledProcessError:
-                        os.chdir(cwd)
-                        raise BuildException(
-                            "Could not build {}".format(llvm_file))
-                # Run opt with selected optimisations
-                self.opt_llvm(llvm_file)
+                self.build_source_to_llvm(*source)
+                return source[1]
             except BuildException:
-                raise
-            finally:
-                os.chdir(cwd)
+                return None
+
+        with ThreadPoolExecutor(max_workers=self.jobs) as executor:
+            return [llvm_file for llvm_file in executor.map(build, sources)
+                    if llvm_file is not None]
 
     def build_kernel_mod_to_llvm(self, mod_dir, mod_name):
         """
@@ -350,19 +501,24 @@ class LlvmKernelBuilder:
                                                                   mod_name)
             llvm_commands = self.kbuild_to_llvm_commands(gcc_commands,
                                                          file_name)
+            # Translation units are independent, compile them in parallel.
+            to_compile = []
+            for c in llvm_commands:
+                if c[0] == "clang":
+                    src = self._get_build_source(c)
+                    obj = self._get_build_object(c)
+                    if (not os.path.isfile(obj) or
+                            os.path.getmtime(obj) < os.path.getmtime(src)):
+                        to_compile.append(c)
+            with ThreadPoolExecutor(max_workers=self.jobs) as executor:
+                # Iterating the results re-raises exceptions from workers
+                list(executor.map(self._run_clang, to_compile))
+
             with open(os.devnull, "w") as stderr:
-                built = False
                 for c in llvm_commands:
-                    if c[0] == "clang":
-                        src = self._get_build_source(c)
-                        obj = self._get_build_object(c)
-                        if (not os.path.isfile(obj) or
-                                os.path.getmtime(obj) < os.path.getmtime(src)):
-                            built = True
-                            check_call(c, stderr=stderr)
-                    elif c[0] == "llvm-link":
+                    if c[0] == "llvm-link":
                         obj = self._get_build_object(c)
-                        if not os.path.isfile(obj) or built:
+                        if not os.path.isfile(obj) or to_compile:
                             check_call(c, stderr=stderr)
             llvm_file = os.path.join(mod_dir, "{}.ll".format(file_name))
             self.opt_llvm(llvm_file)
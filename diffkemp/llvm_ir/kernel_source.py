@@ -5,6 +5,7 @@ Functions for searching function definitions, kernel modules, etc.
 from diffkemp.llvm_ir.build_llvm import LlvmKernelBuilder, BuildException
 from diffkemp.llvm_ir.kernel_module import LlvmKernelModule
 from diffkemp.llvm_ir.llvm_sysctl_module import LlvmSysctlModule
+from diffkemp.llvm_ir.symbol_index import SourceSymbolIndex, SymbolIndex
 import errno
 import os
 import shutil
@@ -26,11 +27,18 @@ class KernelSource:
     modules, and others.
     """
 
-    def __init__(self, kernel_dir, with_builder=False):
+    def __init__(self, kernel_dir, with_builder=False, build_jobs=None,
+                 llvm_cache_dir=None, cscope_fallback=True):
         self.kernel_dir = os.path.abspath(kernel_dir)
-        self.builder = LlvmKernelBuilder(kernel_dir) if with_builder else None
+        self.builder = LlvmKernelBuilder(kernel_dir, build_jobs,
+                                         llvm_cache_dir) \
+            if with_builder else None
         self.modules = dict()
         self.cscope_cache = dict()
+        self.symbol_index = SymbolIndex(self.kernel_dir)
+        self.source_index = SourceSymbolIndex(self.kernel_dir)
+        # Whether to run cscope for symbols missing in the source index
+        self.cscope_fallback = cscope_fallback
 
     def initialize(self):
         """
@@ -42,9 +50,18 @@ class KernelSource:
             self.builder.initialize()
 
     def finalize(self):
-        """Restore the kernel builder state."""
+        """
+        Restore the kernel builder state and store the indices of symbols so
+        that they can be reused next time.
+        """
         if self.builder:
             self.builder.finalize()
+            for index in [self.symbol_index, self.source_index]:
+                if index.added:
+                    try:
+                        index.write()
+                    except OSError:
+                        pass
 
     def get_sources_with_params(self, directory):
         """
@@ -99,14 +116,36 @@ class KernelSource:
         check_call(["cscope", "-b", "-q", "-k"])
         os.chdir(cwd)
 
+    def index_symbols(self, symbols):
+        """
+        Index definitions and uses of the given symbols in the source index.
+        The symbols are searched by a single cscope process, later lookups of
+        the symbols then need no cscope run.
+        :param symbols: Iterable of symbols to index.
+        """
+        self.build_cscope_database()
+        try:
+            self.source_index.add_symbols(symbols)
+        except OSError:
+            # Symbols that could not be indexed are looked up by cscope.
+            pass
+
     def _cscope_run(self, symbol, definition):
         """
-        Run cscope search for a symbol.
+        Get cscope entries for a symbol. The entries are taken from the source
+        index if the symbol is indexed, otherwise cscope is run for the symbol
+        (unless the cscope fallback is disabled).
         :param symbol: Symbol to search for
         :param definition: If true, search definitions, otherwise search all
                            usage.
         :return: List of found cscope entries.
         """
+        indexed = self.source_index.lookup(symbol, definition)
+        if indexed is not None:
+            return indexed
+        if not self.cscope_fallback:
+            return []
+
         if (symbol, definition) in self.cscope_cache:
             return self.cscope_cache[(symbol, definition)]
 
@@ -286,12 +325,40 @@ class KernelSource:
 
         mod = LlvmKernelModule(llvm_file, source_file)
         self.modules[name] = mod
+        self.symbol_index.add_module(llvm_file)
         return mod
 
+    def build_sources_for_symbols(self, symbols):
+        """
+        Build sources that most likely contain definitions of the given
+        symbols into LLVM IR. The sources are built in parallel, modules for
+        the symbols can be then retrieved by get_module_for_symbol without
+        further compilation.
+        :param symbols: List of symbols to build sources for.
+        """
+        if not self.builder:
+            return
+        self.index_symbols(symbols)
+        sources = []
+        for symbol in symbols:
+            if not symbol or not (symbol[0].isalpha() or symbol[0] == "_"):
+                continue
+            try:
+                src = self.find_srcs_with_symbol_def(symbol)[0]
+            except (SourceNotFoundException, IndexError):
+                continue
+            if not src.endswith(".c"):
+                continue
+            llvm_file = "{}.ll".format(src[:-2])
+            if (src, llvm_file) not in sources:
+                sources.append((src, llvm_file))
+        self.builder.build_sources_to_llvm(sources)
+
     def get_module_for_symbol(self, symbol, created_before=None):
         """
-        Looks up files containing definition of a symbol using CScope, then
-        transforms them into LLVM modules and looks whether the symbol is
+        Looks up the symbol in the index of symbol definitions. If it is not
+        there, looks up files containing definition of a symbol using CScope,
+        then transforms them into LLVM modules and looks whether the symbol is
         actually defined in the created module.
         In case there are multiple files containing the definition, the first
         module containing the function definition is returned.
@@ -301,11 +368,25 @@ class KernelSource:
         """
         mod = None
 
+        llvm_file = self.symbol_index.lookup(symbol)
+        if llvm_file is not None:
+            # Modules linked from multiple sources have no source file of the
+            # same name, these are found using CScope
+            src = "{}.c".format(llvm_file[:-3])
+            if os.path.isfile(os.path.join(self.kernel_dir, src)):
+                mod = self.get_module_from_source(src, created_before)
+                if mod and self.symbol_index.module_defines(mod.llvm, symbol):
+                    return mod
+                mod = None
+
         srcs = self.find_srcs_with_symbol_def(symbol)
         for src in srcs:
             mod = self.get_module_from_source(src, created_before)
             if mod:
-                if not (mod.has_function(symbol) or mod.has_global(symbol)):
+                name = src[:-2] if src.endswith(".c") else src
+                if not self.symbol_index.module_defines(
+                        os.path.join(self.kernel_dir, "{}.ll".format(name)),
+                        symbol):
                     mod = None
                 else:
                     break
@@ -0,0 +1,435 @@
+"""
+Indices of symbols.
+Map symbols (functions and global variables) to LLVM IR files that contain
+their definitions and to source files that define or use them.
+"""
+import mmap
+import os
+import re
+from subprocess import PIPE, Popen
+from tempfile import mkstemp
+
+
+class SymbolIndex:
+    """
+    Index mapping symbols to LLVM IR files defining them.
+    The index is stored in a file consisting of lines "<symbol> <file>" sorted
+    by the symbol name, file paths are relative to the index root directory.
+    The file is memory-mapped and searched using binary search, hence it need
+    not be parsed when loaded. Symbols from modules added after loading are
+    kept in memory until the index is written.
+    Only symbols with external linkage are indexed since an internal symbol
+    may be defined by many modules and it cannot be linked from elsewhere.
+    Entries of LLVM IR files that were modified (or removed) after the index
+    was written are considered outdated unless the file is added again.
+    The same format is read by SimpLL to link missing definitions.
+    """
+    # Name of the index file in kernel and snapshot directories.
+    file_name = "symbols.idx"
+
+    # Definitions of functions and global variables in LLVM IR.
+    _function_def = re.compile(r'^define [^@]*@"?([^"(\s]+)"?\(')
+    _global_def = re.compile(r'^@"?([^"\s]+)"? = (.*)$')
+    _function_decl = re.compile(r'^declare [^@]*@"?([^"(\s]+)"?\(')
+
+    def __init__(self, root_dir, index_file=None, load=True):
+        self.root_dir = os.path.abspath(root_dir)
+        self.index_file = index_file if index_file else \
+            os.path.join(self.root_dir, self.file_name)
+        self.mapped = None
+        # Modification time of the mapped index file
+        self.mapped_mtime = None
+        # Symbols added after loading the index
+        self.added = dict()
+        # Symbols defined by modules that were added, mapped to True if they
+        # have external linkage (used to detect outdated entries of the mapped
+        # index)
+        self.module_symbols = dict()
+        if load:
+            self._load()
+
+    def _load(self):
+        """Memory-map the index file if it exists."""
+        if not os.path.isfile(self.index_file) or \
+                os.path.getsize(self.index_file) == 0:
+            return
+        with open(self.index_file, "rb") as index:
+            self.mapped = mmap.mmap(index.fileno(), 0, access=mmap.ACCESS_READ)
+            self.mapped_mtime = os.fstat(index.fileno()).st_mtime
+
+    def _is_current(self, symbol, file):
+        """
+        Check whether an entry of the mapped index is up to date, i.e. the
+        LLVM IR file still exports the symbol. Files that were not added are
+        only checked not to be modified after the index was written.
+        """
+        if file in self.module_symbols:
+            return self.module_symbols[file].get(symbol, False)
+        try:
+            return os.path.getmtime(os.path.join(self.root_dir, file)) <= \
+                self.mapped_mtime
+        except OSError:
+            return False
+
+    def _lookup_mapped(self, symbol):
+        """
+        Binary search for the symbol in the mapped index. The searched range
+        always starts at a beginning of a line and the line containing the
+        middle byte of the range is compared with the symbol.
+        """
+        if self.mapped is None:
+            return None
+        data = self.mapped
+        key = symbol.encode("utf-8")
+        low = 0
+        high = len(data)
+        while low < high:
+            middle = low + (high - low) // 2
+            start = max(data.rfind(b"\n", low, middle) + 1, low)
+            end = data.find(b"\n", start)
+            if end == -1:
+                end = len(data)
+            name, _, file = data[start:end].partition(b" ")
+            if name == key:
+                return file.decode("utf-8")
+            if name < key:
+                low = end + 1
+            else:
+                high = start
+        return None
+
+    def lookup(self, symbol):
+        """
+        Find the LLVM IR file defining the symbol.
+        :param symbol: Symbol to find.
+        :return Path to the LLVM IR file relative to the root directory or
+                None if the symbol is not in the index.
+        """
+        if symbol in self.added:
+            return self.added[symbol]
+        file = self._lookup_mapped(symbol)
+        if file is not None and not self._is_current(symbol, file):
+            # The module was rebuilt and no longer exports the symbol
+            return None
+        return file
+
+    @staticmethod
+    def _is_exported(attributes):
+        """Check the linkage of a definition given its leading keywords."""
+        return "internal" not in attributes and "private" not in attributes
+
+    @classmethod
+    def _get_linkages(cls, llvm_file):
+        """
+        Get all functions and global variables defined in an LLVM IR file.
+        :return Dictionary mapping names of the defined symbols to True if
+                they have external linkage.
+        """
+        result = dict()
+        with open(llvm_file, "r", errors="ignore") as llvm:
+            for line in llvm:
+                if line.startswith("define "):
+                    match = cls._function_def.match(line)
+                    if match:
+                        attributes = line[:match.start(1)].split()
+                        result[match.group(1)] = cls._is_exported(attributes)
+                elif line.startswith("@"):
+                    match = cls._global_def.match(line)
+                    if not match:
+                        continue
+                    # Declarations have external linkage and no initializer
+                    attributes = match.group(2).split()
+                    for keyword in ["global", "constant", "alias"]:
+                        if keyword in attributes:
+                            attributes = attributes[
+                                :attributes.index(keyword)]
+                            break
+                    if "external" not in attributes and \
+                            "extern_weak" not in attributes:
+                        result[match.group(1)] = cls._is_exported(attributes)
+        return result
+
+    @classmethod
+    def get_definitions(cls, llvm_file, exported_only=False):
+        """
+        Get names of all functions and global variables defined in an LLVM
+        IR file.
+        :param exported_only: Only get symbols with external linkage.
+        """
+        return set(symbol for symbol, exported
+                   in cls._get_linkages(llvm_file).items()
+                   if exported or not exported_only)
+
+    @classmethod
+    def get_declarations(cls, llvm_file):
+        """
+        Get names of all functions and global variables declared (i.e. used
+        but not defined) in an LLVM IR file.
+        """
+        result = set()
+        with open(llvm_file, "r", errors="ignore") as llvm:
+            for line in llvm:
+                if line.startswith("declare "):
+                    match = cls._function_decl.match(line)
+                    if match:
+                        result.add(match.group(1))
+                elif line.startswith("@"):
+                    match = cls._global_def.match(line)
+                    if match and ("external" in match.group(2).split() or
+                                  "extern_weak" in match.group(2).split()):
+                        result.add(match.group(1))
+        return result
+
+    def add_module(self, llvm_file):
+        """
+        Add all symbols exported by an LLVM IR file into the index.
+        Symbols already exported by another module are not overwritten.
+        :param llvm_file: Path to the LLVM IR file.
+        """
+        file = os.path.relpath(os.path.abspath(llvm_file), self.root_dir)
+        if file in self.module_symbols:
+            return
+        symbols = self._get_linkages(llvm_file)
+        self.module_symbols[file] = symbols
+        for symbol, exported in symbols.items():
+            if exported and self.lookup(symbol) is None:
+                self.added[symbol] = file
+
+    def module_defines(self, llvm_file, symbol):
+        """
+        Check whether an LLVM IR file defines the symbol. The file is added to
+        the index if it has not been added yet.
+        """
+        file = os.path.relpath(os.path.abspath(llvm_file), self.root_dir)
+        if file not in self.module_symbols:
+            self.add_module(llvm_file)
+        return symbol in self.module_symbols[file]
+
+    def _entries(self):
+        """All entries of the index (including the added ones)."""
+        entries = dict()
+        if self.mapped is not None:
+            for line in self.mapped[:].splitlines():
+                name, _, file = line.partition(b" ")
+                if name:
+                    entries[name.decode("utf-8")] = file.decode("utf-8")
+        # Drop entries of modules that no longer export the symbols
+        entries = {s: f for s, f in entries.items() if self._is_current(s, f)}
+        entries.update(self.added)
+        return entries
+
+    def write(self, index_file=None):
+        """
+        Write the index into a file. The file is replaced atomically so that
+        it can be safely rewritten while being mapped.
+        :param index_file: Target file (defaults to the loaded index file).
+        """
+        index_file = index_file if index_file else self.index_file
+        entries = sorted(
+            (symbol.encode("utf-8"), file.encode("utf-8"))
+            for symbol, file in self._entries().items())
+        fd, tmp_file = mkstemp(dir=os.path.dirname(index_file))
+        with os.fdopen(fd, "wb") as index:
+            for symbol, file in entries:
+                index.write(symbol + b" " + file + b"\n")
+        os.chmod(tmp_file, 0o644)
+        os.replace(tmp_file, index_file)
+
+    @classmethod
+    def create(cls, root_dir, llvm_files, index_file=None):
+        """
+        Create a new index from a list of LLVM IR files and write it.
+        :param root_dir: Directory to which the files in the index are
+                         relative.
+        :param llvm_files: LLVM IR files to index.
+        :param index_file: Target file (defaults to root_dir/symbols.idx).
+        :return The created index.
+        """
+        index = cls(root_dir, index_file, load=False)
+        for llvm_file in llvm_files:
+            index.add_module(llvm_file)
+        index.write()
+        return index
+
+
+class SourceSymbolIndex:
+    """
+    Index of cscope results for symbols of a kernel (or a snapshot).
+    For each indexed symbol, the index stores the cscope entries of its
+    definitions and uses. The index is built at once for a set of symbols
+    using a single cscope process running in the line-oriented mode, hence
+    looking up an indexed symbol spawns no process.
+    The index is stored in a file consisting of lines
+    "<symbol>\t<kind>\t<cscope entry>" sorted by the symbol name, where kind
+    is "d" for definitions and "u" for uses. Symbols having no entries of
+    either kind are stored with kind "-" so that they are known to be
+    indexed. The file is memory-mapped and searched using binary search.
+    """
+    # Name of the index file in kernel and snapshot directories.
+    file_name = "cscope.idx"
+
+    def __init__(self, root_dir, index_file=None, load=True):
+        self.root_dir = os.path.abspath(root_dir)
+        self.index_file = index_file if index_file else \
+            os.path.join(self.root_dir, self.file_name)
+        self.mapped = None
+        # Symbols indexed after loading, mapped to pairs of lists
+        # (definitions, uses)
+        self.added = dict()
+        if load:
+            self._load()
+
+    def _load(self):
+        """Memory-map the index file if it exists."""
+        if not os.path.isfile(self.index_file) or \
+                os.path.getsize(self.index_file) == 0:
+            return
+        with open(self.index_file, "rb") as index:
+            self.mapped = mmap.mmap(index.fileno(), 0, access=mmap.ACCESS_READ)
+
+    def _lookup_mapped(self, symbol):
+        """
+        Binary search for the first line of the symbol in the mapped index
+        and collect all its lines.
+        :return Pair of lists (definitions, uses) or None if the symbol is not
+                in the index.
+        """
+        if self.mapped is None:
+            return None
+        data = self.mapped
+        key = symbol.encode("utf-8")
+        low = 0
+        high = len(data)
+        first = None
+        while low < high:
+            middle = low + (high - low) // 2
+            start = max(data.rfind(b"\n", low, middle) + 1, low)
+            end = data.find(b"\n", start)
+            if end == -1:
+                end = len(data)
+            name = data[start:end].partition(b"\t")[0]
+            if name == key:
+                first = start
+            if name < key:
+                low = end + 1
+            else:
+                high = start
+        if first is None:
+            return None
+
+        result = ([], [])
+        start = first
+        while start < len(data):
+            end = data.find(b"\n", start)
+            if end == -1:
+                end = len(data)
+            name, _, rest = data[start:end].partition(b"\t")
+            if name != key:
+                break
+            kind, _, entry = rest.partition(b"\t")
+            if kind == b"d":
+                result[0].append(entry.decode("utf-8"))
+            elif kind == b"u":
+                result[1].append(entry.decode("utf-8"))
+            start = end + 1
+        return result
+
+    def lookup(self, symbol, definition):
+        """
+        Get cscope entries for the symbol.
+        :param symbol: Symbol to find.
+        :param definition: If true, get definitions, otherwise get all uses.
+        :return List of cscope entries or None if the symbol is not indexed.
+        """
+        entries = self.added.get(symbol)
+        if entries is None:
+            entries = self._lookup_mapped(symbol)
+        if entries is None:
+            return None
+        return entries[0] if definition else entries[1]
+
+    @staticmethod
+    def _read_cscope_result(output):
+        """
+        Read result of a single query from the output of cscope running in
+        the line-oriented mode.
+        """
+        while True:
+            line = output.readline()
+            if not line:
+                raise OSError("cscope terminated unexpectedly")
+            # Skip the prompt printed before reading each command
+            while line.startswith(">> "):
+                line = line[3:]
+            if line.startswith("cscope: "):
+                break
+        count = int(line.split()[1])
+        return [output.readline().rstrip("\n") for _ in range(count)]
+
+    def add_symbols(self, symbols):
+        """
+        Index definitions and uses of the given symbols. All symbols that are
+        not indexed yet are searched by a single cscope process using the
+        database in the root directory.
+        :param symbols: Iterable of symbols to index.
+        """
+        missing = sorted(set(s for s in symbols
+                             if s and (s[0].isalpha() or s[0] == "_") and
+                             self.lookup(s, True) is None))
+        if not missing:
+            return
+        with open(os.devnull, "w") as devnull:
+            cscope = Popen(["cscope", "-d", "-l"], cwd=self.root_dir,
+                           stdin=PIPE, stdout=PIPE, stderr=devnull,
+                           universal_newlines=True, errors="ignore")
+        try:
+            for symbol in missing:
+                cscope.stdin.write("1{}\n".format(symbol))
+                cscope.stdin.flush()
+                defs = self._read_cscope_result(cscope.stdout)
+                cscope.stdin.write("0{}\n".format(symbol))
+                cscope.stdin.flush()
+                uses = self._read_cscope_result(cscope.stdout)
+                # Only C sources are of interest
+                self.added[symbol] = (
+                    [e for e in defs if e.split()[0].endswith("c")],
+                    [e for e in uses if e.split()[0].endswith("c")])
+            cscope.stdin.write("q\n")
+            cscope.stdin.flush()
+        finally:
+            cscope.stdin.close()
+            cscope.wait()
+
+    def _entries(self):
+        """All lines of the index (including the added symbols)."""
+        entries = []
+        if self.mapped is not None:
+            entries = [line for line in self.mapped[:].splitlines()
+                       if line.partition(b"\t")[0].decode("utf-8")
+                       not in self.added]
+        for symbol, (defs, uses) in self.added.items():
+            key = symbol.encode("utf-8")
+            for kind, kind_entries in [(b"d", defs), (b"u", uses)]:
+                for entry in kind_entries:
+                    entries.append(b"\t".join([key, kind,
+                                               entry.encode("utf-8")]))
+            if not defs and not uses:
+                entries.append(key + b"\t-\t")
+        return entries
+
+    def write(self, index_file=None):
+        """
+        Write the index into a file. The file is replaced atomically so that
+        it can be safely rewritten while being mapped.
+        :param index_file: Target file (defaults to the loaded index file).
+        """
+        index_file = index_file if index_file else self.index_file
+        # Sort by the symbol only to keep the order of cscope entries.
+        entries = sorted(self._entries(),
+                         key=lambda line: line.partition(b"\t")[0])
+        fd, tmp_file = mkstemp(dir=os.path.dirname(index_file))
+        with os.fdopen(fd, "wb") as index:
+            for line in entries:
+                index.write(line + b"\n")
+        os.chmod(tmp_file, 0o644)
+        os.replace(tmp_file, index_file)
@@ -1,11 +1,16 @@
 """Semantic difference of two functions using llreve and Z3 SMT solver."""
 from diffkemp.llvm_ir.kernel_source import SourceNotFoundException
-from diffkemp.simpll.simpll import run_simpll, SimpLLException
+from diffkemp.simpll.simpll import run_simpll, run_simpll_vars, \
+    SimpLLException
 from diffkemp.semdiff.result import Result
 from diffkemp.syndiff.function_syntax_diff import syntax_diff
-from subprocess import Popen, PIPE
-from threading import Timer
+from concurrent.futures import ThreadPoolExecutor, wait, FIRST_COMPLETED
+from subprocess import Popen, PIPE, DEVNULL, TimeoutExpired
+import hashlib
+import os
+import re
 import sys
+import time
 
 
 def _kill(processes):
@@ -47,14 +52,100 @@ def _link_symbol_def(snapshot, module, symbol):
     return result
 
 
+# Definition of a function in LLVM IR
+_function_def = re.compile(r'^define [^@]*@"?([^"(\s]+)"?\(')
+
+# Configurations of the Z3 fixedpoint solver that are run concurrently for
+# each formula. The first definite answer is used.
+z3_portfolio = [["fixedpoint.engine=duality"],
+                ["fixedpoint.engine=spacer"]]
+
+
+def _z3_result_kind(process, formula):
+    """
+    Pass the formula to a running Z3 process and get the result of the
+    analysis from its output.
+    """
+    try:
+        output, _ = process.communicate(formula)
+    except (BrokenPipeError, ValueError):
+        process.wait()
+        return Result.Kind.ERROR
+    if process.returncode != 0:
+        return Result.Kind.ERROR
+    result_kind = Result.Kind.ERROR
+    for line in output.splitlines():
+        line = line.strip()
+        if line == b"sat":
+            result_kind = Result.Kind.NOT_EQUAL
+        elif line == b"unsat":
+            result_kind = Result.Kind.EQUAL
+        elif line == b"unknown":
+            result_kind = Result.Kind.UNKNOWN
+    return result_kind
+
+
+def _combine_z3_results(kinds, timed_out):
+    """
+    Combine results of the solvers from the portfolio into a single result.
+    A definite answer (EQUAL or NOT_EQUAL) takes priority, followed by
+    UNKNOWN, TIMEOUT (if some solver did not finish in time), and ERROR.
+    :param kinds: Kinds of results of the solvers that finished.
+    :param timed_out: True if some solver did not finish in time.
+    :return Kind of the combined result.
+    """
+    for kind in [Result.Kind.EQUAL, Result.Kind.NOT_EQUAL,
+                 Result.Kind.UNKNOWN]:
+        if kind in kinds:
+            return kind
+    return Result.Kind.TIMEOUT if timed_out else Result.Kind.ERROR
+
+
+def _run_z3_portfolio(formula, timeout, stderr):
+    """
+    Solve the formula by running all configurations of Z3 from the portfolio
+    concurrently. As soon as one of the solvers gives a definite answer (sat
+    or unsat), the other ones are killed.
+    :param formula: Formula to solve (in the SMT-LIB format).
+    :param timeout: Timeout for the solvers in seconds.
+    :param stderr: Where to redirect the error output of the solvers.
+    :return Kind of the result.
+    """
+    processes = [Popen(["z3"] + options + ["-in"],
+                       stdin=PIPE, stdout=PIPE, stderr=stderr)
+                 for options in z3_portfolio]
+    kinds = []
+    timed_out = False
+    with ThreadPoolExecutor(max_workers=len(processes)) as executor:
+        pending = {executor.submit(_z3_result_kind, p, formula)
+                   for p in processes}
+        deadline = time.monotonic() + timeout
+        try:
+            while pending:
+                done, pending = wait(
+                    pending, timeout=max(deadline - time.monotonic(), 0),
+                    return_when=FIRST_COMPLETED)
+                if not done:
+                    timed_out = True
+                    break
+                kinds.extend(f.result() for f in done)
+                if Result.Kind.EQUAL in kinds or \
+                        Result.Kind.NOT_EQUAL in kinds:
+                    break
+        finally:
+            _kill(processes)
+    return _combine_z3_results(kinds, timed_out)
+
+
 def _run_llreve_z3(first, second, funFirst, funSecond, coupled, timeout,
                    verbose):
     """
     Run the comparison of semantics of two functions using the llreve tool and
     the Z3 SMT solver. The llreve tool takes compared functions in LLVM IR and
     generates a formula in first-order predicate logic. The formula is then
-    solved using the Z3 solver. If it is unsatisfiable, the compared functions
-    are semantically the same, otherwise, they are different.
+    solved by a portfolio of Z3 configurations. If it is unsatisfiable, the
+    compared functions are semantically the same, otherwise, they are
+    different.
 
     The generated formula is in the theory of bitvectors.
 
@@ -71,9 +162,9 @@ def _run_llreve_z3(first, second, funFirst, funSecond, coupled, timeout,
 
     stderr = None
     if not verbose:
-        stderr = open('/dev/null', 'w')
+        stderr = DEVNULL
 
-    # Commands for running llreve and Z3 (output of llreve is piped into Z3)
+    # Command for running llreve (its output is passed to Z3)
     command = ["build/llreve/reve/reve/llreve",
                first, second,
                "--fun=" + funFirst + "," + funSecond,
@@ -85,56 +176,146 @@ def _run_llreve_z3(first, second, funFirst, funSecond, coupled, timeout,
     if verbose:
         sys.stderr.write(" ".join(command) + "\n")
 
+    # The timeout applies to both tools
+    start = time.monotonic()
     llreve_process = Popen(command, stdout=PIPE, stderr=stderr)
+    try:
+        formula, _ = llreve_process.communicate(timeout=timeout)
+    except TimeoutExpired:
+        _kill([llreve_process])
+        llreve_process.wait()
+        return Result(Result.Kind.TIMEOUT, first, second)
+    if llreve_process.returncode != 0:
+        return Result(Result.Kind.ERROR, first, second)
 
-    z3_process = Popen(["z3", "fixedpoint.engine=duality", "-in"],
-                       stdin=llreve_process.stdout,
-                       stdout=PIPE, stderr=stderr)
+    remaining = timeout - (time.monotonic() - start)
+    if remaining <= 0:
+        return Result(Result.Kind.TIMEOUT, first, second)
+    return Result(_run_z3_portfolio(formula, remaining, stderr),
+                  first, second)
 
-    # Set timeout for both tools
-    timer = Timer(timeout, _kill, [[llreve_process, z3_process]])
-    try:
-        timer.start()
-
-        z3_process.wait()
-        result_kind = Result.Kind.ERROR
-        # Processing the output
-        for line in z3_process.stdout:
-            line = line.strip()
-            if line == b"sat":
-                result_kind = Result.Kind.NOT_EQUAL
-            elif line == b"unsat":
-                result_kind = Result.Kind.EQUAL
-            elif line == b"unknown":
-                result_kind = Result.Kind.UNKNOWN
-
-        if z3_process.returncode != 0:
-            result_kind = Result.Kind.ERROR
-    finally:
-        if not timer.is_alive():
-            result_kind = Result.Kind.TIMEOUT
-        timer.cancel()
-
-    return Result(result_kind, first, second)
-
-
-def functions_semdiff(first, second, fun_first, fun_second, config):
+
+# Definitions parsed from LLVM files, indexed by paths. Each entry is a pair
+# of the modification time (and size) of the file and of the definitions.
+_llvm_definitions_cache = dict()
+
+
+def _llvm_definitions(llvm_file):
     """
-    Compare two functions for semantic equality.
+    Get texts of all function definitions and of all named type definitions
+    from a file with an LLVM module. Each file is parsed once, the result is
+    reused until the file is modified.
+    :return Pair of a dictionary mapping function names to their definitions
+            and of a list of type definitions.
+    """
+    path = os.path.abspath(llvm_file)
+    stat = os.stat(path)
+    stamp = (stat.st_mtime_ns, stat.st_size)
+    cached = _llvm_definitions_cache.get(path)
+    if cached is None or cached[0] != stamp:
+        cached = (stamp, _parse_llvm_definitions(path))
+        _llvm_definitions_cache[path] = cached
+    return cached[1]
+
+
+def _parse_llvm_definitions(llvm_file):
+    """Parse definitions from an LLVM file (see _llvm_definitions)."""
+    functions = dict()
+    types = []
+    with open(llvm_file, "r", errors="ignore") as llvm:
+        name = None
+        for line in llvm:
+            if name is not None:
+                functions[name].append(line)
+                if line.startswith("}"):
+                    name = None
+            elif line.startswith("define "):
+                match = _function_def.match(line)
+                if match:
+                    name = match.group(1)
+                    functions[name] = [line]
+            elif line.startswith("%") and " = type " in line:
+                types.append(line)
+    return {n: "".join(d) for n, d in functions.items()}, types
+
+
+def _semdiff_digest(first, second, fun_first, fun_second, called_first,
+                    called_second, coupled):
+    """
+    Compute a digest of a simplified function pair that identifies the semantic
+    comparison. It covers definitions of both functions, of all functions that
+    they (recursively) call, type definitions, and the function couplings.
+    """
+    digest = hashlib.sha256()
+    for llvm, fun, called in [(first, fun_first, called_first),
+                              (second, fun_second, called_second)]:
+        functions, types = _llvm_definitions(llvm)
+        digest.update(fun.encode("utf-8") + b"\0")
+        for name in [fun] + sorted(called - {fun}):
+            digest.update(functions.get(name, name).encode("utf-8") + b"\0")
+        for type_def in types:
+            digest.update(type_def.encode("utf-8"))
+        digest.update(b"\0")
+    for c in coupled:
+        digest.update("{},{}\0".format(c[0], c[1]).encode("utf-8"))
+    for options in z3_portfolio:
+        digest.update(" ".join(options).encode("utf-8") + b"\0")
+    return digest.hexdigest()
 
-    Functions are compared under various assumptions, each having some
-    'assumption level'. The higher the level is, the more strong assumption has
-    been made. Level 0 indicates no assumption. These levels are determined
-    from differences of coupled functions that are set as a parameter of the
-    analysis. The analysis tries all assumption levels in increasing manner
-    until functions are proven to be equal or no assumptions remain.
 
+def functions_semdiff_parallel(first, second, fun_pairs, config):
+    """
+    Compare multiple pairs of functions for semantic equality. The pairs are
+    compared concurrently using at most config.semdiff_jobs workers. Results
+    are cached in config.semdiff_cache using a digest of the simplified
+    function pair, hence each distinct pair is analysed only once.
     :param first: File with the first LLVM module
     :param second: File with the second LLVM module
-    :param fun_first: Function from the first module to be compared
-    :param fun_second: Function from the second module to be compared
+    :param fun_pairs: List of pairs of function names to compare.
     :param config: Configuration.
+    :return Dictionary mapping function pairs to results of the comparison.
     """
+    results = dict()
+    if config.semdiff_tool != "llreve":
+        return results
+
+    # Collect couplings and digests of the compared pairs. This is done
+    # sequentially since parsing of LLVM modules is not thread-safe.
+    tasks = dict()
+    for fun_first, fun_second in fun_pairs:
+        if (fun_first, fun_second) in tasks:
+            continue
+        called_first = first.get_functions_called_by(fun_first)
+        called_second = second.get_functions_called_by(fun_second)
+        called_couplings = [(f, s) for f in called_first for s in called_second
+                            if f == s]
+        digest = _semdiff_digest(first.llvm, second.llvm,
+                                 fun_first, fun_second,
+                                 called_first, called_second,
+                                 called_couplings)
+        tasks[(fun_first, fun_second)] = (called_couplings, digest)
+    first.clean_module()
+    second.clean_module()
+
+    futures = dict()
+    with ThreadPoolExecutor(max_workers=config.semdiff_jobs) as executor:
+        for (fun_first, fun_second), (coupled, digest) in tasks.items():
+            if digest in config.semdiff_cache or digest in futures:
+                continue
+            futures[digest] = executor.submit(
+                _run_llreve_z3, first.llvm, second.llvm, fun_first,
+                fun_second, coupled, config.timeout, config.verbosity)
+
+        for fun_pair, (_, digest) in tasks.items():
+            if digest not in config.semdiff_cache:
+                config.semdiff_cache[digest] = futures[digest].result().kind
+            results[fun_pair] = Result(config.semdiff_cache[digest],
+                                       first.llvm, second.llvm)
+    return results
+
+
+def _print_semdiff(fun_first, fun_second):
+    """Print that semantic diff of the given functions is performed."""
     if fun_first == fun_second:
         fun_str = fun_first
     else:
@@ -143,18 +324,65 @@ def functions_semdiff(first, second, fun_first, fun_second, config):
     sys.stdout.write("...")
     sys.stdout.flush()
 
-    # Run the actual analysis
-    if config.semdiff_tool == "llreve":
-        called_first = first.get_functions_called_by(fun_first)
-        called_second = second.get_functions_called_by(fun_second)
-        called_couplings = [(f, s) for f in called_first for s in called_second
-                            if f == s]
-        result = _run_llreve_z3(first.llvm, second.llvm, fun_first, fun_second,
-                                called_couplings, config.timeout,
-                                config.verbosity)
-        first.clean_module()
-        second.clean_module()
-        return result
+
+def _simplify(mod_first, mod_second, fun_first, fun_second, glob_var,
+              function_cache, config, symbol_index_first, symbol_index_second,
+              share_vars):
+    """
+    Simplify the modules using SimpLL.
+    If share_vars is set and there are other global variables w.r.t. which the
+    same function pair is to be compared (registered in
+    config.simpll_pending_vars), all the variables are handled by a single run
+    of SimpLL and the results for the other variables are kept for later use.
+    The cache can be used for all the variables since only the compared
+    functions are sliced w.r.t. the variables, hence the cached results for
+    the called functions do not depend on the variable.
+    :return Tuple in the format returned by run_simpll.
+    """
+    var = glob_var.name if glob_var else None
+    key = (mod_first.llvm, mod_second.llvm, fun_first, fun_second)
+    if share_vars and var is not None:
+        if key + (var,) in config.simpll_var_results:
+            return config.simpll_var_results.pop(key + (var,))
+        pending = config.simpll_pending_vars.get(key, set())
+        pending.discard(var)
+        if pending:
+            variables = [var] + sorted(pending)
+            pending.clear()
+            results = run_simpll_vars(
+                first=mod_first.llvm, second=mod_second.llvm,
+                fun_first=fun_first, fun_second=fun_second,
+                variables=variables,
+                cache_dir=function_cache.directory
+                if function_cache else None,
+                control_flow_only=config.control_flow_only,
+                output_llvm_ir=config.output_llvm_ir,
+                print_asm_diffs=config.print_asm_diffs,
+                verbose=config.verbosity,
+                use_ffi=config.use_ffi,
+                symbol_index_first=symbol_index_first,
+                symbol_index_second=symbol_index_second,
+                memory_limit=config.simpll_memory_limit,
+                inline_wrappers=config.simpll_inline_wrappers)
+            for other_var in variables[1:]:
+                config.simpll_var_results[key + (other_var,)] = \
+                    results[other_var]
+            return results[var]
+
+    return run_simpll(first=mod_first.llvm, second=mod_second.llvm,
+                      fun_first=fun_first, fun_second=fun_second,
+                      var=var, suffix=var if var else "simpl",
+                      cache_dir=function_cache.directory
+                      if function_cache else None,
+                      control_flow_only=config.control_flow_only,
+                      output_llvm_ir=config.output_llvm_ir,
+                      print_asm_diffs=config.print_asm_diffs,
+                      verbose=config.verbosity,
+                      use_ffi=config.use_ffi,
+                      symbol_index_first=symbol_index_first,
+                      symbol_index_second=symbol_index_second,
+                      memory_limit=config.simpll_memory_limit,
+                      inline_wrappers=config.simpll_inline_wrappers)
 
 
 def functions_diff(mod_first, mod_second,
@@ -191,7 +419,13 @@ def functions_diff(mod_first, mod_second,
             print("Syntactic diff of {} (in {})".format(fun_str,
                                                         mod_first.llvm))
 
+        # Indices of symbol definitions allowing SimpLL to link missing
+        # definitions by itself
+        symbol_index_first = config.snapshot_first.symbol_index()
+        symbol_index_second = config.snapshot_second.symbol_index()
+
         simplify = True
+        linked = False
         while simplify:
             simplify = False
             if (prev_result_graph and
@@ -203,22 +437,18 @@ def functions_diff(mod_first, mod_second,
                 curr_result_graph = prev_result_graph
             else:
                 # Simplify modules and get the output graph.
+                # Results for other variables can be shared only if the
+                # modules were not changed by linking.
                 first_simpl, second_simpl, curr_result_graph, missing_defs = \
-                    run_simpll(first=mod_first.llvm, second=mod_second.llvm,
-                               fun_first=fun_first, fun_second=fun_second,
-                               var=glob_var.name if glob_var else None,
-                               suffix=glob_var.name if glob_var else "simpl",
-                               cache_dir=function_cache.directory
-                               if function_cache else None,
-                               control_flow_only=config.control_flow_only,
-                               output_llvm_ir=config.output_llvm_ir,
-                               print_asm_diffs=config.print_asm_diffs,
-                               verbose=config.verbosity,
-                               use_ffi=config.use_ffi)
+                    _simplify(mod_first, mod_second, fun_first, fun_second,
+                              glob_var, function_cache, config,
+                              symbol_index_first, symbol_index_second,
+                              share_vars=not linked)
                 if missing_defs:
-                    # If there are missing function definitions, try to find
-                    # their implementation, link them to the current modules,
-                    # and rerun the simplification.
+                    # If there are missing function definitions that SimpLL
+                    # could not link by itself, try to find their
+                    # implementation, link them to the current modules, and
+                    # rerun the simplification.
                     for fun_pair in missing_defs:
                         if "first" in fun_pair:
                             if _link_symbol_def(config.snapshot_first,
@@ -231,6 +461,7 @@ def functions_diff(mod_first, mod_second,
                                                 mod_second,
                                                 fun_pair["second"]):
                                 simplify = True
+                    linked = linked or simplify
                 if prev_result_graph and not simplify:
                     # Note: "curr_result_graph" is here the partial result
                     # graph, i.e. can contain unknown results that are known in
@@ -259,15 +490,23 @@ def functions_diff(mod_first, mod_second,
         else:
             # If the functions are not syntactically equal, objects_to_compare
             # contains a list of functions and macros that are different.
+            # If a semantic diff tool is set, use it for further comparison of
+            # non-equal functions. All pairs are compared at once so that the
+            # analyses can run in parallel.
+            semdiff_results = dict()
+            if config.semdiff_tool is not None:
+                semdiff_results = functions_semdiff_parallel(
+                    first_simpl, second_simpl,
+                    [(fun_pair[0].name, fun_pair[1].name)
+                     for fun_pair in objects_to_compare
+                     if not fun_pair[0].diff_kind == "function"],
+                    config)
             for fun_pair in objects_to_compare:
                 if (not fun_pair[0].diff_kind == "function" and
                         config.semdiff_tool is not None):
-                    # If a semantic diff tool is set, use it for further
-                    # comparison of non-equal functions
-                    fun_result = functions_semdiff(first_simpl, second_simpl,
-                                                   fun_pair[0].name,
-                                                   fun_pair[1].name,
-                                                   config)
+                    _print_semdiff(fun_pair[0].name, fun_pair[1].name)
+                    fun_result = semdiff_results[(fun_pair[0].name,
+                                                  fun_pair[1].name)]
                 else:
                     fun_result = Result(fun_pair[2], fun_first, fun_second)
                 fun_result.first = fun_pair[0]
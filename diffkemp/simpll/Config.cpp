@@ -25,10 +25,13 @@ cl::opt<std::string>
 cl::opt<std::string> FunctionOpt("fun",
                                  cl::value_desc("function"),
                                  cl::desc("Specify function to be analysed"));
-cl::opt<std::string> VariableOpt(
+cl::list<std::string> VariableOpt(
         "var",
+        cl::CommaSeparated,
         cl::value_desc("variable"),
-        cl::desc("Do analysis w.r.t. the value of the given variable"));
+        cl::desc("Do analysis w.r.t. the value of the given variable. If "
+                 "multiple comma-separated variables are given, the analysis "
+                 "is done for each of them."));
 cl::opt<bool> OutputLlvmIROpt(
         "output-llvm-ir",
         cl::value_desc("Output each simplified module to a file."));
@@ -40,6 +43,16 @@ cl::opt<std::string> CacheDirOpt(
         "cache-dir",
         cl::value_desc("cache-dir"),
         cl::desc("Directory containing a SimpLL cache generated by DiffKemp."));
+cl::opt<std::string> FirstSymbolIndexOpt(
+        "first-symbol-index",
+        cl::value_desc("file"),
+        cl::desc("Index of symbol definitions used to link missing "
+                 "definitions into the first module."));
+cl::opt<std::string> SecondSymbolIndexOpt(
+        "second-symbol-index",
+        cl::value_desc("file"),
+        cl::desc("Index of symbol definitions used to link missing "
+                 "definitions into the second module."));
 cl::opt<bool> ControlFlowOpt(
         "control-flow",
         cl::desc("Only keep instructions related to the control-flow."));
@@ -56,6 +69,31 @@ cl::opt<bool> PrintAsmDiffsOpt(
         "print-asm-diffs",
         cl::desc("Print raw differences in inline assembly code "
                  "(does not apply to macros)."));
+cl::opt<unsigned> MemoryLimitOpt(
+        "memory-limit",
+        cl::value_desc("MiB"),
+        cl::desc("Limit of the memory used by the comparison. Caches are "
+                 "dropped when the limit is reached, the comparison is stopped "
+                 "if it is exceeded anyway."));
+cl::opt<unsigned> InlineWrappersOpt(
+        "inline-wrappers",
+        cl::value_desc("instructions"),
+        cl::desc("Inline simple wrappers with at most the given number of "
+                 "instructions that are called from one of the compared "
+                 "functions only before comparing the functions."));
+cl::opt<bool> BottomUpOpt(
+        "bottom-up",
+        cl::init(true),
+        cl::desc("When comparing whole modules, compare functions bottom-up "
+                 "along the call graphs of both modules, so that results of "
+                 "callees are reused by their callers (enabled by default, "
+                 "use --bottom-up=false to compare the functions in the order "
+                 "of the first module)."));
+cl::opt<bool> UnfusedPreprocessingOpt(
+        "unfused-preprocessing",
+        cl::Hidden,
+        cl::desc("Run the preprocessing transformations as separate passes "
+                 "(for verification of the fused preprocessing)."));
 
 /// Add suffix to the file name.
 /// \param File Original file name.
@@ -72,7 +110,10 @@ Config::Config()
           Second(parseIRFile(SecondFileOpt, err, context_second)),
           FirstOutFile(FirstFileOpt), SecondOutFile(SecondFileOpt),
           OutputLlvmIR(OutputLlvmIROpt), ControlFlowOnly(ControlFlowOpt),
-          PrintAsmDiffs(PrintAsmDiffsOpt), PrintCallStacks(PrintCallstacksOpt) {
+          PrintAsmDiffs(PrintAsmDiffsOpt), PrintCallStacks(PrintCallstacksOpt),
+          InlineWrappersLimit(InlineWrappersOpt),
+          FusedPreprocessing(!UnfusedPreprocessingOpt),
+          BottomUpOrder(BottomUpOpt) {
     if (!FunctionOpt.empty()) {
         // Parse --fun option - find functions with given names.
         // The option can be either single function name (same for both modules)
@@ -93,8 +134,11 @@ Config::Config()
     }
     if (!VariableOpt.empty()) {
         // Parse --var option - find global variables with given name.
-        FirstVar = First->getGlobalVariable(VariableOpt, true);
-        SecondVar = Second->getGlobalVariable(VariableOpt, true);
+        // For multiple variables, the global variables are looked up when
+        // analysing each of them.
+        Variables.assign(VariableOpt.begin(), VariableOpt.end());
+        if (Variables.size() == 1)
+            setVariable(Variables.front());
     }
     if (!SuffixOpt.empty()) {
         // Parse --suffix option - add suffix to the names of output files.
@@ -105,6 +149,9 @@ Config::Config()
         // Parse --cache-dir option - directory with cache diles from DiffKemp.
         CacheDir = CacheDirOpt;
     }
+    FirstSymbolIndex = FirstSymbolIndexOpt;
+    SecondSymbolIndex = SecondSymbolIndexOpt;
+    Memory.setLimit(uint64_t(MemoryLimitOpt) << 20);
 
     std::vector<std::string> debugTypes;
     if (VerboseOpt) {
@@ -140,26 +187,36 @@ Config::Config(std::string FirstFunName,
                std::string FirstOutFile,
                std::string SecondOutFile,
                std::string CacheDir,
-               std::string Variable,
+               std::string VariableList,
                bool OutputLlvmIR,
                bool ControlFlowOnly,
                bool PrintAsmDiffs,
                bool PrintCallStacks,
                bool Verbose,
-               bool VerboseMacros)
+               bool VerboseMacros,
+               std::string FirstSymbolIndex,
+               std::string SecondSymbolIndex,
+               unsigned MemoryLimit,
+               unsigned InlineWrappersLimit)
         : First(parseIRFile(FirstModule, err, context_first)),
           Second(parseIRFile(SecondModule, err, context_second)),
           FirstFunName(FirstFunName), SecondFunName(SecondFunName),
           FirstOutFile(FirstOutFile), SecondOutFile(SecondOutFile),
-          CacheDir(CacheDir), OutputLlvmIR(OutputLlvmIR),
+          CacheDir(CacheDir), FirstSymbolIndex(FirstSymbolIndex),
+          SecondSymbolIndex(SecondSymbolIndex), OutputLlvmIR(OutputLlvmIR),
           ControlFlowOnly(ControlFlowOnly), PrintAsmDiffs(PrintAsmDiffs),
-          PrintCallStacks(PrintCallStacks) {
+          PrintCallStacks(PrintCallStacks),
+          InlineWrappersLimit(InlineWrappersLimit) {
     refreshFunctions();
+    Memory.setLimit(uint64_t(MemoryLimit) << 20);
 
-    if (!Variable.empty()) {
-        FirstVar = First->getGlobalVariable(Variable, true);
-        SecondVar = Second->getGlobalVariable(Variable, true);
-    }
+    // Variables are given as a comma-separated list.
+    SmallVector<StringRef, 4> VariableNames;
+    StringRef(VariableList).split(VariableNames, ',', -1, false);
+    for (auto &Name : VariableNames)
+        Variables.push_back(Name.str());
+    if (Variables.size() == 1)
+        setVariable(Variables.front());
 
     std::vector<std::string> debugTypes;
     if (Verbose) {
@@ -177,3 +234,8 @@ void Config::refreshFunctions() {
     FirstFun = First->getFunction(FirstFunName);
     SecondFun = Second->getFunction(SecondFunName);
 }
+
+void Config::setVariable(const std::string &Name) {
+    FirstVar = Name.empty() ? nullptr : First->getGlobalVariable(Name, true);
+    SecondVar = Name.empty() ? nullptr : Second->getGlobalVariable(Name, true);
+}
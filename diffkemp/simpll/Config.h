@@ -15,6 +15,7 @@
 #ifndef DIFFKEMP_SIMPLL_CONFIG_H
 #define DIFFKEMP_SIMPLL_CONFIG_H
 
+#include "MemoryUsage.h"
 #include "llvm/Support/CommandLine.h"
 #include <llvm/IR/Module.h>
 #include <llvm/IRReader/IRReader.h>
@@ -29,12 +30,16 @@ using namespace llvm;
 extern cl::opt<std::string> FirstFileOpt;
 extern cl::opt<std::string> SecondFileOpt;
 extern cl::opt<std::string> FunctionOpt;
-extern cl::opt<std::string> VariableOpt;
+extern cl::list<std::string> VariableOpt;
 extern cl::opt<std::string> SuffixOpt;
 extern cl::opt<bool> ControlFlowOpt;
 extern cl::opt<bool> PrintCallstacksOpt;
 extern cl::opt<bool> VerboseOpt;
 extern cl::opt<bool> VerboseMacrosOpt;
+extern cl::opt<unsigned> MemoryLimitOpt;
+extern cl::opt<unsigned> InlineWrappersOpt;
+extern cl::opt<bool> BottomUpOpt;
+extern cl::opt<bool> UnfusedPreprocessingOpt;
 
 /// Tool configuration parsed from CLI options.
 class Config {
@@ -56,11 +61,17 @@ class Config {
     // Compared global variables
     GlobalVariable *FirstVar = nullptr;
     GlobalVariable *SecondVar = nullptr;
+    // Names of all global variables w.r.t. whose values the modules are
+    // compared. If there are multiple, each one is analysed separately.
+    std::vector<std::string> Variables;
     // Output files
     std::string FirstOutFile;
     std::string SecondOutFile;
     // Cache file directory.
     std::string CacheDir;
+    // Indices of symbol definitions used to link missing definitions.
+    std::string FirstSymbolIndex;
+    std::string SecondSymbolIndex;
 
     // Save the simplified IR of the module to a file.
     bool OutputLlvmIR;
@@ -70,6 +81,18 @@ class Config {
     bool PrintAsmDiffs;
     // Show call stacks for non-equal functions
     bool PrintCallStacks;
+    // Maximal number of instructions of simple wrappers that are inlined
+    // before comparing functions (0 disables the inlining).
+    unsigned InlineWrappersLimit = 0;
+    // Run the preprocessing transformations in a single walk (the separate
+    // passes are kept for verification).
+    bool FusedPreprocessing = true;
+    // When comparing whole modules, compare callees before their callers.
+    bool BottomUpOrder = true;
+
+    // Accounting of the memory used by the comparison (including the memory
+    // limit). It is updated during the comparison which gets a const config.
+    mutable MemoryAccounting Memory;
 
     // Constructor for command-line use.
     Config();
@@ -81,13 +104,17 @@ class Config {
            std::string FirstOutFile,
            std::string SecondOutFile,
            std::string CacheDir,
-           std::string Variable = "",
+           std::string VariableList = "",
            bool OutputLlvmIR = false,
            bool ControlFlowOnly = false,
            bool PrintAsmDiffs = true,
            bool PrintCallStacks = true,
            bool Verbose = false,
-           bool VerboseMacros = false);
+           bool VerboseMacros = false,
+           std::string FirstSymbolIndex = "",
+           std::string SecondSymbolIndex = "",
+           unsigned MemoryLimit = 0,
+           unsigned InlineWrappersLimit = 0);
     // Constructor without module loading (for tests).
     Config(std::string FirstFunName,
            std::string SecondFunName,
@@ -105,6 +132,13 @@ class Config {
     void setDebugTypes(std::vector<std::string> &debugTypes);
 
     void refreshFunctions();
+
+    /// Set the compared global variables to the variables with the given name
+    /// (or to null if the name is empty).
+    void setVariable(const std::string &Name);
 };
 
+/// Add suffix to the file name.
+std::string addSuffix(std::string File, std::string Suffix);
+
 #endif // DIFFKEMP_SIMPLL_CONFIG_H
@@ -57,200 +57,79 @@ std::string getStructTypeName(const StructType *type) {
     return name;
 }
 
+/// Get debug info for struct type with given name. The types of both modules
+/// are indexed by their names lazily.
 DICompositeType *DebugInfo::getStructTypeInfo(const StringRef name,
                                               const Program prog) const {
-    auto types = prog == Program::First ? DebugInfoFirst.types()
-                                        : DebugInfoSecond.types();
-
-    for (auto Type : types) {
-        if (auto StructType = dyn_cast<DICompositeType>(Type)) {
-            if (StructType->getName() == name)
-                return StructType;
-        }
-    }
-    return nullptr;
+    return prog == Program::First ? StructTypesFirst.lookup(name)
+                                  : StructTypesSecond.lookup(name);
 }
 
-/// Calculate alignments of the corresponding indices for one GEP
-/// instruction.
-void DebugInfo::extractAlignmentFromInstructions(GetElementPtrInst *GEP,
-                                                 GetElementPtrInst *OtherGEP) {
-    if (GEP) {
-        std::vector<Value *> indices;
-        std::vector<Value *> indicesOther;
-
-        User::op_iterator idx_other;
-        if (OtherGEP)
-            // If we have the other GEP, iterate over its indices, too
-            idx_other = OtherGEP->idx_begin();
-
-        // Iterate all indices
-        for (auto idx = GEP->idx_begin(); idx != GEP->idx_end();
-             ++idx, indices.push_back(*idx)) {
-            auto indexedType = GEP->getIndexedType(GEP->getSourceElementType(),
-                                                   ArrayRef<Value *>(indices));
-
-            Type *indexedTypeOther = nullptr;
-            if (OtherGEP)
-                indexedTypeOther = OtherGEP->getIndexedType(
-                        OtherGEP->getSourceElementType(),
-                        ArrayRef<Value *>(indicesOther));
-
-            if (!indexedType->isStructTy())
-                continue;
-
-            if (indexedTypeOther && !indexedTypeOther->isStructTy()) {
-                // The type in the corresponding GEP instruction is different,
-                // therefore it cannot be used
-                indexedTypeOther = nullptr;
-            }
-
-            auto &indexMap = IndexMaps[dyn_cast<StructType>(indexedType)];
-
-            if (auto IndexConstant = dyn_cast<ConstantInt>(*idx)) {
-                // Numeric value of the current index
-                uint64_t indexFirst = IndexConstant->getZExtValue();
-
-                // Check if the corresponding index already exists
-                auto otherIndex = indexMap.find(indexFirst);
-                if (otherIndex != indexMap.end()) {
-                    if (indexFirst != otherIndex->second) {
-                        setNewAlignmentOfIndex(*GEP,
-                                               indices.size(),
-                                               otherIndex->second,
-                                               IndexConstant->getBitWidth(),
-                                               ModFirst.getContext());
-                    }
-                    continue;
-                }
-
-                indexMap.emplace(indexFirst, indexFirst);
-
-                // Name of the current type (type being indexed)
-                if (!dyn_cast<StructType>(indexedType)->hasName())
-                    continue;
-                std::string typeName =
-                        getStructTypeName(dyn_cast<StructType>(indexedType));
-
-                // Get name of the element at the current index in
-                // the first module
-                auto TypeDIFirst = getStructTypeInfo(typeName, Program::First);
-                if (!TypeDIFirst)
-                    continue;
-
-                StringRef elementName =
-                        getElementNameAtIndex(*TypeDIFirst, indexFirst);
-
-                // Find index of the element with the same name in
-                // the second module
-                auto TypeDISecond =
-                        getStructTypeInfo(typeName, Program::Second);
-                if (!TypeDISecond)
-                    continue;
-
-                int indexSecond =
-                        getTypeMemberIndex(*TypeDISecond, elementName);
-
-                if (indexSecond > 0) {
-                    if (indexFirst != indexSecond) {
-                        // If indices do not match, align the first one to
-                        // be the same as the second one
-                        indexMap.at(indexFirst) = (unsigned)indexSecond;
-                        setNewAlignmentOfIndex(*GEP,
-                                               indices.size(),
-                                               (unsigned)indexSecond,
-                                               IndexConstant->getBitWidth(),
-                                               ModFirst.getContext());
-                        DEBUG_WITH_TYPE(
-                                DEBUG_SIMPLL,
-                                dbgs() << "Index alignment in:" << *GEP << "\n"
-                                       << "                     " << indexFirst
-                                       << " -> " << indexSecond << "\n");
-                    }
-                    // Insert the names of the indices into StructFieldNames.
-                    StructFieldNames.insert(
-                            {{dyn_cast<StructType>(indexedType), indexFirst},
-                             elementName});
-
-                    if (indexedTypeOther)
-                        StructFieldNames.insert(
-                                {{dyn_cast<StructType>(indexedTypeOther),
-                                  indexSecond},
-                                 elementName});
-                    else
-                        StructFieldNames.insert(
-                                {{ModSecond.getTypeByName(
-                                          indexedType->getStructName()),
-                                  indexSecond},
-                                 elementName});
-                }
-            }
+/// Match the fields of the struct types by their names in the debug info.
+/// For each field of the first type, the index of the field with the same
+/// name in the second type is found and the name is stored for both indices
+/// into StructFieldNames.
+void DebugInfo::alignStructFields(StructType *TypeFirst,
+                                  StructType *TypeSecond) const {
+    if (!AlignedStructs.insert({TypeFirst, TypeSecond}).second)
+        return;
 
-            if (OtherGEP && idx_other != OtherGEP->idx_end()) {
-                indicesOther.push_back(*idx_other);
-                ++idx_other;
-            }
-        }
-    }
-}
+    if (!TypeFirst->hasName() || !TypeSecond->hasName())
+        return;
+    std::string typeName = getStructTypeName(TypeFirst);
+    if (typeName != getStructTypeName(TypeSecond))
+        return;
 
-/// For each GEP instruction, check if the accessed struct members of
-/// the same name have the same alignment in both modules. If not, add
-/// metadata to the instruction of one module containing new value of
-/// the alignment
-void DebugInfo::calculateGEPIndexAlignments() {
-    // Check if any debug info was collected
-    if (DebugInfoFirst.type_count() == 0 || DebugInfoSecond.type_count() == 0)
+    auto TypeDIFirst = getStructTypeInfo(typeName, Program::First);
+    auto TypeDISecond = getStructTypeInfo(typeName, Program::Second);
+    if (!TypeDIFirst || !TypeDISecond)
         return;
 
-    for (auto &Fun : ModFirst) {
-        auto OtherFun = ModSecond.getFunction(Fun.getName());
-        if (!OtherFun)
+    for (uint64_t indexFirst = 0; indexFirst < TypeFirst->getNumElements();
+         ++indexFirst) {
+        StringRef elementName =
+                getElementNameAtIndex(*TypeDIFirst, indexFirst);
+        if (elementName.empty())
             continue;
 
-        if (CalledFirst.find(&Fun) == CalledFirst.end())
+        int indexSecond = getTypeMemberIndex(*TypeDISecond, elementName);
+        if (indexSecond < 0)
             continue;
 
-        auto OtherBB = OtherFun->begin();
-        for (auto &BB : Fun) {
-            if (OtherBB != OtherFun->end()) {
-                // The other basic block is available; iterate over its
-                // instructions and try to find the corresponding GEP
-                // instructions
-                auto OtherInstr = OtherBB->begin();
-
-                for (auto &Instr : BB) {
-                    auto GEP = dyn_cast<GetElementPtrInst>(&Instr);
-
-                    if (OtherInstr != OtherBB->end()) {
-                        // The other instruction is available; try to get the
-                        // corresponding GEP instruction
-                        auto OtherGEP =
-                                dyn_cast<GetElementPtrInst>(&*OtherInstr);
-
-                        extractAlignmentFromInstructions(GEP, OtherGEP);
-
-                        ++OtherInstr;
-                    } else
-                        // The end of the basic block has been reached in the
-                        // other module, so the other GEP parameter can't be
-                        // used
-                        extractAlignmentFromInstructions(GEP, nullptr);
-                }
-
-                ++OtherBB;
-            } else {
-                // The other basic block is not available - iterate the
-                // standard way without instructions in the other module
-                for (auto &Instr : BB) {
-                    auto GEP = dyn_cast<GetElementPtrInst>(&Instr);
-                    extractAlignmentFromInstructions(GEP, nullptr);
-                }
-            }
-        }
+        if (indexFirst != (uint64_t)indexSecond)
+            DEBUG_WITH_TYPE(DEBUG_SIMPLL,
+                            dbgs() << "Index alignment in " << typeName << ": "
+                                   << indexFirst << " -> " << indexSecond
+                                   << "\n");
+        StructFieldNames.insert({{TypeFirst, indexFirst}, elementName});
+        StructFieldNames.insert({{TypeSecond, indexSecond}, elementName});
     }
 }
 
+/// Get the name of the struct field at the given index. Names of the fields
+/// matched by alignStructFields are taken from StructFieldNames, other names
+/// are taken from the debug info of the type with the same C name.
+StringRef DebugInfo::getStructFieldName(StructType *Type,
+                                        uint64_t Index,
+                                        Program Prog) const {
+    auto Aligned = StructFieldNames.find({Type, Index});
+    if (Aligned != StructFieldNames.end())
+        return Aligned->second;
+
+    if (!Type->hasName())
+        return "";
+    auto TypeDI = getStructTypeInfo(getStructTypeName(Type), Prog);
+    return TypeDI ? getElementNameAtIndex(*TypeDI, Index) : "";
+}
+
+/// Get the function corresponding to Fun in the second module. Uses the table
+/// of corresponding globals if available.
+Function *DebugInfo::getSecondFunction(Function &Fun) const {
+    if (Globals)
+        return Globals->getSecondFunction(&Fun);
+    return ModSecond.getFunction(Fun.getName());
+}
+
 /// Check if a struct element is at the same offset as the previous element. Th
 /// is can be determined by checking if the value of DIFlagBitField is different
 /// from the element offset.
@@ -320,18 +199,6 @@ StringRef DebugInfo::getElementNameAtIndex(const DICompositeType &type,
     return "";
 }
 
-/// Add metadata with the new offset to the GEP instruction
-void DebugInfo::setNewAlignmentOfIndex(GetElementPtrInst &GEP,
-                                       unsigned long index,
-                                       uint64_t alignment,
-                                       unsigned bitWidth,
-                                       LLVMContext &c) {
-    MDNode *MD = MDNode::get(c,
-                             ConstantAsMetadata::get(ConstantInt::get(
-                                     c, APInt(bitWidth, alignment, false))));
-    GEP.setMetadata("idx_align_" + std::to_string(index), MD);
-}
-
 /// Collects mappings of values for constants that are potentially generated
 /// from macros. It finds all used constants that correpond to some macro value
 /// in the first module and then finds values or given macros in the second
@@ -344,7 +211,7 @@ void DebugInfo::calculateMacroAlignments() {
     // Find all constants used in the first module whose values correspond to
     // some macro value.
     for (auto &Fun : ModFirst) {
-        if (!ModSecond.getFunction(Fun.getName()))
+        if (!getSecondFunction(Fun))
             continue;
         if (CalledFirst.find(&Fun) == CalledFirst.end())
             continue;
@@ -466,6 +333,50 @@ void DebugInfo::addAlignment(std::string MacroName, std::string MacroValue) {
     }
 }
 
+/// Estimate the memory taken by the debug info finder (in bytes). The finder
+/// keeps each found node in a vector and in a set.
+static uint64_t estimateMemory(const DebugInfoFinder &Finder) {
+    return sizeof(Finder)
+           + 2 * sizeof(void *)
+                     * (Finder.compile_unit_count()
+                        + Finder.global_variable_count()
+                        + Finder.subprogram_count() + Finder.type_count()
+                        + Finder.scope_count());
+}
+
+/// Node of a map contains (about) three pointers besides the value.
+static const uint64_t MapNodeSize = 3 * sizeof(void *);
+
+/// Estimate the memory taken by the debug info finders and by the maps built
+/// in the constructor (in bytes).
+uint64_t DebugInfo::estimateCollectedMemory() const {
+    uint64_t Bytes = estimateMemory(DebugInfoFirst)
+                     + estimateMemory(DebugInfoSecond);
+    for (auto &Macro : MacroConstantMap)
+        Bytes += MapNodeSize + sizeof(Macro) + Macro.second.capacity();
+    for (auto *Map : {&LocalVariableMapL, &LocalVariableMapR})
+        for (auto &Var : *Map)
+            Bytes += MapNodeSize + sizeof(Var) + Var.first.capacity();
+    for (auto &Usage : MacroUsageMap)
+        Bytes += MapNodeSize + sizeof(Usage) + Usage.first.capacity()
+                 + Usage.second.size() * (MapNodeSize + sizeof(void *));
+    return Bytes;
+}
+
+/// Estimate the memory taken by the maps built from the debug info and by the
+/// debug info finders (in bytes). The maps that grow during the comparison
+/// are only counted by their sizes, hence this is cheap enough to be called
+/// after each comparison of functions.
+uint64_t DebugInfo::getMemoryUsage() const {
+    return CollectedMemory + StructTypesFirst.getMemoryUsage()
+           + StructTypesSecond.getMemoryUsage()
+           + StructFieldNames.size()
+                     * (MapNodeSize + sizeof(StructFieldNamesMap::value_type))
+           + AlignedStructs.size()
+                     * (MapNodeSize
+                        + sizeof(std::pair<StructType *, StructType *>));
+}
+
 /// Remove calls to debug info intrinsics from all functions in the module.
 /// We do not use LLVM's stripDebugInfo functions here since they remove other
 /// information that we need later (particularly file names).
@@ -15,7 +15,10 @@
 #ifndef DIFFKEMP_SIMPLL_DEBUGINFO_H
 #define DIFFKEMP_SIMPLL_DEBUGINFO_H
 
+#include "GlobalCorrespondence.h"
 #include "Utils.h"
+#include "passes/StructureDebugInfoAnalysis.h"
+#include <llvm/ADT/StringMap.h>
 #include <llvm/IR/DebugInfo.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/PassManager.h>
@@ -27,11 +30,12 @@ using namespace llvm;
 
 /// Analysing debug info of the module and extracting useful information.
 /// The following information is extracted:
-/// 1. Alignment of GEP indices.
+/// 1. Names of structure fields.
 ///    In case the corresponding structure has a different set of fields between
 ///    the analysed modules, it might happen that corresponding fields are at
-///    different indices. This analysis matches fields with same name and saves
-///    the index offset into the metadata of a GEP instruction.
+///    different indices. Fields of a pair of structure types are matched by
+///    their names lazily, the first time the pair is compared. Names of
+///    fields of a single type can be looked up on demand.
 class DebugInfo {
   public:
     using StructFieldNamesMap =
@@ -41,25 +45,29 @@ class DebugInfo {
               Function *funFirst,
               Function *funSecond,
               std::set<const Function *> &CalledFirst,
-              std::set<const Function *> &CalledSecond)
+              std::set<const Function *> &CalledSecond,
+              const GlobalCorrespondence *Globals = nullptr)
             : FunFirst(funFirst), FunSecond(funSecond), ModFirst(modFirst),
               ModSecond(modSecond), CalledFirst(CalledFirst),
-              CalledSecond(CalledSecond) {
+              CalledSecond(CalledSecond), Globals(Globals) {
         DebugInfoFirst.processModule(ModFirst);
         DebugInfoSecond.processModule(ModSecond);
+        StructTypesFirst = StructDebugInfoIndex(DebugInfoFirst);
+        StructTypesSecond = StructDebugInfoIndex(DebugInfoSecond);
         // Use debug info to gather useful information
-        calculateGEPIndexAlignments();
         calculateMacroAlignments();
         collectLocalVariables(CalledFirst, LocalVariableMapL);
         collectLocalVariables(CalledSecond, LocalVariableMapR);
+        CollectedMemory = estimateCollectedMemory();
         // Remove calls to debug info intrinsics from the functions - it may
         // cause some non-equalities in FunctionComparator.
         removeFunctionsDebugInfo(modFirst);
         removeFunctionsDebugInfo(modSecond);
     };
 
-    /// Maps structure type and index to struct member names
-    StructFieldNamesMap StructFieldNames;
+    /// Maps structure type and index to struct member names. The map is
+    /// filled by alignStructFields.
+    mutable StructFieldNamesMap StructFieldNames;
 
     /// Maps constants potentially generated from a macro from the first module
     /// to corresponding values in the second module.
@@ -69,6 +77,24 @@ class DebugInfo {
     std::unordered_map<std::string, const Value *> LocalVariableMapL;
     std::unordered_map<std::string, const Value *> LocalVariableMapR;
 
+    /// Estimate the memory taken by the maps built from the debug info and by
+    /// the debug info finders (in bytes).
+    uint64_t getMemoryUsage() const;
+
+    /// Match the fields of the given structure types (from the first and
+    /// the second module, respectively) by their names in the debug info and
+    /// store the names into StructFieldNames. Each pair of types is only
+    /// processed once.
+    void alignStructFields(StructType *TypeFirst, StructType *TypeSecond) const;
+
+    /// Get the name of the field of the structure type from the given program
+    /// at the given index. Unlike StructFieldNames, this does not require the
+    /// field to be matched with a field of a type from the other program.
+    /// \return Name of the field or an empty string if it is unknown.
+    StringRef getStructFieldName(StructType *Type,
+                                 uint64_t Index,
+                                 Program Prog) const;
+
   private:
     Function *FunFirst;
     Function *FunSecond;
@@ -77,22 +103,32 @@ class DebugInfo {
     DebugInfoFinder DebugInfoFirst;
     DebugInfoFinder DebugInfoSecond;
     std::set<const Function *> &CalledFirst, &CalledSecond;
+    /// Table of corresponding globals (optional).
+    const GlobalCorrespondence *Globals;
 
-    /// Mapping struct types to index maps that contain pairs of corresponding
-    /// indices.
-    std::map<StructType *, std::map<uint64_t, uint64_t>> IndexMaps;
+    /// Pairs of struct types whose fields have already been aligned.
+    mutable std::set<std::pair<StructType *, StructType *>> AlignedStructs;
+
+    /// Debug info of struct types of each module indexed by the type name.
+    /// The indices are built lazily from the types found by the debug info
+    /// finders.
+    mutable StructDebugInfoIndex StructTypesFirst;
+    mutable StructDebugInfoIndex StructTypesSecond;
 
     /// Mapping macro names to the set of constants in the first module having
     /// the macro value.
     std::map<std::string, std::set<const Constant *>> MacroUsageMap;
 
-    /// Calculate alignments of the corresponding indices for one GEP
-    /// instruction.
-    void extractAlignmentFromInstructions(GetElementPtrInst *GEPL,
-                                          GetElementPtrInst *GEPR);
+    /// Estimate of the memory taken by the debug info finders and by the maps
+    /// built in the constructor.
+    uint64_t CollectedMemory = 0;
+
+    /// Estimate the memory taken by the debug info finders and by the maps
+    /// built in the constructor.
+    uint64_t estimateCollectedMemory() const;
 
-    /// Calculate alignments of the corresponding indices of GEP instructions.
-    void calculateGEPIndexAlignments();
+    /// Get the function corresponding to Fun in the second module.
+    Function *getSecondFunction(Function &Fun) const;
 
     /// Calculate alignments of the corresponding macros
     void calculateMacroAlignments();
@@ -129,18 +165,6 @@ class DebugInfo {
     static StringRef getElementNameAtIndex(const DICompositeType &type,
                                            uint64_t index);
 
-    /// Add metadata with the new offset to the GEP instruction
-    /// \param GEP GEP instruction.
-    /// \param index GEP instruction index.
-    /// \param alignment New alignment.
-    /// \param bitWidth Alignment bit width.
-    /// \param c LLVM context.
-    static void setNewAlignmentOfIndex(GetElementPtrInst &GEP,
-                                       unsigned long index,
-                                       uint64_t alignment,
-                                       unsigned bitWidth,
-                                       LLVMContext &c);
-
     /// Check if the struct element has the same index as the previous element
     /// (this situation may be caused by the compiler due to struct alignment).
     static bool isSameElemIndex(const DIDerivedType *TypeElem);
@@ -46,7 +46,8 @@ int DifferentialFunctionComparator::compare() {
 /// Compare GEPs. This code is copied from FunctionComparator::cmpGEPs since it
 /// was not possible to simply call the original function.
 /// Handles offset between matching GEP indices in the compared modules.
-/// Uses data saved in StructFieldNames.
+/// Uses data saved in StructFieldNames, the fields of each pair of indexed
+/// structure types are matched by their names when the pair is first met.
 int DifferentialFunctionComparator::cmpGEPs(const GEPOperator *GEPL,
                                             const GEPOperator *GEPR) const {
     int OriginalResult = FunctionComparator::cmpGEPs(GEPL, GEPR);
@@ -113,6 +114,8 @@ int DifferentialFunctionComparator::cmpGEPs(const GEPOperator *GEPL,
 
             // The indexed type is a structure type - compare the names of the
             // structure members from StructFieldNames.
+            DI->alignStructFields(dyn_cast<StructType>(ValueTypeL),
+                                  dyn_cast<StructType>(ValueTypeR));
             auto MemberNameL =
                     DI->StructFieldNames.find({dyn_cast<StructType>(ValueTypeL),
                                                NumericIndexL.getZExtValue()});
@@ -359,15 +362,8 @@ void DifferentialFunctionComparator::findTypeDifference(
                                                         : L->getName();
 
         // Try to get the debug info for the structure type.
-        DICompositeType *DCTyL = nullptr, *DCTyR = nullptr;
-        if (ModComparator->StructDIMapL.find(diff->name)
-            != ModComparator->StructDIMapL.end()) {
-            DCTyL = ModComparator->StructDIMapL[diff->name];
-        }
-        if (ModComparator->StructDIMapR.find(diff->name)
-            != ModComparator->StructDIMapR.end()) {
-            DCTyR = ModComparator->StructDIMapR[diff->name];
-        }
+        DICompositeType *DCTyL = ModComparator->StructDIMapL.lookup(diff->name);
+        DICompositeType *DCTyR = ModComparator->StructDIMapR.lookup(diff->name);
         if (!DCTyL || !DCTyR)
             // Debug info not found.
             return;
@@ -764,18 +760,18 @@ std::vector<std::unique_ptr<SyntaxDifference>>
     // found by SourceCodeUtils, the original arguments in the C source code
     // also cannot be localed, therefore the C-like identifier is used instead.
     std::string argumentNamesL, argumentNamesR;
-    for (auto T : {std::make_tuple(IL, &argumentNamesL),
-                   std::make_tuple(IR, &argumentNamesR)}) {
+    for (auto T : {std::make_tuple(IL, &argumentNamesL, &IdentifiersL),
+                   std::make_tuple(IR, &argumentNamesR, &IdentifiersR)}) {
         // The identifier generation is done separately for the left and right
         // call instruction; vector of tuples and pointers are used in order to
         // re-use the code for both.
         const CallInst *I = std::get<0>(T);
         std::string *argumentNames = std::get<1>(T);
+        IdentifierCache *Identifiers = std::get<2>(T);
 
         for (int i = 0; i < I->getNumArgOperands(); i++) {
             const Value *Op = I->getArgOperand(i);
-            std::string OpName = getIdentifierForValue(
-                    Op, DI->StructFieldNames, I->getFunction());
+            std::string OpName = Identifiers->getIdentifierForValue(Op).str();
 
             if (*argumentNames == "")
                 *argumentNames += OpName;
@@ -822,14 +818,9 @@ int DifferentialFunctionComparator::cmpGlobalValues(GlobalValue *L,
         return cmpConstants(GVarL->getInitializer(), GVarR->getInitializer());
     } else if (L->hasName() && R->hasName()) {
         // Both values are named, compare them by names
-        auto NameL = L->getName();
-        auto NameR = R->getName();
-
         // Remove number suffixes
-        if (hasSuffix(NameL))
-            NameL = NameL.substr(0, NameL.find_last_of("."));
-        if (hasSuffix(NameR))
-            NameR = NameR.substr(0, NameR.find_last_of("."));
+        StringRef NameL = ModComparator->getBaseName(L);
+        StringRef NameR = ModComparator->getBaseName(R);
         if (NameL == NameR
             || (isPrintFunction(NameL) && isPrintFunction(NameR))) {
             if (isa<Function>(L) && isa<Function>(R)) {
@@ -1067,8 +1058,10 @@ int DifferentialFunctionComparator::cmpCallsWithExtraArg(
     return 1;
 }
 
-/// Compares array types with equivalent element types as equal when
-/// comparing the control flow only.
+/// Compare types. Results of structural comparisons are cached in the module
+/// comparator, hence each pair of types is compared structurally only once
+/// per comparison of modules. The comparison of unions depends on the type
+/// names, hence it is done before looking into the cache.
 int DifferentialFunctionComparator::cmpTypes(Type *L, Type *R) const {
     // Compare union as equal to another type in case it is at least of the same
     // size.
@@ -1078,25 +1071,51 @@ int DifferentialFunctionComparator::cmpTypes(Type *L, Type *R) const {
         Type *Ty;
         StructType *StrTy;
         const DataLayout *TyLayout, *StrTyLayout;
+        TypeIndex *TyIndex, *StrTyIndex;
         if (L->isStructTy()) {
             StrTy = dyn_cast<StructType>(L);
             Ty = R;
             StrTyLayout = &LayoutL;
             TyLayout = &LayoutR;
+            StrTyIndex = ModComparator->TypesL;
+            TyIndex = ModComparator->TypesR;
         } else {
             StrTy = dyn_cast<StructType>(R);
             Ty = L;
             StrTyLayout = &LayoutR;
             TyLayout = &LayoutL;
+            StrTyIndex = ModComparator->TypesR;
+            TyIndex = ModComparator->TypesL;
         }
 
-        if (StrTy->getStructName().startswith("union")
-            && (StrTyLayout->getTypeAllocSize(StrTy)
-                >= TyLayout->getTypeAllocSize(Ty))) {
-            return 0;
+        if (StrTy->getStructName().startswith("union")) {
+            // Use the memoised sizes from the type indices if available.
+            uint64_t StrTySize = StrTyIndex
+                                         ? StrTyIndex->allocSize(StrTy)
+                                         : StrTyLayout->getTypeAllocSize(StrTy);
+            uint64_t TySize = TyIndex ? TyIndex->allocSize(Ty)
+                                      : TyLayout->getTypeAllocSize(Ty);
+            if (StrTySize >= TySize)
+                return 0;
         }
     }
 
+    TypeComparisonKey Key{L, R, config.ControlFlowOnly};
+    auto Cached = ModComparator->TypeComparisons.find(Key);
+    if (Cached != ModComparator->TypeComparisons.end())
+        return Cached->second;
+
+    // The comparison may recursively add other entries into the cache, hence
+    // the entry is inserted after it is done.
+    int Result = cmpTypesUncached(L, R);
+    ModComparator->TypeComparisons[Key] = Result;
+    return Result;
+}
+
+/// Compares integer types and array types with equivalent element types as
+/// equal when comparing the control flow only.
+/// Note: nested types are compared using cmpTypes, i.e. using the cache.
+int DifferentialFunctionComparator::cmpTypesUncached(Type *L, Type *R) const {
     // Compare integer types (except the boolean type) as the same when
     // comparing the control flow only.
     if (L->isIntegerTy() && R->isIntegerTy() && config.ControlFlowOnly) {
@@ -35,6 +35,8 @@ class DifferentialFunctionComparator : public FunctionComparator {
                                    const DebugInfo *DI,
                                    ModuleComparator *MC)
             : FunctionComparator(F1, F2, nullptr), config(config), DI(DI),
+              IdentifiersL(DI, Program::First),
+              IdentifiersR(DI, Program::Second),
               LayoutL(F1->getParent()->getDataLayout()),
               LayoutR(F2->getParent()->getDataLayout()), ModComparator(MC) {}
 
@@ -62,6 +64,7 @@ class DifferentialFunctionComparator : public FunctionComparator {
     int cmpCallsWithExtraArg(const CallInst *CL, const CallInst *CR) const;
     /// Compares array types with equivalent element types and all integer types
     /// as equal when comparing the control flow only.
+    /// The results are cached in the module comparator.
     int cmpTypes(Type *L, Type *R) const override;
     /// Do not compare bitwidth when comparing the control flow only.
     int cmpAPInts(const APInt &L, const APInt &R) const override;
@@ -104,6 +107,16 @@ class DifferentialFunctionComparator : public FunctionComparator {
     const Config &config;
     const DebugInfo *DI;
 
+    /// C-like identifiers of values of each of the compared functions used in
+    /// the reported differences. The caches live as long as the compared pair
+    /// of functions, since the functions may be modified (by inlining)
+    /// afterwards.
+    mutable IdentifierCache IdentifiersL;
+    mutable IdentifierCache IdentifiersR;
+
+    /// Compare types without looking into the cache of type comparisons.
+    int cmpTypesUncached(Type *L, Type *R) const;
+
     const DataLayout &LayoutL, &LayoutR;
 
     mutable const DebugLoc *CurrentLocL, *CurrentLocR;
@@ -16,6 +16,7 @@
 #include "Config.h"
 #include "ModuleAnalysis.h"
 #include "Output.h"
+#include <cstdlib>
 #include <cstring>
 
 extern "C" {
@@ -26,7 +27,7 @@ void runSimpLL(const char *ModL,
                const char *FunL,
                const char *FunR,
                struct config Conf,
-               char *Output) {
+               char **Output) {
     Config config(FunL,
                   FunR,
                   ModL,
@@ -40,14 +41,28 @@ void runSimpLL(const char *ModL,
                   Conf.PrintAsmDiffs,
                   Conf.PrintCallStacks,
                   Conf.Verbose,
-                  Conf.VerboseMacros);
+                  Conf.VerboseMacros,
+                  Conf.FirstSymbolIndex,
+                  Conf.SecondSymbolIndex,
+                  Conf.MemoryLimit,
+                  Conf.InlineWrappers);
 
-    OverallResult Result;
-    processAndCompare(config, Result);
-
-    std::string outputString = reportOutputToString(config, Result);
-    strcpy(Output, outputString.c_str());
+    std::string outputString;
+    if (config.Variables.size() > 1) {
+        MultiVariableResult Result;
+        processAndCompare(config, Result);
+        outputString = reportOutputToString(config, Result);
+    } else {
+        OverallResult Result;
+        processAndCompare(config, Result);
+        outputString = reportOutputToString(config, Result);
+    }
+    // The output is allocated here since its size is not known in advance,
+    // it must be released by freeSimpLLOutput.
+    *Output = strdup(outputString.c_str());
 
     llvm_shutdown();
 }
+
+void freeSimpLLOutput(char *Output) { free(Output); }
 }
@@ -18,13 +18,17 @@ extern "C" {
 
 struct config {
     const char *CacheDir;
-    const char *Variable;
+    const char *Variable; // Comma-separated list of variables
     int OutputLlvmIR;
     int ControlFlowOnly;
     int PrintAsmDiffs;
     int PrintCallStacks;
     int Verbose;
     int VerboseMacros;
+    const char *FirstSymbolIndex;
+    const char *SecondSymbolIndex;
+    int MemoryLimit; // In MiB, 0 means unlimited
+    int InlineWrappers; // Size limit of wrappers, 0 disables inlining
 };
 
 void runSimpLL(const char *ModL,
@@ -34,7 +38,10 @@ void runSimpLL(const char *ModL,
                const char *FunL,
                const char *FunR,
                struct config Conf,
-               char *Output);
+               char **Output);
+
+// Release the output allocated by runSimpLL.
+void freeSimpLLOutput(char *Output);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,71 @@
+//===----- GlobalCorrespondence.cpp - Matching globals between modules ----===//
+//
+//       SimpLL - Program simplifier for analysis of semantic difference      //
+//
+// This file is published under Apache 2.0 license. See LICENSE for details.
+// Author: Viktor Malik, vmalik@redhat.com
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the implementation of the GlobalCorrespondence class.
+///
+//===----------------------------------------------------------------------===//
+
+#include "GlobalCorrespondence.h"
+#include "Utils.h"
+#include <llvm/ADT/StringMap.h>
+
+GlobalCorrespondence::GlobalCorrespondence(Module &First, Module &Second) {
+    for (auto *Mod : {&First, &Second}) {
+        for (auto &GV : Mod->global_values())
+            BaseNames[&GV] = ::getBaseName(GV.getName()).str();
+    }
+    matchGlobals(First, Second, FirstToSecond);
+    matchGlobals(Second, First, SecondToFirst);
+}
+
+void GlobalCorrespondence::matchGlobals(
+        Module &Src,
+        Module &Dest,
+        DenseMap<const GlobalValue *, GlobalValue *> &Map) {
+    // Globals of the target module indexed by their base names. If there are
+    // more globals with the same base name, the one without the suffix is
+    // preferred.
+    StringMap<GlobalValue *> DestByBaseName;
+    for (auto &GV : Dest.global_values()) {
+        if (!GV.hasName())
+            continue;
+        auto Inserted = DestByBaseName.insert({BaseNames[&GV], &GV});
+        if (!Inserted.second && GV.getName() == BaseNames[&GV])
+            Inserted.first->second = &GV;
+    }
+
+    for (auto &GV : Src.global_values()) {
+        if (!GV.hasName())
+            continue;
+        GlobalValue *Other = Dest.getNamedValue(GV.getName());
+        if (!Other) {
+            auto ByBaseName = DestByBaseName.find(BaseNames[&GV]);
+            if (ByBaseName != DestByBaseName.end())
+                Other = ByBaseName->second;
+        }
+        if (Other)
+            Map[&GV] = Other;
+    }
+}
+
+GlobalValue *GlobalCorrespondence::getSecond(const GlobalValue *GV) const {
+    return FirstToSecond.lookup(GV);
+}
+
+GlobalValue *GlobalCorrespondence::getFirst(const GlobalValue *GV) const {
+    return SecondToFirst.lookup(GV);
+}
+
+StringRef GlobalCorrespondence::getBaseName(const GlobalValue *GV) const {
+    auto BaseName = BaseNames.find(GV);
+    if (BaseName != BaseNames.end())
+        return BaseName->second;
+    // Globals created after building the table.
+    return ::getBaseName(GV->getName());
+}
@@ -0,0 +1,68 @@
+//===------ GlobalCorrespondence.h - Matching globals between modules -----===//
+//
+//       SimpLL - Program simplifier for analysis of semantic difference      //
+//
+// This file is published under Apache 2.0 license. See LICENSE for details.
+// Author: Viktor Malik, vmalik@redhat.com
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the GlobalCorrespondence class that
+/// maps global values of one compared module to their counterparts in the
+/// other module.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef DIFFKEMP_SIMPLL_GLOBALCORRESPONDENCE_H
+#define DIFFKEMP_SIMPLL_GLOBALCORRESPONDENCE_H
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/IR/Module.h>
+#include <string>
+
+using namespace llvm;
+
+/// Table of corresponding global values of the compared modules.
+/// A global value corresponds to the global of the same name in the other
+/// module or, if there is no such global, to a global having the same name
+/// after dropping the .<NUMBER> suffix.
+/// The table is built once the modules are simplified and it must be used only
+/// while no globals are renamed or removed.
+class GlobalCorrespondence {
+  public:
+    GlobalCorrespondence(Module &First, Module &Second);
+
+    /// Get the counterpart of a global value of the first module in the second
+    /// module or null if there is none.
+    GlobalValue *getSecond(const GlobalValue *GV) const;
+    /// Get the counterpart of a global value of the second module in the first
+    /// module or null if there is none.
+    GlobalValue *getFirst(const GlobalValue *GV) const;
+
+    /// Get the counterpart of a function of the first module in the second
+    /// module or null if there is none (or if it is not a function).
+    Function *getSecondFunction(const Function *Fun) const {
+        return dyn_cast_or_null<Function>(getSecond(Fun));
+    }
+
+    /// Get name of the global value without the .<NUMBER> suffix. Names of
+    /// the globals of the compared modules are memoised when the table is
+    /// built (a global renamed later keeps its original base name).
+    StringRef getBaseName(const GlobalValue *GV) const;
+
+  private:
+    DenseMap<const GlobalValue *, GlobalValue *> FirstToSecond;
+    DenseMap<const GlobalValue *, GlobalValue *> SecondToFirst;
+    // The base names are copied since names of globals are freed when the
+    // globals are renamed or erased. The map is not modified after it is
+    // built, hence references to the names stay valid.
+    DenseMap<const GlobalValue *, std::string> BaseNames;
+
+    /// Map globals of the source module to their counterparts in the target
+    /// module.
+    void matchGlobals(Module &Src,
+                      Module &Dest,
+                      DenseMap<const GlobalValue *, GlobalValue *> &Map);
+};
+
+#endif // DIFFKEMP_SIMPLL_GLOBALCORRESPONDENCE_H
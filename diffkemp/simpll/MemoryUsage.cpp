@@ -0,0 +1,117 @@
+//===------- MemoryUsage.cpp - Accounting of memory used by SimpLL --------===//
+//
+//       SimpLL - Program simplifier for analysis of semantic difference      //
+//
+// This file is published under Apache 2.0 license. See LICENSE for details.
+// Author: Viktor Malik, vmalik@redhat.com
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the implementation of the MemoryAccounting class and of
+/// the estimation of the memory taken by LLVM modules.
+///
+//===----------------------------------------------------------------------===//
+
+#include "MemoryUsage.h"
+#include <algorithm>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/IR/Instruction.h>
+#include <llvm/IR/Metadata.h>
+
+/// Record the current memory usage of the subsystem and update the peaks.
+void MemoryAccounting::update(MemorySubsystem Subsystem, uint64_t Bytes) {
+    Current[static_cast<size_t>(Subsystem)] = Bytes;
+    switch (Subsystem) {
+    case MemorySubsystem::Modules:
+        Stats.modules = std::max(Stats.modules, Bytes);
+        break;
+    case MemorySubsystem::Macros:
+        Stats.macros = std::max(Stats.macros, Bytes);
+        break;
+    case MemorySubsystem::DebugInfo:
+        Stats.debugInfo = std::max(Stats.debugInfo, Bytes);
+        break;
+    case MemorySubsystem::Results:
+        Stats.results = std::max(Stats.results, Bytes);
+        break;
+    }
+    Stats.peak = std::max(Stats.peak, getTotal());
+}
+
+/// Current memory usage of all subsystems.
+uint64_t MemoryAccounting::getTotal() const {
+    uint64_t Total = 0;
+    for (uint64_t Bytes : Current)
+        Total += Bytes;
+    return Total;
+}
+
+/// Estimate the memory taken by the metadata reachable from the given
+/// metadata nodes. Each node is counted once.
+static uint64_t
+        estimateMetadataMemory(SmallVectorImpl<const Metadata *> &Nodes) {
+    SmallPtrSet<const Metadata *, 32> Visited;
+    uint64_t Bytes = 0;
+    while (!Nodes.empty()) {
+        const Metadata *MD = Nodes.pop_back_val();
+        if (!MD || !Visited.insert(MD).second)
+            continue;
+        if (auto *String = dyn_cast<MDString>(MD)) {
+            Bytes += sizeof(MDString) + String->getLength();
+        } else if (auto *Node = dyn_cast<MDNode>(MD)) {
+            Bytes += sizeof(MDNode)
+                     + Node->getNumOperands() * sizeof(MDOperand);
+            for (auto &Op : Node->operands())
+                Nodes.push_back(Op.get());
+        } else {
+            Bytes += sizeof(ValueAsMetadata);
+        }
+    }
+    return Bytes;
+}
+
+/// Estimate the memory taken by the IR of the module. Each instruction is
+/// counted together with its operands (uses). Metadata (including debug info)
+/// are counted once per node, regardless of the number of references.
+uint64_t estimateModuleMemory(const Module &Mod) {
+    uint64_t Bytes = sizeof(Module);
+    SmallVector<const Metadata *, 32> Nodes;
+    SmallVector<std::pair<unsigned, MDNode *>, 4> Attachments;
+    auto addAttachments = [&]() {
+        for (auto &Attachment : Attachments)
+            Nodes.push_back(Attachment.second);
+        Attachments.clear();
+    };
+
+    for (auto &Named : Mod.named_metadata()) {
+        Bytes += sizeof(NamedMDNode) + Named.getNumOperands() * sizeof(void *);
+        for (auto *Node : Named.operands())
+            Nodes.push_back(Node);
+    }
+    for (auto &Global : Mod.globals()) {
+        Bytes += sizeof(GlobalVariable)
+                 + Global.getNumOperands() * sizeof(Use);
+        Global.getAllMetadata(Attachments);
+        addAttachments();
+    }
+    for (auto &Fun : Mod) {
+        Bytes += sizeof(Function) + Fun.arg_size() * sizeof(Argument);
+        Fun.getAllMetadata(Attachments);
+        addAttachments();
+        for (auto &BB : Fun) {
+            Bytes += sizeof(BasicBlock);
+            for (auto &Inst : BB) {
+                Bytes += sizeof(Instruction)
+                         + Inst.getNumOperands() * sizeof(Use);
+                // Includes the debug location.
+                Inst.getAllMetadata(Attachments);
+                addAttachments();
+                for (auto &Op : Inst.operands())
+                    if (auto *MDValue = dyn_cast<MetadataAsValue>(Op.get()))
+                        Nodes.push_back(MDValue->getMetadata());
+            }
+        }
+    }
+
+    return Bytes + estimateMetadataMemory(Nodes);
+}
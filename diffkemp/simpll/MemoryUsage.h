@@ -0,0 +1,96 @@
+//===--------- MemoryUsage.h - Accounting of memory used by SimpLL --------===//
+//
+//       SimpLL - Program simplifier for analysis of semantic difference      //
+//
+// This file is published under Apache 2.0 license. See LICENSE for details.
+// Author: Viktor Malik, vmalik@redhat.com
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the MemoryAccounting class that keeps
+/// track of the memory used by the individual subsystems of SimpLL and checks
+/// it against the memory limit.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef DIFFKEMP_SIMPLL_MEMORYUSAGE_H
+#define DIFFKEMP_SIMPLL_MEMORYUSAGE_H
+
+#include <array>
+#include <cstdint>
+#include <llvm/IR/Module.h>
+
+using namespace llvm;
+
+/// Subsystems of SimpLL whose memory is accounted.
+enum class MemorySubsystem {
+    // IR of the compared modules.
+    Modules,
+    // Caches of MacroDiffAnalysis (macro definitions and uses, source files).
+    Macros,
+    // Maps built by DebugInfo.
+    DebugInfo,
+    // Results of the compared function pairs and of the compared types.
+    Results
+};
+
+/// Peak memory usage (in bytes) reported in the output of SimpLL.
+struct MemoryStats {
+    // Peak of the sum of all subsystems.
+    uint64_t peak = 0;
+    // Peaks of the individual subsystems.
+    uint64_t modules = 0;
+    uint64_t macros = 0;
+    uint64_t debugInfo = 0;
+    uint64_t results = 0;
+    // Number of times the caches were shed to get under the memory limit.
+    int cacheSheds = 0;
+    // The limit was exceeded even after shedding the caches. Function pairs
+    // that were not compared yet have an unknown result.
+    bool limitExceeded = false;
+};
+
+/// Accounting of memory used by SimpLL.
+/// The usage of each subsystem is estimated by the subsystem itself (from the
+/// sizes of the objects it allocates) and recorded here at checkpoints of the
+/// comparison. The estimates do not include allocator overhead and memory
+/// owned by LLVM contexts that is not referenced from the modules (e.g. types
+/// and uniqued constants), hence they are lower than the RSS.
+class MemoryAccounting {
+  public:
+    /// Set the memory limit in bytes (0 means unlimited).
+    void setLimit(uint64_t Bytes) { Limit = Bytes; }
+    uint64_t getLimit() const { return Limit; }
+
+    /// Record the current memory usage of the subsystem.
+    void update(MemorySubsystem Subsystem, uint64_t Bytes);
+
+    /// Current memory usage of all subsystems.
+    uint64_t getTotal() const;
+
+    /// Check whether the current usage is over the limit (if it is set).
+    bool isOverLimit() const { return Limit && getTotal() > Limit; }
+
+    /// Record that the caches were shed because of the limit.
+    void recordCacheShed() { Stats.cacheSheds++; }
+
+    /// Record that the limit cannot be met, the comparison is then stopped.
+    void setLimitExceeded() { Stats.limitExceeded = true; }
+    bool isLimitExceeded() const { return Stats.limitExceeded; }
+    /// Clear the record of the exceeded limit when a new comparison starts.
+    void resetLimitExceeded() { Stats.limitExceeded = false; }
+
+    const MemoryStats &getStats() const { return Stats; }
+
+  private:
+    uint64_t Limit = 0;
+    std::array<uint64_t, 4> Current{};
+    MemoryStats Stats;
+};
+
+/// Estimate the memory taken by the IR of the module (functions, basic
+/// blocks, instructions, global variables, and metadata including debug
+/// info).
+uint64_t estimateModuleMemory(const Module &Mod);
+
+#endif // DIFFKEMP_SIMPLL_MEMORYUSAGE_H
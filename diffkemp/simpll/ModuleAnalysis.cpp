@@ -15,14 +15,17 @@
 #include "ModuleAnalysis.h"
 #include "DebugInfo.h"
 #include "DifferentialFunctionComparator.h"
+#include "GlobalCorrespondence.h"
 #include "ModuleComparator.h"
 #include "ResultsCache.h"
 #include "SourceCodeUtils.h"
+#include "SymbolIndex.h"
 #include "Utils.h"
 #include "passes/CalledFunctionsAnalysis.h"
 #include "passes/ControlFlowSlicer.h"
 #include "passes/FieldAccessFunctionGenerator.h"
 #include "passes/FunctionAbstractionsGenerator.h"
+#include "passes/FusedPreprocessingPass.h"
 #include "passes/MergeNumberedFunctionsPass.h"
 #include "passes/ReduceFunctionMetadataPass.h"
 #include "passes/RemoveLifetimeCallsPass.h"
@@ -33,15 +36,57 @@
 #include "passes/StructHashGeneratorPass.h"
 #include "passes/StructureDebugInfoAnalysis.h"
 #include "passes/StructureSizeAnalysis.h"
+#include "passes/TypeIndexAnalysis.h"
 #include "passes/UnifyMemcpyPass.h"
 #include "passes/VarDependencySlicer.h"
+#include <llvm/ADT/SCCIterator.h>
+#include <llvm/Analysis/CallGraph.h>
 #include <llvm/IR/PassManager.h>
 #include <llvm/Passes/PassBuilder.h>
 #include <llvm/Support/FileSystem.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Transforms/IPO/AlwaysInliner.h>
+#include <llvm/Transforms/IPO/DeadArgumentElimination.h>
 #include <llvm/Transforms/Scalar/DCE.h>
 #include <llvm/Transforms/Scalar/LowerExpectIntrinsic.h>
+/// Slice the main function w.r.t. the value of a global variable.
+/// Keeps only those instructions whose value or execution depends on the value
+/// of the global variable.
+static void sliceByVariable(Function &Main, GlobalVariable *Var) {
+    PassManager<Function, FunctionAnalysisManager, GlobalVariable *> fpm;
+    FunctionAnalysisManager fam(false);
+    PassBuilder pb;
+    pb.registerFunctionAnalyses(fam);
+
+    fpm.addPass(VarDependencySlicer{});
+    fpm.run(Main, fam, Var);
+}
+
+/// Add the function passes of preprocessModule to the pass manager.
+static void addFunctionPreprocessingPasses(FunctionPassManager &fpm,
+                                           bool ControlFlowOnly,
+                                           bool Fused) {
+    if (ControlFlowOnly)
+        fpm.addPass(ControlFlowSlicer{});
+    if (Fused) {
+        // The fused transformations do not depend on DCE and on lowering
+        // llvm.expect, hence these can be run afterwards. Bitcasts are
+        // separated after DCE (as in the separate passes), so that bitcasts
+        // of unused call results are kept.
+        fpm.addPass(FusedPreprocessingPass{});
+        fpm.addPass(DCEPass{});
+        fpm.addPass(LowerExpectIntrinsicPass{});
+        fpm.addPass(SeparateCallsToBitcastPass{});
+    } else {
+        fpm.addPass(SimplifyKernelFunctionCallsPass{});
+        fpm.addPass(UnifyMemcpyPass{});
+        fpm.addPass(DCEPass{});
+        fpm.addPass(LowerExpectIntrinsicPass{});
+        fpm.addPass(ReduceFunctionMetadataPass{});
+        fpm.addPass(SeparateCallsToBitcastPass{});
+    }
+}
+
 /// Preprocessing functions run on each module at the beginning.
 /// The following transformations are applied:
 /// 1. Slicing of program w.r.t. to the value of some global variable.
@@ -54,19 +99,21 @@
 /// 3. Unification of memcpy variants so that all use the llvm.memcpy intrinsic.
 /// 4. Dead code elimination.
 /// 5. Removing calls to llvm.expect.
+/// 6. Removal of custom sections of functions.
+/// 7. Separation of bitcasts from calls to bitcast operators.
+/// Transformations 2, 3, and 6 are done by FusedPreprocessingPass in a single
+/// walk over the instructions unless Fused is false.
+/// If SkipMain is set, the main function is neither sliced nor transformed by
+/// the function passes, this is then done by preprocessMainFunction.
 void preprocessModule(Module &Mod,
                       Function *Main,
                       GlobalVariable *Var,
-                      bool ControlFlowOnly) {
-    if (Var) {
+                      bool ControlFlowOnly,
+                      bool Fused,
+                      bool SkipMain) {
+    if (Var && !SkipMain) {
         // Slicing of the program w.r.t. the value of a global variable
-        PassManager<Function, FunctionAnalysisManager, GlobalVariable *> fpm;
-        FunctionAnalysisManager fam(false);
-        PassBuilder pb;
-        pb.registerFunctionAnalyses(fam);
-
-        fpm.addPass(VarDependencySlicer{});
-        fpm.run(*Main, fam, Var);
+        sliceByVariable(*Main, Var);
     }
 
     // Function passes
@@ -74,23 +121,18 @@ void preprocessModule(Module &Mod,
     FunctionAnalysisManager fam(false);
     PassBuilder pb;
     pb.registerFunctionAnalyses(fam);
+    addFunctionPreprocessingPasses(fpm, ControlFlowOnly, Fused);
 
-    if (ControlFlowOnly)
-        fpm.addPass(ControlFlowSlicer{});
-    fpm.addPass(SimplifyKernelFunctionCallsPass{});
-    fpm.addPass(UnifyMemcpyPass{});
-    fpm.addPass(DCEPass{});
-    fpm.addPass(LowerExpectIntrinsicPass{});
-    fpm.addPass(ReduceFunctionMetadataPass{});
-    fpm.addPass(SeparateCallsToBitcastPass{});
-
-    for (auto &Fun : Mod)
-        fpm.run(Fun, fam);
+    for (auto &Fun : Mod) {
+        if (!SkipMain || &Fun != Main)
+            fpm.run(Fun, fam);
+    }
 
     // Module passes
     ModulePassManager mpm(false);
     ModuleAnalysisManager mam(false);
     pb.registerModuleAnalyses(mam);
+    mam.registerPass([] { return TypeIndexAnalysis(); });
 
     mpm.addPass(MergeNumberedFunctionsPass{});
     mpm.addPass(SimplifyKernelGlobalsPass{});
@@ -100,6 +142,140 @@ void preprocessModule(Module &Mod,
     mpm.run(Mod, mam);
 }
 
+/// Slice the main function of a module pre-processed by preprocessModule with
+/// SkipMain set w.r.t. the value of a global variable and run the function
+/// pre-processing passes on it. The module passes need not be run again since
+/// they do not depend on the body of the main function.
+void preprocessMainFunction(Module &Mod,
+                            Function *Main,
+                            GlobalVariable *Var,
+                            bool ControlFlowOnly,
+                            bool Fused) {
+    if (!Main)
+        return;
+
+    // The slicer may replace the main function by a new one returning void,
+    // the new function has to be transformed, too.
+    std::set<const Function *> OldFuns;
+    for (auto &Fun : Mod)
+        OldFuns.insert(&Fun);
+    if (Var)
+        sliceByVariable(*Main, Var);
+    std::vector<Function *> Funs = {Main};
+    for (auto &Fun : Mod) {
+        if (OldFuns.find(&Fun) == OldFuns.end())
+            Funs.push_back(&Fun);
+    }
+
+    FunctionPassManager fpm(false);
+    FunctionAnalysisManager fam(false);
+    PassBuilder pb;
+    pb.registerFunctionAnalyses(fam);
+    addFunctionPreprocessingPasses(fpm, ControlFlowOnly, Fused);
+    for (auto *Fun : Funs)
+        fpm.run(*Fun, fam);
+}
+
+/// Analyse structure types of the compared modules.
+StructureAnalyses analyseStructures(Config &config) {
+    AnalysisManager<Module, Function *> mam(false);
+    mam.registerPass([] { return StructureSizeAnalysis(); });
+    mam.registerPass([] { return StructureDebugInfoAnalysis(); });
+    mam.registerPass([] { return TypeIndexAnalysis(); });
+#if LLVM_VERSION_MAJOR >= 8
+    mam.registerPass([] { return PassInstrumentationAnalysis(); });
+#endif
+
+    StructureAnalyses Structures;
+    Structures.SizeMapL = mam.getResult<StructureSizeAnalysis>(
+            *config.First, config.FirstFun);
+    Structures.SizeMapR = mam.getResult<StructureSizeAnalysis>(
+            *config.Second, config.SecondFun);
+    Structures.DebugInfoL = mam.getResult<StructureDebugInfoAnalysis>(
+            *config.First, config.FirstFun);
+    Structures.DebugInfoR = mam.getResult<StructureDebugInfoAnalysis>(
+            *config.Second, config.SecondFun);
+    // The type indices are used by the comparison, too. The analysis manager
+    // is destroyed here, hence the indices can be taken over from it.
+    Structures.TypesL = std::make_unique<TypeIndex>(std::move(
+            mam.getResult<TypeIndexAnalysis>(*config.First, config.FirstFun)));
+    Structures.TypesR = std::make_unique<TypeIndex>(
+            std::move(mam.getResult<TypeIndexAnalysis>(*config.Second,
+                                                       config.SecondFun)));
+    return Structures;
+}
+
+/// Node of the merged call graph of the compared modules. Each node is a pair
+/// of corresponding functions, a pair calls another pair if the function
+/// from either module calls the corresponding function.
+struct FunctionPairNode {
+    Function *First;
+    Function *Second;
+    std::vector<FunctionPairNode *> Callees;
+};
+
+namespace llvm {
+template <> struct GraphTraits<FunctionPairNode *> {
+    using NodeRef = FunctionPairNode *;
+    using ChildIteratorType = std::vector<FunctionPairNode *>::iterator;
+
+    static NodeRef getEntryNode(FunctionPairNode *Node) { return Node; }
+    static ChildIteratorType child_begin(NodeRef Node) {
+        return Node->Callees.begin();
+    }
+    static ChildIteratorType child_end(NodeRef Node) {
+        return Node->Callees.end();
+    }
+};
+} // namespace llvm
+
+/// Get pairs of corresponding functions of the compared modules in the
+/// bottom-up order of the strongly connected components of the merged call
+/// graph of both modules (i.e. callees from either module go before their
+/// callers). The order of pairs inside a component is unspecified.
+std::vector<std::pair<Function *, Function *>>
+        getBottomUpOrder(Module &First,
+                         Module &Second,
+                         const GlobalCorrespondence &Globals) {
+    std::vector<FunctionPairNode> Nodes;
+    for (auto &FunFirst : First) {
+        if (auto FunSecond = Globals.getSecondFunction(&FunFirst))
+            Nodes.push_back({&FunFirst, FunSecond, {}});
+    }
+    DenseMap<const Function *, FunctionPairNode *> FirstNodes, SecondNodes;
+    for (auto &Node : Nodes) {
+        FirstNodes[Node.First] = &Node;
+        SecondNodes[Node.Second] = &Node;
+    }
+
+    // Add call edges of both call graphs. The root node calls all pairs so
+    // that the whole graph is traversed.
+    FunctionPairNode Root{nullptr, nullptr, {}};
+    for (auto *Mod : {&First, &Second}) {
+        auto &ModNodes = Mod == &First ? FirstNodes : SecondNodes;
+        CallGraph CG(*Mod);
+        for (auto &Node : Nodes) {
+            Function *Fun = Mod == &First ? Node.First : Node.Second;
+            for (auto &Call : *CG[Fun]) {
+                auto Callee = ModNodes.find(Call.second->getFunction());
+                if (Callee != ModNodes.end())
+                    Node.Callees.push_back(Callee->second);
+            }
+        }
+    }
+    for (auto &Node : Nodes)
+        Root.Callees.push_back(&Node);
+
+    std::vector<std::pair<Function *, Function *>> Order;
+    for (auto SCC = scc_begin(&Root); !SCC.isAtEnd(); ++SCC) {
+        for (FunctionPairNode *Node : *SCC) {
+            if (Node != &Root)
+                Order.emplace_back(Node->First, Node->Second);
+        }
+    }
+    return Order;
+}
+
 /// Simplification of modules to ease the semantic diff.
 /// Removes all the code that is syntactically same between modules (hence it
 /// must not be checked for semantic equivalence).
@@ -111,14 +287,18 @@ void preprocessModule(Module &Mod,
 /// 3. Using debug information to compute offsets of the corresponding GEP
 ///    indices. Offsets are stored inside LLVM metadata.
 /// 4. Removing bodies of functions that are syntactically equivalent.
-void simplifyModulesDiff(Config &config, OverallResult &Result) {
+/// If no main functions are given, all functions having a counterpart in the
+/// other module are compared. If config.BottomUpOrder is set, callees are
+/// compared before their callers, otherwise the functions are compared in the
+/// order of the first module.
+void simplifyModulesDiff(Config &config,
+                         OverallResult &Result,
+                         StructureAnalyses *Structures) {
     // Generate abstractions of indirect function calls and for inline
     // assemblies.
     AnalysisManager<Module, Function *> mam(false);
     mam.registerPass([] { return CalledFunctionsAnalysis(); });
     mam.registerPass([] { return FunctionAbstractionsGenerator(); });
-    mam.registerPass([] { return StructureSizeAnalysis(); });
-    mam.registerPass([] { return StructureDebugInfoAnalysis(); });
 #if LLVM_VERSION_MAJOR >= 8
     mam.registerPass([] { return PassInstrumentationAnalysis(); });
 #endif
@@ -130,14 +310,11 @@ void simplifyModulesDiff(Config &config, OverallResult &Result) {
             mam.getResult<FunctionAbstractionsGenerator>(*config.Second,
                                                          config.SecondFun);
 
-    auto StructSizeMapL = mam.getResult<StructureSizeAnalysis>(*config.First,
-                                                               config.FirstFun);
-    auto StructSizeMapR = mam.getResult<StructureSizeAnalysis>(
-            *config.Second, config.SecondFun);
-    auto StructDIL = mam.getResult<StructureDebugInfoAnalysis>(*config.First,
-                                                               config.FirstFun);
-    auto StructDIR = mam.getResult<StructureDebugInfoAnalysis>(
-            *config.Second, config.SecondFun);
+    StructureAnalyses ModuleStructures;
+    if (!Structures) {
+        ModuleStructures = analyseStructures(config);
+        Structures = &ModuleStructures;
+    }
 
     // Module passes
     PassManager<Module,
@@ -154,6 +331,10 @@ void simplifyModulesDiff(Config &config, OverallResult &Result) {
     // a new version by a pass
     config.refreshFunctions();
 
+    // Globals are not renamed or removed from now on, hence the corresponding
+    // globals can be matched once.
+    GlobalCorrespondence Globals(*config.First, *config.Second);
+
     DebugInfo DI(*config.First,
                  *config.Second,
                  config.FirstFun,
@@ -161,17 +342,30 @@ void simplifyModulesDiff(Config &config, OverallResult &Result) {
                  mam.getResult<CalledFunctionsAnalysis>(*config.First,
                                                         config.FirstFun),
                  mam.getResult<CalledFunctionsAnalysis>(*config.Second,
-                                                        config.SecondFun));
+                                                        config.SecondFun),
+                 &Globals);
+    // The modules may have been compared before (w.r.t. another variable or
+    // before linking missing definitions). Functions that were not compared
+    // then because of the memory limit are compared again.
+    config.Memory.resetLimitExceeded();
+    config.Memory.update(MemorySubsystem::Modules,
+                         estimateModuleMemory(*config.First)
+                                 + estimateModuleMemory(*config.Second));
+    config.Memory.update(MemorySubsystem::DebugInfo, DI.getMemoryUsage());
 
     // Compare functions for syntactical equivalence
     ModuleComparator modComp(*config.First,
                              *config.Second,
                              config,
                              &DI,
-                             StructSizeMapL,
-                             StructSizeMapR,
-                             StructDIL,
-                             StructDIR);
+                             Structures->SizeMapL,
+                             Structures->SizeMapR,
+                             Structures->DebugInfoL,
+                             Structures->DebugInfoR,
+                             Structures->TypesL.get(),
+                             Structures->TypesR.get(),
+                             &Globals,
+                             &Structures->MacroDiffs);
 
     if (config.FirstFun && config.SecondFun) {
         modComp.compareFunctions(config.FirstFun, config.SecondFun);
@@ -192,10 +386,12 @@ void simplifyModulesDiff(Config &config, OverallResult &Result) {
                                        << " are syntactically different\n");
             }
         }
-        if (allEqual) {
+        if (allEqual && !config.Memory.isLimitExceeded()) {
             // Functions are equal iff all functions that were compared by
             // module comparator (i.e. those that are recursively called by the
             // main functions) are equal.
+            // If the memory limit was exceeded, some of them were not
+            // compared.
             DEBUG_WITH_TYPE(
                     DEBUG_SIMPLL,
                     dbgs() << "All functions are syntactically equal\n");
@@ -204,15 +400,61 @@ void simplifyModulesDiff(Config &config, OverallResult &Result) {
             deleteAliasToFun(*config.First, config.FirstFun);
             deleteAliasToFun(*config.Second, config.SecondFun);
         }
+    } else if (config.BottomUpOrder) {
+        // Compare functions bottom-up w.r.t. the call graphs so that callees
+        // are compared before their callers and the results of their
+        // comparison are reused instead of comparing them by recursion.
+        for (auto &FunPair :
+             getBottomUpOrder(*config.First, *config.Second, Globals)) {
+            if (modComp.ComparedFuns.find(FunPair)
+                != modComp.ComparedFuns.end())
+                continue;
+            modComp.compareFunctions(FunPair.first, FunPair.second);
+        }
     } else {
         for (auto &FunFirst : *config.First) {
-            if (auto FunSecond =
-                        config.Second->getFunction(FunFirst.getName())) {
+            if (auto FunSecond = Globals.getSecondFunction(&FunFirst))
                 modComp.compareFunctions(&FunFirst, FunSecond);
-            }
         }
     }
     Result.missingDefs = modComp.MissingDefs;
+    Result.stats.comparedFunctions += modComp.Stats.comparedFunctions;
+    Result.stats.inlinedCalls += modComp.Stats.inlinedCalls;
+    Result.stats.memory = config.Memory.getStats();
+}
+
+/// Remove dead arguments and unused return values of functions in the module.
+/// This is run on the simplified modules before they are written to files.
+/// Only functions called by the main function (if given) are transformed.
+/// \param Mod LLVM module to transform.
+/// \param Main Main compared function, all functions are transformed if it is
+///             null.
+void eliminateDeadArguments(Module &Mod, Function *Main) {
+    // Dead argument elimination only transforms functions with local linkage,
+    // hence the functions outside of the closure of Main are made external
+    // while the pass is run.
+    std::vector<std::pair<Function *, GlobalValue::LinkageTypes>> Hidden;
+    if (Main) {
+        AnalysisManager<Module, Function *> fam(false);
+        auto Called = CalledFunctionsAnalysis().run(Mod, fam, Main);
+        for (auto &Fun : Mod) {
+            if (Fun.hasLocalLinkage() && Called.find(&Fun) == Called.end()) {
+                Hidden.emplace_back(&Fun, Fun.getLinkage());
+                Fun.setLinkage(GlobalValue::ExternalLinkage);
+            }
+        }
+    }
+
+    ModulePassManager mpm(false);
+    ModuleAnalysisManager mam(false);
+    PassBuilder pb;
+    pb.registerModuleAnalyses(mam);
+
+    mpm.addPass(DeadArgumentEliminationPass{});
+    mpm.run(Mod, mam);
+
+    for (auto &Fun : Hidden)
+        Fun.first->setLinkage(Fun.second);
 }
 
 /// Write LLVM IR of a module into a file.
@@ -225,26 +467,218 @@ void writeIRToFile(Module &Mod, StringRef FileName) {
     stream.close();
 }
 
+/// Link missing definitions reported by the comparison into the original
+/// modules and replace the compared modules in config by new copies of the
+/// original ones.
+/// \return True if any definition was linked (the comparison has to be then
+///         run again).
+bool linkMissingDefinitions(Config &config,
+                            OverallResult &Result,
+                            MissingDefsLinker &LinkerFirst,
+                            MissingDefsLinker &LinkerSecond) {
+    bool linked = false;
+    for (auto &MissingDef : Result.missingDefs) {
+        if (MissingDef.first)
+            linked |= LinkerFirst.linkDefinition(MissingDef.first->getName());
+        if (MissingDef.second)
+            linked |= LinkerSecond.linkDefinition(MissingDef.second->getName());
+    }
+    if (!linked)
+        return false;
+
+    // Global variables have to be looked up in the new modules.
+    std::string FirstVarName =
+            config.FirstVar ? config.FirstVar->getName().str() : "";
+    std::string SecondVarName =
+            config.SecondVar ? config.SecondVar->getName().str() : "";
+
+    // Both modules have to be replaced since the simplification of each module
+    // depends on the other one.
+    config.First = LinkerFirst.getModuleCopy();
+    config.Second = LinkerSecond.getModuleCopy();
+    config.refreshFunctions();
+    if (!FirstVarName.empty())
+        config.FirstVar = config.First->getGlobalVariable(FirstVarName, true);
+    if (!SecondVarName.empty())
+        config.SecondVar =
+                config.Second->getGlobalVariable(SecondVarName, true);
+
+    // Statistics are kept since they cover all comparisons.
+    ComparisonStats Stats = Result.stats;
+    Result = OverallResult();
+    Result.stats = Stats;
+    return true;
+}
+
 /// Run pre-process passes on the modules specified in the config and compare
 /// them using simplifyModulesDiff. The output is written to files specified
 /// in config.
+/// If symbol indices are given in config, missing definitions are linked into
+/// the modules and the comparison is repeated until no more definitions can
+/// be linked.
 void processAndCompare(Config &config, OverallResult &Result) {
-    // Run transformations
-    preprocessModule(*config.First,
-                     config.FirstFun,
-                     config.FirstVar,
-                     config.ControlFlowOnly);
-    preprocessModule(*config.Second,
-                     config.SecondFun,
-                     config.SecondVar,
-                     config.ControlFlowOnly);
-    config.refreshFunctions();
+    // The linkers parse the original modules again when some definition is
+    // missing since the compared modules are transformed in place.
+    std::unique_ptr<MissingDefsLinker> LinkerFirst, LinkerSecond;
+    if (!config.FirstSymbolIndex.empty() || !config.SecondSymbolIndex.empty()) {
+        LinkerFirst = std::make_unique<MissingDefsLinker>(
+                *config.First, config.FirstSymbolIndex);
+        LinkerSecond = std::make_unique<MissingDefsLinker>(
+                *config.Second, config.SecondSymbolIndex);
+    }
+
+    do {
+        // Run transformations
+        preprocessModule(*config.First,
+                         config.FirstFun,
+                         config.FirstVar,
+                         config.ControlFlowOnly,
+                         config.FusedPreprocessing);
+        preprocessModule(*config.Second,
+                         config.SecondFun,
+                         config.SecondVar,
+                         config.ControlFlowOnly,
+                         config.FusedPreprocessing);
+        config.refreshFunctions();
 
-    simplifyModulesDiff(config, Result);
+        simplifyModulesDiff(config, Result);
+    } while (LinkerFirst
+             && linkMissingDefinitions(
+                     config, Result, *LinkerFirst, *LinkerSecond));
 
     if (config.OutputLlvmIR) {
-        // Write LLVM IR to output files
+        // Remove dead arguments and write LLVM IR to output files
+        eliminateDeadArguments(*config.First, config.FirstFun);
+        eliminateDeadArguments(*config.Second, config.SecondFun);
         writeIRToFile(*config.First, config.FirstOutFile);
         writeIRToFile(*config.Second, config.SecondOutFile);
     }
 }
+
+/// Replace the globals in the missing definitions of a result by the globals
+/// of the same names from the given modules, so that the result does not refer
+/// to the modules in which it was computed.
+static void remapMissingDefs(OverallResult &Result,
+                             const Module &First,
+                             const Module &Second) {
+    std::vector<GlobalValuePair> MissingDefs;
+    for (auto &MissingDef : Result.missingDefs) {
+        const GlobalValue *DefFirst =
+                MissingDef.first
+                        ? First.getNamedValue(MissingDef.first->getName())
+                        : nullptr;
+        const GlobalValue *DefSecond =
+                MissingDef.second
+                        ? Second.getNamedValue(MissingDef.second->getName())
+                        : nullptr;
+        if (DefFirst || DefSecond)
+            MissingDefs.emplace_back(DefFirst, DefSecond);
+    }
+    Result.missingDefs = std::move(MissingDefs);
+}
+
+/// Run pre-process passes on the modules specified in the config and compare
+/// them w.r.t. the value of each variable from config.Variables.
+/// The modules are parsed (and missing definitions are linked) once for all
+/// variables. All functions except the main ones are pre-processed once and
+/// the structure types are analysed once, too. Each variable is then analysed
+/// on a copy of the pre-processed modules in which the main functions are
+/// sliced w.r.t. the variable and pre-processed afterwards. The copies are
+/// released (and written to the output files if requested) once the variable
+/// is compared. Analysis of macros does not depend on the variable, hence it
+/// is shared by all variables.
+void processAndCompare(Config &config, MultiVariableResult &Result) {
+    std::unique_ptr<MissingDefsLinker> LinkerFirst, LinkerSecond;
+    if (!config.FirstSymbolIndex.empty() || !config.SecondSymbolIndex.empty()) {
+        LinkerFirst = std::make_unique<MissingDefsLinker>(
+                *config.First, config.FirstSymbolIndex);
+        LinkerSecond = std::make_unique<MissingDefsLinker>(
+                *config.Second, config.SecondSymbolIndex);
+    }
+
+    // Missing definitions of all variables (used for linking).
+    OverallResult MissingDefsResult;
+    MacroDiffAnalysis MacroDiffs;
+    do {
+        Result.variableResults.clear();
+        MissingDefsResult = OverallResult();
+
+        preprocessModule(*config.First,
+                         config.FirstFun,
+                         nullptr,
+                         config.ControlFlowOnly,
+                         config.FusedPreprocessing,
+                         true);
+        preprocessModule(*config.Second,
+                         config.SecondFun,
+                         nullptr,
+                         config.ControlFlowOnly,
+                         config.FusedPreprocessing,
+                         true);
+        config.refreshFunctions();
+        // The structure types of the copies are the same as the types of the
+        // pre-processed modules (the types are owned by the context). Since
+        // only the main functions are sliced, the types used in the copies
+        // are a subset of the types used in the modules.
+        StructureAnalyses Structures = analyseStructures(config);
+        std::swap(Structures.MacroDiffs, MacroDiffs);
+
+        std::unique_ptr<Module> First = std::move(config.First);
+        std::unique_ptr<Module> Second = std::move(config.Second);
+        for (auto &Var : config.Variables) {
+            DEBUG_WITH_TYPE(DEBUG_SIMPLL,
+                            dbgs() << "Comparing w.r.t. variable " << Var
+                                   << "\n");
+            config.First = cloneModule(*First);
+            config.Second = cloneModule(*Second);
+            config.refreshFunctions();
+            config.setVariable(Var);
+            preprocessMainFunction(*config.First,
+                                   config.FirstFun,
+                                   config.FirstVar,
+                                   config.ControlFlowOnly,
+                                   config.FusedPreprocessing);
+            preprocessMainFunction(*config.Second,
+                                   config.SecondFun,
+                                   config.SecondVar,
+                                   config.ControlFlowOnly,
+                                   config.FusedPreprocessing);
+            config.refreshFunctions();
+
+            VariableResult VarResult;
+            VarResult.variable = Var;
+            simplifyModulesDiff(config, VarResult.result, &Structures);
+
+            if (config.OutputLlvmIR) {
+                // Remove dead arguments and write LLVM IR of the variable to
+                // output files
+                eliminateDeadArguments(*config.First, config.FirstFun);
+                eliminateDeadArguments(*config.Second, config.SecondFun);
+                writeIRToFile(*config.First,
+                              addSuffix(config.FirstOutFile, Var));
+                writeIRToFile(*config.Second,
+                              addSuffix(config.SecondOutFile, Var));
+            }
+            // The copies are released, hence the missing definitions must
+            // refer to the pre-processed modules.
+            remapMissingDefs(VarResult.result, *First, *Second);
+            config.First.reset();
+            config.Second.reset();
+
+            MissingDefsResult.missingDefs.insert(
+                    MissingDefsResult.missingDefs.end(),
+                    VarResult.result.missingDefs.begin(),
+                    VarResult.result.missingDefs.end());
+            Result.variableResults.push_back(std::move(VarResult));
+        }
+        std::swap(Structures.MacroDiffs, MacroDiffs);
+        config.First = std::move(First);
+        config.Second = std::move(Second);
+        config.refreshFunctions();
+        config.setVariable("");
+    } while (LinkerFirst
+             && linkMissingDefinitions(config,
+                                       MissingDefsResult,
+                                       *LinkerFirst,
+                                       *LinkerSecond));
+}
@@ -16,8 +16,13 @@
 #define DIFFKEMP_SIMPLL_INDEPENDENTPASSES_H
 
 #include "Config.h"
+#include "GlobalCorrespondence.h"
 #include "ModuleComparator.h"
+#include "SymbolIndex.h"
 #include "Utils.h"
+#include "passes/StructureDebugInfoAnalysis.h"
+#include "passes/StructureSizeAnalysis.h"
+#include "passes/TypeIndexAnalysis.h"
 #include <llvm/IR/Function.h>
 #include <llvm/IR/Module.h>
 #include <set>
@@ -32,20 +37,85 @@ using namespace llvm;
 /// \param Var Global variable w.r.t. to whose value the semantic diff will be
 ///            done. Can be set to NULL, but specifying this enables more
 ///            aggresive simplification.
+/// \param Fused Run the function transformations fused in a single walk over
+///              instructions instead of running the separate passes.
+/// \param SkipMain Do not slice and transform the main function, this is left
+///                 for preprocessMainFunction.
 void preprocessModule(Module &Mod,
                       Function *Main,
                       GlobalVariable *Var,
-                      bool ControlFlowOnly);
+                      bool ControlFlowOnly,
+                      bool Fused = true,
+                      bool SkipMain = false);
+
+/// Slice the main function of a module pre-processed by preprocessModule with
+/// SkipMain set w.r.t. the value of a global variable (if given) and run the
+/// function transformations of preprocessModule on it.
+void preprocessMainFunction(Module &Mod,
+                            Function *Main,
+                            GlobalVariable *Var,
+                            bool ControlFlowOnly,
+                            bool Fused = true);
+
+/// Results of analyses of structure types of the compared modules.
+struct StructureAnalyses {
+    StructureSizeAnalysis::Result SizeMapL;
+    StructureSizeAnalysis::Result SizeMapR;
+    StructureDebugInfoAnalysis::Result DebugInfoL;
+    StructureDebugInfoAnalysis::Result DebugInfoR;
+    std::unique_ptr<TypeIndex> TypesL;
+    std::unique_ptr<TypeIndex> TypesR;
+    // Macro uses do not depend on the compared global variable, hence the
+    // analysis of macros can be shared when comparing the modules w.r.t.
+    // multiple variables.
+    MacroDiffAnalysis MacroDiffs;
+};
+
+/// Analyse structure types of the modules specified in the config.
+StructureAnalyses analyseStructures(Config &config);
+
+/// Get pairs of corresponding functions of the compared modules in the
+/// bottom-up order of the merged call graph of both modules, i.e. callees
+/// (called from either module) go before their callers. Functions that do not
+/// have a counterpart in the other module are not included.
+std::vector<std::pair<Function *, Function *>>
+        getBottomUpOrder(Module &First,
+                         Module &Second,
+                         const GlobalCorrespondence &Globals);
 
 /// Simplify two corresponding modules for the purpose of their subsequent
 /// semantic difference analysis. Tries to remove all the code that is
 /// syntactically equal between the modules which should decrease the complexity
 /// of the semantic diff.
-void simplifyModulesDiff(Config &config, OverallResult &Result);
+/// \param Structures Results of the structure analyses of the modules. If not
+///                   given, the modules are analysed.
+void simplifyModulesDiff(Config &config,
+                         OverallResult &Result,
+                         StructureAnalyses *Structures = nullptr);
+
+/// Link missing definitions reported by the comparison into the original
+/// modules (kept by the linkers) and replace the compared modules in config by
+/// new copies of the original ones.
+/// \return True if any definition was linked (the comparison has to be then
+///         run again).
+bool linkMissingDefinitions(Config &config,
+                            OverallResult &Result,
+                            MissingDefsLinker &LinkerFirst,
+                            MissingDefsLinker &LinkerSecond);
 
 /// Run pre-process passes on the modules specified in the config and compare
 /// them using simplifyModulesDiff. The output is written to files specified
 /// in config.
 void processAndCompare(Config &config, OverallResult &Result);
 
+/// Run pre-process passes on the modules specified in the config and compare
+/// them w.r.t. the value of each variable from config.Variables. The modules
+/// are parsed and pre-processed only once (except for the main functions) and
+/// their structure types are analysed once. Each variable is then analysed on
+/// a copy of the pre-processed modules in which the main functions are sliced
+/// w.r.t. the variable and pre-processed. The output for each variable is
+/// written to the files specified in config with the variable name added as
+/// a suffix.
+void processAndCompare(Config &config, MultiVariableResult &Result);
+
 #endif // DIFFKEMP_SIMPLL_INDEPENDENTPASSES_H
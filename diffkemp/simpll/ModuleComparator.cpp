@@ -18,6 +18,7 @@
 #include "Utils.h"
 #include "passes/FieldAccessFunctionGenerator.h"
 #include "passes/FunctionAbstractionsGenerator.h"
+#include <llvm/IR/InstIterator.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Transforms/Utils/Cloning.h>
 
@@ -41,18 +42,20 @@ void ModuleComparator::compareFunctions(Function *FirstFun,
         return;
     }
 
+    // Do not compare any more functions if the memory limit was exceeded.
+    if (config.Memory.isLimitExceeded()) {
+        ComparedFuns.at({FirstFun, SecondFun}).kind = Result::UNKNOWN;
+        return;
+    }
+
     // Comparing function declarations (function without bodies).
     if (FirstFun->isDeclaration() || SecondFun->isDeclaration()) {
         // Drop suffixes of function names. This is necessary in order to
         // successfully compare an original void-returning function with one
         // generated by RemoveUnusedReturnValuesPass, which will have a number
         // suffix.
-        auto FirstFunName = FirstFun->getName().str();
-        if (hasSuffix(FirstFunName))
-            FirstFunName = dropSuffix(FirstFunName);
-        auto SecondFunName = SecondFun->getName().str();
-        if (hasSuffix(SecondFunName))
-            SecondFunName = dropSuffix(SecondFunName);
+        StringRef FirstFunName = getBaseName(FirstFun);
+        StringRef SecondFunName = getBaseName(SecondFun);
 
         if (config.ControlFlowOnly) {
             // If checking control flow only, it suffices that one of the
@@ -98,9 +101,21 @@ void ModuleComparator::compareFunctions(Function *FirstFun,
         return;
     }
 
+    // Comparisons of called functions started from here are nested.
+    ++ComparisonDepth;
+
+    // Inline simple wrappers that were added or removed before the first
+    // comparison (if enabled). Otherwise, they are inlined one by one after
+    // the comparison fails.
+    std::pair<std::vector<const Function *>, std::vector<const Function *>>
+            InlinedWrappers;
+    if (config.InlineWrappersLimit)
+        InlinedWrappers = inlineWrappers(FirstFun, SecondFun);
+
     // Comparing functions with bodies using custom FunctionComparator.
     DifferentialFunctionComparator fComp(FirstFun, SecondFun, config, DI, this);
     int result = fComp.compare();
+    Stats.comparedFunctions++;
 
     DEBUG_WITH_TYPE(DEBUG_SIMPLL, decreaseDebugIndentLevel());
     if (result == 0) {
@@ -160,8 +175,10 @@ void ModuleComparator::compareFunctions(Function *FirstFun,
                         missingDefs.first = toInline;
                 } else {
                     InlineFunctionInfo ifi;
-                    if (InlineFunction(inlineFirst, ifi, nullptr, false))
+                    if (InlineFunction(inlineFirst, ifi, nullptr, false)) {
                         inlined = true;
+                        Stats.inlinedCalls++;
+                    }
                 }
             }
             if (inlineSecond) {
@@ -180,8 +197,10 @@ void ModuleComparator::compareFunctions(Function *FirstFun,
                         missingDefs.second = toInline;
                 } else {
                     InlineFunctionInfo ifi;
-                    if (InlineFunction(inlineSecond, ifi, nullptr, false))
+                    if (InlineFunction(inlineSecond, ifi, nullptr, false)) {
                         inlined = true;
+                        Stats.inlinedCalls++;
+                    }
                 }
             }
             // If some function to be inlined does not have a declaration,
@@ -203,6 +222,7 @@ void ModuleComparator::compareFunctions(Function *FirstFun,
             DifferentialFunctionComparator fCompSecond(
                     FirstFun, SecondFun, config, DI, this);
             result = fCompSecond.compare();
+            Stats.comparedFunctions++;
             // If the functions are equal after the inlining and there is a
             // call to the inlined function, mark it as weak.
             if (!result) {
@@ -234,4 +254,174 @@ void ModuleComparator::compareFunctions(Function *FirstFun,
             }
         }
     }
+
+    // If the functions are equal, calls to the inlined wrappers are weak
+    // (the same as for the functions inlined above).
+    Result &FunResult = ComparedFuns.at({FirstFun, SecondFun});
+    if (FunResult.kind == Result::EQUAL) {
+        for (const Function *Wrapper : InlinedWrappers.first)
+            for (const CallInfo &CI : FunResult.First.calls) {
+                if (CI.fun == Wrapper->getName().str())
+                    CI.weak = true;
+            }
+        for (const Function *Wrapper : InlinedWrappers.second)
+            for (const CallInfo &CI : FunResult.Second.calls) {
+                if (CI.fun == Wrapper->getName().str())
+                    CI.weak = true;
+            }
+    }
+
+    --ComparisonDepth;
+    ResultsMemory += ComparedFuns.at({FirstFun, SecondFun}).getMemoryUsage();
+    checkMemory();
+}
+
+/// Get the function wrapped by a simple wrapper. A simple wrapper is a defined
+/// function having at most Limit instructions that calls a single function
+/// (intrinsics and SimpLL abstractions do not count). Variadic functions,
+/// recursive functions, and wrappers containing indirect calls are excluded.
+/// \return The wrapped function or null if the function is not a simple
+///         wrapper.
+static const Function *getWrappedFunction(const Function *Fun,
+                                          unsigned Limit) {
+    if (Fun->isDeclaration() || Fun->isVarArg() || isSimpllAbstraction(Fun))
+        return nullptr;
+
+    const Function *Wrapped = nullptr;
+    unsigned Size = 0;
+    for (auto &Inst : instructions(Fun)) {
+        if (++Size > Limit)
+            return nullptr;
+        auto Call = dyn_cast<CallInst>(&Inst);
+        if (!Call)
+            continue;
+        const Function *Callee = getCalledFunction(Call->getCalledValue());
+        if (!Callee)
+            return nullptr;
+        if (Callee->isIntrinsic() || isSimpllAbstraction(Callee))
+            continue;
+        if (Wrapped || Callee == Fun)
+            return nullptr;
+        Wrapped = Callee;
+    }
+    return Wrapped;
+}
+
+/// Inline simple wrappers in both compared functions. The wrappers that are
+/// called from one function only typically were added or removed between
+/// the compared versions. Without this, each of them would be inlined
+/// separately via tryInline, followed by a new comparison of the functions.
+std::pair<std::vector<const Function *>, std::vector<const Function *>>
+        ModuleComparator::inlineWrappers(Function *FirstFun,
+                                         Function *SecondFun) {
+    StringSet<> CalledFirst = getCalledNames(FirstFun);
+    StringSet<> CalledSecond = getCalledNames(SecondFun);
+    Result &FunResult = ComparedFuns.at({FirstFun, SecondFun});
+
+    auto InlinedFirst =
+            inlineWrappersIn(FirstFun, CalledSecond, FunResult.First);
+    auto InlinedSecond =
+            inlineWrappersIn(SecondFun, CalledFirst, FunResult.Second);
+    if (!InlinedFirst.empty())
+        simplifyFunction(FirstFun);
+    if (!InlinedSecond.empty())
+        simplifyFunction(SecondFun);
+    return {InlinedFirst, InlinedSecond};
+}
+
+/// Inline calls to simple wrappers in the function. A wrapper is inlined if
+/// it is not called by the other compared function (by its name) while the
+/// wrapped function is. Only the calls present in the function before the
+/// inlining are considered, i.e. the wrappers are not inlined recursively.
+std::vector<const Function *>
+        ModuleComparator::inlineWrappersIn(Function *Fun,
+                                           const StringSet<> &CalledOther,
+                                           FunctionInfo &Info) {
+    std::vector<CallInst *> ToInline;
+    for (auto &Inst : instructions(Fun)) {
+        auto Call = dyn_cast<CallInst>(&Inst);
+        if (!Call)
+            continue;
+        Function *Callee = getCalledFunction(Call->getCalledValue());
+        if (!Callee || CalledOther.count(getBaseName(Callee)))
+            continue;
+        const Function *Wrapped =
+                getWrappedFunction(Callee, config.InlineWrappersLimit);
+        if (Wrapped && CalledOther.count(getBaseName(Wrapped)))
+            ToInline.push_back(Call);
+    }
+
+    std::vector<const Function *> Inlined;
+    for (CallInst *Call : ToInline) {
+        Function *Wrapper = getCalledFunction(Call->getCalledValue());
+        DEBUG_WITH_TYPE(DEBUG_SIMPLL,
+                        dbgs() << getDebugIndent() << "Inlining wrapper "
+                               << Wrapper->getName() << " in "
+                               << Fun->getName() << "\n");
+        // The call is recorded so that it can be marked as weak later.
+        int Line = Call->getDebugLoc() ? Call->getDebugLoc()->getLine() : 0;
+        InlineFunctionInfo ifi;
+        if (InlineFunction(Call, ifi, nullptr, false)) {
+            Info.addCall(Wrapper, Line);
+            Inlined.push_back(Wrapper);
+            Stats.inlinedCalls++;
+        }
+    }
+    return Inlined;
+}
+
+/// Get base names of all functions called by the function.
+StringSet<> ModuleComparator::getCalledNames(const Function *Fun) const {
+    StringSet<> Names;
+    for (auto &Inst : instructions(Fun)) {
+        if (auto Call = dyn_cast<CallInst>(&Inst)) {
+            if (auto Callee = getCalledFunction(Call->getCalledValue()))
+                Names.insert(getBaseName(Callee));
+        }
+    }
+    return Names;
+}
+
+/// Record the memory used by the macro analysis, by the debug info maps, and
+/// by the results and check it against the memory limit. When the limit is
+/// reached, the caches of the macro analysis and of the type comparisons are
+/// dropped. If that does not help, the comparison is stopped and the
+/// remaining function pairs get an unknown result.
+/// This is called after each comparison of functions, including the nested
+/// comparisons of called functions. The comparisons in progress may hold
+/// references to the cached macros, hence the caches are only dropped when
+/// no comparison is in progress. The nested comparisons only check whether
+/// dropping the caches would be enough.
+void ModuleComparator::checkMemory() {
+    MemoryAccounting &Memory = config.Memory;
+    uint64_t CacheMemory =
+            MacroDiffs.getMemoryUsage() + TypeComparisons.getMemorySize();
+    Memory.update(MemorySubsystem::Macros, MacroDiffs.getMemoryUsage());
+    if (DI)
+        Memory.update(MemorySubsystem::DebugInfo, DI->getMemoryUsage());
+    Memory.update(MemorySubsystem::Results,
+                  ResultsMemory + TypeComparisons.getMemorySize());
+    if (!Memory.isOverLimit() || Memory.isLimitExceeded())
+        return;
+
+    if (ComparisonDepth == 0) {
+        DEBUG_WITH_TYPE(DEBUG_SIMPLL,
+                        dbgs() << getDebugIndent() << "Memory limit reached, "
+                               << "dropping caches\n");
+        MacroDiffs.clearCaches();
+        TypeComparisons.shrink_and_clear();
+        Memory.recordCacheShed();
+        Memory.update(MemorySubsystem::Macros, MacroDiffs.getMemoryUsage());
+        Memory.update(MemorySubsystem::Results,
+                      ResultsMemory + TypeComparisons.getMemorySize());
+    } else if (Memory.getTotal() - CacheMemory <= Memory.getLimit())
+        // Dropping the caches will be enough, do it once the comparisons in
+        // progress are finished.
+        return;
+
+    if (Memory.isOverLimit()) {
+        Memory.setLimitExceeded();
+        errs() << "SimpLL memory limit exceeded (" << (Memory.getTotal() >> 20)
+               << " MiB used), the remaining functions are not compared\n";
+    }
 }
@@ -17,17 +17,53 @@
 
 #include "Config.h"
 #include "DebugInfo.h"
+#include "GlobalCorrespondence.h"
 #include "Result.h"
 #include "ResultsCache.h"
 #include "SourceCodeUtils.h"
 #include "Utils.h"
 #include "passes/StructureDebugInfoAnalysis.h"
 #include "passes/StructureSizeAnalysis.h"
+#include "passes/TypeIndexAnalysis.h"
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/Hashing.h>
+#include <llvm/ADT/StringSet.h>
 #include <llvm/IR/Module.h>
 #include <set>
 
 using namespace llvm;
 
+/// Key of the cache of type comparisons: the compared types and the mode of
+/// the comparison (whether only the control flow is compared).
+struct TypeComparisonKey {
+    Type *L;
+    Type *R;
+    bool ControlFlowOnly;
+
+    bool operator==(const TypeComparisonKey &Other) const {
+        return L == Other.L && R == Other.R
+               && ControlFlowOnly == Other.ControlFlowOnly;
+    }
+};
+
+namespace llvm {
+template <> struct DenseMapInfo<TypeComparisonKey> {
+    static TypeComparisonKey getEmptyKey() {
+        return {DenseMapInfo<Type *>::getEmptyKey(), nullptr, false};
+    }
+    static TypeComparisonKey getTombstoneKey() {
+        return {DenseMapInfo<Type *>::getTombstoneKey(), nullptr, false};
+    }
+    static unsigned getHashValue(const TypeComparisonKey &Key) {
+        return hash_combine(Key.L, Key.R, Key.ControlFlowOnly);
+    }
+    static bool isEqual(const TypeComparisonKey &A,
+                        const TypeComparisonKey &B) {
+        return A == B;
+    }
+};
+} // namespace llvm
+
 class ModuleComparator {
     Module &First;
     Module &Second;
@@ -42,8 +78,23 @@ class ModuleComparator {
     // Structure name to structure debug info map.
     StructureDebugInfoAnalysis::Result &StructDIMapL;
     StructureDebugInfoAnalysis::Result &StructDIMapR;
+    // Indices of types used in the modules (optional).
+    TypeIndex *TypesL;
+    TypeIndex *TypesR;
+    // Table of corresponding globals of the modules (optional).
+    const GlobalCorrespondence *Globals;
     // Counter of assembly diffs
     int asmDifferenceCounter = 0;
+    // Statistics of the comparison
+    ComparisonStats Stats;
+    // Estimate of the memory taken by the results of the compared functions.
+    uint64_t ResultsMemory = 0;
+    // Number of comparisons of functions in progress (comparisons of called
+    // functions are nested in the comparisons of their callers).
+    unsigned ComparisonDepth = 0;
+    // Results of type comparisons shared by all function comparators. The
+    // result of a type comparison does not depend on the compared functions.
+    DenseMap<TypeComparisonKey, int> TypeComparisons;
 
     std::vector<GlobalValuePair> MissingDefs;
 
@@ -54,8 +105,13 @@ class ModuleComparator {
     /// data passed from DiffKemp.
     ResultsCache ResCache;
 
+  private:
+    /// Analysis of differences in macros used if no shared one is given.
+    MacroDiffAnalysis OwnMacroDiffs;
+
+  public:
     /// Analysis of differences in macros
-    MacroDiffAnalysis MacroDiffs;
+    MacroDiffAnalysis &MacroDiffs;
 
     ModuleComparator(Module &First,
                      Module &Second,
@@ -64,11 +120,23 @@ class ModuleComparator {
                      StructureSizeAnalysis::Result &StructSizeMapL,
                      StructureSizeAnalysis::Result &StructSizeMapR,
                      StructureDebugInfoAnalysis::Result &StructDIMapL,
-                     StructureDebugInfoAnalysis::Result &StructDIMapR)
+                     StructureDebugInfoAnalysis::Result &StructDIMapR,
+                     TypeIndex *TypesL = nullptr,
+                     TypeIndex *TypesR = nullptr,
+                     const GlobalCorrespondence *Globals = nullptr,
+                     MacroDiffAnalysis *SharedMacroDiffs = nullptr)
             : First(First), Second(Second), config(config), DI(DI),
-              ResCache(config.CacheDir), MacroDiffs(),
+              ResCache(config.CacheDir), OwnMacroDiffs(),
+              MacroDiffs(SharedMacroDiffs ? *SharedMacroDiffs : OwnMacroDiffs),
               StructSizeMapL(StructSizeMapL), StructSizeMapR(StructSizeMapR),
-              StructDIMapL(StructDIMapL), StructDIMapR(StructDIMapR) {}
+              StructDIMapL(StructDIMapL), StructDIMapR(StructDIMapR),
+              TypesL(TypesL), TypesR(TypesR), Globals(Globals) {}
+
+    /// Get name of the global value without the .<NUMBER> suffix.
+    StringRef getBaseName(const GlobalValue *GV) const {
+        return Globals ? Globals->getBaseName(GV)
+                       : ::getBaseName(GV->getName());
+    }
 
     /// Syntactically compare two functions.
     /// The result of the comparison is stored into the ComparedFuns map.
@@ -78,6 +146,30 @@ class ModuleComparator {
     /// functions and needs to be inlined.
     std::pair<const CallInst *, const CallInst *> tryInline = {nullptr,
                                                                nullptr};
+
+  private:
+    /// Inline calls to simple wrappers that are called from one of the
+    /// functions only before the functions are compared.
+    /// \return Inlined wrappers (for each of the functions).
+    std::pair<std::vector<const Function *>, std::vector<const Function *>>
+            inlineWrappers(Function *FirstFun, Function *SecondFun);
+
+    /// Inline calls to simple wrappers in a single function.
+    /// \param CalledOther Names of functions called by the other compared
+    ///                    function.
+    /// \param Info Information about the function in the result, calls to
+    ///             the inlined wrappers are added to it.
+    std::vector<const Function *>
+            inlineWrappersIn(Function *Fun,
+                             const StringSet<> &CalledOther,
+                             FunctionInfo &Info);
+
+    /// Get base names of all functions called by the function.
+    StringSet<> getCalledNames(const Function *Fun) const;
+
+    /// Record the memory used by the comparison and check it against the
+    /// memory limit.
+    void checkMemory();
 };
 
 #endif // DIFFKEMP_SIMPLL_MODULECOMPARATOR_H
@@ -114,12 +114,62 @@ template <> struct MappingTraits<GlobalValuePair> {
 
 LLVM_YAML_IS_SEQUENCE_VECTOR(GlobalValuePair)
 
+// MemoryStats to YAML
+namespace llvm::yaml {
+template <> struct MappingTraits<MemoryStats> {
+    static void mapping(IO &io, MemoryStats &stats) {
+        io.mapRequired("peak", stats.peak);
+        io.mapRequired("modules", stats.modules);
+        io.mapRequired("macros", stats.macros);
+        io.mapRequired("debug-info", stats.debugInfo);
+        io.mapRequired("results", stats.results);
+        io.mapRequired("cache-sheds", stats.cacheSheds);
+        io.mapRequired("limit-exceeded", stats.limitExceeded);
+    }
+};
+} // namespace llvm::yaml
+
+// ComparisonStats to YAML
+namespace llvm::yaml {
+template <> struct MappingTraits<ComparisonStats> {
+    static void mapping(IO &io, ComparisonStats &stats) {
+        io.mapRequired("compared-functions", stats.comparedFunctions);
+        io.mapRequired("inlined-calls", stats.inlinedCalls);
+        io.mapRequired("memory", stats.memory);
+    }
+};
+} // namespace llvm::yaml
+
 // OverallResult to YAML
 namespace llvm::yaml {
 template <> struct MappingTraits<OverallResult> {
     static void mapping(IO &io, OverallResult &result) {
         io.mapOptional("function-results", result.functionResults);
         io.mapOptional("missing-defs", result.missingDefs);
+        io.mapRequired("stats", result.stats);
+    }
+};
+} // namespace llvm::yaml
+
+// VariableResult to YAML
+namespace llvm::yaml {
+template <> struct MappingTraits<VariableResult> {
+    static void mapping(IO &io, VariableResult &result) {
+        io.mapRequired("variable", result.variable);
+        io.mapOptional("function-results", result.result.functionResults);
+        io.mapOptional("missing-defs", result.result.missingDefs);
+        io.mapRequired("stats", result.result.stats);
+    }
+};
+} // namespace llvm::yaml
+
+LLVM_YAML_IS_SEQUENCE_VECTOR(VariableResult)
+
+// MultiVariableResult to YAML
+namespace llvm::yaml {
+template <> struct MappingTraits<MultiVariableResult> {
+    static void mapping(IO &io, MultiVariableResult &result) {
+        io.mapOptional("variable-results", result.variableResults);
     }
 };
 } // namespace llvm::yaml
@@ -138,3 +188,18 @@ std::string reportOutputToString(Config &config, OverallResult &result) {
     output << result;
     return DumpStrm.str();
 }
+
+/// Report the results for multiple variables in YAML format to stdout.
+void reportOutput(Config &config, MultiVariableResult &result) {
+    llvm::yaml::Output output(outs());
+    output << result;
+}
+
+/// Report the results for multiple variables in YAML format to a string.
+std::string reportOutputToString(Config &config, MultiVariableResult &result) {
+    std::string DumpStr;
+    llvm::raw_string_ostream DumpStrm(DumpStr);
+    llvm::yaml::Output output(DumpStrm);
+    output << result;
+    return DumpStrm.str();
+}
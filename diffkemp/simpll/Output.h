@@ -28,4 +28,10 @@ void reportOutput(Config &config, OverallResult &Result);
 /// Report the overall result in YAML format to a string.
 std::string reportOutputToString(Config &config, OverallResult &result);
 
+/// Report the results for multiple variables in YAML format to stdout.
+void reportOutput(Config &config, MultiVariableResult &result);
+
+/// Report the results for multiple variables in YAML format to a string.
+std::string reportOutputToString(Config &config, MultiVariableResult &result);
+
 #endif // DIFFKEMP_SIMPLL_OUTPUT_H
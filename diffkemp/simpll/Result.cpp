@@ -46,3 +46,36 @@ void Result::addDifferingObjects(
                             std::make_move_iterator(Objects.begin()),
                             std::make_move_iterator(Objects.end()));
 }
+
+/// Estimate the memory taken by the function info (in bytes).
+static uint64_t estimateMemory(const FunctionInfo &Info) {
+    uint64_t Bytes = Info.name.capacity() + Info.file.capacity();
+    for (auto &Call : Info.calls)
+        Bytes += sizeof(CallInfo) + Call.fun.capacity() + Call.file.capacity();
+    return Bytes;
+}
+
+/// Estimate the memory taken by the call stack (in bytes).
+static uint64_t estimateMemory(const CallStack &Stack) {
+    uint64_t Bytes = Stack.capacity() * sizeof(CallInfo);
+    for (auto &Call : Stack)
+        Bytes += Call.fun.capacity() + Call.file.capacity();
+    return Bytes;
+}
+
+/// Estimate the memory taken by the result (in bytes).
+uint64_t Result::getMemoryUsage() const {
+    uint64_t Bytes = sizeof(Result) + estimateMemory(First)
+                     + estimateMemory(Second);
+    for (auto &Object : DifferingObjects) {
+        Bytes += Object->name.capacity() + Object->function.capacity()
+                 + estimateMemory(Object->StackL)
+                 + estimateMemory(Object->StackR);
+        if (auto SynDiff = dyn_cast<SyntaxDifference>(Object.get()))
+            Bytes += sizeof(SyntaxDifference) + SynDiff->BodyL.capacity()
+                     + SynDiff->BodyR.capacity();
+        else
+            Bytes += sizeof(TypeDifference);
+    }
+    return Bytes;
+}
@@ -15,6 +15,7 @@
 #ifndef DIFFKEMP_SIMPLL_RESULT_H
 #define DIFFKEMP_SIMPLL_RESULT_H
 
+#include "MemoryUsage.h"
 #include "Utils.h"
 #include <llvm/IR/Function.h>
 #include <memory>
@@ -159,13 +160,39 @@ class Result {
     /// Add multiple TypeDifference objects.
     void addDifferingObjects(
             std::vector<std::unique_ptr<TypeDifference>> &&Object);
+
+    /// Estimate the memory taken by the result (in bytes).
+    uint64_t getMemoryUsage() const;
+};
+
+/// Statistics of the comparison used to track the performance of SimpLL.
+struct ComparisonStats {
+    // Number of runs of DifferentialFunctionComparator.
+    int comparedFunctions = 0;
+    // Number of calls inlined during the comparison.
+    int inlinedCalls = 0;
+    // Peak memory usage of SimpLL until the end of the comparison.
+    MemoryStats memory;
 };
 
-/// The overall results containing results of all compared function pairs and a
-/// list of missing definitions.
+/// The overall results containing results of all compared function pairs, a
+/// list of missing definitions, and statistics of the comparison.
 struct OverallResult {
     std::vector<Result> functionResults;
     std::vector<GlobalValuePair> missingDefs;
+    ComparisonStats stats;
+};
+
+/// The result of the comparison w.r.t. the value of a single global variable.
+struct VariableResult {
+    std::string variable;
+    OverallResult result;
+};
+
+/// The results of the comparison w.r.t. the values of multiple global
+/// variables (one result per variable).
+struct MultiVariableResult {
+    std::vector<VariableResult> variableResults;
 };
 
 #endif // DIFFKEMP_SIMPLL_RESULT_H
@@ -24,12 +24,19 @@ int main(int argc, const char **argv) {
     cl::ParseCommandLineOptions(argc, argv);
     Config config;
 
-    // Run transformations and the comparison.
-    OverallResult Result;
-    processAndCompare(config, Result);
+    if (config.Variables.size() > 1) {
+        // Run transformations and the comparison for each variable.
+        MultiVariableResult Result;
+        processAndCompare(config, Result);
+        reportOutput(config, Result);
+    } else {
+        // Run transformations and the comparison.
+        OverallResult Result;
+        processAndCompare(config, Result);
 
-    // Report the result to standard output.
-    reportOutput(config, Result);
+        // Report the result to standard output.
+        reportOutput(config, Result);
+    }
 
     llvm_shutdown();
     return 0;
@@ -0,0 +1,163 @@
+//===-------- SimpLLGen.cpp - Generator of synthetic module pairs ---------===//
+//
+//       SimpLL - Program simplifier for analysis of semantic difference      //
+//
+// This file is published under Apache 2.0 license. See LICENSE for details.
+// Author: Viktor Malik, vmalik@redhat.com
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the main function of a tool generating pairs of
+/// synthetic LLVM modules for measuring how SimpLL scales.
+/// The tool writes the modules (first.ll and second.ll), their C sources
+/// (first.c and second.c), and a manifest (manifest.yaml) listing the root
+/// functions to compare and the injected differences into the output
+/// directory.
+///
+//===----------------------------------------------------------------------===//
+
+#include "SyntheticModuleGenerator.h"
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/ManagedStatic.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+
+using namespace llvm;
+
+cl::opt<std::string> OutputDirOpt(cl::Positional,
+                                  cl::Required,
+                                  cl::desc("<output directory>"));
+cl::opt<unsigned> FunctionsOpt("functions",
+                               cl::init(100),
+                               cl::desc("Number of functions."));
+cl::opt<unsigned> FanOutOpt("fan-out",
+                            cl::init(2),
+                            cl::desc("Number of calls done by each function."));
+cl::opt<unsigned> DepthOpt("depth",
+                           cl::init(4),
+                           cl::desc("Number of levels of the call graph."));
+cl::opt<unsigned> StructsOpt("structs",
+                             cl::init(10),
+                             cl::desc("Number of structure types."));
+cl::opt<unsigned> MacrosOpt("macros",
+                            cl::init(100),
+                            cl::desc("Number of macro definitions."));
+cl::opt<double>
+        AsmDensityOpt("asm-density",
+                      cl::init(0.1),
+                      cl::desc("Fraction of functions using inline asm."));
+cl::opt<double> DiffFractionOpt(
+        "diff-fraction",
+        cl::init(0.1),
+        cl::desc("Fraction of functions into which a difference is injected."));
+cl::list<std::string> DiffKindsOpt(
+        "diff-kinds",
+        cl::CommaSeparated,
+        cl::value_desc("kind"),
+        cl::desc("Kinds of injected differences (constant, macro, call, "
+                 "field, asm). All kinds are used by default."));
+cl::opt<unsigned> SeedOpt("seed",
+                          cl::init(0),
+                          cl::desc("Seed of the random generator."));
+
+/// Write the module into the output directory.
+static bool writeModule(Module &Mod, StringRef Name) {
+    if (verifyModule(Mod, &errs()))
+        return false;
+    SmallString<128> Path(OutputDirOpt);
+    sys::path::append(Path, Name);
+    std::error_code EC;
+    raw_fd_ostream Stream(Path, EC, sys::fs::F_None);
+    if (EC) {
+        errs() << "Cannot write " << Path << ": " << EC.message() << "\n";
+        return false;
+    }
+    Mod.print(Stream, nullptr);
+    Stream.close();
+    if (Stream.has_error()) {
+        errs() << "Cannot write " << Path << ": " << Stream.error().message()
+               << "\n";
+        Stream.clear_error();
+        return false;
+    }
+    return true;
+}
+
+/// Write the manifest describing the generated pair into the output
+/// directory.
+static bool writeManifest(const SyntheticModuleGenerator &Generator) {
+    SmallString<128> Path(OutputDirOpt);
+    sys::path::append(Path, "manifest.yaml");
+    std::error_code EC;
+    raw_fd_ostream Manifest(Path, EC, sys::fs::F_None);
+    if (EC) {
+        errs() << "Cannot write " << Path << ": " << EC.message() << "\n";
+        return false;
+    }
+    Manifest << "first: first.ll\n";
+    Manifest << "second: second.ll\n";
+    Manifest << "functions:\n";
+    for (auto &Root : Generator.getRoots())
+        Manifest << "  - " << Root << "\n";
+    auto Differences = Generator.getDifferences();
+    Manifest << "differences:" << (Differences.empty() ? " {}" : "") << "\n";
+    for (auto &Diff : Differences)
+        Manifest << "  " << Diff.first << ": "
+                 << getDifferenceKindName(Diff.second) << "\n";
+    Manifest.close();
+    if (Manifest.has_error()) {
+        errs() << "Cannot write " << Path << ": "
+               << Manifest.error().message() << "\n";
+        Manifest.clear_error();
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, const char **argv) {
+    cl::ParseCommandLineOptions(argc, argv);
+
+    GeneratorParams Params;
+    Params.Functions = FunctionsOpt;
+    Params.FanOut = FanOutOpt;
+    Params.Depth = DepthOpt;
+    Params.Structs = StructsOpt;
+    Params.Macros = MacrosOpt;
+    Params.AsmDensity = AsmDensityOpt;
+    Params.DiffFraction = DiffFractionOpt;
+    Params.Seed = SeedOpt;
+    if (!DiffKindsOpt.empty()) {
+        Params.DiffKinds.clear();
+        for (auto &Name : DiffKindsOpt) {
+            DifferenceKind Kind;
+            if (!parseDifferenceKind(Name, Kind)) {
+                errs() << "Unknown difference kind: " << Name << "\n";
+                return 1;
+            }
+            Params.DiffKinds.push_back(Kind);
+        }
+    }
+
+    if (std::error_code EC = sys::fs::create_directories(OutputDirOpt)) {
+        errs() << "Cannot create " << OutputDirOpt << ": " << EC.message()
+               << "\n";
+        return 1;
+    }
+    // Sources are referenced from the debug info, use an absolute path.
+    SmallString<128> OutputDir(OutputDirOpt);
+    sys::fs::make_absolute(OutputDir);
+
+    SyntheticModuleGenerator Generator(Params);
+    LLVMContext CtxFirst, CtxSecond;
+    auto First = Generator.generate(CtxFirst, false, OutputDir.str().str());
+    auto Second = Generator.generate(CtxSecond, true, OutputDir.str().str());
+    if (!First || !Second || !writeModule(*First, "first.ll")
+        || !writeModule(*Second, "second.ll") || !writeManifest(Generator))
+        return 1;
+
+    llvm_shutdown();
+    return 0;
+}
@@ -24,12 +24,11 @@
 /// Gets all macros used on a certain DILocation in the form of a StringMap
 /// mapping macro names to MacroUse objects
 void MacroDiffAnalysis::collectMacroUsesAtLocation(
-        DILocation *Loc, const StringMap<MacroDef> &macroDefs, int lineOffset) {
-
-    if (MacroUsesAtLocation.find(Loc) == MacroUsesAtLocation.end())
-        MacroUsesAtLocation.emplace(Loc, StringMap<MacroUse>());
-
-    std::string line = extractLineFromLocation(Loc, lineOffset);
+        DILocation *Loc,
+        const StringMap<MacroDef> &macroDefs,
+        StringMap<MacroUse> &ResultMacroUses,
+        int lineOffset) {
+    std::string line = getSourceLine(Loc, lineOffset);
     if (line.empty()) {
         // Source line was not found
         DEBUG_WITH_TYPE(DEBUG_SIMPLL_MACROS,
@@ -43,8 +42,6 @@ void MacroDiffAnalysis::collectMacroUsesAtLocation(
                            << "Looking for all macros on line:" << line
                            << "\n");
 
-    StringMap<MacroUse> &ResultMacroUses = MacroUsesAtLocation.at(Loc);
-
     // Search for all macros used at the line. The algorithm uses a queue to
     // store strings that must be explored. Initially, the queue contains the
     // current line and every time a macro identifier is found, the
@@ -159,29 +156,17 @@ void expandCompositeMacroNames(std::vector<std::string> params,
     }
 }
 
-/// Extract the line corresponding to the DILocation from the C source file.
-std::string extractLineFromLocation(DILocation *LineLoc, int offset) {
-    // Get the path of the source file corresponding to the module where the
-    // difference was found
-    if (LineLoc == nullptr)
-        // Line location was not found
-        return "";
-
-    auto sourcePath = getSourceFilePath(dyn_cast<DIScope>(LineLoc->getScope()));
-
-    // Open the C source file corresponding to the location and extract the line
-    auto sourceFile = MemoryBuffer::getFile(Twine(sourcePath));
-    if (sourceFile.getError()) {
-        // Source file was not found, return empty string
-        return "";
-    }
-
+/// Extract the line corresponding to the DILocation from the contents of its
+/// C source file.
+static std::string extractLineFromBuffer(const MemoryBuffer &Source,
+                                         DILocation *LineLoc,
+                                         int offset) {
     // Read the source file by lines, stop at the right number (the line that
     // is referenced by the DILocation)
     // The code also tries to include other lines belonging to the statement by
     // counting parenthesis - in case the line is only a part of the statement,
     // the other parts are added to it.
-    line_iterator it(**sourceFile);
+    line_iterator it(Source);
     std::string line, previousLine;
     while (!it.is_at_end()
            && it.line_number() != (LineLoc->getLine() + offset)) {
@@ -220,6 +205,91 @@ std::string extractLineFromLocation(DILocation *LineLoc, int offset) {
     return line;
 }
 
+/// Extract the line corresponding to the DILocation from the C source file.
+std::string extractLineFromLocation(DILocation *LineLoc, int offset) {
+    // Get the path of the source file corresponding to the module where the
+    // difference was found
+    if (LineLoc == nullptr)
+        // Line location was not found
+        return "";
+
+    auto sourcePath = getSourceFilePath(dyn_cast<DIScope>(LineLoc->getScope()));
+
+    // Open the C source file corresponding to the location and extract the line
+    auto sourceFile = MemoryBuffer::getFile(Twine(sourcePath));
+    if (sourceFile.getError()) {
+        // Source file was not found, return empty string
+        return "";
+    }
+    return extractLineFromBuffer(**sourceFile, LineLoc, offset);
+}
+
+/// Extract the line corresponding to the DILocation from the C source file.
+/// The source file is read only once, its contents are kept in SourceBuffers.
+/// Files that cannot be read are remembered as well (with a null buffer).
+std::string MacroDiffAnalysis::getSourceLine(DILocation *LineLoc,
+                                             int lineOffset) {
+    if (LineLoc == nullptr)
+        return "";
+
+    auto sourcePath = getSourceFilePath(dyn_cast<DIScope>(LineLoc->getScope()));
+    auto Cached = SourceBuffers.find(sourcePath);
+    if (Cached == SourceBuffers.end()) {
+        auto sourceFile = MemoryBuffer::getFile(Twine(sourcePath));
+        std::unique_ptr<MemoryBuffer> Buffer;
+        if (!sourceFile.getError()) {
+            Buffer = std::move(*sourceFile);
+            AllocatedBytes += Buffer->getBufferSize();
+        }
+        AllocatedBytes += sizeof(StringMapEntry<std::unique_ptr<MemoryBuffer>>)
+                          + sourcePath.size();
+        Cached = SourceBuffers.try_emplace(sourcePath, std::move(Buffer)).first;
+    }
+    if (!Cached->second)
+        return "";
+    return extractLineFromBuffer(*Cached->second, LineLoc, lineOffset);
+}
+
+/// Estimate the memory taken by the strings (in bytes).
+static uint64_t estimateMemory(const std::vector<std::string> &Strings) {
+    uint64_t Bytes = Strings.capacity() * sizeof(std::string);
+    for (auto &String : Strings)
+        Bytes += String.capacity();
+    return Bytes;
+}
+
+/// Estimate the memory taken by the macro definitions (in bytes).
+static uint64_t estimateMemory(const StringMap<MacroDef> &Defs) {
+    uint64_t Bytes = sizeof(Defs);
+    for (auto &Def : Defs)
+        Bytes += sizeof(Def) + Def.first().size() + Def.second.name.capacity()
+                 + Def.second.fullName.capacity()
+                 + Def.second.sourceFile.capacity()
+                 + estimateMemory(Def.second.params);
+    return Bytes;
+}
+
+/// Estimate the memory taken by the macro uses (in bytes).
+static uint64_t estimateMemory(const StringMap<MacroUse> &Uses) {
+    uint64_t Bytes = sizeof(Uses);
+    for (auto &Use : Uses)
+        Bytes += sizeof(Use) + Use.first().size()
+                 + Use.second.sourceFile.capacity()
+                 + estimateMemory(Use.second.args);
+    return Bytes;
+}
+
+/// Get the canonical key of the location: the macros of the compile unit, the
+/// source file, the line, and the line offset.
+MacroDiffAnalysis::MacroUsesKey
+        MacroDiffAnalysis::getLocationKey(DILocation *Loc, int lineOffset) {
+    auto compileUnit = Loc->getScope()->getSubprogram()->getUnit();
+    return MacroUsesKey{compileUnit->getMacros().get(),
+                        getSourceFilePath(Loc->getScope()),
+                        Loc->getLine(),
+                        lineOffset};
+}
+
 /// Get all macros used on a certain DILocation in the form of a StringMap
 /// mapping macro names to MacroUse objects
 const StringMap<MacroUse> &
@@ -230,24 +300,27 @@ const StringMap<MacroUse> &
         DEBUG_WITH_TYPE(DEBUG_SIMPLL_MACROS,
                         dbgs() << getDebugIndent()
                                << "Scope for macro not found\n");
-        MacroUsesAtLocation.emplace(Loc, StringMap<MacroUse>());
-        return MacroUsesAtLocation.at(Loc);
+        return NoMacroUses;
     }
 
     // Get macro definitions (collect them if they do not exist)
     auto compileUnit = Loc->getScope()->getSubprogram()->getUnit();
-    if (MacroDefMaps.find(compileUnit) == MacroDefMaps.end()) {
-        collectMacroDefs(compileUnit);
-    }
-    const auto &macroDefMap = MacroDefMaps.at(compileUnit);
-
-    // Collect macro usages if they do not exist (or if the line offset is
-    // non-zero) and return them
-    if (MacroUsesAtLocation.find(Loc) == MacroUsesAtLocation.end()
-        || lineOffset != 0) {
-        collectMacroUsesAtLocation(Loc, macroDefMap, lineOffset);
-    }
-    return MacroUsesAtLocation.at(Loc);
+    auto MacroDefs = MacroDefMaps.find(compileUnit->getMacros().get());
+    const auto &macroDefMap = MacroDefs != MacroDefMaps.end()
+                                      ? MacroDefs->second
+                                      : collectMacroDefs(compileUnit);
+
+    // Collect macro usages if they do not exist and return them
+    MacroUsesKey Key = getLocationKey(Loc, lineOffset);
+    auto Cached = MacroUsesAtLocation.find(Key);
+    if (Cached != MacroUsesAtLocation.end())
+        return Cached->second;
+
+    auto &Uses = MacroUsesAtLocation[Key];
+    collectMacroUsesAtLocation(Loc, macroDefMap, Uses, lineOffset);
+    AllocatedBytes += sizeof(Key) + std::get<1>(Key).capacity()
+                      + estimateMemory(Uses);
+    return Uses;
 }
 
 /// Find macro differences at the locations of the instructions L and R and
@@ -338,7 +411,8 @@ std::vector<std::unique_ptr<SyntaxDifference>>
 
 /// Collect all macros defined in the given compile unit and store them into
 /// MacroDefMaps
-void MacroDiffAnalysis::collectMacroDefs(DICompileUnit *CompileUnit) {
+const StringMap<MacroDef> &
+        MacroDiffAnalysis::collectMacroDefs(DICompileUnit *CompileUnit) {
     // Get macros definitions from debug info
     DIMacroNodeArray RawMacros = CompileUnit->getMacros();
     StringMap<const DIMacroFile *> macroFileMap;
@@ -399,7 +473,10 @@ void MacroDiffAnalysis::collectMacroDefs(DICompileUnit *CompileUnit) {
             }
     }
     // Put the created macro definition map into cache
-    MacroDefMaps.emplace(CompileUnit, std::move(macroDefs));
+    AllocatedBytes += estimateMemory(macroDefs);
+    return MacroDefMaps
+            .emplace(CompileUnit->getMacros().get(), std::move(macroDefs))
+            .first->second;
 }
 
 // Takes a string and the position of the first bracket and returns the
@@ -424,6 +501,44 @@ std::string getSubstringToMatchingBracket(std::string str, size_t position) {
         return output;
 }
 
+/// Escape sequences of C strings that are translated when converting inline
+/// ASM to the LLVM syntax. Other escape sequences are kept as they are.
+static const std::pair<char, char> AsmEscapeSequences[] = {{'t', '\t'},
+                                                           {'n', '\n'}};
+
+/// Translates the body of a C inline ASM (with sections already joined) to the
+/// LLVM syntax in a single pass:
+/// - %cN argument references are translated to ${N:c},
+/// - escape sequences from AsmEscapeSequences are replaced by the characters.
+static std::string translateInlineAsmBody(const std::string &body) {
+    std::string result;
+    result.reserve(body.size());
+    for (size_t i = 0; i < body.size(); i++) {
+        if (body[i] == '%' && i + 2 < body.size() && body[i + 1] == 'c'
+            && isdigit(body[i + 2])) {
+            size_t numEnd = i + 2;
+            while (numEnd < body.size() && isdigit(body[numEnd]))
+                ++numEnd;
+            result += "${" + body.substr(i + 2, numEnd - i - 2) + ":c}";
+            i = numEnd - 1;
+            continue;
+        }
+        if (body[i] == '\\' && i + 1 < body.size()) {
+            auto escape = std::find_if(
+                    std::begin(AsmEscapeSequences),
+                    std::end(AsmEscapeSequences),
+                    [&](auto &seq) { return seq.first == body[i + 1]; });
+            if (escape != std::end(AsmEscapeSequences)) {
+                result += escape->second;
+                ++i;
+                continue;
+            }
+        }
+        result += body[i];
+    }
+    return result;
+}
+
 /// Tries to convert C source syntax of inline ASM (the input may include other
 /// code, the inline asm is found and extracted) to the LLVM syntax.
 /// Returns a pair of strings - the first one contains the converted ASM, the
@@ -477,15 +592,7 @@ std::pair<std::string, std::string>
                                                 - 1);
     }
 
-    // Replaces inline asm argument syntax (assuming there are 20 or less
-    // arguments)
-    for (int i = 0; i < 20; i++)
-        findAndReplace(newBody,
-                       "%c" + std::to_string(i),
-                       "${" + std::to_string(i) + ":c}");
-    // Replace escape sequences
-    findAndReplace(newBody, "\\t", "\t");
-    findAndReplace(newBody, "\\n", "\n");
+    newBody = translateInlineAsmBody(newBody);
 
     // Extract arguments
     auto colon = extractedBody.find(':', lastQuotationMark + 1);
@@ -506,14 +613,65 @@ std::vector<std::string>
     // Empty inline asm string cannot be found by the function
     if (inlineAsm == "")
         return {};
+    return MacroDiffs->getInlineAsmSourceArguments(LineLoc, inlineAsm);
+}
 
+/// Get C source arguments of the inline assembly called at the given location.
+/// Results are memoised per location and inline assembly string.
+const std::vector<std::string> &MacroDiffAnalysis::getInlineAsmSourceArguments(
+        DILocation *Loc, const std::string &inlineAsm) {
+    if (!Loc || Loc->getNumOperands() == 0) {
+        NoArguments = collectInlineAsmSourceArguments(Loc, inlineAsm);
+        return NoArguments;
+    }
+
+    auto Key = std::make_pair(getLocationKey(Loc, 0), inlineAsm);
+    auto Cached = InlineAsmArguments.find(Key);
+    if (Cached != InlineAsmArguments.end())
+        return Cached->second;
+    auto Arguments = collectInlineAsmSourceArguments(Loc, inlineAsm);
+    AllocatedBytes += sizeof(Key) + std::get<1>(Key.first).capacity()
+                      + inlineAsm.capacity() + estimateMemory(Arguments);
+    return InlineAsmArguments.emplace(std::move(Key), std::move(Arguments))
+            .first->second;
+}
+
+/// Drop all collected macros, inline assembly arguments, and source files.
+/// Macro uses point to macro definitions, hence they are dropped first.
+void MacroDiffAnalysis::clearCaches() {
+    InlineAsmArguments.clear();
+    MacroUsesAtLocation.clear();
+    MacroDefMaps.clear();
+    SourceBuffers.clear();
+    AllocatedBytes = 0;
+}
+
+/// Length of the common prefix of the candidate and the inline asm. If the
+/// strings are equal, the terminating character is counted, too.
+static size_t matchingPrefixLength(const std::string &candidate,
+                                   const std::string &inlineAsm) {
+    auto mismatch = std::mismatch(candidate.begin(),
+                                  candidate.end(),
+                                  inlineAsm.begin(),
+                                  inlineAsm.end());
+    size_t length = mismatch.first - candidate.begin();
+    if (mismatch.first == candidate.end() && mismatch.second == inlineAsm.end())
+        ++length;
+    return length;
+}
+
+/// Collect C source arguments of the inline assembly called at the given
+/// location. The inline assembly is searched at the source line and in the
+/// bodies of macros used at the line.
+std::vector<std::string> MacroDiffAnalysis::collectInlineAsmSourceArguments(
+        DILocation *LineLoc, const std::string &inlineAsm) {
     // The function searches for the inline asm at two locations - the first one
     // is the line in the original C source code corresponding to the debug info
     // location, the second one are macros used on that line.
-    std::string line = extractLineFromLocation(LineLoc);
+    std::string line = getSourceLine(LineLoc);
     if (line == "")
         return {};
-    auto MacroMap = MacroDiffs->getAllMacroUsesAtLocation(LineLoc, 0);
+    auto &MacroMap = getAllMacroUsesAtLocation(LineLoc, 0);
 
     std::vector<std::string> inputs;
     std::vector<std::pair<std::string, std::string>> candidates;
@@ -531,22 +689,25 @@ std::vector<std::string>
             candidates.push_back(output);
     }
 
-    // If there is more than one candidate, compare the candidates character by
-    // character to the inline asm from LLVM IR and discards a candidate when
-    // its character at the current position does not correspond. This is
-    // repeated until one or no candidate is left.
-    int position = 0;
-    while (candidates.size() > 1) {
-        auto it = std::remove_if(candidates.begin(),
-                                 candidates.end(),
-                                 [&position, &inlineAsm](auto &candidate) {
-                                     return candidate.first[position]
-                                                    != inlineAsm[position]
-                                            || candidate.first == "";
-                                 });
-        candidates.erase(it, candidates.end());
-
-        ++position;
+    // If there is more than one candidate, choose the one whose converted
+    // form has the longest common prefix with the inline asm from LLVM IR.
+    // If there are more such candidates differing from each other, none is
+    // chosen.
+    if (candidates.size() > 1) {
+        size_t bestLength = 0;
+        std::vector<std::pair<std::string, std::string>> best;
+        for (auto &candidate : candidates) {
+            size_t length = matchingPrefixLength(candidate.first, inlineAsm);
+            if (length > bestLength) {
+                bestLength = length;
+                best = {candidate};
+            } else if (length == bestLength && length > 0
+                       && candidate.first != best[0].first)
+                best.push_back(candidate);
+        }
+        candidates = best.size() == 1 ? best
+                                       : std::vector<std::pair<std::string,
+                                                               std::string>>{};
     }
 
     // If there is no candidate, return empty vector
@@ -560,7 +721,7 @@ std::vector<std::string>
     // contains one of them. getSubstringToMatchingBracket is used to extract
     // them.
     std::vector<std::string> result;
-    position = -1;
+    int position = -1;
 
     while (position < int(rawArguments.size())) {
         position = rawArguments.find('(', position + 1);
@@ -626,7 +787,7 @@ std::vector<std::string>
     // The function searches for the function call at two locations - the first
     // one is the line in the original C source code corresponding to the debug
     // info location, the second one are macros used on that line.
-    std::string line = extractLineFromLocation(LineLoc);
+    std::string line = MacroDiffs->getSourceLine(LineLoc);
     if (line == "")
         return {};
     auto &MacroMap = MacroDiffs->getAllMacroUsesAtLocation(LineLoc, 0);
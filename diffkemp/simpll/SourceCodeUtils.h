@@ -21,7 +21,9 @@
 #include <llvm/ADT/StringMap.h>
 #include <llvm/ADT/StringRef.h>
 #include <llvm/IR/DebugInfoMetadata.h>
+#include <llvm/Support/MemoryBuffer.h>
 #include <string>
+#include <tuple>
 #include <unordered_map>
 
 using namespace llvm;
@@ -56,7 +58,14 @@ struct MacroUse {
 };
 
 /// Class for finding differences in macros. Contains collections of macro
-/// definitions and macro usages
+/// definitions and macro usages.
+/// Both collections are keyed canonically (macro definitions by the uniqued
+/// list of macros of the compile unit, macro usages by the macro definitions
+/// and the source location), hence distinct DILocations at the same source
+/// line share the collected macro uses and so do copies of a module in the
+/// same LLVM context (e.g. the modules compared w.r.t. different variables).
+/// The compared modules have separate LLVM contexts, therefore their entries
+/// are never shared, even if a single instance is used for both of them.
 class MacroDiffAnalysis {
   public:
     /// Find macro differences at the locations of the instructions L and R and
@@ -72,25 +81,72 @@ class MacroDiffAnalysis {
     const StringMap<MacroUse> &getAllMacroUsesAtLocation(DILocation *Loc,
                                                          int lineOffset = 0);
 
+    /// Get C source arguments of the inline assembly called at the given
+    /// location. Results are memoised per location and inline assembly string.
+    const std::vector<std::string> &
+            getInlineAsmSourceArguments(DILocation *Loc,
+                                        const std::string &inlineAsm);
+
+    /// Extract the line corresponding to the DILocation from the C source
+    /// file. Source files are kept in memory once they are read.
+    std::string getSourceLine(DILocation *Loc, int lineOffset = 0);
+
+    /// Estimate of the memory taken by the collected macros, inline assembly
+    /// arguments, and source files (in bytes).
+    uint64_t getMemoryUsage() const { return AllocatedBytes; }
+
+    /// Drop everything collected so far. This is used to free memory when
+    /// the memory limit is reached; the data are collected again when needed.
+    /// References returned by the other methods are invalidated.
+    void clearCaches();
+
   private:
+    /// Key of the macro uses cache: macro definitions, source file, line, and
+    /// line offset.
+    using MacroUsesKey =
+            std::tuple<const MDTuple *, std::string, unsigned, int>;
+
+    /// Get the canonical key of the location.
+    MacroUsesKey getLocationKey(DILocation *Loc, int lineOffset);
+
     /// Collect all macros defined in the given compile unit and store them into
     /// MacroDefMaps
-    void collectMacroDefs(DICompileUnit *CompileUnit);
+    const StringMap<MacroDef> &collectMacroDefs(DICompileUnit *CompileUnit);
     /// Collect all macros used at the given location and store the uses into
-    /// MacroUsesAtLocation
+    /// Uses
     void collectMacroUsesAtLocation(DILocation *Loc,
                                     const StringMap<MacroDef> &macroDefs,
+                                    StringMap<MacroUse> &Uses,
                                     int lineOffset = 0);
-
-    /// Collection of macro definition maps for each compilation unit
+    /// Collect C source arguments of the inline assembly called at the given
+    /// location.
+    std::vector<std::string>
+            collectInlineAsmSourceArguments(DILocation *LineLoc,
+                                            const std::string &inlineAsm);
+
+    /// Collection of macro definition maps for each list of macros of
+    /// a compilation unit. The lists are uniqued metadata, therefore compile
+    /// units from the same LLVM context having the same macros share the map.
     /// Every macro definition map is represented as a StringMap mapping macro
     /// names to MacroDef objects.
-    std::map<DICompileUnit *, StringMap<MacroDef>> MacroDefMaps;
-    /// Collection of used macros for each program location.
+    std::map<const MDTuple *, StringMap<MacroDef>> MacroDefMaps;
+    /// Collection of used macros for each source location (file, line, and
+    /// line offset) and macro definitions valid at the location.
     /// All macro uses for a location are represented as a StringMap mapping
     /// macro names to MacroUse objects. MacroUse objects contain pointers to
     /// macro definitions stored in MacroDefMaps.
-    std::map<DILocation *, StringMap<MacroUse>> MacroUsesAtLocation;
+    std::map<MacroUsesKey, StringMap<MacroUse>> MacroUsesAtLocation;
+    /// C source arguments of inline assemblies for each source location and
+    /// LLVM inline assembly string.
+    std::map<std::pair<MacroUsesKey, std::string>, std::vector<std::string>>
+            InlineAsmArguments;
+    /// Contents of the C source files indexed by their paths.
+    StringMap<std::unique_ptr<MemoryBuffer>> SourceBuffers;
+    /// Results for locations without scope.
+    StringMap<MacroUse> NoMacroUses;
+    std::vector<std::string> NoArguments;
+    /// Estimate of the memory taken by the above collections.
+    uint64_t AllocatedBytes = 0;
 };
 
 /// Takes a list of parameter-argument pairs and expand them on places where
@@ -0,0 +1,159 @@
+//===------ SymbolIndex.cpp - Resolving and linking symbol definitions ----===//
+//
+//       SimpLL - Program simplifier for analysis of semantic difference      //
+//
+// This file is published under Apache 2.0 license. See LICENSE for details.
+// Author: Viktor Malik, vmalik@redhat.com
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains implementations of classes for looking up modules
+/// defining symbols in a snapshot symbol index and for linking the missing
+/// definitions into the compared modules.
+///
+//===----------------------------------------------------------------------===//
+
+#include "SymbolIndex.h"
+#include "Config.h"
+#include "Utils.h"
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/SourceMgr.h>
+#include <set>
+
+SymbolIndex::SymbolIndex(const std::string &IndexFile)
+        : BaseDir(sys::path::parent_path(IndexFile)) {
+    auto BufferOrErr = MemoryBuffer::getFile(IndexFile);
+    if (BufferOrErr)
+        Buffer = std::move(BufferOrErr.get());
+}
+
+/// Find the LLVM IR file defining the symbol.
+/// Uses binary search over the lines of the index: the searched range always
+/// starts at the beginning of some line and the line containing the middle
+/// byte of the range is compared with the symbol.
+std::string SymbolIndex::lookup(StringRef Symbol) const {
+    if (!Buffer)
+        return "";
+
+    StringRef Data = Buffer->getBuffer();
+    size_t Low = 0;
+    size_t High = Data.size();
+    while (Low < High) {
+        size_t Start = Low + (High - Low) / 2;
+        while (Start > Low && Data[Start - 1] != '\n')
+            Start--;
+        size_t End = Data.find('\n', Start);
+        if (End == StringRef::npos)
+            End = Data.size();
+
+        auto Entry = Data.slice(Start, End).split(' ');
+        int Cmp = Entry.first.compare(Symbol);
+        if (Cmp == 0)
+            return BaseDir.empty() ? Entry.second.str()
+                                   : joinPath(BaseDir, Entry.second);
+        if (Cmp < 0)
+            Low = End + 1;
+        else
+            High = Start;
+    }
+    return "";
+}
+
+MissingDefsLinker::MissingDefsLinker(const Module &Mod,
+                                     const std::string &IndexFile)
+        : Index(IndexFile), ModuleFile(Mod.getModuleIdentifier()),
+          Context(Mod.getContext()) {}
+
+/// Get the original module, parse it if it has not been parsed yet.
+Module *MissingDefsLinker::getOriginal() {
+    if (!Original) {
+        SMDiagnostic Err;
+        Original = parseIRFile(ModuleFile, Err, Context);
+    }
+    return Original.get();
+}
+
+/// Get module parsed from the given file. Each file is parsed only once.
+Module *MissingDefsLinker::getModule(const std::string &File) {
+    auto Loaded = LoadedModules.find(File);
+    if (Loaded != LoadedModules.end())
+        return Loaded->second.get();
+
+    SMDiagnostic Err;
+    auto &Mod = LoadedModules[File];
+    Mod = parseIRFile(File, Err, Context);
+    return Mod.get();
+}
+
+/// Link the definition of a symbol (found using the index) into the original
+/// module. Only the symbol and the globals that it requires are linked.
+bool MissingDefsLinker::linkDefinition(StringRef Symbol) {
+    // The symbol may have been renamed during the simplification.
+    std::string Name = Symbol.str();
+    if (StringRef(Name).endswith(".void"))
+        Name = Name.substr(0, Name.size() - 5);
+    if (hasSuffix(Name))
+        Name = dropSuffix(Name);
+
+    if (!ProcessedSymbols.insert(Name).second)
+        return false;
+
+    std::string File = Index.lookup(Name);
+    if (File.empty())
+        return false;
+    Module *Src = getModule(File);
+    if (!Src)
+        return false;
+    auto Def = Src->getNamedValue(Name);
+    if (!Def || Def->isDeclaration())
+        return false;
+
+    Module *Dest = getOriginal();
+    if (!Dest)
+        return false;
+    auto Decl = Dest->getNamedValue(Name);
+    if (!Decl || !Decl->isDeclaration())
+        return false;
+
+    DEBUG_WITH_TYPE(DEBUG_SIMPLL,
+                    dbgs() << getDebugIndent() << "Linking definition of "
+                           << Name << " from " << File << "\n");
+
+    // The source module is consumed by the linker, hence a copy is linked.
+    // The linker links all globals that are declared in the original module,
+    // hence other non-local definitions are turned into declarations in the
+    // copy so that only the symbol (and the local globals used by it) are
+    // linked. Aliased globals are kept since an alias needs a definition.
+    auto SrcCopy = cloneModule(*Src);
+    std::set<const GlobalValue *> Kept;
+    for (auto &Alias : SrcCopy->aliases())
+        Kept.insert(Alias.getBaseObject());
+    for (auto &Fun : *SrcCopy) {
+        if (!Fun.isDeclaration() && !Fun.hasLocalLinkage()
+            && Fun.getName() != Name && Kept.find(&Fun) == Kept.end()) {
+            Fun.deleteBody();
+            Fun.setComdat(nullptr);
+        }
+    }
+    for (auto &Var : SrcCopy->globals()) {
+        if (!Var.isDeclaration() && !Var.hasLocalLinkage()
+            && Var.getName() != Name && Kept.find(&Var) == Kept.end()) {
+            Var.setInitializer(nullptr);
+            Var.setLinkage(GlobalValue::ExternalLinkage);
+            Var.setComdat(nullptr);
+        }
+    }
+    if (Linker::linkModules(
+                *Dest, std::move(SrcCopy), Linker::Flags::LinkOnlyNeeded))
+        return false;
+
+    auto Linked = Dest->getNamedValue(Name);
+    return Linked && !Linked->isDeclaration();
+}
+
+/// Get a new copy of the original module (including the linked definitions).
+std::unique_ptr<Module> MissingDefsLinker::getModuleCopy() const {
+    return cloneModule(*Original);
+}
@@ -0,0 +1,86 @@
+//===------- SymbolIndex.h - Resolving and linking symbol definitions -----===//
+//
+//       SimpLL - Program simplifier for analysis of semantic difference      //
+//
+// This file is published under Apache 2.0 license. See LICENSE for details.
+// Author: Viktor Malik, vmalik@redhat.com
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains declarations of classes for looking up modules defining
+/// symbols in a snapshot symbol index and for linking the missing definitions
+/// into the compared modules.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef DIFFKEMP_SIMPLL_SYMBOLINDEX_H
+#define DIFFKEMP_SIMPLL_SYMBOLINDEX_H
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <memory>
+#include <string>
+
+using namespace llvm;
+
+/// Index mapping symbols to LLVM IR files containing their definitions.
+/// The index file consists of lines "<symbol> <file>" sorted by the symbol
+/// name, file paths are relative to the directory containing the index.
+/// The file is memory-mapped and looked up using binary search, so no parsing
+/// is necessary when the index is loaded.
+class SymbolIndex {
+  public:
+    SymbolIndex(const std::string &IndexFile);
+
+    /// Find the LLVM IR file defining the symbol.
+    /// \return Path to the file or an empty string if the symbol is not in
+    ///         the index.
+    std::string lookup(StringRef Symbol) const;
+
+  private:
+    std::unique_ptr<MemoryBuffer> Buffer;
+    /// Directory to which the files in the index are relative.
+    std::string BaseDir;
+};
+
+/// Links missing symbol definitions into a module.
+/// Since the compared modules are transformed during the comparison, the
+/// definitions are linked into the original module from which a new module
+/// for the next comparison is created. The original module is parsed again
+/// from its file (given by the module identifier) when the first definition
+/// is linked, hence nothing is kept if no definitions are missing.
+class MissingDefsLinker {
+  public:
+    MissingDefsLinker(const Module &Mod, const std::string &IndexFile);
+
+    /// Link the definition of a symbol (found using the index) into the
+    /// original module. Only the symbol and the internal globals that it
+    /// requires are linked, other definitions from the same file are not.
+    /// \return True if the definition was successfully linked.
+    bool linkDefinition(StringRef Symbol);
+
+    /// Get a new copy of the original module (including the linked
+    /// definitions).
+    std::unique_ptr<Module> getModuleCopy() const;
+
+  private:
+    SymbolIndex Index;
+    /// File from which the original module is parsed.
+    std::string ModuleFile;
+    LLVMContext &Context;
+    std::unique_ptr<Module> Original;
+    /// Modules loaded from the files in the index (loaded lazily).
+    StringMap<std::unique_ptr<Module>> LoadedModules;
+    /// Symbols whose definitions were already linked or could not be found.
+    StringSet<> ProcessedSymbols;
+
+    /// Get module parsed from the given file. Each file is parsed only once.
+    Module *getModule(const std::string &File);
+
+    /// Get the original module, parse it if it has not been parsed yet.
+    Module *getOriginal();
+};
+
+#endif // DIFFKEMP_SIMPLL_SYMBOLINDEX_H
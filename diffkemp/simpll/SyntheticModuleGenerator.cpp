@@ -0,0 +1,350 @@
+//===-- SyntheticModuleGenerator.cpp - Generating synthetic module pairs --===//
+//
+//       SimpLL - Program simplifier for analysis of semantic difference      //
+//
+// This file is published under Apache 2.0 license. See LICENSE for details.
+// Author: Viktor Malik, vmalik@redhat.com
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the implementation of the SyntheticModuleGenerator
+/// class.
+///
+//===----------------------------------------------------------------------===//
+
+#include "SyntheticModuleGenerator.h"
+#include <llvm/BinaryFormat/Dwarf.h>
+#include <llvm/IR/DIBuilder.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/InlineAsm.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+#include <random>
+
+/// Number of fields of each generated structure type.
+static const unsigned StructFields = 3;
+/// Maximal length of a chain of macros using each other.
+static const unsigned MacroChainLength = 8;
+
+std::string getDifferenceKindName(DifferenceKind Kind) {
+    switch (Kind) {
+    case DifferenceKind::Constant:
+        return "constant";
+    case DifferenceKind::Macro:
+        return "macro";
+    case DifferenceKind::Call:
+        return "call";
+    case DifferenceKind::Field:
+        return "field";
+    case DifferenceKind::Asm:
+        return "asm";
+    }
+    return "";
+}
+
+bool parseDifferenceKind(StringRef Name, DifferenceKind &Kind) {
+    for (auto K : {DifferenceKind::Constant,
+                   DifferenceKind::Macro,
+                   DifferenceKind::Call,
+                   DifferenceKind::Field,
+                   DifferenceKind::Asm}) {
+        if (Name == getDifferenceKindName(K)) {
+            Kind = K;
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Macros form chains of length MacroChainLength, MACRO_<i> is either i + 1
+/// (at the start of a chain) or (MACRO_<i - 1> + 1). Hence, the value of
+/// MACRO_<i> is always i + 1.
+int SyntheticModuleGenerator::getMacroValue(unsigned Macro) {
+    return Macro + 1;
+}
+
+SyntheticModuleGenerator::SyntheticModuleGenerator(
+        const GeneratorParams &Params)
+        : Params(Params) {
+    std::mt19937 Rand(Params.Seed);
+    auto random = [&Rand](unsigned Bound) {
+        return std::uniform_int_distribution<unsigned>(0, Bound - 1)(Rand);
+    };
+    auto chance = [&Rand](double Fraction) {
+        return std::uniform_real_distribution<double>(0, 1)(Rand) < Fraction;
+    };
+
+    // Split functions into levels of (nearly) the same size.
+    unsigned Depth = std::max(1u, std::min(Params.Depth, Params.Functions));
+    for (unsigned Level = 0; Level < Depth; Level++)
+        Levels.emplace_back(Level * Params.Functions / Depth,
+                            (Level + 1) * Params.Functions / Depth);
+
+    for (unsigned Level = 0; Level < Levels.size(); Level++) {
+        for (unsigned i = Levels[Level].first; i < Levels[Level].second; i++) {
+            FunctionPlan Plan;
+            Plan.Name = "fun_" + std::to_string(i);
+            Plan.Level = Level;
+            if (Level + 1 < Levels.size()) {
+                auto &Next = Levels[Level + 1];
+                for (unsigned c = 0; c < Params.FanOut; c++)
+                    Plan.Callees.push_back(
+                            Next.first + random(Next.second - Next.first));
+            }
+            Plan.Macro = Params.Macros > 0 ? random(Params.Macros) : 0;
+            Plan.Struct = Params.Structs > 0 ? random(Params.Structs) : 0;
+            Plan.Field = random(StructFields);
+            Plan.HasAsm = chance(Params.AsmDensity);
+
+            // Choose the kind of the difference among those that can be
+            // injected into the function.
+            if (chance(Params.DiffFraction)) {
+                std::vector<DifferenceKind> Kinds;
+                for (auto Kind : Params.DiffKinds) {
+                    if ((Kind == DifferenceKind::Macro && Params.Macros < 2)
+                        || (Kind == DifferenceKind::Call
+                            && (Plan.Callees.empty()
+                                || Levels[Level + 1].second
+                                                   - Levels[Level + 1].first
+                                           < 2))
+                        || (Kind == DifferenceKind::Field
+                            && Params.Structs == 0)
+                        || (Kind == DifferenceKind::Asm && !Plan.HasAsm))
+                        continue;
+                    Kinds.push_back(Kind);
+                }
+                if (!Kinds.empty()) {
+                    Plan.Differs = true;
+                    Plan.Kind = Kinds[random(Kinds.size())];
+                }
+            }
+            Plans.push_back(Plan);
+        }
+    }
+}
+
+std::vector<std::string> SyntheticModuleGenerator::getRoots() const {
+    std::vector<std::string> Roots;
+    for (auto &Plan : Plans) {
+        if (Plan.Level == 0)
+            Roots.push_back(Plan.Name);
+    }
+    return Roots;
+}
+
+std::map<std::string, DifferenceKind>
+        SyntheticModuleGenerator::getDifferences() const {
+    std::map<std::string, DifferenceKind> Differences;
+    for (auto &Plan : Plans) {
+        if (Plan.Differs)
+            Differences.emplace(Plan.Name, Plan.Kind);
+    }
+    return Differences;
+}
+
+std::unique_ptr<Module> SyntheticModuleGenerator::generate(
+        LLVMContext &Ctx, bool Second, const std::string &Dir) const {
+    std::string SourceName = Second ? "second.c" : "first.c";
+    SmallString<128> SourcePath(Dir);
+    sys::path::append(SourcePath, SourceName);
+    std::error_code EC;
+    raw_fd_ostream Source(SourcePath, EC, sys::fs::F_None);
+    if (EC) {
+        errs() << "Cannot write " << SourcePath << ": " << EC.message()
+               << "\n";
+        return nullptr;
+    }
+    unsigned Line = 0;
+    auto writeLine = [&](const Twine &Text) {
+        Source << Text << "\n";
+        return ++Line;
+    };
+
+    auto Mod = std::make_unique<Module>(Second ? "second" : "first", Ctx);
+    Mod->addModuleFlag(
+            Module::Warning, "Debug Info Version", DEBUG_METADATA_VERSION);
+    DIBuilder DIB(*Mod);
+    DIFile *File = DIB.createFile(SourceName, Dir);
+    DIB.createCompileUnit(
+            dwarf::DW_LANG_C99, File, "diffkemp-simpll-gen", false, "", 0);
+    auto *IntTy = Type::getInt32Ty(Ctx);
+    auto *DIIntTy = DIB.createBasicType("int", 32, dwarf::DW_ATE_signed);
+
+    // Macros
+    DIMacroFile *MacroFile = DIB.createTempMacroFile(nullptr, 0, File);
+    for (unsigned m = 0; m < Params.Macros; m++) {
+        std::string Body =
+                m % MacroChainLength == 0
+                        ? std::to_string(getMacroValue(m))
+                        : "(MACRO_" + std::to_string(m - 1) + " + 1)";
+        std::string Name = "MACRO_" + std::to_string(m);
+        unsigned DefLine = writeLine("#define " + Name + " " + Body);
+        DIB.createMacro(
+                MacroFile, DefLine, dwarf::DW_MACINFO_define, Name, Body);
+    }
+
+    // Structure types and their global variables
+    std::vector<GlobalVariable *> Objects;
+    for (unsigned s = 0; s < Params.Structs; s++) {
+        std::string Name = "s" + std::to_string(s);
+        std::string Fields;
+        for (unsigned f = 0; f < StructFields; f++)
+            Fields += " int f" + std::to_string(f) + ";";
+        unsigned TypeLine = writeLine("struct " + Name + " {" + Fields + " };");
+
+        auto *STy = StructType::create(Ctx,
+                                       std::vector<Type *>(StructFields, IntTy),
+                                       "struct." + Name);
+        std::vector<Metadata *> Members;
+        for (unsigned f = 0; f < StructFields; f++)
+            Members.push_back(DIB.createMemberType(File,
+                                                   "f" + std::to_string(f),
+                                                   File,
+                                                   TypeLine,
+                                                   32,
+                                                   32,
+                                                   32 * f,
+                                                   DINode::FlagZero,
+                                                   DIIntTy));
+        auto *DISTy = DIB.createStructType(File,
+                                           Name,
+                                           File,
+                                           TypeLine,
+                                           32 * StructFields,
+                                           32,
+                                           DINode::FlagZero,
+                                           nullptr,
+                                           DIB.getOrCreateArray(Members));
+        DIB.retainType(DISTy);
+
+        std::string ObjName = "obj_" + std::to_string(s);
+        unsigned ObjLine = writeLine("struct " + Name + " " + ObjName + ";");
+        auto *Obj = new GlobalVariable(*Mod,
+                                       STy,
+                                       false,
+                                       GlobalValue::ExternalLinkage,
+                                       ConstantAggregateZero::get(STy),
+                                       ObjName);
+        Obj->addDebugInfo(DIB.createGlobalVariableExpression(
+                File, ObjName, ObjName, File, ObjLine, DISTy, false));
+        Objects.push_back(Obj);
+    }
+
+    // Function declarations (so that they can call each other)
+    auto *FunTy = FunctionType::get(IntTy, {IntTy}, false);
+    auto *DIFunTy = DIB.createSubroutineType(
+            DIB.getOrCreateTypeArray({DIIntTy, DIIntTy}));
+    std::vector<Function *> Functions;
+    for (auto &Plan : Plans) {
+        Functions.push_back(Function::Create(
+                FunTy, GlobalValue::ExternalLinkage, Plan.Name, Mod.get()));
+        writeLine("int " + Plan.Name + "(int x);");
+    }
+
+    // Function definitions
+    auto *AsmTy = FunctionType::get(Type::getVoidTy(Ctx), {IntTy}, false);
+    for (unsigned i = 0; i < Plans.size(); i++) {
+        auto &Plan = Plans[i];
+        // Kind of the difference injected into this module (if any).
+        bool Differs = Second && Plan.Differs;
+        auto differs = [&](DifferenceKind Kind) {
+            return Differs && Plan.Kind == Kind;
+        };
+
+        Function *Fun = Functions[i];
+        unsigned FunLine = writeLine("int " + Plan.Name + "(int x) {");
+#if LLVM_VERSION_MAJOR < 8
+        DISubprogram *SP = DIB.createFunction(File,
+                                              Plan.Name,
+                                              Plan.Name,
+                                              File,
+                                              FunLine,
+                                              DIFunTy,
+                                              false,
+                                              true,
+                                              FunLine);
+#else
+        DISubprogram *SP =
+                DIB.createFunction(File,
+                                   Plan.Name,
+                                   Plan.Name,
+                                   File,
+                                   FunLine,
+                                   DIFunTy,
+                                   FunLine,
+                                   DINode::FlagZero,
+                                   DISubprogram::SPFlagDefinition);
+#endif
+        Fun->setSubprogram(SP);
+
+        IRBuilder<> Builder(BasicBlock::Create(Ctx, "", Fun));
+        auto setLine = [&](unsigned L) {
+            Builder.SetCurrentDebugLocation(DILocation::get(Ctx, L, 5, SP));
+        };
+        Value *X = &*Fun->arg_begin();
+
+        // Macro
+        if (Params.Macros > 0) {
+            unsigned Macro = differs(DifferenceKind::Macro)
+                                     ? (Plan.Macro + 1) % Params.Macros
+                                     : Plan.Macro;
+            setLine(writeLine("    x = x + MACRO_" + std::to_string(Macro)
+                              + ";"));
+            X = Builder.CreateAdd(
+                    X, ConstantInt::get(IntTy, getMacroValue(Macro)));
+        }
+
+        // Structure field
+        if (Params.Structs > 0) {
+            unsigned Field = differs(DifferenceKind::Field)
+                                     ? (Plan.Field + 1) % StructFields
+                                     : Plan.Field;
+            setLine(writeLine("    x = x + obj_" + std::to_string(Plan.Struct)
+                              + ".f" + std::to_string(Field) + ";"));
+            GlobalVariable *Obj = Objects[Plan.Struct];
+            Value *FieldPtr = Builder.CreateStructGEP(
+                    Obj->getValueType(), Obj, Field);
+            X = Builder.CreateAdd(X, Builder.CreateLoad(IntTy, FieldPtr));
+        }
+
+        // Calls (the first callee is replaced by another function from the
+        // same level for the call difference)
+        for (unsigned c = 0; c < Plan.Callees.size(); c++) {
+            unsigned Callee = Plan.Callees[c];
+            if (c == 0 && differs(DifferenceKind::Call)) {
+                auto &Level = Levels[Plan.Level + 1];
+                Callee = Callee + 1 < Level.second ? Callee + 1 : Level.first;
+            }
+            setLine(writeLine("    x = " + Plans[Callee].Name + "(x);"));
+            X = Builder.CreateCall(Functions[Callee], {X});
+        }
+
+        // Inline assembly
+        if (Plan.HasAsm) {
+            std::string Asm = differs(DifferenceKind::Asm) ? "nop; nop" : "nop";
+            setLine(writeLine("    asm volatile(\"" + Asm
+                              + "\" : : \"r\"(x));"));
+            Builder.CreateCall(InlineAsm::get(AsmTy, Asm, "r", true), {X});
+        }
+
+        // Constant
+        int Constant = i + 2 + (differs(DifferenceKind::Constant) ? 1 : 0);
+        setLine(writeLine("    x = x * " + std::to_string(Constant) + ";"));
+        X = Builder.CreateMul(X, ConstantInt::get(IntTy, Constant));
+
+        setLine(writeLine("    return x;"));
+        Builder.CreateRet(X);
+        writeLine("}");
+    }
+
+    DIB.finalize();
+    Source.close();
+    if (Source.has_error()) {
+        errs() << "Cannot write " << SourcePath << ": "
+               << Source.error().message() << "\n";
+        Source.clear_error();
+        return nullptr;
+    }
+    return Mod;
+}
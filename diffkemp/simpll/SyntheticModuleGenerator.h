@@ -0,0 +1,125 @@
+//===--- SyntheticModuleGenerator.h - Generating synthetic module pairs ---===//
+//
+//       SimpLL - Program simplifier for analysis of semantic difference      //
+//
+// This file is published under Apache 2.0 license. See LICENSE for details.
+// Author: Viktor Malik, vmalik@redhat.com
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the SyntheticModuleGenerator class
+/// that generates pairs of LLVM modules (together with their C sources) having
+/// a controlled size and shape. The pairs are used to measure how SimpLL
+/// scales.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef DIFFKEMP_SIMPLL_SYNTHETICMODULEGENERATOR_H
+#define DIFFKEMP_SIMPLL_SYNTHETICMODULEGENERATOR_H
+
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+/// Kinds of differences that can be injected into the second module.
+enum class DifferenceKind {
+    // Different integer constant.
+    Constant,
+    // Different macro used.
+    Macro,
+    // Different function called.
+    Call,
+    // Different structure field accessed.
+    Field,
+    // Different inline assembly.
+    Asm
+};
+
+/// Get the name of the difference kind (as used in the manifest).
+std::string getDifferenceKindName(DifferenceKind Kind);
+
+/// Parse the name of the difference kind.
+/// \return False if the name is not valid.
+bool parseDifferenceKind(StringRef Name, DifferenceKind &Kind);
+
+/// Parameters of the generated module pair.
+struct GeneratorParams {
+    // Number of functions.
+    unsigned Functions = 100;
+    // Number of calls to functions from the next level done by each function.
+    unsigned FanOut = 2;
+    // Number of levels of the call graph.
+    unsigned Depth = 4;
+    // Number of structure types (each has a global variable).
+    unsigned Structs = 10;
+    // Number of macro definitions in the debug info.
+    unsigned Macros = 100;
+    // Fraction of functions containing inline assembly.
+    double AsmDensity = 0.1;
+    // Fraction of functions into which a difference is injected.
+    double DiffFraction = 0.1;
+    // Kinds of the injected differences.
+    std::vector<DifferenceKind> DiffKinds = {DifferenceKind::Constant,
+                                             DifferenceKind::Macro,
+                                             DifferenceKind::Call,
+                                             DifferenceKind::Field,
+                                             DifferenceKind::Asm};
+    // Seed of the random generator.
+    unsigned Seed = 0;
+};
+
+/// Generator of pairs of synthetic modules.
+/// Functions are split into Depth levels of the call graph, each function
+/// calls FanOut random functions from the next level. The body of a function
+/// uses a macro, reads a field of a global structure, calls its callees,
+/// optionally runs an inline assembly, and multiplies the result by
+/// a constant. Each of these has its own line in the generated C source.
+/// The shape of the modules and the injected differences are chosen in the
+/// constructor, hence the generated modules are the same for the same
+/// parameters.
+class SyntheticModuleGenerator {
+  public:
+    explicit SyntheticModuleGenerator(const GeneratorParams &Params);
+
+    /// Generate the first (or the second) module into the given context.
+    /// The C source of the module is written into the given directory.
+    /// Returns nullptr if the source cannot be written.
+    std::unique_ptr<Module> generate(LLVMContext &Ctx,
+                                     bool Second,
+                                     const std::string &Dir) const;
+
+    /// Names of the functions that are not called by other functions.
+    std::vector<std::string> getRoots() const;
+
+    /// Functions into which a difference was injected with its kind.
+    std::map<std::string, DifferenceKind> getDifferences() const;
+
+  private:
+    /// Shape of a single function.
+    struct FunctionPlan {
+        std::string Name;
+        unsigned Level;
+        std::vector<unsigned> Callees;
+        unsigned Macro;
+        unsigned Struct;
+        unsigned Field;
+        bool HasAsm;
+        bool Differs = false;
+        DifferenceKind Kind = DifferenceKind::Constant;
+    };
+
+    GeneratorParams Params;
+    std::vector<FunctionPlan> Plans;
+    /// Ranges of indices of functions on each level.
+    std::vector<std::pair<unsigned, unsigned>> Levels;
+
+    /// Value of the macro with the given index.
+    static int getMacroValue(unsigned Macro);
+};
+
+#endif // DIFFKEMP_SIMPLL_SYNTHETICMODULEGENERATOR_H
@@ -13,6 +13,7 @@
 
 #include "Utils.h"
 #include "Config.h"
+#include "DebugInfo.h"
 #include <algorithm>
 #include <iostream>
 #include <llvm/IR/Module.h>
@@ -115,12 +116,31 @@ void deleteAliasToFun(Module &Mod, Function *Fun) {
     }
 }
 
+/// Create a copy of a module.
+std::unique_ptr<Module> cloneModule(const Module &Mod) {
+#if LLVM_VERSION_MAJOR < 7
+    return CloneModule(&Mod);
+#else
+    return CloneModule(Mod);
+#endif
+}
+
+/// Get the position of the last dot ('.') if the substring behind it contains
+/// only numbers (or it is ".void"), otherwise return StringRef::npos.
+static size_t getSuffixPos(StringRef Name) {
+    size_t DotPos = Name.rfind('.');
+    if (DotPos == StringRef::npos)
+        return StringRef::npos;
+    size_t LastNonNumber = Name.find_last_not_of("0123456789.");
+    if ((LastNonNumber != StringRef::npos && LastNonNumber < DotPos)
+        || Name.substr(DotPos) == ".void")
+        return DotPos;
+    return StringRef::npos;
+}
+
 /// Check if the substring behind the last dot ('.') contains only numbers.
 bool hasSuffix(std::string Name) {
-    size_t dotPos = Name.find_last_of('.');
-    return dotPos != std::string::npos
-           && (Name.find_last_not_of("0123456789.") < dotPos
-               || Name.substr(dotPos) == ".void");
+    return getSuffixPos(Name) != StringRef::npos;
 }
 
 /// Remove everything behind the last dot ('.'). Assumes that hasSuffix returned
@@ -129,6 +149,13 @@ std::string dropSuffix(std::string Name) {
     return Name.substr(0, Name.find_last_of('.'));
 }
 
+/// Get the name without the .<NUMBER> (or .void) suffix. Equivalent to calling
+/// dropSuffix if hasSuffix holds, but no string is created.
+StringRef getBaseName(StringRef Name) {
+    size_t DotPos = getSuffixPos(Name);
+    return DotPos == StringRef::npos ? Name : Name.substr(0, DotPos);
+}
+
 /// Join directory path with a filename in case the filename does not already
 /// contain the directory.
 std::string joinPath(StringRef DirName, StringRef FileName) {
@@ -415,8 +442,18 @@ const Instruction *getConstExprAsInstruction(const ConstantExpr *CEx) {
     }
 }
 
-/// Generates human-readable C-like identifier for type.
-std::string getIdentifierForType(Type *Ty) {
+/// Get the human-readable C-like identifier of the type.
+StringRef IdentifierCache::getIdentifierForType(Type *Ty) {
+    auto Cached = TypeIdentifiers.find(Ty);
+    if (Cached != TypeIdentifiers.end())
+        return Cached->second;
+    StringRef Identifier = Saver.save(buildIdentifierForType(Ty));
+    TypeIdentifiers[Ty] = Identifier;
+    return Identifier;
+}
+
+/// Build the human-readable C-like identifier of the type.
+std::string IdentifierCache::buildIdentifierForType(Type *Ty) {
     if (auto STy = dyn_cast<StructType>(Ty)) {
         // Remove prefix and append "struct"
         if (STy->getStructName().startswith("union"))
@@ -431,28 +468,33 @@ std::string getIdentifierForType(Type *Ty) {
         else
             return "int" + std::to_string(IntTy->getBitWidth()) + "_t";
     } else if (auto ArrTy = dyn_cast<ArrayType>(Ty)) {
-        return getIdentifierForType(ArrTy->getElementType()) + "[]";
+        return (getIdentifierForType(ArrTy->getElementType()) + "[]").str();
     } else if (Ty->isVoidTy()) {
         return "void";
     } else if (auto PointTy = dyn_cast<PointerType>(Ty)) {
-        return getIdentifierForType(PointTy->getElementType()) + " *";
+        return (getIdentifierForType(PointTy->getElementType()) + " *").str();
     } else
         return "<unknown>";
 }
 
-/// Generates human-readable C-like identifier for value.
-std::string getIdentifierForValue(
-        const Value *Val,
-        const std::map<std::pair<StructType *, uint64_t>, StringRef>
-                &StructFieldNames,
-        const Function *Parent) {
+/// Get the human-readable C-like identifier of the value.
+StringRef IdentifierCache::getIdentifierForValue(const Value *Val) {
+    auto Cached = ValueIdentifiers.find(Val);
+    if (Cached != ValueIdentifiers.end())
+        return Cached->second;
+    StringRef Identifier = Saver.save(buildIdentifierForValue(Val));
+    ValueIdentifiers[Val] = Identifier;
+    return Identifier;
+}
+
+/// Build the human-readable C-like identifier of the value.
+std::string IdentifierCache::buildIdentifierForValue(const Value *Val) {
     // This function uses a different approach for different types of values.
     if (auto GEPi = dyn_cast<GetElementPtrInst>(Val)) {
         // GEP instruction.
         // First find the original variable name, then try to append the names
         // of all indices.
-        std::string name = getIdentifierForValue(
-                GEPi->getOperand(0), StructFieldNames, Parent);
+        std::string name = getIdentifierForValue(GEPi->getOperand(0)).str();
 
         std::vector<Value *> Indices;
 
@@ -471,26 +513,29 @@ std::string getIdentifierForValue(
 
             if (isa<StructType>(ValueType)) {
                 // Structure type indexing
-                auto NumericIndex = dyn_cast<ConstantInt>(Index)->getValue();
-                auto IndexName =
-                        StructFieldNames.find({dyn_cast<StructType>(ValueType),
-                                               NumericIndex.getZExtValue()});
-                if (IndexName != StructFieldNames.end()) {
+                uint64_t NumericIndex =
+                        dyn_cast<ConstantInt>(Index)->getZExtValue();
+                StringRef IndexName;
+                if (DI)
+                    IndexName = DI->getStructFieldName(
+                            dyn_cast<StructType>(ValueType),
+                            NumericIndex,
+                            Prog);
+                if (!IndexName.empty()) {
                     // We can use the index name to create a C-like syntax.
-                    name += "->" + IndexName->second.str();
+                    name += "->" + IndexName.str();
                 } else {
-                    name += "->" + std::to_string(NumericIndex.getZExtValue());
+                    name += "->" + std::to_string(NumericIndex);
                 }
             } else {
                 // Array type indexing (the index doesn't have to be constant)
-                std::string IdxName =
-                        getIdentifierForValue(Index, StructFieldNames, Parent);
+                StringRef IdxName = getIdentifierForValue(Index);
 
                 // Remove reference operator to match C syntax
                 name = name.substr(2, name.size() - 3);
 
                 if (IdxName != "") {
-                    name += "[" + IdxName + "]";
+                    name += "[" + IdxName.str() + "]";
                 } else {
                     name += "[<unknown>]";
                 }
@@ -502,99 +547,88 @@ std::string getIdentifierForValue(
 
         return name;
     } else if (auto CEx = dyn_cast<ConstantExpr>(Val)) {
-        // Constant expressions are converted to instructions.
-        return getIdentifierForValue(
-                getConstExprAsInstruction(CEx), StructFieldNames, Parent);
+        // Constant expressions are converted to instructions. The instruction
+        // is not cached itself, its identifier is cached for the expression.
+        return buildIdentifierForValue(getConstExprAsInstruction(CEx));
     } else if (auto BitCast = dyn_cast<BitCastInst>(Val)) {
         // Bit casts are expanded to C-like cast syntax.
-        std::string Casted = getIdentifierForValue(
-                BitCast->getOperand(0), StructFieldNames, Parent);
-        return "((" + getIdentifierForType(BitCast->getDestTy()) + ") " + Casted
-               + ")";
+        return ("((" + getIdentifierForType(BitCast->getDestTy()) + ") "
+                + getIdentifierForValue(BitCast->getOperand(0)) + ")")
+                .str();
     } else if (auto ZExt = dyn_cast<ZExtInst>(Val)) {
         // ZExt is treated the same as a statement without it
-        return getIdentifierForValue(
-                ZExt->getOperand(0), StructFieldNames, Parent);
+        return getIdentifierForValue(ZExt->getOperand(0)).str();
     } else if (auto Load = dyn_cast<LoadInst>(Val)) {
         // Load instruction is treated as the dereference operator
-        std::string Internal = getIdentifierForValue(
-                Load->getOperand(0), StructFieldNames, Parent);
+        StringRef Internal = getIdentifierForValue(Load->getOperand(0));
 
-        if (Internal[0] == '&')
+        if (Internal.startswith("&"))
             // Reference and dereference operator cancel out.
             // (delete & and parethenses)
-            return Internal.substr(2, Internal.size() - 3);
+            return Internal.substr(2, Internal.size() - 3).str();
         else
-            return "*(" + Internal + ")";
+            return ("*(" + Internal + ")").str();
     } else if (Val->hasName()) {
         // If everything fails, try to get the name directly from the value
         return Val->getName().str();
     } else if (auto Const = dyn_cast<Constant>(Val)) {
         // Constant to string is already implemented in a different function
         return valueAsString(Const);
-    } else if (Parent) {
-        // Check if the value is a function argument - in case it is, extract
-        // the argument name.
-        int idx = 0;
-
-        // Extract register number
-        std::string ValDump;
-        llvm::raw_string_ostream ValDumStrm(ValDump);
-        Val->print(ValDumStrm);
-        std::string RegName = ValDump.substr(ValDump.find_last_of('%') + 1,
-                                             std::string::npos);
-        int RegNum;
-        std::istringstream Iss(RegName);
-        Iss >> RegNum;
-        if (Iss.fail())
-            return "<unknown>";
-
-        // Find the argument name
-        if (RegNum >= Parent->arg_size())
-            // Not a function argument
-            return "<unknown>";
+    } else if (auto Arg = dyn_cast<Argument>(Val)) {
+        // The value is a function argument - extract the argument name from
+        // the debug info.
+        StringRef Name = getArgumentName(Arg);
+        return Name.empty() ? "<unknown>" : Name.str();
+    } else
+        return "<unknown>";
+}
 
-        DISubprogram *Sub = Parent->getSubprogram();
+/// Get the name of the function argument from the debug info. Names of all
+/// arguments of the function are collected at once from the retained nodes
+/// of its subprogram.
+StringRef IdentifierCache::getArgumentName(const Argument *Arg) {
+    const Function *Fun = Arg->getParent();
+    auto Cached = ArgumentNames.find(Fun);
+    if (Cached == ArgumentNames.end()) {
+        auto &Names = ArgumentNames[Fun];
+        if (DISubprogram *Sub = Fun->getSubprogram()) {
 #if LLVM_VERSION_MAJOR < 7
-        DINodeArray funArgs = Sub->getVariables();
+            DINodeArray funArgs = Sub->getVariables();
 #else
-        DINodeArray funArgs = Sub->getRetainedNodes();
+            DINodeArray funArgs = Sub->getRetainedNodes();
 #endif
-        for (DINode *Node : funArgs) {
-            if (idx == RegNum) {
-                DILocalVariable *LocVar = dyn_cast<DILocalVariable>(Node);
-                if (!LocVar)
-                    return "<unknown>";
-                return LocVar->getName().str();
+            for (DINode *Node : funArgs) {
+                auto LocVar = dyn_cast<DILocalVariable>(Node);
+                // Argument numbers of parameters start from 1.
+                if (LocVar && LocVar->isParameter())
+                    Names[LocVar->getArg() - 1] = LocVar->getName();
             }
-            ++idx;
         }
-
-        return "<unknown>";
-    } else
-        return "<unknown>";
+        Cached = ArgumentNames.find(Fun);
+    }
+    return Cached->second.lookup(Arg->getArgNo());
 }
 
 /// Retrieves the type of the value based its C source code expression.
 Type *getCSourceIdentifierType(
-        std::string expr,
+        StringRef expr,
         const Function *Parent,
         const std::unordered_map<std::string, const Value *>
                 &LocalVariableMap) {
     // First we have to remove pointer operators from the call.
-    if (expr[0] == '*') {
+    if (expr.startswith("*")) {
         // Dereference operator. Return the original type.
         Type *Ty = getCSourceIdentifierType(
-                expr.substr(1), Parent, LocalVariableMap);
+                expr.drop_front(1), Parent, LocalVariableMap);
         if (!Ty)
             return nullptr;
 
         PointerType *PTy = dyn_cast<PointerType>(Ty);
         return PTy->getElementType();
-    } else if (expr[0] == '&') {
+    } else if (expr.startswith("&")) {
         // Reference operator. Return a pointer type.
         Type *InnerTy = getCSourceIdentifierType(
-                expr.substr(1), Parent, LocalVariableMap);
+                expr.drop_front(1), Parent, LocalVariableMap);
 
         // Note: assuming von Neumann architecture with single address space.
         if (!InnerTy)
@@ -604,14 +638,7 @@ Type *getCSourceIdentifierType(
     } else {
         // Determine whether the expression is an identifier at this point.
         // If not, it is not supported.
-        std::vector<bool> Tmp;
-        std::transform(expr.begin(),
-                       expr.end(),
-                       std::back_inserter(Tmp),
-                       isValidCharForIdentifier);
-        if (!std::accumulate(Tmp.begin(), Tmp.end(), true, [](auto a, auto b) {
-                return a && b;
-            })) {
+        if (!llvm::all_of(expr, isValidCharForIdentifier)) {
             // There are some characters that are not allowed in an identifier.
             return nullptr;
         }
@@ -622,7 +649,8 @@ Type *getCSourceIdentifierType(
         if (Glob)
             return Glob->getValueType();
 
-        auto Loc = LocalVariableMap.find(Parent->getName().str() + "::" + expr);
+        auto Loc = LocalVariableMap.find(
+                (Parent->getName() + "::" + expr).str());
         if (Loc != LocalVariableMap.end())
             return Loc->second->getType();
 
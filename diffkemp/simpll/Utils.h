@@ -14,10 +14,14 @@
 #ifndef DIFFKEMP_SIMPLL_UTILS_H
 #define DIFFKEMP_SIMPLL_UTILS_H
 
+#include <llvm/ADT/DenseMap.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/DebugInfoMetadata.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/Instructions.h>
+#include <llvm/Support/Allocator.h>
+#include <llvm/Support/StringSaver.h>
+#include <map>
 #include <unordered_map>
 
 using namespace llvm;
@@ -29,6 +33,8 @@ typedef std::pair<Function *, Function *> FunPair;
 typedef std::pair<const Function *, const Function *> ConstFunPair;
 typedef std::pair<const GlobalValue *, const GlobalValue *> GlobalValuePair;
 
+class DebugInfo;
+
 /// Extract called function from a called value. Handles situation when the
 /// called value is a bitcast.
 const Function *getCalledFunction(const Value *CalledValue);
@@ -49,12 +55,18 @@ std::string typeName(const Type *Type);
 /// Delete alias to a function
 void deleteAliasToFun(Module &Mod, Function *Fun);
 
+/// Create a copy of a module.
+std::unique_ptr<Module> cloneModule(const Module &Mod);
+
 /// Check if an LLVM name has a .<NUMBER> suffix.
 bool hasSuffix(std::string Name);
 
 /// Drop the .<NUMBER> suffix from the LLVM name.
 std::string dropSuffix(std::string Name);
 
+/// Get the LLVM name without the .<NUMBER> (or .void) suffix.
+StringRef getBaseName(StringRef Name);
+
 /// Join directory path with a filename in case the filename does not already
 /// contain the directory.
 std::string joinPath(StringRef DirName, StringRef FileName);
@@ -118,19 +130,50 @@ const Instruction *getConstExprAsInstruction(const ConstantExpr *CEx);
 
 /// Retrives type of the value based its C source code identifier.
 Type *getCSourceIdentifierType(
-        std::string expr,
+        StringRef expr,
         const Function *Parent,
         const std::unordered_map<std::string, const Value *> &LocalVariableMap);
 
-/// Generates human-readable C-like identifier for type.
-std::string getIdentifierForType(Type *Ty);
-
-/// Finds the name of a value (in case there exists one).
-std::string getIdentifierForValue(
-        const Value *Val,
-        const std::map<std::pair<StructType *, uint64_t>, StringRef>
-                &StructFieldNames,
-        const Function *Parent = nullptr);
+/// Cache of human-readable C-like identifiers of values and types.
+/// Identifiers are built bottom-up (the identifier of a value is built from
+/// the cached identifiers of its operands) and stored in an arena, hence the
+/// returned references are valid for the lifetime of the cache.
+class IdentifierCache {
+  public:
+    /// \param DI Debug info used to get names of structure fields in
+    ///           identifiers of GEPs (optional).
+    /// \param Prog Program containing the values.
+    explicit IdentifierCache(const DebugInfo *DI = nullptr,
+                             Program Prog = Program::First)
+            : DI(DI), Prog(Prog), Saver(Arena) {}
+
+    /// Get the identifier of the value.
+    StringRef getIdentifierForValue(const Value *Val);
+
+    /// Get the identifier of the type.
+    StringRef getIdentifierForType(Type *Ty);
+
+  private:
+    const DebugInfo *DI;
+    Program Prog;
+    BumpPtrAllocator Arena;
+    StringSaver Saver;
+    DenseMap<const Value *, StringRef> ValueIdentifiers;
+    DenseMap<Type *, StringRef> TypeIdentifiers;
+    /// Names of arguments of each function indexed by the argument numbers.
+    /// Collected from the retained nodes of the function subprogram.
+    DenseMap<const Function *, DenseMap<unsigned, StringRef>> ArgumentNames;
+
+    /// Build the identifier of the value (operands are taken from the cache).
+    std::string buildIdentifierForValue(const Value *Val);
+
+    /// Build the identifier of the type (inner types are taken from the
+    /// cache).
+    std::string buildIdentifierForType(Type *Ty);
+
+    /// Get the name of the function argument from the debug info.
+    StringRef getArgumentName(const Argument *Arg);
+};
 
 /// Copies properties from one call instruction to another.
 void copyCallInstProperties(CallInst *srcCall, CallInst *destCall);
@@ -15,6 +15,9 @@
 
 #include "CalledFunctionsAnalysis.h"
 #include "Utils.h"
+#include <limits>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallPtrSet.h>
 #include <llvm/IR/Instructions.h>
 
 PreservedAnalyses FieldAccessFunctionGenerator::run(
@@ -28,6 +31,7 @@ PreservedAnalyses FieldAccessFunctionGenerator::run(
     // functions, it has to be implemented as a module pass, because it adds new
     // functions to the module.
     auto &CalledFuns = mam.getResult<CalledFunctionsAnalysis>(Mod, Main);
+    Abstractions.clear();
 
     for (Function &Fun : Mod) {
         if (!ModOther->getFunction(Fun.getName()))
@@ -88,6 +92,10 @@ PreservedAnalyses FieldAccessFunctionGenerator::run(
     return PreservedAnalyses();
 }
 
+/// Description of a constant operand in the structure of the field access
+/// block (constants themselves are stored separately in the key).
+static const int ConstantOperand = std::numeric_limits<int>::min();
+
 /// First checks whether the instructions in the stack can be moved away from
 /// the original function without causing an error, then creates the abstraction
 /// function, moves the instructions into it, modify the input and output of the
@@ -100,6 +108,8 @@ void FieldAccessFunctionGenerator::processStack(
         // Do not attempt to process empty stacks, that would cause an error.
         return;
 
+    SmallPtrSet<const Value *, 8> StackSet(Stack.begin(), Stack.end());
+
     // Check if all the instruction (besides the last one, of course) are used
     // only by other instructions in the stack.
     // If not, do not generate an abstraction, since this would break the code.
@@ -112,7 +122,7 @@ void FieldAccessFunctionGenerator::processStack(
         if (Inst == Stack.back())
             continue;
         for (User *U : Inst->users()) {
-            if (std::find(Stack.begin(), Stack.end(), U) == std::end(Stack))
+            if (!StackSet.count(U))
                 return;
         }
     }
@@ -122,21 +132,49 @@ void FieldAccessFunctionGenerator::processStack(
     // Note: the first argument of the abstraction is always the operand of the
     // GEP - this should not be changed, since it is expected to be this way
     // later in the analysis.
+    // At the same time, build the key identifying identical blocks. Each
+    // instruction is described by its opcode (and the inbounds flag for GEPs)
+    // and by its operands. A non-constant operand is described by its index in
+    // the stack or (as a negative number) by the index of the abstraction
+    // argument.
     std::vector<Value *> valuesToReplace;
+    DenseMap<const Value *, int> stackIndices;
+    DenseMap<const Value *, int> argIndices;
+    std::vector<Type *> keyTypes;
+    std::vector<const Value *> keyConstants;
+    std::vector<int> keyStructure;
     for (Instruction *Inst : Stack) {
+        keyTypes.push_back(Inst->getType());
+        keyStructure.push_back(Inst->getOpcode());
+        keyStructure.push_back(Inst->getNumOperands());
+        if (auto *GEP = dyn_cast<GetElementPtrInst>(Inst)) {
+            keyTypes.push_back(GEP->getSourceElementType());
+            keyStructure.push_back(GEP->isInBounds());
+        }
         for (Value *Op : Inst->operands()) {
-            if (isa<Constant>(Op))
+            if (isa<Constant>(Op)) {
                 // Constants are fine, they can be moved without problem.
+                keyConstants.push_back(Op);
+                keyStructure.push_back(ConstantOperand);
+                continue;
+            }
+            auto StackIndex = stackIndices.find(Op);
+            if (StackIndex != stackIndices.end()) {
+                keyStructure.push_back(StackIndex->second);
                 continue;
-            if (std::find(Stack.begin(), Stack.end(), Op) == std::end(Stack)
-                && std::find(valuesToReplace.begin(), valuesToReplace.end(), Op)
-                           == std::end(valuesToReplace)) {
+            }
+            auto ArgIndex = argIndices.find(Op);
+            if (ArgIndex == argIndices.end()) {
                 // The value was not found in the stack.
                 // Add it to the replacement vector (unless it is already
                 // there).
+                ArgIndex = argIndices.insert({Op, valuesToReplace.size()})
+                                   .first;
                 valuesToReplace.push_back(Op);
             }
+            keyStructure.push_back(-1 - ArgIndex->second);
         }
+        stackIndices.insert({Inst, stackIndices.size()});
     }
 
     // Create the function definition.
@@ -150,6 +188,28 @@ void FieldAccessFunctionGenerator::processStack(
                    [](Value *V) { return V->getType(); });
     FunctionType *FT =
             FunctionType::get(Stack.back()->getType(), argTypes, false);
+
+    // If an identical block has already been replaced by an abstraction,
+    // replace this block by a call to the same abstraction.
+    FieldAccessKey Key{Stack.front()->getDebugLoc().get(),
+                       FT,
+                       std::move(keyTypes),
+                       std::move(keyConstants),
+                       std::move(keyStructure)};
+    auto Existing = Abstractions.find(Key);
+    if (Existing != Abstractions.end()) {
+        Function *Abstraction = Existing->second;
+        auto Call = CallInst::Create(FT, Abstraction, valuesToReplace);
+        Call->insertAfter(Stack.back());
+        Call->setDebugLoc(DebugLoc(
+                Abstraction->getMetadata(SimpllFieldAccessMetadata)));
+        Stack.back()->replaceAllUsesWith(Call);
+        // Instructions of the block are used only by the following ones.
+        for (auto Inst = Stack.rbegin(); Inst != Stack.rend(); ++Inst)
+            (*Inst)->eraseFromParent();
+        return;
+    }
+
     Function *Abstraction =
             Function::Create(FT,
                              GlobalValue::LinkageTypes::ExternalLinkage,
@@ -157,6 +217,7 @@ void FieldAccessFunctionGenerator::processStack(
                              &Mod);
     Abstraction->setMetadata(SimpllFieldAccessMetadata,
                              Stack.front()->getDebugLoc().get());
+    Abstractions.emplace(std::move(Key), Abstraction);
 
     // Create a map that will be used for replacing operands referencing values
     // outside of the abstraction function with its arguments.
@@ -14,7 +14,11 @@
 #ifndef DIFFKEMP_SIMPLL_FIELDACCESSFUNCTIONGENERATOR_H
 #define DIFFKEMP_SIMPLL_FIELDACCESSFUNCTIONGENERATOR_H
 
+#include <llvm/IR/DebugInfoMetadata.h>
 #include <llvm/IR/PassManager.h>
+#include <map>
+#include <tuple>
+#include <vector>
 
 const std::string SimpllFieldAccessFunName = "simpll__fieldaccess";
 const std::string SimpllFieldAccessMetadata = "fieldaccess";
@@ -27,6 +31,8 @@ using namespace llvm;
 /// them; they also must not be accessed by any other instructions that those
 /// in the block and they may not access any value outside of the block in order
 /// not to break the code).
+/// Identical blocks (having the same debug location, types, and constant
+/// operands) share a single abstraction.
 class FieldAccessFunctionGenerator
         : public PassInfoMixin<FieldAccessFunctionGenerator> {
   public:
@@ -36,6 +42,19 @@ class FieldAccessFunctionGenerator
                           Module *ModOther);
 
   private:
+    /// Key identifying identical field access blocks: the debug location of
+    /// the block, the type of the abstraction, the types of the instructions
+    /// (and source element types of GEPs), their constant operands, and the
+    /// structure of the block (opcodes and the origin of the operands).
+    using FieldAccessKey = std::tuple<DILocation *,
+                                      FunctionType *,
+                                      std::vector<Type *>,
+                                      std::vector<const Value *>,
+                                      std::vector<int>>;
+
+    /// Abstractions generated for field access blocks in the current module.
+    std::map<FieldAccessKey, Function *> Abstractions;
+
     void processStack(const std::vector<Instruction *> &Stack, Module &Mod);
 };
 
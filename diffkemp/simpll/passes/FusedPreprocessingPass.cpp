@@ -0,0 +1,95 @@
+//===--- FusedPreprocessingPass.cpp - Preprocessing in a single walk ------===//
+//
+//       SimpLL - Program simplifier for analysis of semantic difference      //
+//
+// This file is published under Apache 2.0 license. See LICENSE for details.
+// Author: Viktor Malik, vmalik@redhat.com
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the implementation of the FusedPreprocessingPass.
+/// The transformations themselves are shared with the separate passes.
+///
+//===----------------------------------------------------------------------===//
+
+#include "FusedPreprocessingPass.h"
+#include "ReduceFunctionMetadataPass.h"
+#include "SimplifyKernelFunctionCallsPass.h"
+#include "UnifyMemcpyPass.h"
+#include "Utils.h"
+#include <llvm/IR/Intrinsics.h>
+
+PreservedAnalyses FusedPreprocessingPass::run(Function &Fun,
+                                              FunctionAnalysisManager &fam) {
+    for (auto &BB : Fun) {
+        for (auto It = BB.begin(); It != BB.end();) {
+            // New instructions are inserted before the visited call, hence
+            // they are not visited (the same as in the separate passes).
+            auto Call = dyn_cast<CallInst>(&*It++);
+            if (Call && simplifyCall(Call))
+                Call->eraseFromParent();
+        }
+    }
+    ReduceFunctionMetadataPass().run(Fun, fam);
+    return PreservedAnalyses();
+}
+
+/// Classify the function by its name.
+FusedPreprocessingPass::CallRole
+        FusedPreprocessingPass::getRole(const Function *Fun) {
+    auto Cached = Roles.find(Fun);
+    if (Cached != Roles.end())
+        return Cached->second;
+
+    CallRole Role = CallRole::None;
+    StringRef Name = Fun->getName();
+    if (Name == "printk")
+        Role = CallRole::Printk;
+    else if (isPrintFunction(Name.str()))
+        Role = CallRole::Print;
+    else if (hasFileAndLineArgs(Name))
+        Role = CallRole::FileAndLine;
+    else if (Name == "__memcpy")
+        Role = CallRole::KernelMemcpy;
+    else if (Fun->getIntrinsicID() == Intrinsic::memcpy)
+        Role = CallRole::Memcpy;
+    Roles[Fun] = Role;
+    return Role;
+}
+
+bool FusedPreprocessingPass::simplifyCall(CallInst *Call) {
+    Function *CalledFun = Call->getCalledFunction();
+    if (!CalledFun) {
+        auto CalledVal = Call->getCalledValue();
+        if (auto Asm = dyn_cast<InlineAsm>(CalledVal)) {
+            auto BugTable = BugTableAsms.find(Asm);
+            if (BugTable == BugTableAsms.end())
+                BugTable = BugTableAsms.try_emplace(Asm, isBugTableAsm(Asm))
+                                   .first;
+            if (BugTable->second)
+                removeFileAndLineArgs(Call);
+        }
+        return false;
+    }
+
+    switch (getRole(CalledFun)) {
+    case CallRole::Printk:
+        simplifyPrintCall(Call, CalledFun, true);
+        return true;
+    case CallRole::Print:
+        simplifyPrintCall(Call, CalledFun, false);
+        return true;
+    case CallRole::FileAndLine:
+        removeFileAndLineArgs(Call);
+        return false;
+    case CallRole::KernelMemcpy:
+        replaceKernelMemcpy(Call);
+        return true;
+    case CallRole::Memcpy:
+        unifyMemcpyAlignment(Call);
+        return false;
+    case CallRole::None:
+        return false;
+    }
+    return false;
+}
@@ -0,0 +1,67 @@
+//===---- FusedPreprocessingPass.h - Preprocessing in a single walk -------===//
+//
+//       SimpLL - Program simplifier for analysis of semantic difference      //
+//
+// This file is published under Apache 2.0 license. See LICENSE for details.
+// Author: Viktor Malik, vmalik@redhat.com
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the FusedPreprocessingPass that does
+/// the transformations of SimplifyKernelFunctionCallsPass, UnifyMemcpyPass,
+/// and ReduceFunctionMetadataPass in a single walk over the instructions of
+/// a function.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef DIFFKEMP_SIMPLL_FUSEDPREPROCESSINGPASS_H
+#define DIFFKEMP_SIMPLL_FUSEDPREPROCESSINGPASS_H
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/IR/InlineAsm.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/PassManager.h>
+
+using namespace llvm;
+
+/// Fused preprocessing of calls. The called functions are classified by their
+/// names only once per module (the roles are kept in a table), then all
+/// rewrites of a call are done when the call is visited.
+/// The result is the same as of running the separate passes in the order
+/// SimplifyKernelFunctionCallsPass, UnifyMemcpyPass, and
+/// ReduceFunctionMetadataPass. Calls to bitcast operators are left to
+/// SeparateCallsToBitcastPass which is run after DCE.
+class FusedPreprocessingPass : public PassInfoMixin<FusedPreprocessingPass> {
+  public:
+    PreservedAnalyses run(Function &Fun, FunctionAnalysisManager &fam);
+
+  private:
+    /// Roles of called functions in the preprocessing.
+    enum class CallRole {
+        // The call is not transformed.
+        None,
+        // Call to printk, arguments are removed.
+        Printk,
+        // Call to other printing function, arguments are removed.
+        Print,
+        // Call to a function having a file name and a line number as its
+        // first two arguments, the arguments are removed.
+        FileAndLine,
+        // Call to __memcpy, replaced by llvm.memcpy.
+        KernelMemcpy,
+        // Call to llvm.memcpy, its alignment is unified.
+        Memcpy
+    };
+
+    DenseMap<const Function *, CallRole> Roles;
+    DenseMap<const InlineAsm *, bool> BugTableAsms;
+
+    /// Get the role of the called function (classify it on the first use).
+    CallRole getRole(const Function *Fun);
+
+    /// Transform the call according to the role of the called value.
+    /// \return True if the call was replaced and should be removed.
+    bool simplifyCall(CallInst *Call);
+};
+
+#endif // DIFFKEMP_SIMPLL_FUSEDPREPROCESSINGPASS_H
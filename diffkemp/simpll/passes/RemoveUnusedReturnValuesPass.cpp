@@ -41,12 +41,11 @@ PreservedAnalyses RemoveUnusedReturnValuesPass::run(
             continue;
 
         if (!isSimpllAbstractionDeclaration(Fun)) {
-            if (!ModOther->getFunction(Fun->getName()))
+            auto FunOther = ModOther->getFunction(Fun->getName());
+            if (!FunOther)
                 continue;
 
-            if (!ModOther->getFunction(Fun->getName())
-                         ->getReturnType()
-                         ->isVoidTy())
+            if (!FunOther->getReturnType()->isVoidTy())
                 continue;
 
             if (CalledFuns.find(Fun) == CalledFuns.end())
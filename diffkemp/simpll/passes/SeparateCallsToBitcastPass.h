@@ -14,6 +14,7 @@
 #ifndef DIFFKEMP_SIMPLL_SEPARATECALLSTOBITCASTPASS_H
 #define DIFFKEMP_SIMPLL_SEPARATECALLSTOBITCASTPASS_H
 
+#include <llvm/IR/Instructions.h>
 #include <llvm/IR/PassManager.h>
 
 using namespace llvm;
@@ -25,4 +26,10 @@ class SeparateCallsToBitcastPass
     PreservedAnalyses run(Function &Fun, FunctionAnalysisManager &fam);
 };
 
+/// Separate the bitcast from a call to a bitcast operator (the original call
+/// is not removed).
+/// \return The instruction replacing the call or null if the call was not
+///         separated.
+Instruction *separateCallToBitcast(CallInst *Call);
+
 #endif // DIFFKEMP_SIMPLL_SEPARATECALLSTOBITCASTPASS_H
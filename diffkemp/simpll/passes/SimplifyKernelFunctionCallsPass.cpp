@@ -47,6 +47,53 @@ void replaceArgByNull(CallInst *Call, unsigned index) {
     }
 }
 
+/// Replace a call to a printing function by a call with null arguments.
+CallInst *simplifyPrintCall(CallInst *Call, Function *CalledFun, bool Printk) {
+    CallInst *newCall;
+    if (Printk) {
+        // Functions with 1 mandatory argument
+        auto OpType = dyn_cast<PointerType>(Call->getOperand(0)->getType());
+        // An additional void pointer is added to the operand list so the
+        // instruction can be compared as equal even when the other one is one
+        // of the other printing functions.
+        newCall = CallInst::Create(CalledFun,
+                                   {ConstantPointerNull::get(OpType),
+                                    ConstantPointerNull::get(OpType)},
+                                   "",
+                                   Call);
+    } else {
+        // Functions with 2 mandatory arguments
+        auto Op0Type = dyn_cast<PointerType>(Call->getOperand(0)->getType());
+        auto Op1Type = dyn_cast<PointerType>(Call->getOperand(1)->getType());
+        newCall = CallInst::Create(CalledFun,
+                                   {ConstantPointerNull::get(Op0Type),
+                                    ConstantPointerNull::get(Op1Type)},
+                                   "",
+                                   Call);
+    }
+    copyCallInstProperties(Call, newCall);
+    Call->replaceAllUsesWith(newCall);
+    return newCall;
+}
+
+/// Check if the function has a file name and a line number as its first two
+/// arguments.
+bool hasFileAndLineArgs(StringRef FunName) {
+    return FunName == "warn_slowpath_null" || FunName == "warn_slowpath_fmt"
+           || FunName == "__might_sleep" || FunName == "__might_fault"
+           || FunName == "acpi_ut_predefined_warning";
+}
+
+/// Replace the file name by null and the line number by 0.
+void removeFileAndLineArgs(CallInst *Call) {
+    replaceArgByNull(Call, 0);
+    replaceArgByZero(Call, 1);
+}
+
+bool isBugTableAsm(const InlineAsm *Asm) {
+    return Asm->getAsmString().find("__bug_table") != std::string::npos;
+}
+
 PreservedAnalyses
         SimplifyKernelFunctionCallsPass::run(Function &Fun,
                                              FunctionAnalysisManager &fam) {
@@ -62,59 +109,25 @@ PreservedAnalyses
                     //  - replace the second argument by 0 (is a line number)
                     auto CalledVal = CallInstr->getCalledValue();
                     if (auto Asm = dyn_cast<InlineAsm>(CalledVal)) {
-                        if (Asm->getAsmString().find("__bug_table")
-                            != std::string::npos) {
-                            replaceArgByNull(CallInstr, 0);
-                            replaceArgByZero(CallInstr, 1);
-                        }
+                        if (isBugTableAsm(Asm))
+                            removeFileAndLineArgs(CallInstr);
                     }
                     continue;
                 }
 
                 // Remove arguments of printing functions
                 if (CalledFun->getName() == "printk") {
-                    // Functions with 1 mandatory argument
-                    auto OpType = dyn_cast<PointerType>(
-                            CallInstr->getOperand(0)->getType());
-                    // An additional void pointer is added to the operand list
-                    // so the instruction can be compared as equal even when the
-                    // other one is one of the functions listed in the other if
-                    auto newCall =
-                            CallInst::Create(CalledFun,
-                                             {ConstantPointerNull::get(OpType),
-                                              ConstantPointerNull::get(OpType)},
-                                             "",
-                                             &Instr);
-                    copyCallInstProperties(CallInstr, newCall);
-                    CallInstr->replaceAllUsesWith(newCall);
+                    simplifyPrintCall(CallInstr, CalledFun, true);
                     toRemove.push_back(&Instr);
                 } else if (isPrintFunction(CalledFun->getName())) {
-                    // Functions with 2 mandatory arguments
-                    auto Op0Type = dyn_cast<PointerType>(
-                            CallInstr->getOperand(0)->getType());
-                    auto Op1Type = dyn_cast<PointerType>(
-                            CallInstr->getOperand(1)->getType());
-                    auto newCall = CallInst::Create(
-                            CalledFun,
-                            {ConstantPointerNull::get(Op0Type),
-                             ConstantPointerNull::get(Op1Type)},
-                            "",
-                            &Instr);
-                    copyCallInstProperties(CallInstr, newCall);
-                    CallInstr->replaceAllUsesWith(newCall);
+                    simplifyPrintCall(CallInstr, CalledFun, false);
                     toRemove.push_back(&Instr);
                 }
 
                 // Replace the second argument of a call to warn_slowpath_null
                 // by 0 (it is a line number).
-                if (CalledFun->getName() == "warn_slowpath_null"
-                    || CalledFun->getName() == "warn_slowpath_fmt"
-                    || CalledFun->getName() == "__might_sleep"
-                    || CalledFun->getName() == "__might_fault"
-                    || CalledFun->getName() == "acpi_ut_predefined_warning") {
-                    replaceArgByNull(CallInstr, 0);
-                    replaceArgByZero(CallInstr, 1);
-                }
+                if (hasFileAndLineArgs(CalledFun->getName()))
+                    removeFileAndLineArgs(CallInstr);
             }
         }
     }
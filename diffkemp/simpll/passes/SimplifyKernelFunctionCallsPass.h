@@ -17,6 +17,8 @@
 #define DIFFKEMP_SIMPLL_SIMPLIFYKERNELFUNCTIONCALLSPASS_H
 
 #include <llvm/ADT/StringSet.h>
+#include <llvm/IR/InlineAsm.h>
+#include <llvm/IR/Instructions.h>
 #include <llvm/IR/PassManager.h>
 
 using namespace llvm;
@@ -27,4 +29,22 @@ class SimplifyKernelFunctionCallsPass
     PreservedAnalyses run(Function &Fun, FunctionAnalysisManager &fam);
 };
 
+/// Replace a call to a printing function by a call with null arguments.
+/// \param Printk True if the called function is printk (it has one mandatory
+///               argument, the other printing functions have two).
+/// \return The new call (the original call is not removed).
+CallInst *simplifyPrintCall(CallInst *Call, Function *CalledFun, bool Printk);
+
+/// Check if the function has a file name and a line number as its first two
+/// arguments.
+bool hasFileAndLineArgs(StringRef FunName);
+
+/// Replace the file name and the line number arguments of a call (the first
+/// and the second one) by null and 0.
+void removeFileAndLineArgs(CallInst *Call);
+
+/// Check if the inline assembly contains the __bug_table string (its first
+/// two arguments are then a file name and a line number).
+bool isBugTableAsm(const InlineAsm *Asm);
+
 #endif // DIFFKEMP_SIMPLL_SIMPLIFYKERNELFUNCTIONCALLSPASS_H
\ No newline at end of file
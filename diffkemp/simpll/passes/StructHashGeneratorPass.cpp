@@ -12,41 +12,28 @@
 //===----------------------------------------------------------------------===//
 
 #include "StructHashGeneratorPass.h"
-#include <llvm/ADT/Hashing.h>
-#include <llvm/IR/TypeFinder.h>
-#include <llvm/Support/raw_ostream.h>
+#include "TypeIndexAnalysis.h"
 
 PreservedAnalyses StructHashGeneratorPass::run(
         Module &Mod, llvm::AnalysisManager<llvm::Module> &Main) {
-    TypeFinder Types;
-    Types.run(Mod, true);
+    auto &Types = Main.getResult<TypeIndexAnalysis>(Mod);
 
-    for (auto *Ty : Types) {
-        if (auto STy = dyn_cast<StructType>(Ty)) {
-            if (!STy->getStructName().startswith("union.anon")
-                && !STy->getStructName().startswith("struct.anon"))
-                continue;
-            std::string TypeName = STy->getStructName().str();
-            std::string TypeDump;
-            llvm::raw_string_ostream DumpStrm(TypeDump);
-            DumpStrm << *STy;
-            TypeDump = DumpStrm.str();
+    for (auto *STy : Types.structTypes()) {
+        if (!isAnonStructType(STy) || STy->isOpaque())
+            continue;
+        // The hash does not depend on the name of the type itself, hence the
+        // memoised hashes stay valid after renaming.
+        std::string NewTypeName =
+                (STy->getName().startswith("union.anon") ? "union.anon."
+                                                         : "struct.anon.")
+                + std::to_string(Types.structuralHash(STy));
 
-            // Extract the type declaration without type name
-            int pos = TypeDump.find("{");
-            if (pos == std::string::npos)
-                continue;
-            std::string TypeDecl = TypeDump.substr(pos);
-            std::string NewTypeName =
-                    (STy->getStructName().startswith("union.anon")
-                             ? "union.anon."
-                             : "struct.anon.")
-                    + std::to_string(hash_value(TypeDecl));
-
-            // Rename the type
-            STy->setName(NewTypeName);
-        }
+        // Rename the type
+        STy->setName(NewTypeName);
     }
 
-    return PreservedAnalyses();
+    // Renaming types does not invalidate the type index.
+    PreservedAnalyses PA;
+    PA.preserve<TypeIndexAnalysis>();
+    return PA;
 }
@@ -7,70 +7,103 @@
 //===----------------------------------------------------------------------===//
 ///
 /// \file
-/// This file contains the definition of the StructureDebugInfoAnalysis pass.
+/// This file contains the definition of the StructureDebugInfoAnalysis pass
+/// and of the StructDebugInfoIndex class.
 ///
 //===----------------------------------------------------------------------===//
 
 #include "StructureDebugInfoAnalysis.h"
-#include <llvm/IR/DebugInfoMetadata.h>
+#include <algorithm>
+#include <llvm/IR/Module.h>
 
 AnalysisKey StructureDebugInfoAnalysis::Key;
 
 StructureDebugInfoAnalysis::Result StructureDebugInfoAnalysis::run(
         Module &Mod, AnalysisManager<Module, Function *> &mam, Function *Main) {
-    Result Res;
+    return StructDebugInfoIndex(Mod);
+}
+
+StructDebugInfoIndex::StructDebugInfoIndex(const Module &Mod) {
+    std::vector<DIType *> Roots;
     for (DICompileUnit *CU : Mod.debug_compile_units()) {
-        // Use a DFS algorithm to get to all DI nodes for structure types.
-        std::vector<DIType *> Stack;
         // Add retained types.
         DIScopeArray Nodes = CU->getRetainedTypes();
         for (DIScope *DNd : Nodes) {
             if (auto DTy = dyn_cast<DIType>(DNd))
-                Stack.push_back(DTy);
+                Roots.push_back(DTy);
         }
         // Add global variable types.
         DIGlobalVariableExpressionArray GExprs = CU->getGlobalVariables();
         for (DIGlobalVariableExpression *GExpr : GExprs) {
             DIGlobalVariable *GVar = GExpr->getVariable();
 #if LLVM_VERSION_MAJOR < 9
-            Stack.push_back(GVar->getType().resolve());
+            Roots.push_back(GVar->getType().resolve());
 #else
-            Stack.push_back(GVar->getType());
+            Roots.push_back(GVar->getType());
 #endif
         }
-        // The actual DFS.
-        // Note: since the type graph apparently is not a tree, a set to record
-        // already processed values has to be used.
-        std::set<DIType *> processedVals;
-        while (!Stack.empty()) {
-            DIType *DTy = Stack.back();
-            Stack.pop_back();
-            if (processedVals.find(DTy) != processedVals.end())
-                continue;
-            processedVals.insert(DTy);
-            if (auto DDTy = dyn_cast<DIDerivedType>(DTy)) {
+    }
+    addRoots(Roots);
+}
+
+StructDebugInfoIndex::StructDebugInfoIndex(const DebugInfoFinder &Finder) {
+    std::vector<DIType *> Roots;
+    for (auto *DTy : Finder.types())
+        Roots.push_back(DTy);
+    addRoots(Roots);
+}
+
+void StructDebugInfoIndex::addRoots(const std::vector<DIType *> &Roots) {
+    // The stack is processed from its end.
+    Stack.insert(Stack.end(), Roots.rbegin(), Roots.rend());
+}
+
+/// Look up the structure among the already found ones. If it is not there,
+/// continue the DFS over the type graph until the structure is found or
+/// until all types are processed.
+DICompositeType *StructDebugInfoIndex::lookup(StringRef Name) {
+    auto Found = Structs.find(Name);
+    if (Found != Structs.end())
+        return Found->second;
+
+    while (!Stack.empty()) {
+        DIType *DTy = Stack.back();
+        Stack.pop_back();
+        if (!DTy || !Processed.insert(DTy).second)
+            continue;
+        if (auto DDTy = dyn_cast<DIDerivedType>(DTy)) {
 #if LLVM_VERSION_MAJOR < 9
-                if (DDTy->getBaseType().resolve())
-                    Stack.push_back(DDTy->getBaseType().resolve());
+            Stack.push_back(DDTy->getBaseType().resolve());
 #else
-                if (DDTy->getBaseType())
-                    Stack.push_back(DDTy->getBaseType());
+            Stack.push_back(DDTy->getBaseType());
 #endif
-            } else if (auto DCTy = dyn_cast<DICompositeType>(DTy)) {
-                if (DCTy->getTag() == dwarf::DW_TAG_structure_type
-                    && DCTy->getName() != "") {
-                    // The type is a structure type, add entry to map.
-                    Res[DCTy->getName()] = DCTy;
-                }
-                // Go through all types inside the composite type.
-                DINodeArray Elems = DCTy->getElements();
-                for (DINode *DNd : Elems) {
-                    if (auto DTy2 = dyn_cast<DIType>(DNd)) {
-                        Stack.push_back(DTy2);
-                    }
-                }
+        } else if (auto DCTy = dyn_cast<DICompositeType>(DTy)) {
+            // Go through all types inside the composite type (in their order,
+            // hence they are pushed in the reverse order).
+            size_t Pushed = Stack.size();
+            for (DINode *DNd : DCTy->getElements()) {
+                if (auto DTy2 = dyn_cast<DIType>(DNd))
+                    Stack.push_back(DTy2);
+            }
+            std::reverse(Stack.begin() + Pushed, Stack.end());
+            if (DCTy->getTag() == dwarf::DW_TAG_structure_type
+                && DCTy->getName() != "") {
+                // The type is a structure type, add entry to the index (unless
+                // a structure of the same name was found before).
+                // Stop if it is the requested one.
+                auto Inserted = Structs.try_emplace(DCTy->getName(), DCTy);
+                if (Inserted.second && DCTy->getName() == Name)
+                    return DCTy;
             }
         }
     }
-    return Res;
+    return nullptr;
+}
+
+uint64_t StructDebugInfoIndex::getMemoryUsage() const {
+    uint64_t Bytes = Stack.capacity() * sizeof(DIType *)
+                     + Processed.size() * sizeof(DIType *);
+    for (auto &Entry : Structs)
+        Bytes += sizeof(Entry) + Entry.getKeyLength();
+    return Bytes;
 }
@@ -7,26 +7,75 @@
 //===----------------------------------------------------------------------===//
 ///
 /// \file
-/// This file contains the declaration of the StructureDebugInfoAnalysis pass.
+/// This file contains the declaration of the StructureDebugInfoAnalysis pass
+/// and of the StructDebugInfoIndex class which it computes.
 ///
 //===----------------------------------------------------------------------===//
 
 #ifndef DIFFKEMP_SIMPLL_STRUCTUREDEBUGINFOANALYSIS_H
 #define DIFFKEMP_SIMPLL_STRUCTUREDEBUGINFOANALYSIS_H
 
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/IR/DebugInfo.h>
+#include <llvm/IR/DebugInfoMetadata.h>
 #include <llvm/IR/PassManager.h>
-#include <set>
-#include <unordered_map>
+#include <vector>
 
 using namespace llvm;
 
+/// Index of debug info nodes (DICompositeType) of structure types by their
+/// names (as given in the debug info, i.e. without the "struct." prefix).
+/// The index is built lazily: the type graph of the debug info is traversed
+/// only until the requested name is found and the traversal is resumed by
+/// the next lookup of a name that has not been found yet.
+/// The traversal is a DFS visiting the root types and the elements of
+/// composite types in their order. If there are more structure types with
+/// the same name (e.g. from multiple compile units or a declaration and
+/// a definition of the type), the first one visited is used.
+class StructDebugInfoIndex {
+  public:
+    /// Create an empty index.
+    StructDebugInfoIndex() = default;
+
+    /// Create an index of the module. The traversal starts from the retained
+    /// types and from the types of global variables of each compile unit (in
+    /// the order of the compile units).
+    explicit StructDebugInfoIndex(const Module &Mod);
+
+    /// Create an index of the types collected by the debug info finder
+    /// (the traversal starts from them in the order of the finder).
+    explicit StructDebugInfoIndex(const DebugInfoFinder &Finder);
+
+    /// Get the debug info node of the structure type with the given name.
+    /// \return Null if the module has no such structure type.
+    DICompositeType *lookup(StringRef Name);
+
+    /// Estimate of the memory taken by the index (in bytes).
+    uint64_t getMemoryUsage() const;
+
+  private:
+    /// Add the roots of the traversal so that they are visited in the given
+    /// order.
+    void addRoots(const std::vector<DIType *> &Roots);
+
+    /// Structure types found so far.
+    StringMap<DICompositeType *> Structs;
+    /// Types that are yet to be processed by the traversal.
+    std::vector<DIType *> Stack;
+    /// Types already processed by the traversal.
+    /// Note: since the type graph apparently is not a tree, the set is
+    /// necessary.
+    SmallPtrSet<DIType *, 32> Processed;
+};
+
 class StructureDebugInfoAnalysis
         : public AnalysisInfoMixin<StructureDebugInfoAnalysis> {
   public:
-    using Result = std::unordered_map<std::string, DICompositeType *>;
+    using Result = StructDebugInfoIndex;
 
-    /// Collects all debug info nodes (DICompositeType) belonging to structure
-    /// types and saves them into a map from the type names to the nodes.
+    /// Creates an index of the debug info nodes (DICompositeType) belonging
+    /// to structure types by the type names.
     Result run(Module &Mod,
                AnalysisManager<Module, Function *> &mam,
                Function *Main);
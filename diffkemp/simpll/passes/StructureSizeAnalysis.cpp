@@ -12,30 +12,19 @@
 //===----------------------------------------------------------------------===//
 
 #include "StructureSizeAnalysis.h"
-#include "llvm/IR/TypeFinder.h"
+#include "TypeIndexAnalysis.h"
 
 AnalysisKey StructureSizeAnalysis::Key;
 
 StructureSizeAnalysis::Result StructureSizeAnalysis::run(
         Module &Mod, AnalysisManager<Module, Function *> &mam, Function *Main) {
-    TypeFinder Types;
+    auto &Types = mam.getResult<TypeIndexAnalysis>(Mod, Main);
     Result Res;
-    Types.run(Mod, true);
 
-    for (auto *Ty : Types) {
-        if (StructType *STy = dyn_cast<StructType>(Ty)) {
-            if (!STy->isSized())
-                continue;
-            uint64_t STySize = Mod.getDataLayout().getTypeAllocSize(STy);
-            auto Elem = Res.find(STySize);
-            if (Elem != Res.end()) {
-                Elem->second.insert(STy->getStructName());
-            } else {
-                std::set<std::string> Set;
-                Set.insert(STy->getStructName());
-                Res[STySize] = Set;
-            }
-        }
+    for (auto *STy : Types.structTypes()) {
+        if (!STy->isSized())
+            continue;
+        Res[Types.allocSize(STy)].insert(STy->getStructName().str());
     }
 
     return Res;
@@ -0,0 +1,121 @@
+//===----- TypeIndexAnalysis.cpp - Index of types used in a module --------===//
+//
+//       SimpLL - Program simplifier for analysis of semantic difference      //
+//
+// This file is published under Apache 2.0 license. See LICENSE for details.
+// Author: Viktor Malik, vmalik@redhat.com
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the implementation of the TypeIndex class and of the
+/// TypeIndexAnalysis pass.
+///
+//===----------------------------------------------------------------------===//
+
+#include "TypeIndexAnalysis.h"
+#include <llvm/IR/Module.h>
+#include <llvm/IR/TypeFinder.h>
+
+AnalysisKey TypeIndexAnalysis::Key;
+
+TypeIndexAnalysis::Result TypeIndexAnalysis::run(Module &Mod,
+                                                 AnalysisManager<Module> &mam) {
+    return TypeIndex(Mod);
+}
+
+TypeIndexAnalysis::Result TypeIndexAnalysis::run(
+        Module &Mod, AnalysisManager<Module, Function *> &mam, Function *Main) {
+    return TypeIndex(Mod);
+}
+
+bool isAnonStructType(const StructType *STy) {
+    return STy->hasName()
+           && (STy->getName().startswith("union.anon")
+               || STy->getName().startswith("struct.anon"));
+}
+
+TypeIndex::TypeIndex(const Module &Mod) : Layout(Mod.getDataLayout()) {
+    TypeFinder Types;
+    Types.run(Mod, true);
+    for (auto *Ty : Types) {
+        if (auto STy = dyn_cast<StructType>(Ty))
+            StructTypes.push_back(STy);
+    }
+}
+
+/// Check if the structure type is hashed by its contents (i.e. it has no name
+/// or it is an anonymous structure or union).
+static bool isHashedByContents(const StructType *STy) {
+    return !STy->hasName() || isAnonStructType(STy);
+}
+
+/// Hash of the layout of a structure type hashed by its contents. Only the
+/// kinds of the element types are hashed, hence the hash does not recurse into
+/// other types.
+static hash_code layoutHash(const StructType *STy) {
+    hash_code Hash = hash_combine(STy->getTypeID(), STy->isOpaque());
+    if (!STy->isOpaque()) {
+        Hash = hash_combine(Hash, STy->isPacked());
+        for (Type *Elem : STy->elements())
+            Hash = hash_combine(Hash, Elem->getTypeID());
+    }
+    return Hash;
+}
+
+hash_code TypeIndex::structuralHash(Type *Ty) {
+    auto Cached = Hashes.find(Ty);
+    if (Cached != Hashes.end())
+        return Cached->second;
+
+    hash_code Hash = hash_value(Ty->getTypeID());
+    if (auto STy = dyn_cast<StructType>(Ty)) {
+        if (!isHashedByContents(STy)) {
+            Hash = hash_combine(Hash, STy->getName());
+        } else if (STy->isOpaque()) {
+            Hash = hash_combine(Hash, true);
+        } else {
+            Hash = hash_combine(Hash, STy->isPacked());
+            for (Type *Elem : STy->elements())
+                Hash = hash_combine(Hash, structuralHash(Elem));
+        }
+    } else if (auto ITy = dyn_cast<IntegerType>(Ty)) {
+        Hash = hash_combine(Hash, ITy->getBitWidth());
+    } else if (auto PTy = dyn_cast<PointerType>(Ty)) {
+        // Types can be recursive only through pointers to structures. Pointed
+        // structures hashed by their contents are hashed by their layout only,
+        // so that the hash of every type is computed without recursion into
+        // itself and it does not depend on the order in which the hashes are
+        // computed.
+        auto PointedSTy = dyn_cast<StructType>(PTy->getElementType());
+        Hash = hash_combine(Hash,
+                            PTy->getAddressSpace(),
+                            PointedSTy && isHashedByContents(PointedSTy)
+                                    ? layoutHash(PointedSTy)
+                                    : structuralHash(PTy->getElementType()));
+    } else if (auto ATy = dyn_cast<ArrayType>(Ty)) {
+        Hash = hash_combine(Hash,
+                            ATy->getNumElements(),
+                            structuralHash(ATy->getElementType()));
+    } else if (auto VTy = dyn_cast<VectorType>(Ty)) {
+        Hash = hash_combine(Hash,
+                            VTy->getNumElements(),
+                            structuralHash(VTy->getElementType()));
+    } else if (auto FTy = dyn_cast<FunctionType>(Ty)) {
+        Hash = hash_combine(Hash,
+                            FTy->isVarArg(),
+                            structuralHash(FTy->getReturnType()));
+        for (Type *Param : FTy->params())
+            Hash = hash_combine(Hash, structuralHash(Param));
+    }
+    Hashes[Ty] = Hash;
+    return Hash;
+}
+
+uint64_t TypeIndex::allocSize(Type *Ty) {
+    auto Cached = Sizes.find(Ty);
+    if (Cached != Sizes.end())
+        return Cached->second;
+    uint64_t Size = Ty->isSized() ? Layout.getTypeAllocSize(Ty) : 0;
+    Sizes[Ty] = Size;
+    return Size;
+}
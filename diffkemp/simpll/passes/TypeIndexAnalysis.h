@@ -0,0 +1,77 @@
+//===------ TypeIndexAnalysis.h - Index of types used in a module ---------===//
+//
+//       SimpLL - Program simplifier for analysis of semantic difference      //
+//
+// This file is published under Apache 2.0 license. See LICENSE for details.
+// Author: Viktor Malik, vmalik@redhat.com
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the TypeIndex class, which collects
+/// all structure types used in a module in a single walk and memoises
+/// information about them, and of the TypeIndexAnalysis pass computing it.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef DIFFKEMP_SIMPLL_TYPEINDEXANALYSIS_H
+#define DIFFKEMP_SIMPLL_TYPEINDEXANALYSIS_H
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/Hashing.h>
+#include <llvm/IR/PassManager.h>
+#include <vector>
+
+using namespace llvm;
+
+/// Index of types used in a module.
+/// Structure types are collected once, their structural hashes and allocation
+/// sizes are computed on demand and memoised.
+class TypeIndex {
+  public:
+    explicit TypeIndex(const Module &Mod);
+
+    /// All structure types used in the module.
+    const std::vector<StructType *> &structTypes() const {
+        return StructTypes;
+    }
+
+    /// Structural hash of a type computed directly over the type graph.
+    /// Identified structure types are hashed by their names, except for
+    /// anonymous structures (and unions) which are hashed by their contents
+    /// since their names are not stable between modules. Anonymous structures
+    /// pointed to from the hashed type are hashed by their layout only, hence
+    /// the hash of a type does not depend on the order of the queries.
+    hash_code structuralHash(Type *Ty);
+
+    /// Allocation size of a type (0 if the type is not sized).
+    uint64_t allocSize(Type *Ty);
+
+  private:
+    const DataLayout &Layout;
+    std::vector<StructType *> StructTypes;
+
+    DenseMap<Type *, hash_code> Hashes;
+    DenseMap<Type *, uint64_t> Sizes;
+};
+
+/// Check if the structure type is an anonymous structure or union.
+bool isAnonStructType(const StructType *STy);
+
+class TypeIndexAnalysis : public AnalysisInfoMixin<TypeIndexAnalysis> {
+  public:
+    using Result = TypeIndex;
+
+    /// Collects all types of the module. Can be used from both the plain
+    /// module analysis manager (during preprocessing) and the one
+    /// parametrised by the main function (during simplification).
+    Result run(Module &Mod, AnalysisManager<Module> &mam);
+    Result run(Module &Mod,
+               AnalysisManager<Module, Function *> &mam,
+               Function *Main);
+
+  private:
+    friend AnalysisInfoMixin<TypeIndexAnalysis>;
+    static AnalysisKey Key;
+};
+
+#endif // DIFFKEMP_SIMPLL_TYPEINDEXANALYSIS_H
@@ -16,6 +16,41 @@
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Instructions.h>
 
+/// Replace a call to __memcpy by the llvm.memcpy intrinsic.
+void replaceKernelMemcpy(CallInst *Call) {
+    IRBuilder<> builder(Call);
+#if LLVM_VERSION_MAJOR < 7
+    builder.CreateMemCpy(Call->getArgOperand(0),
+                         Call->getArgOperand(1),
+                         Call->getArgOperand(2),
+                         0);
+#elif LLVM_VERSION_MAJOR < 10
+    builder.CreateMemCpy(Call->getArgOperand(0),
+                         0,
+                         Call->getArgOperand(1),
+                         0,
+                         Call->getArgOperand(2));
+#else
+    builder.CreateMemCpy(Call->getArgOperand(0),
+                         MaybeAlign(0),
+                         Call->getArgOperand(1),
+                         MaybeAlign(0),
+                         Call->getArgOperand(2));
+#endif
+    // __memcpy returns pointer to the destination
+    Call->replaceAllUsesWith(Call->getArgOperand(1));
+}
+
+/// If the alignment parameter is set to 1, set it to 0 (LLVM defines 0 and 1
+/// as no alignment).
+void unifyMemcpyAlignment(CallInst *Call) {
+    if (auto MemcpyAlign = dyn_cast<ConstantInt>(Call->getArgOperand(3))) {
+        if (MemcpyAlign->getZExtValue() == 1)
+            Call->setArgOperand(
+                    3, ConstantInt::get(MemcpyAlign->getType(), 0, false));
+    }
+}
+
 PreservedAnalyses UnifyMemcpyPass::run(Function &Fun,
                                        FunctionAnalysisManager &fam) {
     std::vector<Instruction *> toRemove;
@@ -28,39 +63,10 @@ PreservedAnalyses UnifyMemcpyPass::run(Function &Fun,
 
                 if (CalledFun->getName() == "__memcpy") {
                     // Replace call to __memcpy by llvm.memcpy intrinsic
-                    IRBuilder<> builder(&Instr);
-#if LLVM_VERSION_MAJOR < 7
-                    builder.CreateMemCpy(Call->getArgOperand(0),
-                                         Call->getArgOperand(1),
-                                         Call->getArgOperand(2),
-                                         0);
-#elif LLVM_VERSION_MAJOR < 10
-                    builder.CreateMemCpy(Call->getArgOperand(0),
-                                         0,
-                                         Call->getArgOperand(1),
-                                         0,
-                                         Call->getArgOperand(2));
-#else
-                    builder.CreateMemCpy(Call->getArgOperand(0),
-                                         MaybeAlign(0),
-                                         Call->getArgOperand(1),
-                                         MaybeAlign(0),
-                                         Call->getArgOperand(2));
-#endif
-                    // __memcpy returns pointer to the destination
-                    Call->replaceAllUsesWith(Call->getArgOperand(1));
+                    replaceKernelMemcpy(Call);
                     toRemove.push_back(Call);
                 } else if (CalledFun->getIntrinsicID() == Intrinsic::memcpy) {
-                    // If the alignment parameter is set to 1, set it to 0
-                    // (LLVM defines 0 and 1 as no alignment)
-                    if (auto MemcpyAlign =
-                                dyn_cast<ConstantInt>(Call->getArgOperand(3))) {
-                        if (MemcpyAlign->getZExtValue() == 1)
-                            Call->setArgOperand(
-                                    3,
-                                    ConstantInt::get(
-                                            MemcpyAlign->getType(), 0, false));
-                    }
+                    unifyMemcpyAlignment(Call);
                 }
             }
         }
@@ -15,6 +15,7 @@
 #ifndef DIFFKEMP_SIMPLL_UNIFYMEMCPYPASS_H
 #define DIFFKEMP_SIMPLL_UNIFYMEMCPYPASS_H
 
+#include <llvm/IR/Instructions.h>
 #include <llvm/IR/PassManager.h>
 
 using namespace llvm;
@@ -24,4 +25,11 @@ class UnifyMemcpyPass : public PassInfoMixin<UnifyMemcpyPass> {
     PreservedAnalyses run(Function &Fun, FunctionAnalysisManager &fam);
 };
 
+/// Replace a call to __memcpy by the llvm.memcpy intrinsic (the original call
+/// is not removed).
+void replaceKernelMemcpy(CallInst *Call);
+
+/// Set the alignment argument of a call to llvm.memcpy to 0 if it is 1.
+void unifyMemcpyAlignment(CallInst *Call);
+
 #endif // DIFFKEMP_SIMPLL_UNIFYMEMCPYPASS_H
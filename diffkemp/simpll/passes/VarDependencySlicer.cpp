@@ -15,6 +15,7 @@
 #include "VarDependencySlicer.h"
 #include "DebugInfo.h"
 #include <Config.h>
+#include <list>
 #include <llvm/Analysis/CFG.h>
 #include <llvm/IR/CFG.h>
 #include <llvm/IR/Operator.h>
@@ -22,6 +23,7 @@
 #include <llvm/Transforms/Utils/Cloning.h>
 #include <llvm/Transforms/Utils/Local.h>
 #include <llvm/Transforms/Utils/UnifyFunctionExitNodes.h>
+#include <set>
 
 PreservedAnalyses VarDependencySlicer::run(Function &Fun,
                                            FunctionAnalysisManager &fam,
@@ -30,12 +32,8 @@ PreservedAnalyses VarDependencySlicer::run(Function &Fun,
         return PreservedAnalyses::all();
 
     Variable = Var;
-    // Clear all sets
-    DependentInstrs.clear();
-    IncludedInstrs.clear();
-    AffectedBasicBlocks.clear();
-    IncludedBasicBlocks.clear();
-    IncludedParams.clear();
+    // Number blocks and instructions and clear all sets
+    numberFunction(Fun);
 
     DEBUG_WITH_TYPE(DEBUG_SIMPLL,
                     dbgs() << "Function: " << Fun.getName().str() << "\n");
@@ -87,15 +85,33 @@ PreservedAnalyses VarDependencySlicer::run(Function &Fun,
     // produce a valid CFG
     DEBUG_WITH_TYPE(DEBUG_SIMPLL, dbgs() << "Second phase\n");
     // Recursively add all instruction operands to included
-    for (auto &Inst : DependentInstrs) {
-        if (isa<PHINode>(Inst))
+    BitVector Dependent = DependentInstrs;
+    for (int i = Dependent.find_first(); i != -1; i = Dependent.find_next(i)) {
+        if (isa<PHINode>(Instrs[i]))
             continue;
-        addAllOpsToIncluded(Inst);
+        addAllOpsToIncluded(Instrs[i]);
     }
 
+    // Unification of exit nodes replaces all returns (and all unreachable
+    // instructions) by branches if there are more of them.
+    std::vector<const Instruction *> Returns;
+    std::vector<const Instruction *> Unreachables;
+    for (auto &BB : Fun) {
+        if (isa<ReturnInst>(BB.getTerminator()))
+            Returns.push_back(BB.getTerminator());
+        else if (isa<UnreachableInst>(BB.getTerminator()))
+            Unreachables.push_back(BB.getTerminator());
+    }
     UnifyFunctionExitNodes unifyExitPass;
     unifyExitPass.runOnFunction(Fun);
     RetBB = unifyExitPass.getReturnBlock();
+    for (auto *Removed : {&Returns, &Unreachables}) {
+        if (Removed->size() > 1) {
+            for (auto Inst : *Removed)
+                forgetInstruction(Inst);
+        }
+    }
+    ReachableCache.clear();
 
     for (auto &BB : Fun) {
         auto Term = dyn_cast<BranchInst>(BB.getTerminator());
@@ -119,14 +135,16 @@ PreservedAnalyses VarDependencySlicer::run(Function &Fun,
             }
             // Create and insert new branch
             auto NewTerm = BranchInst::Create(NewSucc, Term);
+            forgetInstruction(Term);
             Term->eraseFromParent();
-            IncludedInstrs.insert(NewTerm);
+            IncludedInstrs.set(getNumber(NewTerm));
+            ReachableCache.clear();
         } else {
             addToIncluded(Term);
             addAllOpsToIncluded(Term);
         }
     }
-    IncludedInstrs.insert(DependentInstrs.begin(), DependentInstrs.end());
+    IncludedInstrs |= DependentInstrs;
 
     // Add needed instructions coming to Phis to included
     for (auto &BB : Fun) {
@@ -230,44 +248,38 @@ PreservedAnalyses VarDependencySlicer::run(Function &Fun,
 /// A condition affects those blocks that are reachable through one branch
 /// only: hence it is a difference of union and intersection of sets of
 /// blocks reachable from individual branches.
-std::vector<const BasicBlock *>
-        VarDependencySlicer::affectedBasicBlocks(BranchInst *Branch) {
-    std::set<const BasicBlock *> reachableUnion;
-    std::set<const BasicBlock *> reachableIntersection;
+BitVector VarDependencySlicer::affectedBasicBlocks(BranchInst *Branch) {
+    BitVector reachableUnion(Blocks.size());
+    BitVector reachableIntersection(Blocks.size());
     bool first = true;
     if (Branch->isConditional()) {
         for (auto Succ : Branch->successors()) {
             auto reachable = reachableBlocksThroughSucc(Branch, Succ);
 
             // Compute union with blocks reachable from other branches
-            uniteWith(reachableUnion, reachable);
+            reachableUnion |= reachable;
 
             // Compute intersection with blocks reachable from other branches
             if (first) {
                 reachableIntersection = std::move(reachable);
                 first = false;
             } else {
-                intersectWith(reachableIntersection, reachable);
+                reachableIntersection &= reachable;
             }
         }
     }
-    std::vector<const BasicBlock *> result;
-    std::set_difference(reachableUnion.begin(),
-                        reachableUnion.end(),
-                        reachableIntersection.begin(),
-                        reachableIntersection.end(),
-                        std::back_inserter(result));
-    return result;
+    reachableUnion.reset(reachableIntersection);
+    return reachableUnion;
 }
 
 /// Add all instructions of a basic block to included.
-void VarDependencySlicer::addAllInstrs(
-        const std::vector<const BasicBlock *> BBs) {
-    for (auto BB : BBs) {
-        AffectedBasicBlocks.insert(BB);
-        IncludedBasicBlocks.insert(BB);
+void VarDependencySlicer::addAllInstrs(const BitVector &BBs) {
+    for (int i = BBs.find_first(); i != -1; i = BBs.find_next(i)) {
+        auto BB = Blocks[i];
+        AffectedBasicBlocks.set(i);
+        IncludedBasicBlocks.set(i);
         for (auto &Instr : *BB) {
-            DependentInstrs.insert(&Instr);
+            DependentInstrs.set(getNumber(&Instr));
             DEBUG_WITH_TYPE(DEBUG_SIMPLL, {
                 dbgs() << "Dependent: ";
                 Instr.print(dbgs());
@@ -309,16 +321,13 @@ bool VarDependencySlicer::addToIncluded(const Instruction *Inst) {
 }
 
 /// Add instruction to the given set of instructions.
-bool VarDependencySlicer::addToSet(const Instruction *Inst,
-                                   std::set<const Instruction *> &set) {
-
-    bool added = false;
-    auto add = set.insert(Inst);
-    if (add.second) {
-        added = true;
-        IncludedBasicBlocks.insert(Inst->getParent());
-    }
-    return added;
+bool VarDependencySlicer::addToSet(const Instruction *Inst, BitVector &set) {
+    unsigned Number = getNumber(Inst);
+    if (set.test(Number))
+        return false;
+    set.set(Number);
+    IncludedBasicBlocks.set(getNumber(Inst->getParent()));
+    return true;
 }
 
 /// Recursively add all operands of an instruction to included instructions.
@@ -342,7 +351,7 @@ bool VarDependencySlicer::addAllOpsToIncluded(const Instruction *Inst) {
                 addStoresToIncluded(OpInst, Inst);
         }
         if (auto OpParam = dyn_cast<Argument>(Op))
-            IncludedParams.insert(OpParam);
+            IncludedParams.set(OpParam->getArgNo());
     }
     return added;
 }
@@ -350,7 +359,7 @@ bool VarDependencySlicer::addAllOpsToIncluded(const Instruction *Inst) {
 /// Calculate which successors of a terminator instruction must be included.
 /// We include a successor if there exists an included basic block that is
 /// reachable only via this successor.
-std::set<BasicBlock *>
+std::vector<BasicBlock *>
         VarDependencySlicer::includedSuccessors(BranchInst &Terminator,
                                                 const BasicBlock *ExitBlock) {
 
@@ -366,28 +375,22 @@ std::set<BasicBlock *>
     // Find all included blocks (except exit block) that are reachable through
     // true edge
     auto reachableTrue = reachableBlocksThroughSucc(&Terminator, TrueSucc);
-    intersectWith(reachableTrue, IncludedBasicBlocks);
+    reachableTrue &= IncludedBasicBlocks;
     if (ExitBlock)
-        reachableTrue.erase(ExitBlock);
+        reachableTrue.reset(getNumber(ExitBlock));
     // Find all included blocks (except exit block) that are reachable through
     // false edge
     auto reachableFalse = reachableBlocksThroughSucc(&Terminator, FalseSucc);
-    intersectWith(reachableFalse, IncludedBasicBlocks);
+    reachableFalse &= IncludedBasicBlocks;
     if (ExitBlock)
-        reachableFalse.erase(ExitBlock);
+        reachableFalse.reset(getNumber(ExitBlock));
 
     if (reachableTrue != reachableFalse) {
         // If one successor covers all included blocks reachable from the other
         // successor, choose it
-        if (std::includes(reachableTrue.begin(),
-                          reachableTrue.end(),
-                          reachableFalse.begin(),
-                          reachableFalse.end()))
+        if (!reachableFalse.test(reachableTrue))
             return {TrueSucc};
-        if (std::includes(reachableFalse.begin(),
-                          reachableFalse.end(),
-                          reachableTrue.begin(),
-                          reachableTrue.end()))
+        if (!reachableTrue.test(reachableFalse))
             return {FalseSucc};
         // If neither of successors covers all blocks reachable by the other,
         // we have to follow both
@@ -399,10 +402,10 @@ std::set<BasicBlock *>
     // One of them might reach other blocks through loop only and than we need
     // to keep the other one
     // TODO this should use loop analysis
-    if (!reachableTrue.empty()) {
-        if (!isPotentiallyReachable(TrueSucc, Terminator.getParent())) {
+    if (reachableTrue.any()) {
+        if (!isReachable(TrueSucc, Terminator.getParent())) {
             return {TrueSucc};
-        } else if (!isPotentiallyReachable(FalseSucc, Terminator.getParent())) {
+        } else if (!isReachable(FalseSucc, Terminator.getParent())) {
             return {FalseSucc};
         } else {
             return {TrueSucc == ExitBlock ? FalseSucc : TrueSucc};
@@ -449,86 +452,151 @@ bool VarDependencySlicer::canRemoveFirstBlock(const BasicBlock *bb) {
     return true;
 }
 
-/// Calculate the set of all basic blocks reachable from some block in
-/// a function.
-std::set<const BasicBlock *>
-        VarDependencySlicer::reachableBlocks(const BasicBlock *Src,
-                                             Function &Fun) {
-    std::set<const BasicBlock *> result;
-    for (auto &BB : Fun) {
-        if (Src != &BB && isPotentiallyReachable(Src, &BB))
-            result.insert(&BB);
+/// Calculate the set of all basic blocks reachable from some block (including
+/// the block itself). Successors of the stop block are not searched.
+BitVector VarDependencySlicer::reachableBlocks(const BasicBlock *Src,
+                                               const BasicBlock *Stop) {
+    BitVector Result(Blocks.size());
+    Result.set(getNumber(Src));
+    std::vector<const BasicBlock *> Worklist = {Src};
+    while (!Worklist.empty()) {
+        auto BB = Worklist.back();
+        Worklist.pop_back();
+        if (BB == Stop)
+            continue;
+        for (auto Succ : successors(BB)) {
+            unsigned Number = getNumber(Succ);
+            if (Number >= Result.size())
+                Result.resize(Blocks.size());
+            if (!Result.test(Number)) {
+                Result.set(Number);
+                Worklist.push_back(Succ);
+            }
+        }
     }
-    return result;
+    Result.resize(Blocks.size());
+    return Result;
 }
 
 /// Calculate a set of all basic blocks that are reachable via a successor of
-/// a terminator instruction.
-std::set<const BasicBlock *>
+/// a terminator instruction (omitting all other successors).
+BitVector
         VarDependencySlicer::reachableBlocksThroughSucc(Instruction *Terminator,
                                                         BasicBlock *Succ) {
-    // Replace terminator by unconditional branch and find all blocks reachable
-    // through the new branch (one that omits all other successors)
-    auto NewBranch = BranchInst::Create(Succ, Terminator);
-    Terminator->removeFromParent();
-    auto reachable =
-            reachableBlocks(NewBranch->getParent(), *Succ->getParent());
+    auto BB = Terminator->getParent();
+    // Blocks reachable from the successor. When the search returns back to the
+    // block of the terminator, it continues to the successor only.
+    auto reachable = reachableBlocks(Succ, BB);
+    reachable.reset(getNumber(BB));
+    return reachable;
+}
 
-    // Restore original terminator
-    Terminator->insertBefore(NewBranch);
-    NewBranch->eraseFromParent();
+/// Check if there is a path between two blocks. The sets of reachable blocks
+/// are cached until the CFG is changed.
+bool VarDependencySlicer::isReachable(const BasicBlock *From,
+                                      const BasicBlock *To) {
+    auto Cached = ReachableCache.find(From);
+    if (Cached == ReachableCache.end())
+        Cached = ReachableCache.try_emplace(From, reachableBlocks(From)).first;
+    unsigned Number = getNumber(To);
+    return Number < Cached->second.size() && Cached->second.test(Number);
+}
 
-    return reachable;
+/// Number all basic blocks and instructions of the function and reset all
+/// sets.
+void VarDependencySlicer::numberFunction(const Function &Fun) {
+    BlockNumbers.clear();
+    Blocks.clear();
+    InstrNumbers.clear();
+    Instrs.clear();
+    ReachableCache.clear();
+    for (auto &BB : Fun) {
+        BlockNumbers[&BB] = Blocks.size();
+        Blocks.push_back(&BB);
+        for (auto &Inst : BB) {
+            InstrNumbers[&Inst] = Instrs.size();
+            Instrs.push_back(&Inst);
+        }
+    }
+    DependentInstrs.clear();
+    DependentInstrs.resize(Instrs.size());
+    IncludedInstrs.clear();
+    IncludedInstrs.resize(Instrs.size());
+    AffectedBasicBlocks.clear();
+    AffectedBasicBlocks.resize(Blocks.size());
+    IncludedBasicBlocks.clear();
+    IncludedBasicBlocks.resize(Blocks.size());
+    IncludedParams.clear();
+    IncludedParams.resize(Fun.arg_size());
+}
+
+/// Get the number of a basic block. New blocks are numbered on demand.
+unsigned VarDependencySlicer::getNumber(const BasicBlock *BB) {
+    auto Number = BlockNumbers.find(BB);
+    if (Number != BlockNumbers.end())
+        return Number->second;
+    unsigned NewNumber = Blocks.size();
+    BlockNumbers[BB] = NewNumber;
+    Blocks.push_back(BB);
+    AffectedBasicBlocks.resize(Blocks.size());
+    IncludedBasicBlocks.resize(Blocks.size());
+    return NewNumber;
 }
 
-/// Set intersection. Result is stored in the first set.
-void VarDependencySlicer::intersectWith(
-        std::set<const BasicBlock *> &set,
-        const std::set<const BasicBlock *> &other) {
-    std::set<const BasicBlock *> tmpSet;
-    std::set_intersection(set.begin(),
-                          set.end(),
-                          other.begin(),
-                          other.end(),
-                          std::inserter(tmpSet, tmpSet.begin()));
-    set = std::move(tmpSet);
+/// Get the number of an instruction. New instructions are numbered on demand.
+unsigned VarDependencySlicer::getNumber(const Instruction *Inst) {
+    auto Number = InstrNumbers.find(Inst);
+    if (Number != InstrNumbers.end())
+        return Number->second;
+    unsigned NewNumber = Instrs.size();
+    InstrNumbers[Inst] = NewNumber;
+    Instrs.push_back(Inst);
+    DependentInstrs.resize(Instrs.size());
+    IncludedInstrs.resize(Instrs.size());
+    return NewNumber;
 }
 
-/// Set union. Result is stored in the first set.
-void VarDependencySlicer::uniteWith(std::set<const BasicBlock *> &set,
-                                    const std::set<const BasicBlock *> &other) {
-    std::set<const BasicBlock *> tmpSet;
-    std::set_union(set.begin(),
-                   set.end(),
-                   other.begin(),
-                   other.end(),
-                   std::inserter(tmpSet, tmpSet.begin()));
-    set = std::move(tmpSet);
+/// Remove an instruction that is going to be deleted from all sets, so that
+/// a new instruction allocated at the same address is not mistaken for it.
+void VarDependencySlicer::forgetInstruction(const Instruction *Inst) {
+    auto Number = InstrNumbers.find(Inst);
+    if (Number == InstrNumbers.end())
+        return;
+    DependentInstrs.reset(Number->second);
+    IncludedInstrs.reset(Number->second);
+    Instrs[Number->second] = nullptr;
+    InstrNumbers.erase(Number);
 }
 
 /// Check if an instruction is dependent on the value of the global variable.
 bool VarDependencySlicer::isDependent(const Instruction *Instr) {
-    return DependentInstrs.find(Instr) != DependentInstrs.end();
+    auto Number = InstrNumbers.find(Instr);
+    return Number != InstrNumbers.end() && DependentInstrs.test(Number->second);
 }
 
 /// Check if an instruction must be included.
 bool VarDependencySlicer::isIncluded(const Instruction *Instr) {
-    return IncludedInstrs.find(Instr) != IncludedInstrs.end();
+    auto Number = InstrNumbers.find(Instr);
+    return Number != InstrNumbers.end() && IncludedInstrs.test(Number->second);
 }
 
 // Check if a basic block is affected by the value of the global variable.
 bool VarDependencySlicer::isAffected(const BasicBlock *BB) {
-    return AffectedBasicBlocks.find(BB) != AffectedBasicBlocks.end();
+    auto Number = BlockNumbers.find(BB);
+    return Number != BlockNumbers.end()
+           && AffectedBasicBlocks.test(Number->second);
 }
 
 // Check if a basic block must be included.
 bool VarDependencySlicer::isIncluded(const BasicBlock *BB) {
-    return IncludedBasicBlocks.find(BB) != IncludedBasicBlocks.end();
+    auto Number = BlockNumbers.find(BB);
+    return Number != BlockNumbers.end()
+           && IncludedBasicBlocks.test(Number->second);
 }
 
 // Check if a function parameter must be included.
 bool VarDependencySlicer::isIncluded(const Argument *Param) {
-    return IncludedParams.find(Param) != IncludedParams.end();
+    return IncludedParams.test(Param->getArgNo());
 }
 
 // Check if the instruction is a debug info that must be included.
@@ -575,7 +643,9 @@ bool VarDependencySlicer::checkPhiDependency(const PHINode &Phi) {
         if (!isIncluded(incomingBB)) {
             auto *BBVal = Phi.getIncomingValueForBlock(incomingBB);
             if (BBVal != Val) {
-                for (auto included : IncludedBasicBlocks) {
+                for (int i = IncludedBasicBlocks.find_first(); i != -1;
+                     i = IncludedBasicBlocks.find_next(i)) {
+                    auto included = Blocks[i];
                     // Do not consider those blocks whose terminator is not
                     // included (since we search for included blocks where both
                     // branches can be included and one of them leads through
@@ -584,10 +654,10 @@ bool VarDependencySlicer::checkPhiDependency(const PHINode &Phi) {
                         continue;
 
                     if (included->getTerminator()->getNumSuccessors() == 2) {
-                        if (isPotentiallyReachable(
+                        if (isReachable(
                                     included->getTerminator()->getSuccessor(0),
                                     incomingBB)
-                            != isPotentiallyReachable(
+                            != isReachable(
                                     included->getTerminator()->getSuccessor(1),
                                     incomingBB))
                             return true;
@@ -606,9 +676,19 @@ bool VarDependencySlicer::addStoresToIncluded(const Instruction *Alloca,
     bool added = false;
     std::list<const Instruction *> worklist;
     worklist.push_back(Alloca->getNextNode());
-    std::set<const Instruction *> visited;
-    visited.insert(Alloca);
-    visited.insert(Use);
+    BitVector visited(Instrs.size());
+    auto visit = [&](const Instruction *Inst) {
+        unsigned Number = getNumber(Inst);
+        if (Number >= visited.size())
+            visited.resize(Instrs.size());
+        visited.set(Number);
+    };
+    auto isVisited = [&](const Instruction *Inst) {
+        unsigned Number = getNumber(Inst);
+        return Number < visited.size() && visited.test(Number);
+    };
+    visit(Alloca);
+    visit(Use);
     while (!worklist.empty()) {
         const Instruction *Current = worklist.front();
         worklist.pop_front();
@@ -653,11 +733,11 @@ bool VarDependencySlicer::addStoresToIncluded(const Instruction *Alloca,
                 next.push_back(Current->getNextNode());
         }
         for (auto &n : next) {
-            if (visited.find(n) == visited.end())
+            if (!isVisited(n))
                 worklist.push_back(n);
         }
 
-        visited.insert(Current);
+        visit(Current);
     }
     return added;
 }
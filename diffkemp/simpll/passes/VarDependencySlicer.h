@@ -15,9 +15,11 @@
 #ifndef PROJECT_VARDEPENDENCYSLICER_H
 #define PROJECT_VARDEPENDENCYSLICER_H
 
+#include <llvm/ADT/BitVector.h>
+#include <llvm/ADT/DenseMap.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/PassManager.h>
-#include <set>
+#include <vector>
 
 using namespace llvm;
 
@@ -26,6 +28,8 @@ using namespace llvm;
 /// the variable are kept, the rest is removed.
 /// Also, additional instructions that are needed to produce a valid LLVM module
 /// are kept.
+/// Basic blocks and instructions of the sliced function are numbered and all
+/// sets used by the slicer are dense bit vectors indexed by these numbers.
 class VarDependencySlicer : public PassInfoMixin<VarDependencySlicer> {
   public:
     PreservedAnalyses run(Function &Fun,
@@ -34,23 +38,42 @@ class VarDependencySlicer : public PassInfoMixin<VarDependencySlicer> {
 
   private:
     GlobalVariable *Variable = nullptr;
+
+    // Numbering of basic blocks and instructions of the sliced function.
+    // Blocks and instructions created during slicing are numbered when they
+    // are first added to some set.
+    DenseMap<const BasicBlock *, unsigned> BlockNumbers;
+    std::vector<const BasicBlock *> Blocks;
+    DenseMap<const Instruction *, unsigned> InstrNumbers;
+    std::vector<const Instruction *> Instrs;
+
     // Instructions directly dependent on the parameter
-    std::set<const Instruction *> DependentInstrs = {};
+    BitVector DependentInstrs;
     // Instructions that must be included
-    std::set<const Instruction *> IncludedInstrs = {};
+    BitVector IncludedInstrs;
     // Basics blocks whose execution is dependent on the parameter
-    std::set<const BasicBlock *> AffectedBasicBlocks = {};
+    BitVector AffectedBasicBlocks;
     // Basic blocks that must be included
-    std::set<const BasicBlock *> IncludedBasicBlocks = {};
-    // Function parameters to be included
-    std::set<const Argument *> IncludedParams = {};
+    BitVector IncludedBasicBlocks;
+    // Function parameters to be included (indexed by argument numbers)
+    BitVector IncludedParams;
+
+    // Blocks reachable from individual blocks of the original CFG. Computed
+    // lazily and valid only until the CFG is changed.
+    DenseMap<const BasicBlock *, BitVector> ReachableCache;
 
     // Return block
     BasicBlock *RetBB = nullptr;
 
+    // Numbering
+    void numberFunction(const Function &Fun);
+    unsigned getNumber(const BasicBlock *BB);
+    unsigned getNumber(const Instruction *Inst);
+    void forgetInstruction(const Instruction *Inst);
+
     // Functions for adding to sets
-    void addAllInstrs(const std::vector<const BasicBlock *> BBs);
-    bool addToSet(const Instruction *Inst, std::set<const Instruction *> &set);
+    void addAllInstrs(const BitVector &BBs);
+    bool addToSet(const Instruction *Inst, BitVector &set);
     bool addToDependent(const Instruction *Instr);
     bool addToIncluded(const Instruction *Inst);
     bool addAllOpsToIncluded(const Instruction *Inst);
@@ -64,24 +87,18 @@ class VarDependencySlicer : public PassInfoMixin<VarDependencySlicer> {
     inline bool isIncluded(const Argument *Param);
 
     // Computing affected and included basic blocks
-    std::vector<const BasicBlock *> affectedBasicBlocks(BranchInst *Branch);
-    std::set<BasicBlock *> includedSuccessors(BranchInst &Terminator,
-                                              const BasicBlock *ExitBlock);
+    BitVector affectedBasicBlocks(BranchInst *Branch);
+    std::vector<BasicBlock *> includedSuccessors(BranchInst &Terminator,
+                                                 const BasicBlock *ExitBlock);
 
     bool checkPhiDependency(const PHINode &Phi);
 
     // Computing reachable blocks
-    std::set<const BasicBlock *> reachableBlocks(const BasicBlock *Src,
-                                                 Function &Fun);
-    std::set<const BasicBlock *>
-            reachableBlocksThroughSucc(Instruction *Terminator,
-                                       BasicBlock *Succ);
-
-    // Set operations
-    void intersectWith(std::set<const BasicBlock *> &set,
-                       const std::set<const BasicBlock *> &other);
-    void uniteWith(std::set<const BasicBlock *> &set,
-                   const std::set<const BasicBlock *> &other);
+    BitVector reachableBlocks(const BasicBlock *Src,
+                              const BasicBlock *Stop = nullptr);
+    BitVector reachableBlocksThroughSucc(Instruction *Terminator,
+                                         BasicBlock *Succ);
+    bool isReachable(const BasicBlock *From, const BasicBlock *To);
 
     bool checkDependency(const Use *Op);
 
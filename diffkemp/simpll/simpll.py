@@ -5,7 +5,7 @@ from diffkemp.semdiff.caching import ComparisonGraph
 from diffkemp.simpll._simpll import ffi, lib
 from diffkemp.llvm_ir.kernel_module import LlvmKernelModule
 import os
-from subprocess import check_call, check_output, CalledProcessError
+from subprocess import check_output, CalledProcessError
 import yaml
 
 
@@ -13,35 +13,53 @@ class SimpLLException(Exception):
     pass
 
 
+class SimpLLStats:
+    """
+    Statistics of SimpLL runs accumulated over the lifetime of the process.
+    Used to track the performance of the comparison.
+    """
+    runs = 0
+    compared_functions = 0
+    inlined_calls = 0
+    # Maximal peak memory (in bytes) estimated by SimpLL over all runs.
+    peak_memory = 0
+
+    @classmethod
+    def reset(cls):
+        cls.runs = 0
+        cls.compared_functions = 0
+        cls.inlined_calls = 0
+        cls.peak_memory = 0
+
+
 def add_suffix(file, suffix):
     """Add suffix to the file name."""
     name, ext = os.path.splitext(file)
     return "{}-{}{}".format(name, suffix, ext)
 
 
-def run_simpll(first, second, fun_first, fun_second, var, suffix=None,
-               cache_dir=None, control_flow_only=False, output_llvm_ir=False,
-               print_asm_diffs=False, verbose=False, use_ffi=False):
+def _simpll_output(first, second, first_out_name, second_out_name,
+                   fun_first, fun_second, var, suffix, cache_dir,
+                   control_flow_only, output_llvm_ir, print_asm_diffs,
+                   verbose, use_ffi, symbol_index_first, symbol_index_second,
+                   memory_limit, inline_wrappers):
     """
-    Simplify modules to ease their semantic difference. Uses the SimpLL tool.
-    :return A tuple containing the two LLVM IR files generated by SimpLL
-            followed by the result of the comparison in the form of a graph and
-            a list of missing function definitions.
+    Run SimpLL (either through FFI or as a binary).
+    :return Raw (YAML) output of SimpLL.
     """
-    stderr = None
-    if not verbose:
-        stderr = open(os.devnull, "w")
-
-    first_out_name = add_suffix(first, suffix) if suffix else first
-    second_out_name = add_suffix(second, suffix) if suffix else second
-
+    SimpLLStats.runs += 1
     if use_ffi:
-        output = ffi.new("char [1000000]")
-        conf_struct = ffi.new("struct config *")
+        output = ffi.new("char **")
 
         cache_dir = ffi.new("char []", cache_dir.encode("ascii") if cache_dir
                             else b"")
         variable = ffi.new("char []", var.encode("ascii") if var else b"")
+        index_first = ffi.new("char []",
+                              symbol_index_first.encode("ascii")
+                              if symbol_index_first else b"")
+        index_second = ffi.new("char []",
+                               symbol_index_second.encode("ascii")
+                               if symbol_index_second else b"")
         conf_struct = ffi.new("struct config *")
         conf_struct.CacheDir = cache_dir
         conf_struct.ControlFlowOnly = control_flow_only
@@ -51,6 +69,10 @@ def run_simpll(first, second, fun_first, fun_second, var, suffix=None,
         conf_struct.Variable = variable
         conf_struct.Verbose = verbose
         conf_struct.VerboseMacros = False
+        conf_struct.FirstSymbolIndex = index_first
+        conf_struct.SecondSymbolIndex = index_second
+        conf_struct.MemoryLimit = memory_limit if memory_limit else 0
+        conf_struct.InlineWrappers = inline_wrappers if inline_wrappers else 0
 
         module_left = ffi.new("char []", first.encode("ascii"))
         module_right = ffi.new("char []", second.encode("ascii"))
@@ -63,7 +85,8 @@ def run_simpll(first, second, fun_first, fun_second, var, suffix=None,
             lib.runSimpLL(module_left, module_right, module_left_out,
                           module_right_out, fun_left, fun_right,
                           conf_struct[0], output)
-            simpll_out = ffi.string(output)
+            simpll_out = ffi.string(output[0])
+            lib.freeSimpLLOutput(output[0])
         except ffi.error:
             raise SimpLLException("Simplifying files failed")
     else:
@@ -92,6 +115,22 @@ def run_simpll(first, second, fun_first, fun_second, var, suffix=None,
             # Cache directory with equal function pairs
             if cache_dir:
                 simpll_command.extend(["--cache-dir", cache_dir])
+            # Indices of symbol definitions for linking missing definitions
+            if symbol_index_first:
+                simpll_command.extend(["--first-symbol-index",
+                                       symbol_index_first])
+            if symbol_index_second:
+                simpll_command.extend(["--second-symbol-index",
+                                       symbol_index_second])
+
+            # Limit of memory used by SimpLL (in MiB)
+            if memory_limit:
+                simpll_command.extend(["--memory-limit", str(memory_limit)])
+
+            # Size limit of wrappers inlined before the comparison
+            if inline_wrappers:
+                simpll_command.extend(["--inline-wrappers",
+                                       str(inline_wrappers)])
 
             if control_flow_only:
                 simpll_command.append("--control-flow")
@@ -109,46 +148,129 @@ def run_simpll(first, second, fun_first, fun_second, var, suffix=None,
             simpll_out = check_output(simpll_command)
         except CalledProcessError:
             raise SimpLLException("Simplifying files failed")
+    return simpll_out
+
+
+def _parse_result(simpll_result):
+    """
+    Parse the result of SimpLL (for a single variable).
+    :return A tuple containing the result of the comparison in the form of
+            a graph and a list of missing function definitions.
+    """
+    result_graph = ComparisonGraph()
+    missing_defs = None
+    if simpll_result is not None:
+        if "function-results" in simpll_result:
+            for fun_result in simpll_result["function-results"]:
+                # Create the vertex from the result and insert it into
+                # the graph.
+                vertex = ComparisonGraph.Vertex.from_yaml(
+                    fun_result, result_graph)
+                # Prefer pointed name to ensure that a difference
+                # contaning the variant function as either the left or
+                # the right side has its name in the key.
+                # This is useful because one can tell this is a weak
+                # vertex from its name.
+                if "." in vertex.names[ComparisonGraph.Side.LEFT]:
+                    result_graph[vertex.names[
+                        ComparisonGraph.Side.LEFT]] = vertex
+                else:
+                    result_graph[vertex.names[
+                        ComparisonGraph.Side.RIGHT]] = vertex
+        result_graph.normalize()
+        result_graph.populate_predecessor_lists()
+        result_graph.mark_uncachable_from_assumed_equal()
+        missing_defs = simpll_result["missing-defs"] \
+            if "missing-defs" in simpll_result else None
+        if "stats" in simpll_result:
+            stats = simpll_result["stats"]
+            SimpLLStats.compared_functions += stats["compared-functions"]
+            SimpLLStats.inlined_calls += stats["inlined-calls"]
+            memory = stats["memory"]
+            SimpLLStats.peak_memory = max(SimpLLStats.peak_memory,
+                                          memory["peak"])
+            if memory["limit-exceeded"]:
+                raise SimpLLException("SimpLL memory limit exceeded")
+    return result_graph, missing_defs
 
-    if output_llvm_ir:
-        check_call(["opt", "-S", "-deadargelim", "-o", first_out_name,
-                    first_out_name],
-                   stderr=stderr)
-        check_call(["opt", "-S", "-deadargelim", "-o", second_out_name,
-                    second_out_name],
-                   stderr=stderr)
+
+def run_simpll(first, second, fun_first, fun_second, var, suffix=None,
+               cache_dir=None, control_flow_only=False, output_llvm_ir=False,
+               print_asm_diffs=False, verbose=False, use_ffi=False,
+               symbol_index_first=None, symbol_index_second=None,
+               memory_limit=None, inline_wrappers=None):
+    """
+    Simplify modules to ease their semantic difference. Uses the SimpLL tool.
+    If symbol indices are given, SimpLL links missing definitions of symbols
+    into the modules by itself.
+    If a memory limit (in MiB) is given and SimpLL exceeds it, SimpLLException
+    is raised.
+    If a size limit of wrappers (in instructions) is given, simple wrappers
+    called from one of the compared functions only are inlined before the
+    comparison.
+    :return A tuple containing the two LLVM IR files generated by SimpLL
+            followed by the result of the comparison in the form of a graph and
+            a list of missing function definitions.
+    """
+    first_out_name = add_suffix(first, suffix) if suffix else first
+    second_out_name = add_suffix(second, suffix) if suffix else second
+
+    simpll_out = _simpll_output(first, second, first_out_name,
+                                second_out_name, fun_first, fun_second, var,
+                                suffix, cache_dir, control_flow_only,
+                                output_llvm_ir, print_asm_diffs, verbose,
+                                use_ffi, symbol_index_first,
+                                symbol_index_second, memory_limit,
+                                inline_wrappers)
 
     first_out = LlvmKernelModule(first_out_name)
     second_out = LlvmKernelModule(second_out_name)
 
+    result_graph = ComparisonGraph()
     missing_defs = None
     try:
-        result_graph = ComparisonGraph()
-        simpll_result = yaml.safe_load(simpll_out)
-        if simpll_result is not None:
-            if "function-results" in simpll_result:
-                for fun_result in simpll_result["function-results"]:
-                    # Create the vertex from the result and insert it into
-                    # the graph.
-                    vertex = ComparisonGraph.Vertex.from_yaml(
-                        fun_result, result_graph)
-                    # Prefer pointed name to ensure that a difference
-                    # contaning the variant function as either the left or
-                    # the right side has its name in the key.
-                    # This is useful because one can tell this is a weak
-                    # vertex from its name.
-                    if "." in vertex.names[ComparisonGraph.Side.LEFT]:
-                        result_graph[vertex.names[
-                            ComparisonGraph.Side.LEFT]] = vertex
-                    else:
-                        result_graph[vertex.names[
-                            ComparisonGraph.Side.RIGHT]] = vertex
-            result_graph.normalize()
-            result_graph.populate_predecessor_lists()
-            result_graph.mark_uncachable_from_assumed_equal()
-            missing_defs = simpll_result["missing-defs"] \
-                if "missing-defs" in simpll_result else None
+        result_graph, missing_defs = _parse_result(
+            yaml.safe_load(simpll_out))
     except yaml.YAMLError:
         pass
 
     return first_out, second_out, result_graph, missing_defs
+
+
+def run_simpll_vars(first, second, fun_first, fun_second, variables,
+                    cache_dir=None, control_flow_only=False,
+                    output_llvm_ir=False, print_asm_diffs=False,
+                    verbose=False, use_ffi=False, symbol_index_first=None,
+                    symbol_index_second=None, memory_limit=None,
+                    inline_wrappers=None):
+    """
+    Simplify modules w.r.t. the values of multiple global variables in
+    a single run of SimpLL. The modules are parsed and pre-processed only once
+    and then sliced and compared for each variable separately.
+    Output files of each variable have the variable name as a suffix.
+    :return A dictionary mapping variable names to tuples in the format
+            returned by run_simpll.
+    """
+    simpll_out = _simpll_output(first, second, first, second, fun_first,
+                                fun_second, ",".join(variables), None,
+                                cache_dir, control_flow_only, output_llvm_ir,
+                                print_asm_diffs, verbose, use_ffi,
+                                symbol_index_first, symbol_index_second,
+                                memory_limit, inline_wrappers)
+    try:
+        simpll_result = yaml.safe_load(simpll_out)
+    except yaml.YAMLError:
+        simpll_result = None
+
+    var_results = dict()
+    if simpll_result is not None and "variable-results" in simpll_result:
+        var_results = {r["variable"]: r
+                       for r in simpll_result["variable-results"]}
+
+    result = dict()
+    for var in variables:
+        result_graph, missing_defs = _parse_result(var_results.get(var))
+        result[var] = (LlvmKernelModule(add_suffix(first, var)),
+                       LlvmKernelModule(add_suffix(second, var)),
+                       result_graph, missing_defs)
+    return result
@@ -14,6 +14,10 @@ ffibuilder.cdef("""
         int PrintCallStacks;
         int Verbose;
         int VerboseMacros;
+        const char *FirstSymbolIndex;
+        const char *SecondSymbolIndex;
+        int MemoryLimit;
+        int InlineWrappers;
     };
 
     void runSimpLL(const char *ModL,
@@ -23,10 +27,12 @@ ffibuilder.cdef("""
                    const char *FunL,
                    const char *FunR,
                    struct config Conf,
-                   char *Output);
+                   char **Output);
+
+    void freeSimpLLOutput(char *Output);
 """)
 
-llvm_libs = ["irreader", "passes", "support"]
+llvm_libs = ["irreader", "linker", "passes", "support"]
 llvm_cflags = check_output(["llvm-config", "--cflags"])
 llvm_ldflags = check_output(["llvm-config", "--libs"] + llvm_libs)
 
@@ -5,6 +5,8 @@ holds the function list.
 """
 from diffkemp.llvm_ir.kernel_module import LlvmKernelModule
 from diffkemp.llvm_ir.kernel_source import KernelSource
+from diffkemp.llvm_ir.symbol_index import SymbolIndex
+from diffkemp.snapshot_manifest import SnapshotManifest, LazyFunctions
 import datetime
 import os
 import pkg_resources
@@ -51,7 +53,8 @@ class Snapshot:
 
     @classmethod
     def create_from_source(cls, kernel_dir, output_dir, fun_kind=None,
-                           setup_dir=True):
+                           setup_dir=True, build_jobs=None,
+                           llvm_cache_dir=None):
         """
         Create a snapshot from a kernel source directory and prepare it for
         snapshot directory generation.
@@ -59,6 +62,8 @@ class Snapshot:
         :param output_dir: Snapshot output directory.
         :param fun_kind: Snapshot function kind.
         :param setup_dir: Whether to recreate the output directory.
+        :param build_jobs: Number of sources built into LLVM IR in parallel.
+        :param llvm_cache_dir: Directory of the built LLVM IR cache.
         :return: Desired instance of Snapshot.
         """
         output_path = os.path.abspath(output_dir)
@@ -70,7 +75,8 @@ class Snapshot:
             os.mkdir(output_path)
 
         # Prepare source representations for the new snapshot
-        kernel_source = KernelSource(kernel_dir, True)
+        kernel_source = KernelSource(kernel_dir, True, build_jobs,
+                                     llvm_cache_dir)
         snapshot_source = KernelSource(output_path)
 
         kernel_snapshot = cls(kernel_source, snapshot_source, fun_kind)
@@ -85,6 +91,9 @@ class Snapshot:
     def load_from_dir(cls, snapshot_dir, config_file="snapshot.yaml"):
         """
         Loads a snapshot from its directory.
+        If the snapshot contains an up-to-date indexed manifest, it is used
+        instead of the YAML configuration file, so that function descriptions
+        are created only when needed.
         :param snapshot_dir: Target snapshot directory.
         :param config_file: Name of the snapshot configuration file.
         :return: Desired instance of Snapshot.
@@ -92,8 +101,16 @@ class Snapshot:
         snapshot_source = KernelSource(snapshot_dir)
         loaded_snapshot = cls(None, snapshot_source)
 
-        with open(os.path.join(snapshot_dir, config_file), "r") as \
-                snapshot_yaml:
+        config_path = os.path.join(snapshot_dir, config_file)
+        manifest_path = os.path.join(snapshot_dir, SnapshotManifest.file_name)
+        if (config_file == "snapshot.yaml" and
+                os.path.isfile(manifest_path) and
+                os.path.getmtime(manifest_path) >=
+                os.path.getmtime(config_path)):
+            loaded_snapshot._from_manifest(SnapshotManifest(manifest_path))
+            return loaded_snapshot
+
+        with open(config_path, "r") as snapshot_yaml:
             loaded_snapshot._from_yaml(snapshot_yaml.read())
 
         return loaded_snapshot
@@ -111,11 +128,25 @@ class Snapshot:
         self.kernel_source.copy_source_files(self.modules(),
                                              self.snapshot_source.kernel_dir)
         self.snapshot_source.build_cscope_database()
+        # Index definitions of symbols in the copied LLVM files.
+        llvm_files = [mod.llvm for mod in self.modules()]
+        SymbolIndex.create(self.snapshot_source.kernel_dir, llvm_files)
+        # Index sources defining and using symbols of the copied LLVM files,
+        # these are looked up when comparing the snapshot.
+        symbols = set()
+        for llvm_file in llvm_files:
+            symbols.update(SymbolIndex.get_definitions(llvm_file))
+            symbols.update(SymbolIndex.get_declarations(llvm_file))
+        self.snapshot_source.index_symbols(symbols)
+        self.snapshot_source.source_index.write()
 
         # Create the YAML snapshot representation inside the output directory.
         with open(os.path.join(self.snapshot_source.kernel_dir,
                                "snapshot.yaml"), "w") as snapshot_yaml:
             snapshot_yaml.write(self.to_yaml())
+        # Create the indexed manifest allowing fast lookup of functions.
+        self.to_manifest(os.path.join(self.snapshot_source.kernel_dir,
+                                      SnapshotManifest.file_name))
 
     def add_fun(self, name, llvm_mod, glob_var=None, tag=None, group=None):
         """
@@ -151,6 +182,20 @@ class Snapshot:
                     for fun in group.functions.values()
                     if fun.mod is not None])
 
+    def symbol_index(self):
+        """
+        Get the index of symbol definitions stored in the snapshot directory.
+        The index maps symbols to LLVM IR files of the snapshot containing
+        their definitions and it is used by SimpLL to link missing
+        definitions.
+        :return: Path to the index or None if the snapshot has no index.
+        """
+        if self.snapshot_source is None:
+            return None
+        index = os.path.join(self.snapshot_source.kernel_dir,
+                             SymbolIndex.file_name)
+        return index if os.path.isfile(index) else None
+
     def get_by_name(self, name, group=None):
         """
         Get module for the function with the given name in the given group.
@@ -205,15 +250,59 @@ class Snapshot:
                 functions = g
             self.fun_groups[group] = self.FunctionGroup()
             for f in functions:
-                self.add_fun(f["name"],
-                             LlvmKernelModule(
-                                 os.path.join(os.path.relpath(
-                                     self.snapshot_source.kernel_dir),
-                                     f["llvm"]))
-                             if f["llvm"] else None,
-                             f["glob_var"],
-                             f["tag"],
-                             group)
+                self.fun_groups[group].functions[f["name"]] = \
+                    self._create_fun_desc(f["llvm"], f["glob_var"], f["tag"])
+
+    def _create_fun_desc(self, llvm, glob_var, tag):
+        """
+        Create a function description. The LLVM file path is relative to the
+        snapshot directory.
+        """
+        return self.FunctionDesc(
+            LlvmKernelModule(os.path.join(
+                os.path.relpath(self.snapshot_source.kernel_dir), llvm))
+            if llvm else None,
+            glob_var,
+            tag)
+
+    def _from_manifest(self, manifest):
+        """
+        Load the snapshot from its indexed manifest. Function descriptions are
+        created lazily when they are looked up.
+        :param manifest: Instance of SnapshotManifest.
+        """
+        self.created_time = manifest.created_time
+
+        if os.path.isdir(manifest.source_kernel_dir):
+            self.kernel_source = KernelSource(manifest.source_kernel_dir,
+                                              True)
+
+        if manifest.fun_kind == "sysctl":
+            self.kind = "sysctl"
+        for group in manifest.groups:
+            self.fun_groups[group] = self.FunctionGroup()
+            self.fun_groups[group].functions = LazyFunctions(
+                manifest, group, self._create_fun_desc)
+
+    def to_manifest(self, manifest_file):
+        """
+        Write the indexed manifest of the snapshot. Paths to files are given
+        relative to the source snapshot directory.
+        :param manifest_file: Path to the manifest file.
+        """
+        SnapshotManifest.write(
+            manifest_file,
+            {group_name: {
+                fun_name: (os.path.relpath(fun_desc.mod.llvm,
+                                           self.snapshot_source.kernel_dir)
+                           if fun_desc.mod else None,
+                           fun_desc.glob_var,
+                           fun_desc.tag)
+                for fun_name, fun_desc in g.functions.items()}
+             for group_name, g in self.fun_groups.items()},
+            datetime.datetime.now(datetime.timezone.utc),
+            self.kernel_source.kernel_dir,
+            self.fun_kind)
 
     def to_yaml(self):
         """
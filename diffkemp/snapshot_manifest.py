@@ -0,0 +1,246 @@
+"""
+Indexed snapshot manifest.
+Binary representation of the snapshot function list which allows to look up
+individual functions without parsing the whole list.
+"""
+from collections.abc import MutableMapping
+from tempfile import mkstemp
+import datetime
+import mmap
+import os
+import struct
+
+
+class ManifestException(Exception):
+    pass
+
+
+class SnapshotManifest:
+    """
+    Memory-mapped manifest of a snapshot.
+    The file has the following layout (all integers are little-endian 32-bit
+    unsigned numbers):
+      - magic string and the number of groups and of functions
+      - metadata record (created time, source kernel dir, and function kind)
+      - group table containing for each group the offset of its name record,
+        the index of its first function in the offset table, and the number
+        of its functions
+      - offset table containing offsets of function records; functions of
+        each group form a contiguous range sorted by the function name
+      - records, each one being a sequence of zero-terminated fields ended
+        by an empty field; each field is prefixed by "=" if it has a value or
+        it is "-" if it is None
+    Function records consist of the name, the LLVM file (relative to the
+    snapshot directory), the global variable, and the tag.
+    """
+    # Name of the manifest file in the snapshot directory.
+    file_name = "snapshot.idx"
+
+    _magic = b"DKSNAPI1"
+    _header = struct.Struct("<8sII")
+    _group_entry = struct.Struct("<III")
+    _offset = struct.Struct("<I")
+    # Group name offset used for the None group
+    _none_group = 0xFFFFFFFF
+
+    def __init__(self, manifest_file):
+        self.manifest_file = manifest_file
+        with open(manifest_file, "rb") as manifest:
+            self.data = mmap.mmap(manifest.fileno(), 0,
+                                  access=mmap.ACCESS_READ)
+        magic, group_count, self.fun_count = \
+            self._header.unpack_from(self.data, 0)
+        if magic != self._magic:
+            raise ManifestException("Invalid snapshot manifest: {}".format(
+                manifest_file))
+        metadata_offset = self._header.size
+        fields, end = self._read_record(metadata_offset)
+        self.created_time = datetime.datetime.fromtimestamp(
+            float(fields[0]), datetime.timezone.utc)
+        self.source_kernel_dir = fields[1]
+        self.fun_kind = fields[2]
+
+        # The group table is small, hence it is read eagerly.
+        self.groups = dict()
+        for i in range(group_count):
+            name_offset, first, count = self._group_entry.unpack_from(
+                self.data, end + i * self._group_entry.size)
+            name = None if name_offset == self._none_group else \
+                self._read_record(name_offset)[0][0]
+            self.groups[name] = (first, count)
+        self._offsets = end + group_count * self._group_entry.size
+
+    def _read_record(self, offset):
+        """
+        Read the record starting at the given offset.
+        :return Pair of the list of fields and of the offset following the
+                record.
+        """
+        fields = []
+        while True:
+            end = self.data.find(b"\0", offset)
+            if end == offset:
+                return fields, end + 1
+            fields.append(self.data[offset + 1:end].decode("utf-8")
+                          if self.data[offset:offset + 1] == b"=" else None)
+            offset = end + 1
+
+    def _fun_record(self, index):
+        """Get fields of the function record with the given index."""
+        offset, = self._offset.unpack_from(
+            self.data, self._offsets + index * self._offset.size)
+        return self._read_record(offset)[0]
+
+    def _fun_name(self, index):
+        """Get name of the function with the given index (as bytes)."""
+        offset, = self._offset.unpack_from(
+            self.data, self._offsets + index * self._offset.size)
+        return self.data[offset + 1:self.data.find(b"\0", offset)]
+
+    def lookup(self, name, group=None):
+        """
+        Find a function in the given group using binary search.
+        :return Tuple (llvm, glob_var, tag) with None for missing values or
+                None if the function is not in the manifest.
+        """
+        if group not in self.groups:
+            return None
+        key = name.encode("utf-8")
+        low, high = self.groups[group]
+        high += low
+        while low < high:
+            middle = (low + high) // 2
+            middle_name = self._fun_name(middle)
+            if middle_name == key:
+                return tuple(self._fun_record(middle)[1:4])
+            if middle_name < key:
+                low = middle + 1
+            else:
+                high = middle
+        return None
+
+    def names(self, group=None):
+        """Get names of all functions in the given group."""
+        first, count = self.groups[group]
+        return [self._fun_name(i).decode("utf-8")
+                for i in range(first, first + count)]
+
+    @classmethod
+    def write(cls, manifest_file, fun_groups, created_time, source_kernel_dir,
+              fun_kind):
+        """
+        Write a new manifest file. The file is replaced atomically.
+        :param manifest_file: Path to the manifest file.
+        :param fun_groups: Dictionary mapping group names to dictionaries that
+                           map function names to tuples (llvm, glob_var, tag).
+        :param created_time: Time of the snapshot creation.
+        :param source_kernel_dir: Source kernel directory of the snapshot.
+        :param fun_kind: Function kind of the snapshot.
+        """
+        def record(*fields):
+            return b"".join(b"-\0" if f is None
+                            else b"=" + f.encode("utf-8") + b"\0"
+                            for f in fields) + b"\0"
+
+        groups = sorted(fun_groups.items(),
+                        key=lambda g: "" if g[0] is None else g[0])
+        fun_count = sum(len(functions) for _, functions in groups)
+        records_start = (cls._header.size +
+                         len(record(repr(created_time.timestamp()),
+                                    source_kernel_dir, fun_kind)) +
+                         len(groups) * cls._group_entry.size +
+                         fun_count * cls._offset.size)
+
+        records = bytearray()
+        group_table = bytearray()
+        offset_table = bytearray()
+        first = 0
+        for group, functions in groups:
+            if group is None:
+                name_offset = cls._none_group
+            else:
+                name_offset = records_start + len(records)
+                records += record(group)
+            group_table += cls._group_entry.pack(name_offset, first,
+                                                 len(functions))
+            first += len(functions)
+            for name in sorted(functions,
+                               key=lambda n: n.encode("utf-8")):
+                offset_table += cls._offset.pack(records_start +
+                                                 len(records))
+                records += record(name, *functions[name])
+
+        fd, tmp_file = mkstemp(dir=os.path.dirname(
+            os.path.abspath(manifest_file)))
+        with os.fdopen(fd, "wb") as manifest:
+            manifest.write(cls._header.pack(cls._magic, len(groups),
+                                            fun_count))
+            manifest.write(record(repr(created_time.timestamp()),
+                                  source_kernel_dir, fun_kind))
+            manifest.write(group_table)
+            manifest.write(offset_table)
+            manifest.write(records)
+        os.chmod(tmp_file, 0o644)
+        os.replace(tmp_file, manifest_file)
+
+
+class LazyFunctions(MutableMapping):
+    """
+    Dictionary of function descriptors of a single group backed by
+    a snapshot manifest. Descriptors are created only when looked up.
+    Functions added after loading are kept in memory.
+    """
+
+    def __init__(self, manifest, group, create_desc):
+        """
+        :param manifest: Snapshot manifest.
+        :param group: Name of the group.
+        :param create_desc: Function creating a function descriptor from
+                            a tuple (llvm, glob_var, tag).
+        """
+        self.manifest = manifest
+        self.group = group
+        self.create_desc = create_desc
+        self.loaded = dict()
+        self.deleted = set()
+        self._names = None
+
+    def _manifest_names(self):
+        if self._names is None:
+            self._names = self.manifest.names(self.group)
+        return self._names
+
+    def __getitem__(self, name):
+        if name in self.loaded:
+            return self.loaded[name]
+        if name not in self.deleted:
+            entry = self.manifest.lookup(name, self.group)
+            if entry is not None:
+                self.loaded[name] = self.create_desc(*entry)
+                return self.loaded[name]
+        raise KeyError(name)
+
+    def __contains__(self, name):
+        if name in self.loaded:
+            return True
+        return name not in self.deleted and \
+            self.manifest.lookup(name, self.group) is not None
+
+    def __setitem__(self, name, desc):
+        self.deleted.discard(name)
+        self.loaded[name] = desc
+
+    def __delitem__(self, name):
+        if name not in self:
+            raise KeyError(name)
+        self.loaded.pop(name, None)
+        self.deleted.add(name)
+
+    def __iter__(self):
+        names = [n for n in self._manifest_names() if n not in self.deleted]
+        yield from names
+        manifest_names = set(names)
+        yield from (n for n in self.loaded if n not in manifest_names)
+
+    def __len__(self):
+        return sum(1 for _ in self)
@@ -0,0 +1,413 @@
+"""
+Line-based difference of two sequences.
+Implements the algorithm used by the diff utility (Myers' O(ND) algorithm with
+the linear-space divide and conquer refinement, preceded by discarding of
+confusing lines and followed by shifting of the changed regions), so that the
+resulting hunks are the same as the ones that the diff utility prints.
+"""
+from collections import Counter
+
+
+def _find_middle_snake(a, b, xoff, xlim, yoff, ylim):
+    """
+    Find the midpoint of the shortest edit script for a[xoff:xlim] and
+    b[yoff:ylim] by searching from both ends at once.
+    :return Pair of indices (x, y) of the midpoint.
+    """
+    fd = dict()
+    bd = dict()
+    dmin = xoff - ylim
+    dmax = xlim - yoff
+    fmid = xoff - yoff
+    bmid = xlim - ylim
+    fmin = fmax = fmid
+    bmin = bmax = bmid
+    odd = (fmid - bmid) & 1
+    fd[fmid] = xoff
+    bd[bmid] = xlim
+    while True:
+        # Extend the top-down search by an edit step in each diagonal.
+        if fmin > dmin:
+            fmin -= 1
+            fd[fmin - 1] = -1
+        else:
+            fmin += 1
+        if fmax < dmax:
+            fmax += 1
+            fd[fmax + 1] = -1
+        else:
+            fmax -= 1
+        for d in range(fmax, fmin - 1, -2):
+            tlo = fd[d - 1]
+            thi = fd[d + 1]
+            x = thi if tlo < thi else tlo + 1
+            y = x - d
+            while x < xlim and y < ylim and a[x] == b[y]:
+                x += 1
+                y += 1
+            fd[d] = x
+            if odd and bmin <= d <= bmax and bd[d] <= x:
+                return x, y
+
+        # Similarly extend the bottom-up search.
+        if bmin > dmin:
+            bmin -= 1
+            bd[bmin - 1] = xlim + ylim + 1
+        else:
+            bmin += 1
+        if bmax < dmax:
+            bmax += 1
+            bd[bmax + 1] = xlim + ylim + 1
+        else:
+            bmax -= 1
+        for d in range(bmax, bmin - 1, -2):
+            tlo = bd[d - 1]
+            thi = bd[d + 1]
+            x = tlo if tlo < thi else thi - 1
+            y = x - d
+            while xoff < x and yoff < y and a[x - 1] == b[y - 1]:
+                x -= 1
+                y -= 1
+            bd[d] = x
+            if not odd and fmin <= d <= fmax and x <= fd[d]:
+                return x, y
+
+
+def _discard_confusing_lines(lines, other_lines):
+    """
+    Find lines that can be discarded before the comparison: lines that do not
+    occur in the other sequence at all and runs of lines that occur there too
+    many times. Discarded lines are always marked as changed.
+    :return List of flags of discarded lines.
+    """
+    counts = Counter(other_lines)
+    end = len(lines)
+    many = 5
+    tem = end // 64
+    # Multiply many by approximate square root of the number of lines. That
+    # is the threshold for provisionally discardable lines.
+    tem >>= 2
+    while tem > 0:
+        many *= 2
+        tem >>= 2
+
+    # 1 means discarded, 2 means provisionally discarded.
+    discards = [0] * end
+    for i, line in enumerate(lines):
+        if counts[line] == 0:
+            discards[i] = 1
+        elif counts[line] > many:
+            discards[i] = 2
+
+    # Do not really discard the provisional lines except when they occur in
+    # a run of discardables, with nonprovisionals at the beginning and end.
+    i = 0
+    while i < end:
+        if discards[i] == 2:
+            discards[i] = 0
+        elif discards[i] != 0:
+            # Find end of this run of discardable lines and count how many
+            # are provisionally discardable.
+            provisional = 0
+            j = i
+            while j < end and discards[j] != 0:
+                if discards[j] == 2:
+                    provisional += 1
+                j += 1
+            # Cancel provisional discards at end, and shrink the run.
+            while j > i and discards[j - 1] == 2:
+                j -= 1
+                discards[j] = 0
+                provisional -= 1
+            length = j - i
+
+            if provisional * 4 > length:
+                # If 1/4 of the lines in the run are provisional, cancel
+                # discarding of all provisional lines in the run.
+                for k in range(i, j):
+                    if discards[k] == 2:
+                        discards[k] = 0
+            else:
+                # Cancel any subrun of minimum or more provisionals within
+                # the larger run, minimum being approximate square root of
+                # length / 4.
+                minimum = 1
+                tem = length >> 2
+                tem >>= 2
+                while tem > 0:
+                    minimum <<= 1
+                    tem >>= 2
+                minimum += 1
+                k = 0
+                consec = 0
+                while k < length:
+                    if discards[i + k] != 2:
+                        consec = 0
+                    else:
+                        consec += 1
+                        if consec == minimum:
+                            # Back up to start of subrun, to cancel it all.
+                            k -= consec
+                        elif consec > minimum:
+                            discards[i + k] = 0
+                    k += 1
+
+                # Scan from beginning of run until we find 3 or more
+                # nonprovisionals in a row or until the first nonprovisional
+                # at least 8 lines in. Until that point, cancel any
+                # provisionals.
+                consec = 0
+                for k in range(length):
+                    if k >= 8 and discards[i + k] == 1:
+                        break
+                    if discards[i + k] == 2:
+                        consec = 0
+                        discards[i + k] = 0
+                    elif discards[i + k] == 0:
+                        consec = 0
+                    else:
+                        consec += 1
+                    if consec == 3:
+                        break
+
+                # Advance to the last line of the run and do the same thing
+                # from its end.
+                i += length - 1
+                consec = 0
+                for k in range(length):
+                    if k >= 8 and discards[i - k] == 1:
+                        break
+                    if discards[i - k] == 2:
+                        consec = 0
+                        discards[i - k] = 0
+                    elif discards[i - k] == 0:
+                        consec = 0
+                    else:
+                        consec += 1
+                    if consec == 3:
+                        break
+        i += 1
+    return [d != 0 for d in discards]
+
+
+def _compare_seq(a, b, changed_a, changed_b):
+    """
+    Mark lines of a and b that are not a part of the longest common
+    subsequence as changed. Uses an explicit stack instead of recursion.
+    """
+    stack = [(0, len(a), 0, len(b))]
+    while stack:
+        xoff, xlim, yoff, ylim = stack.pop()
+        # Slide down the bottom initial diagonal.
+        while xoff < xlim and yoff < ylim and a[xoff] == b[yoff]:
+            xoff += 1
+            yoff += 1
+        # Slide up the top initial diagonal.
+        while xoff < xlim and yoff < ylim and a[xlim - 1] == b[ylim - 1]:
+            xlim -= 1
+            ylim -= 1
+
+        if xoff == xlim:
+            for y in range(yoff, ylim):
+                changed_b[y] = True
+        elif yoff == ylim:
+            for x in range(xoff, xlim):
+                changed_a[x] = True
+        else:
+            xmid, ymid = _find_middle_snake(a, b, xoff, xlim, yoff, ylim)
+            stack.append((xmid, xlim, ymid, ylim))
+            stack.append((xoff, xmid, yoff, ymid))
+
+
+def _shift_boundaries(lines, changed, other_changed):
+    """
+    Adjust runs of changed lines so that they are merged with other runs when
+    possible and otherwise moved as far down as possible (or back to
+    a corresponding run of changes in the other sequence).
+    The changed lists contain one extra False item at both ends.
+    """
+    i = 1
+    j = 1
+    i_end = len(changed) - 1
+
+    def equal(x, y):
+        return lines[x - 1] == lines[y - 1]
+
+    while True:
+        # Scan forwards to find beginning of another run of changes. Also
+        # keep track of the corresponding point in the other sequence.
+        while i < i_end and not changed[i]:
+            while other_changed[j]:
+                j += 1
+            j += 1
+            i += 1
+        if i == i_end:
+            break
+        start = i
+
+        # Find the end of this run of changes.
+        i += 1
+        while changed[i]:
+            i += 1
+        while other_changed[j]:
+            j += 1
+
+        while True:
+            run_length = i - start
+
+            # Move the changed region back, so long as the previous unchanged
+            # line matches the last changed one.
+            while start > 1 and equal(start - 1, i - 1):
+                start -= 1
+                changed[start] = True
+                i -= 1
+                changed[i] = False
+                while changed[start - 1]:
+                    start -= 1
+                j -= 1
+                while other_changed[j]:
+                    j -= 1
+
+            # The end of the changed run at the last point where it
+            # corresponds to a changed run in the other sequence.
+            corresponding = i if other_changed[j - 1] else i_end
+
+            # Move the changed region forward, so long as the first changed
+            # line matches the following unchanged one.
+            while i != i_end and equal(start, i):
+                changed[start] = False
+                start += 1
+                changed[i] = True
+                i += 1
+                while changed[i]:
+                    i += 1
+                j += 1
+                while other_changed[j]:
+                    j += 1
+                    corresponding = i
+
+            if run_length == i - start:
+                break
+
+        # If possible, move the fully-merged run of changes back to
+        # a corresponding run in the other sequence.
+        while corresponding < i:
+            start -= 1
+            changed[start] = True
+            i -= 1
+            changed[i] = False
+            j -= 1
+            while other_changed[j]:
+                j -= 1
+
+
+def _get_opcodes(changed_a, changed_b):
+    """
+    Convert lists of changed lines into opcodes in the format used by
+    difflib.SequenceMatcher.get_opcodes.
+    """
+    opcodes = []
+    i = j = 0
+    len_a = len(changed_a)
+    len_b = len(changed_b)
+    while i < len_a or j < len_b:
+        i1, j1 = i, j
+        while i < len_a and j < len_b and not changed_a[i] and \
+                not changed_b[j]:
+            i += 1
+            j += 1
+        if i > i1:
+            opcodes.append(("equal", i1, i, j1, j))
+            continue
+        while i < len_a and changed_a[i]:
+            i += 1
+        while j < len_b and changed_b[j]:
+            j += 1
+        if i > i1 and j > j1:
+            tag = "replace"
+        elif i > i1:
+            tag = "delete"
+        else:
+            tag = "insert"
+        opcodes.append((tag, i1, i, j1, j))
+    return opcodes
+
+
+def _analyse(a, b):
+    """
+    Find lines of a and b that are changed.
+    :return Pair of lists of flags of changed lines.
+    """
+    discards_a = _discard_confusing_lines(a, b)
+    discards_b = _discard_confusing_lines(b, a)
+    # Only the lines that were not discarded are compared.
+    indices_a = [i for i, d in enumerate(discards_a) if not d]
+    indices_b = [i for i, d in enumerate(discards_b) if not d]
+    inner_a = [False] * len(indices_a)
+    inner_b = [False] * len(indices_b)
+    _compare_seq([a[i] for i in indices_a], [b[i] for i in indices_b],
+                 inner_a, inner_b)
+
+    # The lists of changes contain one extra unchanged item at both ends.
+    changed_a = [False] + discards_a + [False]
+    changed_b = [False] + discards_b + [False]
+    for i, changed in zip(indices_a, inner_a):
+        changed_a[i + 1] = changed
+    for i, changed in zip(indices_b, inner_b):
+        changed_b[i + 1] = changed
+    _shift_boundaries(a, changed_a, changed_b)
+    _shift_boundaries(b, changed_b, changed_a)
+    return changed_a[1:-1], changed_b[1:-1]
+
+
+def grouped_opcodes(a, b, context):
+    """
+    Compute the difference of two sequences of lines and group it into hunks
+    with the given number of context lines.
+    :return List of hunks, each hunk is a list of opcodes in the format used
+            by difflib.SequenceMatcher.get_grouped_opcodes.
+    """
+    # Identical prefix and suffix are not analysed, except for the context
+    # lines adjacent to the differing part.
+    prefix = 0
+    while prefix < min(len(a), len(b)) and a[prefix] == b[prefix]:
+        prefix += 1
+    lo = max(prefix - context, 0)
+    suffix = 0
+    while suffix < min(len(a), len(b)) - lo and \
+            a[-suffix - 1] == b[-suffix - 1]:
+        suffix += 1
+    hi = max(suffix - context, 0)
+
+    changed_a, changed_b = _analyse(a[lo:len(a) - hi], b[lo:len(b) - hi])
+    changed_a = [False] * lo + changed_a + [False] * hi
+    changed_b = [False] * lo + changed_b + [False] * hi
+    opcodes = _get_opcodes(changed_a, changed_b)
+
+    # Split the opcodes into hunks separated by more than 2 * context
+    # unchanged lines.
+    groups = []
+    group = []
+    for tag, i1, i2, j1, j2 in opcodes:
+        if tag == "equal":
+            if not group:
+                # Leading context
+                i1, j1 = max(i1, i2 - context), max(j1, j2 - context)
+            elif i2 - i1 > 2 * context:
+                group.append((tag, i1, i1 + context, j1, j1 + context))
+                groups.append(group)
+                group = []
+                i1, j1 = i2 - context, j2 - context
+            if i1 < i2:
+                group.append((tag, i1, i2, j1, j2))
+        else:
+            group.append((tag, i1, i2, j1, j2))
+    if group and group[-1][0] == "equal":
+        # Trailing context
+        tag, i1, i2, j1, j2 = group.pop()
+        if i1 < i2 and len(group) > 0:
+            group.append((tag, i1, min(i2, i1 + context),
+                          j1, min(j2, j1 + context)))
+    if any(tag != "equal" for tag, _, _, _, _ in group):
+        groups.append(group)
+    return groups
@@ -1,20 +1,53 @@
 """
-Syntax difference of two functions - using diff utility and filtering the
-result.
+Syntax difference of two functions or types.
+The diff is computed in-process and printed in the context format of the diff
+utility (with one line of context).
 """
 
-from subprocess import check_output, CalledProcessError
-from tempfile import mkdtemp
-
-import os
+from diffkemp.syndiff.context_diff import grouped_opcodes
+from functools import lru_cache
+
+
+@lru_cache(maxsize=256)
+def _source_lines(filename):
+    """
+    Get lines of a source file. Files are read only once and kept in a cache
+    since diffs of multiple functions are typically taken from the same file.
+    """
+    with open(filename, "r", encoding='utf-8') as input_file:
+        return tuple(input_file.readlines())
+
+
+def _extract_body(filename, start, terminator_list):
+    """
+    Extract the body of a function or a type starting on the given line.
+    The end of the body is detected as a line that contains nothing but one of
+    the terminators.
+    :return List of lines of the body or None if the end was not found.
+    """
+    lines = _source_lines(filename)
+    for line_index in range(start - 1, len(lines)):
+        if lines[line_index].rstrip() in terminator_list:
+            return lines[start - 1:line_index + 1]
+    return None
+
+
+def _format_range(start, stop, offset):
+    """
+    Format a range of lines in the same way as the diff utility does in the
+    context format. Line numbers are shifted by the offset.
+    """
+    beginning = start + 1
+    length = stop - start
+    if not length:
+        beginning -= 1
+    if length <= 1:
+        return str(beginning + offset)
+    return "{},{}".format(beginning + offset, beginning + offset + length - 1)
 
 
 def syntax_diff(first_file, second_file, name, kind, first_line, second_line):
     """Get diff of a C function or type between first_file and second_file"""
-    tmpdir = mkdtemp()
-    command = ["diff", "-C", "1", os.path.join(tmpdir, "1"),
-               os.path.join(tmpdir, "2")]
-
     if kind == "function":
         terminator_list = ["}", ");"]
     elif kind == "type":
@@ -22,72 +55,42 @@ def syntax_diff(first_file, second_file, name, kind, first_line, second_line):
 
     # Use the provided arguments "first_line" and "second_line" that contain
     # the lines on which the function starts in each file to extract both
-    # functions into temporary files
-    for filename in [first_file, second_file]:
-        tmp_file = "1" if filename == first_file else "2"
-        with open(filename, "r", encoding='utf-8') as input_file, \
-                open(os.path.join(tmpdir, tmp_file), "w",
-                     encoding='utf-8') as output_file:
-            lines = input_file.readlines()
-            start = first_line if filename == first_file else second_line
-
-            # The end of the function is detected as a line that contains
-            # nothing but an ending curly bracket
-            line_index = start - 1
-            line = lines[line_index]
-            while line.rstrip() not in terminator_list:
-                line_index += 1
-                if line_index == len(lines):
-                    return "Error: cannot get diff\n"
-                output_file.write(line)
-                line = lines[line_index]
-            output_file.write(line)
-
-    # check_output fails when the two files are different due to the error code
-    # (1), which in fact signalizes success; the exception has to be caught and
-    # the error code evaluated manually
-    try:
-        diff = check_output(command).decode('utf-8')
-    except CalledProcessError as e:
-        if e.returncode == 1:
-            diff = e.output.decode('utf-8')
-        else:
-            raise
-
-    if diff.isspace() or diff == "":
-        # Empty diff
-        return diff
-
-    # Split off filename names and fix line numbers
-    diff_lines = diff.split('\n')[2:]
-    diff_lines_new = []
+    # functions
+    first_body = _extract_body(first_file, first_line, terminator_list)
+    second_body = _extract_body(second_file, second_line, terminator_list)
+    if first_body is None or second_body is None:
+        return "Error: cannot get diff\n"
 
-    for line in diff_lines:
-        def fix_line(x):
-            offset = first_line if polarity == "*" else second_line
-            return str(int(x) + offset - 1)
+    def body_line(prefix, line):
+        return prefix + (line[:-1] if line.endswith("\n") else line)
 
+    diff_lines = []
+    for group in grouped_opcodes(first_body, second_body, 1):
         # Add function header
-        if set(list(line)) == set(["*"]):
-            with open(os.path.join(tmpdir, "1"), "r") as extract:
-                line += " " + extract.readline().strip()
-
-        # Check whether the line is a line number line
-        number_line_set = set([" ", "*", "-", ","] +
-                              list(map(str, list(range(0, 10)))))
-        if ((not set(list(line)).issubset(number_line_set)) or
-            (not any(char.isdigit() for char in line)) or
-                line.isspace() or line == ""):
-            diff_lines_new += [line]
-            continue
-
-        polarity = "*" if line.count("*") > 1 else "-"
-
-        line = line.replace("*", "").replace("-", "").replace(" ", "")
-        line = ",".join(map(fix_line, line.split(",")))
-        line = polarity * 3 + " " + line + " " + polarity * 3
-
-        diff_lines_new += [line]
-    diff = "\n".join(diff_lines_new)
-
-    return diff
+        diff_lines.append("*************** " + first_body[0].strip())
+
+        first_range = _format_range(group[0][1], group[-1][2], first_line - 1)
+        diff_lines.append("*** {} ***".format(first_range))
+        if any(tag in ["replace", "delete"] for tag, _, _, _, _ in group):
+            for tag, i1, i2, _, _ in group:
+                if tag == "insert":
+                    continue
+                prefix = {"equal": "  ", "replace": "! ", "delete": "- "}[tag]
+                diff_lines.extend(body_line(prefix, line)
+                                  for line in first_body[i1:i2])
+
+        second_range = _format_range(group[0][3], group[-1][4],
+                                     second_line - 1)
+        diff_lines.append("--- {} ---".format(second_range))
+        if any(tag in ["replace", "insert"] for tag, _, _, _, _ in group):
+            for tag, _, _, j1, j2 in group:
+                if tag == "delete":
+                    continue
+                prefix = {"equal": "  ", "replace": "! ", "insert": "+ "}[tag]
+                diff_lines.extend(body_line(prefix, line)
+                                  for line in second_body[j1:j2])
+
+    if not diff_lines:
+        # Empty diff
+        return ""
+    return "\n".join(diff_lines) + "\n"
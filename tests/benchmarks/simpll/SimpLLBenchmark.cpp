@@ -0,0 +1,428 @@
+//===------------ SimpLLBenchmark.cpp - Benchmarks of SimpLL --------------===//
+//
+//       SimpLL - Program simplifier for analysis of semantic difference      //
+//
+// This file is published under Apache 2.0 license. See LICENSE for details.
+// Author: Viktor Malik, vmalik@redhat.com
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains micro-benchmarks of the hot paths of SimpLL. The
+/// benchmarks run on synthetic modules built in memory, parametrised by the
+/// size of the functions, the depth of the call chains, and the number of
+/// macros used on each source line.
+///
+//===----------------------------------------------------------------------===//
+
+#include <Config.h>
+#include <DebugInfo.h>
+#include <DifferentialFunctionComparator.h>
+#include <ModuleComparator.h>
+#include <ResultsCache.h>
+#include <SourceCodeUtils.h>
+#include <SyntheticModuleGenerator.h>
+#include <benchmark/benchmark.h>
+#include <llvm/IR/DIBuilder.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/Support/ErrorHandling.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+#include <passes/StructureDebugInfoAnalysis.h>
+#include <passes/StructureSizeAnalysis.h>
+
+/// Number of functions in each synthetic module.
+static const int FunctionCount = 16;
+
+/// Parameters of a synthetic module.
+struct SyntheticParams {
+    // Number of instructions of each function.
+    int Size;
+    // Length of the call chains (number of wrappers calling each other).
+    int Depth;
+    // Number of nested macros used on each source line.
+    int Macros;
+};
+
+static SyntheticParams getParams(const benchmark::State &state) {
+    return {int(state.range(0)), int(state.range(1)), int(state.range(2))};
+}
+
+/// Temporary directory which is removed (including its contents) when the
+/// object is destroyed.
+struct TemporaryDirectory {
+    std::string Path;
+
+    TemporaryDirectory() {
+        SmallString<128> Dir;
+        if (auto EC = sys::fs::createUniqueDirectory("simpll-benchmark", Dir))
+            report_fatal_error(Twine("Cannot create a temporary directory: ")
+                               + EC.message());
+        Path = Dir.str().str();
+    }
+    ~TemporaryDirectory() { sys::fs::remove_directories(Path); }
+};
+
+/// Directory containing the C sources of the synthetic modules and the cache
+/// files. Created once per benchmark run and removed at the exit.
+static std::string getWorkDir() {
+    static TemporaryDirectory WorkDir;
+    return WorkDir.Path;
+}
+
+/// Name of the C source file of a synthetic module.
+static std::string getSourceName(const SyntheticParams &Params) {
+    return "bench-" + std::to_string(Params.Size) + "-"
+           + std::to_string(Params.Macros) + ".c";
+}
+
+/// Write the C source of a synthetic module. Every line uses the outermost
+/// of the nested macros MACRO_0 ... MACRO_<Macros - 1>.
+static void writeSource(const SyntheticParams &Params) {
+    std::string Path = getWorkDir() + "/" + getSourceName(Params);
+    if (sys::fs::exists(Path))
+        return;
+    std::error_code EC;
+    raw_fd_ostream Source(Path, EC, sys::fs::F_None);
+    if (EC)
+        report_fatal_error(Twine("Cannot write ") + Path + ": "
+                           + EC.message());
+    for (int i = 0; i < FunctionCount * Params.Size + 1; i++)
+        Source << "    x = x + MACRO_" << Params.Macros - 1 << ";\n";
+    Source.close();
+    if (Source.has_error())
+        report_fatal_error(Twine("Cannot write ") + Path + ": "
+                           + Source.error().message());
+}
+
+/// A synthetic module with debug info and macros.
+/// Each of the FunctionCount functions f<i> contains a chain of Size
+/// additions (each having its own source line) and calls the function
+/// w<i>_1 which calls w<i>_2 and so on up to w<i>_<Depth - 1> calling the
+/// leaf function l<i>. If the chain is not kept, f<i> calls l<i> directly.
+struct SyntheticModule {
+    LLVMContext Ctx;
+    std::unique_ptr<Module> Mod;
+    std::vector<Function *> Functions;
+
+    SyntheticModule(const SyntheticParams &Params,
+                    const std::string &Name,
+                    bool KeepChain) {
+        writeSource(Params);
+        Mod = std::make_unique<Module>(Name, Ctx);
+        DIBuilder DIB(*Mod);
+        DIFile *File = DIB.createFile(getSourceName(Params), getWorkDir());
+        DIB.createCompileUnit(
+                dwarf::DW_LANG_C99, File, "simpll-benchmark", false, "", 0);
+
+        // Macros: MACRO_0 is 1, MACRO_<i> is (MACRO_<i - 1> + 1).
+        DIMacroFile *MacroFile = DIB.createTempMacroFile(nullptr, 0, File);
+        for (int i = 0; i < Params.Macros; i++) {
+            std::string Body = i == 0 ? "1"
+                                      : "(MACRO_" + std::to_string(i - 1)
+                                                + " + 1)";
+            DIB.createMacro(MacroFile,
+                            i + 1,
+                            dwarf::DW_MACINFO_define,
+                            "MACRO_" + std::to_string(i),
+                            Body);
+        }
+
+        auto *IntTy = Type::getInt32Ty(Ctx);
+        auto *FunTy = FunctionType::get(IntTy, {IntTy}, false);
+        auto *DIFunTy = DIB.createSubroutineType(DIB.getOrCreateTypeArray({}));
+        auto createFunction = [&](const std::string &FunName, int Line) {
+            Function *Fun = Function::Create(
+                    FunTy, GlobalValue::ExternalLinkage, FunName, Mod.get());
+            DISubprogram *SP =
+                    DIB.createFunction(File,
+                                       FunName,
+                                       FunName,
+                                       File,
+                                       Line,
+                                       DIFunTy,
+                                       Line,
+                                       DINode::FlagZero,
+                                       DISubprogram::SPFlagDefinition);
+            Fun->setSubprogram(SP);
+            return Fun;
+        };
+
+        for (int i = 0; i < FunctionCount; i++) {
+            int FirstLine = i * Params.Size + 1;
+            // Leaf function returning its argument.
+            Function *Callee =
+                    createFunction("l" + std::to_string(i), FirstLine);
+            IRBuilder<> Builder(BasicBlock::Create(Ctx, "", Callee));
+            Builder.CreateRet(&*Callee->arg_begin());
+
+            // Wrappers.
+            for (int d = Params.Depth - 1; KeepChain && d > 0; d--) {
+                Function *Wrapper = createFunction(
+                        "w" + std::to_string(i) + "_" + std::to_string(d),
+                        FirstLine);
+                Builder.SetInsertPoint(BasicBlock::Create(Ctx, "", Wrapper));
+                Builder.SetCurrentDebugLocation(DILocation::get(
+                        Ctx, FirstLine, 0, Wrapper->getSubprogram()));
+                Builder.CreateRet(
+                        Builder.CreateCall(Callee, {&*Wrapper->arg_begin()}));
+                Callee = Wrapper;
+            }
+
+            // Main function.
+            Function *Fun = createFunction("f" + std::to_string(i), FirstLine);
+            Builder.SetInsertPoint(BasicBlock::Create(Ctx, "", Fun));
+            Value *X = &*Fun->arg_begin();
+            for (int j = 0; j < Params.Size; j++) {
+                Builder.SetCurrentDebugLocation(DILocation::get(
+                        Ctx, FirstLine + j, 0, Fun->getSubprogram()));
+                X = Builder.CreateAdd(X, ConstantInt::get(IntTy, j + 1));
+            }
+            Builder.CreateRet(Builder.CreateCall(Callee, {X}));
+            Functions.push_back(Fun);
+        }
+        DIB.finalize();
+    }
+};
+
+/// Objects necessary to compare a pair of synthetic modules.
+struct SyntheticComparison {
+    SyntheticModule First;
+    SyntheticModule Second;
+    Config Conf{"f0", "f0", ""};
+    std::set<const Function *> CalledFirst;
+    std::set<const Function *> CalledSecond;
+    StructureSizeAnalysis::Result StructSizeMapL;
+    StructureSizeAnalysis::Result StructSizeMapR;
+    StructureDebugInfoAnalysis::Result StructDIMapL;
+    StructureDebugInfoAnalysis::Result StructDIMapR;
+    std::unique_ptr<DebugInfo> DI;
+    std::unique_ptr<ModuleComparator> ModComp;
+
+    /// If KeepChain is false, the second module calls the leaf functions
+    /// directly, hence the wrappers must be inlined during the comparison.
+    SyntheticComparison(const SyntheticParams &Params, bool KeepChain)
+            : First(Params, "first", true),
+              Second(Params, "second", KeepChain) {
+        for (auto &Fun : *First.Mod)
+            CalledFirst.insert(&Fun);
+        for (auto &Fun : *Second.Mod)
+            CalledSecond.insert(&Fun);
+        DI = std::make_unique<DebugInfo>(*First.Mod,
+                                         *Second.Mod,
+                                         First.Functions[0],
+                                         Second.Functions[0],
+                                         CalledFirst,
+                                         CalledSecond);
+        ModComp = std::make_unique<ModuleComparator>(*First.Mod,
+                                                     *Second.Mod,
+                                                     Conf,
+                                                     DI.get(),
+                                                     StructSizeMapL,
+                                                     StructSizeMapR,
+                                                     StructDIMapL,
+                                                     StructDIMapR);
+    }
+};
+
+/// Collect debug locations of all instructions of the module.
+static std::vector<DILocation *> getLocations(Module &Mod) {
+    std::vector<DILocation *> Locations;
+    for (auto &Fun : Mod)
+        for (auto &BB : Fun)
+            for (auto &Inst : BB)
+                if (DILocation *Loc = Inst.getDebugLoc())
+                    Locations.push_back(Loc);
+    return Locations;
+}
+
+static void BM_DifferentialFunctionComparatorCompare(benchmark::State &state) {
+    SyntheticComparison Comparison(getParams(state), true);
+    auto &Funs = Comparison.First.Functions;
+    for (auto _ : state) {
+        for (size_t i = 0; i < Funs.size(); i++) {
+            Function *FunL = Funs[i];
+            Function *FunR = Comparison.Second.Functions[i];
+            Comparison.ModComp->ComparedFuns.emplace(
+                    std::make_pair(FunL, FunR), Result(FunL, FunR));
+            DifferentialFunctionComparator Comp(FunL,
+                                                FunR,
+                                                Comparison.Conf,
+                                                Comparison.DI.get(),
+                                                Comparison.ModComp.get());
+            benchmark::DoNotOptimize(Comp.compare());
+        }
+    }
+}
+
+static void BM_ModuleComparatorInlining(benchmark::State &state) {
+    std::unique_ptr<SyntheticComparison> Comparison;
+    for (auto _ : state) {
+        // Inlining modifies the modules, build new ones for each iteration.
+        state.PauseTiming();
+        Comparison = std::make_unique<SyntheticComparison>(getParams(state),
+                                                           false);
+        state.ResumeTiming();
+        for (size_t i = 0; i < Comparison->First.Functions.size(); i++)
+            Comparison->ModComp->compareFunctions(
+                    Comparison->First.Functions[i],
+                    Comparison->Second.Functions[i]);
+        benchmark::DoNotOptimize(Comparison->ModComp->ComparedFuns.size());
+    }
+}
+
+static void BM_MacroDiffAnalysisExpansion(benchmark::State &state) {
+    SyntheticModule Synthetic(getParams(state), "module", true);
+    auto Locations = getLocations(*Synthetic.Mod);
+    for (auto _ : state) {
+        // Macro uses are cached, use a new analysis in each iteration.
+        MacroDiffAnalysis MacroDiffs;
+        for (DILocation *Loc : Locations)
+            benchmark::DoNotOptimize(
+                    MacroDiffs.getAllMacroUsesAtLocation(Loc).size());
+    }
+    state.SetItemsProcessed(state.iterations() * Locations.size());
+}
+
+static void BM_ExtractLineFromLocation(benchmark::State &state) {
+    SyntheticModule Synthetic(getParams(state), "module", true);
+    auto Locations = getLocations(*Synthetic.Mod);
+    for (auto _ : state) {
+        for (DILocation *Loc : Locations)
+            benchmark::DoNotOptimize(extractLineFromLocation(Loc));
+    }
+    state.SetItemsProcessed(state.iterations() * Locations.size());
+}
+
+static void BM_DebugInfoConstruction(benchmark::State &state) {
+    std::unique_ptr<SyntheticModule> First, Second;
+    std::set<const Function *> CalledFirst, CalledSecond;
+    for (auto _ : state) {
+        // DebugInfo modifies the modules, build new ones for each iteration.
+        state.PauseTiming();
+        CalledFirst.clear();
+        CalledSecond.clear();
+        First = std::make_unique<SyntheticModule>(
+                getParams(state), "first", true);
+        Second = std::make_unique<SyntheticModule>(
+                getParams(state), "second", true);
+        for (auto &Fun : *First->Mod)
+            CalledFirst.insert(&Fun);
+        for (auto &Fun : *Second->Mod)
+            CalledSecond.insert(&Fun);
+        state.ResumeTiming();
+        DebugInfo DI(*First->Mod,
+                     *Second->Mod,
+                     First->Functions[0],
+                     Second->Functions[0],
+                     CalledFirst,
+                     CalledSecond);
+        benchmark::DoNotOptimize(DI.StructFieldNames.size());
+    }
+}
+
+static void BM_ResultsCacheLookup(benchmark::State &state) {
+    SyntheticParams Params = getParams(state);
+    SyntheticModule First(Params, "first", true);
+    SyntheticModule Second(Params, "second", true);
+
+    // Cache file containing every other pair of the main functions.
+    std::string SourcePath = getWorkDir() + "/" + getSourceName(Params);
+    std::string CacheName = SourcePath + ":" + SourcePath;
+    findAndReplace(CacheName, "/", "$");
+    std::string CachePath = getWorkDir() + "/" + CacheName;
+    std::error_code EC;
+    raw_fd_ostream CacheFile(CachePath, EC, sys::fs::F_None);
+    if (EC) {
+        state.SkipWithError("Cannot write the cache file");
+        return;
+    }
+    for (int i = 0; i < FunctionCount; i += 2)
+        CacheFile << "f" << i << ":f" << i << "\n";
+    CacheFile.close();
+    if (CacheFile.has_error()) {
+        state.SkipWithError("Cannot write the cache file");
+        CacheFile.clear_error();
+        return;
+    }
+
+    ResultsCache Cache(getWorkDir());
+    for (auto _ : state) {
+        for (int i = 0; i < FunctionCount; i++)
+            benchmark::DoNotOptimize(Cache.isFunctionPairCached(
+                    First.Functions[i], Second.Functions[i]));
+    }
+    state.SetItemsProcessed(state.iterations() * FunctionCount);
+    sys::fs::remove(CachePath);
+}
+
+/// Compare the root functions of a pair of modules generated by
+/// SyntheticModuleGenerator with the given number of functions and depth of
+/// the call graph (the other parameters have their default values).
+static void BM_GeneratedModulePairComparison(benchmark::State &state) {
+    GeneratorParams Params;
+    Params.Functions = state.range(0);
+    Params.Depth = state.range(1);
+    SyntheticModuleGenerator Generator(Params);
+    TemporaryDirectory Dir;
+    for (auto _ : state) {
+        // Inlining modifies the modules, generate new ones for each iteration.
+        state.PauseTiming();
+        LLVMContext CtxL, CtxR;
+        auto ModL = Generator.generate(CtxL, false, Dir.Path);
+        auto ModR = Generator.generate(CtxR, true, Dir.Path);
+        if (!ModL || !ModR) {
+            state.SkipWithError("Cannot generate the modules");
+            break;
+        }
+        auto Roots = Generator.getRoots();
+        Function *MainL = ModL->getFunction(Roots.front());
+        Function *MainR = ModR->getFunction(Roots.front());
+        std::set<const Function *> CalledL, CalledR;
+        for (auto &Fun : *ModL)
+            CalledL.insert(&Fun);
+        for (auto &Fun : *ModR)
+            CalledR.insert(&Fun);
+        Config Conf(Roots.front(), Roots.front(), "");
+        StructureSizeAnalysis::Result StructSizeMapL, StructSizeMapR;
+        StructureDebugInfoAnalysis::Result StructDIMapL, StructDIMapR;
+        DebugInfo DI(*ModL, *ModR, MainL, MainR, CalledL, CalledR);
+        ModuleComparator ModComp(*ModL,
+                                 *ModR,
+                                 Conf,
+                                 &DI,
+                                 StructSizeMapL,
+                                 StructSizeMapR,
+                                 StructDIMapL,
+                                 StructDIMapR);
+        state.ResumeTiming();
+        for (auto &Root : Roots)
+            ModComp.compareFunctions(ModL->getFunction(Root),
+                                     ModR->getFunction(Root));
+        benchmark::DoNotOptimize(ModComp.ComparedFuns.size());
+    }
+}
+
+// Arguments: function size, call depth, macro count.
+BENCHMARK(BM_DifferentialFunctionComparatorCompare)
+        ->RangeMultiplier(8)
+        ->Ranges({{8, 512}, {1, 8}, {1, 64}});
+BENCHMARK(BM_ModuleComparatorInlining)
+        ->RangeMultiplier(8)
+        ->Ranges({{8, 512}, {1, 8}, {1, 64}});
+BENCHMARK(BM_MacroDiffAnalysisExpansion)
+        ->RangeMultiplier(8)
+        ->Ranges({{8, 512}, {1, 1}, {1, 64}});
+BENCHMARK(BM_ExtractLineFromLocation)
+        ->RangeMultiplier(8)
+        ->Ranges({{8, 512}, {1, 1}, {1, 1}});
+BENCHMARK(BM_DebugInfoConstruction)
+        ->RangeMultiplier(8)
+        ->Ranges({{8, 512}, {1, 8}, {1, 64}});
+BENCHMARK(BM_ResultsCacheLookup)->Args({8, 1, 1});
+// Arguments: number of functions, depth of the call graph.
+BENCHMARK(BM_GeneratedModulePairComparison)
+        ->RangeMultiplier(10)
+        ->Ranges({{100, 10000}, {2, 8}});
+
+BENCHMARK_MAIN();
@@ -0,0 +1,240 @@
+"""
+Performance regression test using pytest.
+Runs the comparisons of the regression test specs (the "functions",
+"modules", and "sysctls" keys of the YAML spec files) and records the wall
+time, the growth of the peak RSS, the peak memory estimated by SimpLL, and the
+numbers of function comparisons and inlined calls done by SimpLL for each
+spec.
+
+The test is enabled by setting the DIFFKEMP_PERF_HISTORY environment variable
+to the path of the history file. A JSON object describing the measurement is
+appended to the file (one per line) for each spec.
+The test fails if a budget set by one of the following variables is exceeded:
+ - DIFFKEMP_PERF_TIME_BUDGET: maximal wall time of a spec (in seconds),
+ - DIFFKEMP_PERF_RSS_BUDGET: maximal peak RSS growth of a spec (in MiB),
+ - DIFFKEMP_PERF_MAX_SLOWDOWN: maximal ratio of the wall time of a spec to
+   its wall time in the last record of the history file.
+
+Module pairs generated by diffkemp-simpll-gen can be measured as well by
+setting DIFFKEMP_PERF_SYNTHETIC to a list of output directories of the
+generator (separated by the path separator).
+"""
+from diffkemp.config import Config
+from diffkemp.llvm_ir.kernel_module import LlvmKernelModule
+from diffkemp.semdiff.function_diff import functions_diff
+from diffkemp.semdiff.result import Result
+from diffkemp.simpll.simpll import SimpLLStats
+import json
+import multiprocessing
+import os
+import pytest
+import queue as queue_module
+import resource
+import subprocess
+import time
+import yaml
+
+history_file = os.environ.get("DIFFKEMP_PERF_HISTORY")
+
+
+def _budget(name):
+    """Get the budget set by the given environment variable (or None)."""
+    value = os.environ.get(name)
+    return float(value) if value else None
+
+
+def collect_task_specs():
+    """
+    Collect specs of all regression tests that compare functions. Each spec
+    is a tuple containing the kind of the spec, its id, and the spec object.
+    """
+    from . import functions_test, modules_test, sysctls_test
+    result = list()
+    for kind, module in [("functions", functions_test),
+                         ("modules", modules_test),
+                         ("sysctls", sysctls_test)]:
+        for spec_id, spec in module.specs:
+            result.append((kind, "{}_{}".format(kind, spec_id), spec))
+    synthetic = os.environ.get("DIFFKEMP_PERF_SYNTHETIC")
+    if synthetic:
+        for directory in synthetic.split(os.pathsep):
+            result.append(("synthetic",
+                           "synthetic_{}".format(os.path.basename(
+                               os.path.normpath(directory))),
+                           SyntheticSpec(directory)))
+    return result
+
+
+class SyntheticSpec:
+    """
+    Spec of a module pair generated by diffkemp-simpll-gen. The root
+    functions listed in the manifest of the pair are compared.
+    """
+    def __init__(self, directory):
+        with open(os.path.join(directory, "manifest.yaml"), "r") as f:
+            manifest = yaml.safe_load(f)
+        self.old_module = LlvmKernelModule(
+            os.path.join(directory, manifest["first"]))
+        self.new_module = LlvmKernelModule(
+            os.path.join(directory, manifest["second"]))
+        self.functions = manifest["functions"]
+        self.config = Config(None, None, False, False, False, False, False,
+                             False, None)
+
+    def finalize(self):
+        pass
+
+
+specs = collect_task_specs() if history_file else []
+
+
+def prepare_spec(kind, spec):
+    """
+    Build the modules of the spec (the same way as the corresponding
+    regression test does) and get the list of the comparisons to run.
+    :return List of tuples (first module, second module, function, global
+            variable).
+    """
+    comparisons = list()
+    if kind == "synthetic":
+        return [(spec.old_module, spec.new_module, fun, None)
+                for fun in spec.functions]
+    if kind == "modules":
+        spec.build_module()
+        for fun_spec in spec.functions.values():
+            if fun_spec.result not in [Result.Kind.TIMEOUT, Result.Kind.NONE]:
+                comparisons.append((spec.old_module, spec.new_module,
+                                    fun_spec.name, spec.get_param()))
+        return comparisons
+
+    glob_var = None
+    if kind == "sysctls":
+        spec.build_sysctl_module()
+        glob_var = spec.old_sysctl_module.get_data(spec.name)
+    for fun_spec in spec.functions.values():
+        if fun_spec.result in [Result.Kind.TIMEOUT, Result.Kind.NONE]:
+            continue
+        mod_old, mod_new = spec.build_modules_for_function(fun_spec.name)
+        var = None if kind == "sysctls" and \
+            fun_spec.name == spec.proc_handler else glob_var
+        comparisons.append((mod_old, mod_new, fun_spec.name, var))
+    return comparisons
+
+
+def _measure(comparisons, config, queue):
+    """
+    Run the comparisons and put the measured values into the queue.
+    Runs in a forked process so that the peak RSS covers just the spec. The
+    forked process starts with the RSS of the parent, hence only the growth
+    of the peak RSS above the initial value is recorded.
+    """
+    SimpLLStats.reset()
+    initial_rss = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    start = time.perf_counter()
+    try:
+        for mod_first, mod_second, fun, glob_var in comparisons:
+            functions_diff(mod_first=mod_first, mod_second=mod_second,
+                           fun_first=fun, fun_second=fun,
+                           glob_var=glob_var, config=config)
+    except Exception as e:
+        queue.put({"error": repr(e)})
+        return
+    wall_time = time.perf_counter() - start
+    # SimpLL runs either in this process (FFI) or in child processes.
+    peak_rss = max(
+        resource.getrusage(resource.RUSAGE_SELF).ru_maxrss - initial_rss,
+        resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss)
+    queue.put({
+        "wall-time": wall_time,
+        "peak-rss-kib": peak_rss,
+        "simpll-runs": SimpLLStats.runs,
+        "compared-functions": SimpLLStats.compared_functions,
+        "inlined-calls": SimpLLStats.inlined_calls,
+        "simpll-peak-memory-kib": SimpLLStats.peak_memory // 1024,
+    })
+
+
+def _wait_for_measurement(process, queue):
+    """
+    Get the measurement from the queue. Returns None if the measuring process
+    exits without sending it (e.g. when it crashes or is killed).
+    """
+    while True:
+        try:
+            return queue.get(timeout=1)
+        except queue_module.Empty:
+            if process.exitcode is not None:
+                break
+    # The process may have sent the measurement right before exiting.
+    try:
+        return queue.get(timeout=1)
+    except queue_module.Empty:
+        return None
+
+
+def _git_revision():
+    """Get the current git revision of DiffKemp (or None)."""
+    try:
+        return subprocess.check_output(["git", "rev-parse", "HEAD"],
+                                       stderr=subprocess.DEVNULL) \
+            .decode().strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def _last_record(spec_id):
+    """Get the last record of the spec in the history file (or None)."""
+    record = None
+    if os.path.isfile(history_file):
+        with open(history_file, "r") as history:
+            for line in history:
+                try:
+                    entry = json.loads(line)
+                except ValueError:
+                    continue
+                if entry.get("spec") == spec_id:
+                    record = entry
+    return record
+
+
+@pytest.fixture(params=[x for x in specs],
+                ids=[x[1] for x in specs])
+def task_spec(request):
+    """pytest fixture to prepare tasks"""
+    kind, spec_id, spec = request.param
+    comparisons = prepare_spec(kind, spec)
+    yield spec_id, spec, comparisons
+    spec.finalize()
+
+
+def test_performance(task_spec):
+    """Measure the comparison of the spec and check the budgets."""
+    spec_id, spec, comparisons = task_spec
+    previous = _last_record(spec_id)
+
+    ctx = multiprocessing.get_context("fork")
+    queue = ctx.Queue()
+    process = ctx.Process(target=_measure,
+                          args=(comparisons, spec.config, queue))
+    process.start()
+    measurement = _wait_for_measurement(process, queue)
+    process.join()
+    assert measurement is not None, \
+        "measurement exited with code {}".format(process.exitcode)
+    assert "error" not in measurement, measurement.get("error")
+
+    record = {"spec": spec_id, "timestamp": time.time(),
+              "revision": _git_revision()}
+    record.update(measurement)
+    with open(history_file, "a") as history:
+        history.write(json.dumps(record, sort_keys=True) + "\n")
+
+    time_budget = _budget("DIFFKEMP_PERF_TIME_BUDGET")
+    if time_budget is not None:
+        assert record["wall-time"] <= time_budget
+    rss_budget = _budget("DIFFKEMP_PERF_RSS_BUDGET")
+    if rss_budget is not None:
+        assert record["peak-rss-kib"] <= rss_budget * 1024
+    max_slowdown = _budget("DIFFKEMP_PERF_MAX_SLOWDOWN")
+    if max_slowdown is not None and previous is not None:
+        assert record["wall-time"] <= previous["wall-time"] * max_slowdown
@@ -91,3 +91,30 @@ def test_finalize():
     # Check that "asm goto" has been re-enabled.
     with open(gcc_header_path, "r") as gcc_header:
         assert "asm goto(x)" in gcc_header.read()
+
+
+def test_normalise_clang_command():
+    """Removing output files from a Clang command."""
+    command = ["clang", "-S", "-emit-llvm", "-Wp,-MD,sound/core/.init.o.d",
+               "-Iinclude", "-c", "sound/core/init.c", "-o",
+               "sound/core/init.ll"]
+    assert LlvmKernelBuilder._normalise_clang_command(command) == \
+        ["clang", "-S", "-emit-llvm", "-Iinclude", "-c", "sound/core/init.c"]
+
+
+@pytest.mark.parametrize("kernel_dir", versions)
+def test_build_src_cached(kernel_dir, tmpdir):
+    """Reusing LLVM IR stored in the build cache."""
+    builder = LlvmKernelBuilder(kernel_dir, cache_dir=str(tmpdir))
+    llvm_file = os.path.join(builder.kernel_dir, "sound/core/init.ll")
+    builder.build_source_to_llvm("sound/core/init.c", "sound/core/init.ll")
+    with open(llvm_file, "r") as llvm:
+        built = llvm.read()
+    assert os.listdir(str(tmpdir))
+
+    # Rebuilding takes the file from the cache
+    os.unlink(llvm_file)
+    builder.build_source_to_llvm("sound/core/init.c", "sound/core/init.ll")
+    with open(llvm_file, "r") as llvm:
+        assert llvm.read() == built
+    builder.finalize()
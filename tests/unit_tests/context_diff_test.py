@@ -0,0 +1,49 @@
+"""Unit tests for the in-process computation of syntax diffs."""
+
+from diffkemp.syndiff.context_diff import grouped_opcodes
+from diffkemp.syndiff.function_syntax_diff import syntax_diff
+
+
+def test_grouped_opcodes():
+    """
+    Compute hunks of two sequences. Changes separated by more than two
+    unchanged lines are in separate hunks and deletions from runs of identical
+    lines are placed in the same way as the diff utility does.
+    """
+    first = ["b", "d", "g", "c", "a", "d", "d", "d", "f"]
+    second = ["g", "c", "a", "d", "d", "f"]
+    assert grouped_opcodes(first, second, 1) == [
+        [("delete", 0, 2, 0, 0), ("equal", 2, 3, 0, 1)],
+        [("equal", 5, 6, 3, 4), ("delete", 6, 7, 4, 4),
+         ("equal", 7, 8, 4, 5)]
+    ]
+    assert grouped_opcodes(first, first, 1) == []
+
+
+def test_syntax_diff(tmpdir):
+    """Get diff of a function in the context format with fixed line numbers."""
+    first = tmpdir.join("first.c")
+    first.write("int x;\n"
+                "\n"
+                "static int f(int a)\n"
+                "{\n"
+                "\tint b = a;\n"
+                "\treturn b;\n"
+                "}\n")
+    second = tmpdir.join("second.c")
+    second.write("static int f(int a)\n"
+                 "{\n"
+                 "\tint b = a + 1;\n"
+                 "\treturn b;\n"
+                 "}\n")
+    diff = syntax_diff(str(first), str(second), "f", "function", 3, 1)
+    assert diff == ("*************** static int f(int a)\n"
+                    "*** 4,6 ***\n"
+                    "  {\n"
+                    "! \tint b = a;\n"
+                    "  \treturn b;\n"
+                    "--- 2,4 ---\n"
+                    "  {\n"
+                    "! \tint b = a + 1;\n"
+                    "  \treturn b;\n")
+    assert syntax_diff(str(first), str(first), "f", "function", 3, 3) == ""
@@ -0,0 +1,55 @@
+"""
+Unit tests for the semantic difference of functions.
+Tests for helper functions located in semdiff/function_diff.py.
+"""
+
+from diffkemp.semdiff.function_diff import _combine_z3_results, \
+    _llvm_definitions
+from diffkemp.semdiff.result import Result
+import os
+
+
+def test_combine_z3_results():
+    """Combining results of the solvers from the Z3 portfolio."""
+    Kind = Result.Kind
+    # Definite answers have priority
+    assert _combine_z3_results([Kind.UNKNOWN, Kind.EQUAL], False) == \
+        Kind.EQUAL
+    assert _combine_z3_results([Kind.ERROR, Kind.NOT_EQUAL], True) == \
+        Kind.NOT_EQUAL
+    # UNKNOWN has priority over a timeout and an error, regardless of the
+    # order in which the solvers finished
+    assert _combine_z3_results([Kind.UNKNOWN], True) == Kind.UNKNOWN
+    assert _combine_z3_results([Kind.ERROR, Kind.UNKNOWN], False) == \
+        Kind.UNKNOWN
+    assert _combine_z3_results([Kind.UNKNOWN, Kind.ERROR], False) == \
+        Kind.UNKNOWN
+    # Timeout if no solver finished with an answer in time
+    assert _combine_z3_results([], True) == Kind.TIMEOUT
+    assert _combine_z3_results([Kind.ERROR], True) == Kind.TIMEOUT
+    assert _combine_z3_results([Kind.ERROR, Kind.ERROR], False) == \
+        Kind.ERROR
+
+
+def test_llvm_definitions_cached(tmpdir):
+    """Definitions of an LLVM file are parsed again only if it changes."""
+    llvm_file = tmpdir.join("mod.ll")
+    llvm_file.write("%struct.s = type { i32 }\n"
+                    "define i32 @f() {\n"
+                    "  ret i32 0\n"
+                    "}\n")
+    functions, types = _llvm_definitions(str(llvm_file))
+    assert functions == {"f": "define i32 @f() {\n  ret i32 0\n}\n"}
+    assert types == ["%struct.s = type { i32 }\n"]
+    assert _llvm_definitions(str(llvm_file)) is \
+        _llvm_definitions(str(llvm_file))
+
+    llvm_file.write("define i32 @g() {\n"
+                    "  ret i32 1\n"
+                    "}\n")
+    stat = os.stat(str(llvm_file))
+    os.utime(str(llvm_file),
+             ns=(stat.st_atime_ns, stat.st_mtime_ns + 1000000000))
+    functions, types = _llvm_definitions(str(llvm_file))
+    assert list(functions.keys()) == ["g"]
+    assert types == []
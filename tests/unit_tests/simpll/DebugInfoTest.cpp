@@ -0,0 +1,190 @@
+//===---------------- DebugInfoTest.cpp - Unit tests -----------------------==//
+//
+//       SimpLL - Program simplifier for analysis of semantic difference      //
+//
+// This file is published under Apache 2.0 license. See LICENSE for details.
+// Author: Viktor Malik, vmalik@redhat.com
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains unit tests for matching names of structure fields using
+/// the debug info and for the index of debug info of structure types.
+///
+//===----------------------------------------------------------------------===//
+
+#include <DebugInfo.h>
+#include <gtest/gtest.h>
+#include <llvm/BinaryFormat/Dwarf.h>
+#include <llvm/IR/DIBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <passes/StructureDebugInfoAnalysis.h>
+
+/// Test fixture providing a pair of modules into which structure types with
+/// their debug info are added.
+class DebugInfoTest : public ::testing::Test {
+  public:
+    LLVMContext CtxL, CtxR;
+    Module ModL{"left", CtxL};
+    Module ModR{"right", CtxR};
+    std::set<const Function *> CalledFirst;
+    std::set<const Function *> CalledSecond;
+
+    /// Create a structure type struct.<Name> having the given fields (all of
+    /// type int) in the module. If DebugFields is true, the debug info of
+    /// the type is added into the module, too.
+    static StructType *createStruct(Module &Mod,
+                                    StringRef Name,
+                                    ArrayRef<StringRef> Fields,
+                                    bool DebugFields = true) {
+        LLVMContext &Ctx = Mod.getContext();
+        std::vector<Type *> Elements(Fields.size(), Type::getInt32Ty(Ctx));
+        StructType *Type =
+                StructType::create(Ctx, Elements, ("struct." + Name).str());
+        if (!DebugFields)
+            return Type;
+
+        DIBuilder Builder(Mod);
+        DIFile *File = Builder.createFile("test.c", "test");
+        Builder.createCompileUnit(
+                dwarf::DW_LANG_C99, File, "test", false, "", 0);
+        DIBasicType *IntDI =
+                Builder.createBasicType("int", 32, dwarf::DW_ATE_signed);
+        std::vector<Metadata *> ElementsDI;
+        uint64_t Offset = 0;
+        for (StringRef Field : Fields) {
+            ElementsDI.push_back(Builder.createMemberType(File,
+                                                          Field,
+                                                          File,
+                                                          1,
+                                                          32,
+                                                          32,
+                                                          Offset,
+                                                          DINode::FlagZero,
+                                                          IntDI));
+            Offset += 32;
+        }
+        DICompositeType *TypeDI =
+                Builder.createStructType(File,
+                                         Name,
+                                         File,
+                                         1,
+                                         Offset,
+                                         32,
+                                         DINode::FlagZero,
+                                         nullptr,
+                                         Builder.getOrCreateArray(ElementsDI));
+        Builder.retainType(TypeDI);
+        Builder.finalize();
+        return Type;
+    }
+
+    std::unique_ptr<DebugInfo> createDebugInfo() {
+        return std::make_unique<DebugInfo>(
+                ModL, ModR, nullptr, nullptr, CalledFirst, CalledSecond);
+    }
+
+    /// Get the name of the field stored in StructFieldNames or an empty
+    /// string if there is none.
+    static StringRef getFieldName(const DebugInfo &DI,
+                                  StructType *Type,
+                                  uint64_t Index) {
+        auto Name = DI.StructFieldNames.find({Type, Index});
+        return Name != DI.StructFieldNames.end() ? Name->second : "";
+    }
+};
+
+/// Tests that fields with the same names are matched if their order changes.
+TEST_F(DebugInfoTest, AlignStructFieldsReordered) {
+    StructType *TypeL = createStruct(ModL, "s", {"a", "b", "c"});
+    StructType *TypeR = createStruct(ModR, "s", {"c", "a", "b"});
+    auto DI = createDebugInfo();
+
+    DI->alignStructFields(TypeL, TypeR);
+    ASSERT_EQ(DI->StructFieldNames.size(), 6);
+    ASSERT_EQ(getFieldName(*DI, TypeL, 0), "a");
+    ASSERT_EQ(getFieldName(*DI, TypeL, 1), "b");
+    ASSERT_EQ(getFieldName(*DI, TypeL, 2), "c");
+    ASSERT_EQ(getFieldName(*DI, TypeR, 0), "c");
+    ASSERT_EQ(getFieldName(*DI, TypeR, 1), "a");
+    ASSERT_EQ(getFieldName(*DI, TypeR, 2), "b");
+}
+
+/// Tests that a field of the first type can be matched with the first field
+/// of the second type and that fields present in one of the types only are
+/// not matched.
+TEST_F(DebugInfoTest, AlignStructFieldsFirstFieldOfSecond) {
+    StructType *TypeL = createStruct(ModL, "s", {"x", "y"});
+    StructType *TypeR = createStruct(ModR, "s", {"y", "z"});
+    auto DI = createDebugInfo();
+
+    DI->alignStructFields(TypeL, TypeR);
+    ASSERT_EQ(DI->StructFieldNames.size(), 2);
+    ASSERT_EQ(getFieldName(*DI, TypeL, 1), "y");
+    ASSERT_EQ(getFieldName(*DI, TypeR, 0), "y");
+}
+
+/// Tests that no fields are matched if one of the modules does not have the
+/// debug info of the type, while names of fields of the other type are still
+/// available.
+TEST_F(DebugInfoTest, AlignStructFieldsMissingDebugInfo) {
+    StructType *TypeL = createStruct(ModL, "s", {"a", "b"});
+    StructType *TypeR = createStruct(ModR, "s", {"a", "b"}, false);
+    auto DI = createDebugInfo();
+
+    DI->alignStructFields(TypeL, TypeR);
+    ASSERT_TRUE(DI->StructFieldNames.empty());
+    ASSERT_EQ(DI->getStructFieldName(TypeL, 1, Program::First), "b");
+    ASSERT_EQ(DI->getStructFieldName(TypeR, 1, Program::Second), "");
+}
+
+/// Tests that identifiers of GEPs use the names of structure fields even if
+/// the fields were not matched by alignStructFields.
+TEST_F(DebugInfoTest, IdentifierFieldNames) {
+    createStruct(ModL, "s", {"a"});
+    StructType *TypeR = createStruct(ModR, "s", {"a", "b"});
+    Function *Fun = Function::Create(
+            FunctionType::get(Type::getVoidTy(CtxR),
+                              {PointerType::get(TypeR, 0)},
+                              false),
+            GlobalValue::ExternalLinkage,
+            "F",
+            &ModR);
+    Argument *Dev = &*Fun->arg_begin();
+    Dev->setName("dev");
+    BasicBlock *BB = BasicBlock::Create(CtxR, "", Fun);
+    Value *Indices[] = {ConstantInt::get(Type::getInt32Ty(CtxR), 0),
+                        ConstantInt::get(Type::getInt32Ty(CtxR), 1)};
+    auto GEP = GetElementPtrInst::Create(TypeR, Dev, Indices, "", BB);
+    ReturnInst::Create(CtxR, BB);
+    auto DI = createDebugInfo();
+
+    IdentifierCache Identifiers(DI.get(), Program::Second);
+    ASSERT_EQ(Identifiers.getIdentifierForValue(GEP), "&(dev->b)");
+    ASSERT_TRUE(DI->StructFieldNames.empty());
+    ASSERT_EQ(IdentifierCache().getIdentifierForValue(GEP), "&(dev->1)");
+}
+
+/// Tests that the index of structure debug info finds structures lazily and
+/// that if there are more structures of the same name (here in different
+/// compile units), the first one is used.
+TEST_F(DebugInfoTest, StructDebugInfoIndexFirstFound) {
+    createStruct(ModL, "s", {"a", "b"});
+    createStruct(ModL, "t", {"x"});
+    createStruct(ModL, "s", {"c"});
+
+    StructDebugInfoIndex Index(ModL);
+    DICompositeType *S = Index.lookup("s");
+    ASSERT_TRUE(S);
+    ASSERT_EQ(S->getElements().size(), 2);
+    ASSERT_EQ(Index.lookup("missing"), nullptr);
+    ASSERT_EQ(Index.lookup("s"), S);
+    ASSERT_TRUE(Index.lookup("t"));
+
+    // The index built from the types found by a debug info finder (used by
+    // DebugInfo) chooses the same structure.
+    DebugInfoFinder Finder;
+    Finder.processModule(ModL);
+    ASSERT_EQ(StructDebugInfoIndex(Finder).lookup("s"), S);
+}
@@ -17,7 +17,9 @@
 #include <DifferentialFunctionComparator.h>
 #include <ModuleComparator.h>
 #include <ResultsCache.h>
+#include <Utils.h>
 #include <gtest/gtest.h>
+#include <llvm/IR/DIBuilder.h>
 #include <passes/FieldAccessFunctionGenerator.h>
 #include <passes/StructureDebugInfoAnalysis.h>
 #include <passes/StructureSizeAnalysis.h>
@@ -800,6 +802,43 @@ TEST_F(DifferentialFunctionComparatorTest, CmpTypes) {
               1);
 }
 
+/// Tests that results of type comparisons are cached in the module comparator
+/// separately for comparing the control flow only and that unions are compared
+/// by their sizes before looking into the cache.
+TEST_F(DifferentialFunctionComparatorTest, CmpTypesCached) {
+    StructType *STyL =
+            StructType::create({Type::getInt32Ty(CtxL)}, "struct.cached");
+    StructType *STyR =
+            StructType::create({Type::getInt32Ty(CtxR)}, "struct.cached");
+    auto &Cache = ModComp->TypeComparisons;
+    TypeComparisonKey Key{STyL, STyR, false};
+    TypeComparisonKey KeyControlFlow{STyL, STyR, true};
+
+    ASSERT_EQ(DiffComp->testCmpTypes(STyL, STyR), 0);
+    ASSERT_EQ(Cache.lookup(Key), 0);
+    ASSERT_EQ(Cache.count(KeyControlFlow), 0);
+    // A repeated comparison returns the cached result.
+    Cache[Key] = 1;
+    ASSERT_EQ(DiffComp->testCmpTypes(STyL, STyR), 1);
+
+    // The types are compared again when comparing the control flow only.
+    Conf.ControlFlowOnly = true;
+    ASSERT_EQ(DiffComp->testCmpTypes(STyL, STyR), 0);
+    ASSERT_EQ(Cache.count(KeyControlFlow), 1);
+    Conf.ControlFlowOnly = false;
+    ASSERT_EQ(DiffComp->testCmpTypes(STyL, STyR), 1);
+
+    // A union at least as large as the other type is equal to it regardless
+    // of the cache.
+    StructType *UTyL =
+            StructType::create({Type::getInt32Ty(CtxL)}, "union.cached");
+    Type *IntTyR = Type::getInt16Ty(CtxR);
+    Cache[{UTyL, IntTyR, false}] = 1;
+    ASSERT_EQ(DiffComp->testCmpTypes(UTyL, IntTyR), 0);
+    ASSERT_EQ(DiffComp->testCmpTypes(UTyL, Type::getInt8Ty(CtxR)), 0);
+    ASSERT_EQ(Cache.count({UTyL, Type::getInt8Ty(CtxR), false}), 0);
+}
+
 /// Tests whether calls are properly marked for inlining while comparing
 /// basic blocks.
 TEST_F(DifferentialFunctionComparatorTest, CmpBasicBlocksInlining) {
@@ -1173,4 +1212,180 @@ TEST_F(DifferentialFunctionComparatorTest, CmpConstants) {
     ASSERT_EQ(DiffComp->testCmpConstants(ConstL2, ConstR), -1);
     ASSERT_EQ(DiffComp->testCmpConstants(ConstR, ConstL2), 1);
 }
+
+/// Creates a pair of equal functions (returning void) with the given name.
+static std::pair<Function *, Function *> createEqualFunctions(
+        Module &ModL, Module &ModR, const std::string &Name) {
+    Function *FunL = Function::Create(
+            FunctionType::get(Type::getVoidTy(ModL.getContext()), {}, false),
+            GlobalValue::ExternalLinkage,
+            Name,
+            &ModL);
+    Function *FunR = Function::Create(
+            FunctionType::get(Type::getVoidTy(ModR.getContext()), {}, false),
+            GlobalValue::ExternalLinkage,
+            Name,
+            &ModR);
+    ReturnInst::Create(ModL.getContext(),
+                       BasicBlock::Create(ModL.getContext(), "", FunL));
+    ReturnInst::Create(ModR.getContext(),
+                       BasicBlock::Create(ModR.getContext(), "", FunR));
+    return {FunL, FunR};
+}
+
+/// Tests that functions are compared normally if the memory limit is not
+/// reached.
+TEST_F(DifferentialFunctionComparatorTest, MemoryLimitNotReached) {
+    auto Funs = createEqualFunctions(ModL, ModR, "Mem");
+    Conf.Memory.setLimit(uint64_t(1) << 30);
+
+    ModComp->compareFunctions(Funs.first, Funs.second);
+    ASSERT_EQ(ModComp->ComparedFuns.at(Funs).kind, Result::EQUAL);
+    ASSERT_FALSE(Conf.Memory.isLimitExceeded());
+    ASSERT_EQ(Conf.Memory.getStats().cacheSheds, 0);
+    ASSERT_GT(Conf.Memory.getStats().peak, 0);
+}
+
+/// Tests that the caches are dropped when the memory limit is reached and
+/// that the remaining functions are not compared if the limit is exceeded
+/// even after that.
+TEST_F(DifferentialFunctionComparatorTest, MemoryLimitExceeded) {
+    auto Funs = createEqualFunctions(ModL, ModR, "Mem");
+    auto OtherFuns = createEqualFunctions(ModL, ModR, "OtherMem");
+    Conf.Memory.setLimit(1);
+
+    ModComp->compareFunctions(Funs.first, Funs.second);
+    ASSERT_EQ(ModComp->ComparedFuns.at(Funs).kind, Result::EQUAL);
+    ASSERT_TRUE(Conf.Memory.isLimitExceeded());
+    ASSERT_EQ(Conf.Memory.getStats().cacheSheds, 1);
+
+    ModComp->compareFunctions(OtherFuns.first, OtherFuns.second);
+    ASSERT_EQ(ModComp->ComparedFuns.at(OtherFuns).kind, Result::UNKNOWN);
+}
+
+/// Tests that names of function arguments used in identifiers of values are
+/// taken from the parameters among the retained nodes of the subprogram
+/// (matched by their argument numbers) and that other values without a name
+/// have an unknown identifier.
+TEST_F(DifferentialFunctionComparatorTest, IdentifierArgumentNames) {
+    Type *IntTy = Type::getInt32Ty(CtxL);
+    Function *Fun = Function::Create(
+            FunctionType::get(IntTy, {IntTy, IntTy}, false),
+            GlobalValue::ExternalLinkage,
+            "Args",
+            &ModL);
+    BasicBlock *BB = BasicBlock::Create(CtxL, "", Fun);
+    Argument *ArgA = &*Fun->arg_begin();
+    Argument *ArgB = &*std::next(Fun->arg_begin());
+    auto Sum = BinaryOperator::Create(Instruction::Add, ArgA, ArgB, "", BB);
+    ReturnInst::Create(CtxL, Sum, BB);
+
+    // Identifiers of arguments are unknown without debug info.
+    ASSERT_EQ(IdentifierCache().getIdentifierForValue(ArgA), "<unknown>");
+
+    // A local variable precedes the parameters, which are in reverse order.
+    DIBuilder DIB(ModL);
+    DIFile *File = DIB.createFile("args.c", "test");
+    DIB.createCompileUnit(dwarf::DW_LANG_C99, File, "test", false, "", 0);
+    DISubprogram *Sub = DIB.createFunction(
+            File,
+            "Args",
+            "Args",
+            File,
+            1,
+            DIB.createSubroutineType(DIB.getOrCreateTypeArray({})),
+            1,
+            DINode::FlagZero,
+            DISubprogram::SPFlagDefinition);
+    DIB.createAutoVariable(Sub, "local", File, 2, nullptr, true);
+    DIB.createParameterVariable(Sub, "b", 2, File, 1, nullptr, true);
+    DIB.createParameterVariable(Sub, "a", 1, File, 1, nullptr, true);
+    DIB.finalizeSubprogram(Sub);
+    Fun->setSubprogram(Sub);
+
+    IdentifierCache Identifiers;
+    ASSERT_EQ(Identifiers.getIdentifierForValue(ArgA), "a");
+    ASSERT_EQ(Identifiers.getIdentifierForValue(ArgB), "b");
+    ASSERT_EQ(Identifiers.getIdentifierForValue(Sum), "<unknown>");
+}
+
+/// Creates functions Caller calling Target (a declaration) in both modules.
+/// In the first module, Target is called through a simple wrapper Wrapper
+/// having two instructions (the call and the return).
+static std::pair<Function *, Function *>
+        createWrapperCall(Module &ModL,
+                          Module &ModR,
+                          DISubprogram *DSubL,
+                          DISubprogram *DSubR) {
+    std::pair<Function *, Function *> Callers;
+    for (bool Left : {true, false}) {
+        Module &Mod = Left ? ModL : ModR;
+        LLVMContext &Ctx = Mod.getContext();
+        DISubprogram *DSub = Left ? DSubL : DSubR;
+        FunctionType *FunTy =
+                FunctionType::get(Type::getVoidTy(Ctx), {}, false);
+        Function *Target = Function::Create(
+                FunTy, GlobalValue::ExternalLinkage, "Target", &Mod);
+        Function *Called = Target;
+        if (Left) {
+            Called = Function::Create(
+                    FunTy, GlobalValue::ExternalLinkage, "Wrapper", &Mod);
+            BasicBlock *BB = BasicBlock::Create(Ctx, "", Called);
+            CallInst *Call = CallInst::Create(Target, "", BB);
+            Call->setDebugLoc(DebugLoc{DILocation::get(Ctx, 2, 1, DSub)});
+            ReturnInst::Create(Ctx, BB);
+        }
+        Function *Caller = Function::Create(
+                FunTy, GlobalValue::ExternalLinkage, "Caller", &Mod);
+        BasicBlock *BB = BasicBlock::Create(Ctx, "", Caller);
+        CallInst *Call = CallInst::Create(Called, "", BB);
+        Call->setDebugLoc(DebugLoc{DILocation::get(Ctx, 1, 1, DSub)});
+        ReturnInst::Create(Ctx, BB);
+        (Left ? Callers.first : Callers.second) = Caller;
+    }
+    return Callers;
+}
+
+/// Tests that a wrapper called from one of the functions only is inlined
+/// before the functions are compared if it is not larger than the limit,
+/// hence a single comparison is sufficient and the call to the wrapper is
+/// weak.
+TEST_F(DifferentialFunctionComparatorTest, InlineWrappers) {
+    auto Callers = createWrapperCall(ModL, ModR, DSubL, DSubR);
+    Conf.InlineWrappersLimit = 2;
+
+    ModComp->compareFunctions(Callers.first, Callers.second);
+    Result &Res = ModComp->ComparedFuns.at(Callers);
+    ASSERT_EQ(Res.kind, Result::EQUAL);
+    ASSERT_EQ(ModComp->Stats.comparedFunctions, 1);
+    ASSERT_EQ(ModComp->Stats.inlinedCalls, 1);
+    ASSERT_TRUE(ModComp->MissingDefs.empty());
+    ASSERT_EQ(Res.First.calls.size(), 2);
+    for (const CallInfo &CI : Res.First.calls)
+        ASSERT_EQ(CI.weak, CI.fun == "Wrapper");
+}
+
+/// Tests that a wrapper larger than the limit is not inlined before the
+/// comparison. It is inlined only after the first comparison fails.
+TEST_F(DifferentialFunctionComparatorTest, InlineWrappersOverLimit) {
+    auto Callers = createWrapperCall(ModL, ModR, DSubL, DSubR);
+    Conf.InlineWrappersLimit = 1;
+
+    ModComp->compareFunctions(Callers.first, Callers.second);
+    ASSERT_EQ(ModComp->ComparedFuns.at(Callers).kind, Result::EQUAL);
+    ASSERT_EQ(ModComp->Stats.comparedFunctions, 2);
+    ASSERT_EQ(ModComp->Stats.inlinedCalls, 1);
+}
+
+/// Tests that wrappers are not inlined before the comparison if the inlining
+/// is disabled.
+TEST_F(DifferentialFunctionComparatorTest, InlineWrappersDisabled) {
+    auto Callers = createWrapperCall(ModL, ModR, DSubL, DSubR);
+    Conf.InlineWrappersLimit = 0;
+
+    ModComp->compareFunctions(Callers.first, Callers.second);
+    ASSERT_EQ(ModComp->ComparedFuns.at(Callers).kind, Result::EQUAL);
+    ASSERT_EQ(ModComp->Stats.comparedFunctions, 2);
+    ASSERT_EQ(ModComp->Stats.inlinedCalls, 1);
+}
 #endif
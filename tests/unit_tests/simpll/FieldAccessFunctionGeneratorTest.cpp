@@ -0,0 +1,94 @@
+//===------- FieldAccessFunctionGeneratorTest.cpp - Unit tests -------------==//
+//
+//       SimpLL - Program simplifier for analysis of semantic difference      //
+//
+// This file is published under Apache 2.0 license. See LICENSE for details.
+// Author: Tomas Glozar, tglozar@gmail.com
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains unit tests for the FieldAccessFunctionGenerator pass.
+///
+//===----------------------------------------------------------------------===//
+
+#include <gtest/gtest.h>
+#include <llvm/AsmParser/Parser.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/SourceMgr.h>
+#include <passes/CalledFunctionsAnalysis.h>
+#include <passes/FieldAccessFunctionGenerator.h>
+
+/// Module with a function containing three field access blocks having the
+/// same debug location. The first two blocks are identical, the third one
+/// accesses a different field.
+static const char *FieldAccessModule = R"(
+%struct.s = type { i32, %struct.t }
+%struct.t = type { i32, i32 }
+
+define i32 @test(%struct.s* %p) !dbg !5 {
+entry:
+  %a1 = getelementptr inbounds %struct.s, %struct.s* %p, i32 0, i32 1, !dbg !7
+  %b1 = getelementptr inbounds %struct.t, %struct.t* %a1, i32 0, i32 1, !dbg !7
+  %v1 = load i32, i32* %b1
+  %a2 = getelementptr inbounds %struct.s, %struct.s* %p, i32 0, i32 1, !dbg !7
+  %b2 = getelementptr inbounds %struct.t, %struct.t* %a2, i32 0, i32 1, !dbg !7
+  %v2 = load i32, i32* %b2
+  %a3 = getelementptr inbounds %struct.s, %struct.s* %p, i32 0, i32 1, !dbg !7
+  %b3 = getelementptr inbounds %struct.t, %struct.t* %a3, i32 0, i32 0, !dbg !7
+  %v3 = load i32, i32* %b3
+  %r1 = add i32 %v1, %v2
+  %r2 = add i32 %r1, %v3
+  ret i32 %r2
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "test.c", directory: "/tmp")
+!2 = !{}
+!3 = !{i32 2, !"Dwarf Version", i32 4}
+!4 = !{i32 2, !"Debug Info Version", i32 3}
+!5 = distinct !DISubprogram(name: "test", scope: !1, file: !1, line: 1, type: !6, isLocal: false, isDefinition: true, scopeLine: 1, isOptimized: false, unit: !0, retainedNodes: !2)
+!6 = !DISubroutineType(types: !2)
+!7 = !DILocation(line: 2, column: 10, scope: !5)
+)";
+
+/// Tests that identical field access blocks (having the same debug location,
+/// types, and constant operands) are replaced by calls to a single
+/// abstraction, while a block accessing a different field gets its own one.
+TEST(FieldAccessFunctionGeneratorTest, IdenticalBlocksShareAbstraction) {
+    LLVMContext Ctx, CtxOther;
+    SMDiagnostic Err;
+    auto Mod = parseAssemblyString(FieldAccessModule, Err, Ctx);
+    auto ModOther = parseAssemblyString(FieldAccessModule, Err, CtxOther);
+    ASSERT_TRUE(Mod && ModOther);
+    Function *Test = Mod->getFunction("test");
+
+    AnalysisManager<Module, Function *> mam(false);
+    mam.registerPass([] { return CalledFunctionsAnalysis(); });
+#if LLVM_VERSION_MAJOR >= 8
+    mam.registerPass([] { return PassInstrumentationAnalysis(); });
+#endif
+    FieldAccessFunctionGenerator().run(*Mod, mam, Test, ModOther.get());
+
+    std::vector<Function *> Abstractions;
+    for (auto &Fun : *Mod) {
+        if (isSimpllFieldAccessAbstraction(&Fun))
+            Abstractions.push_back(&Fun);
+    }
+    ASSERT_EQ(Abstractions.size(), 2);
+
+    std::vector<Function *> Called;
+    for (auto &Inst : instructions(*Test)) {
+        ASSERT_FALSE(isa<GetElementPtrInst>(Inst));
+        if (auto Call = dyn_cast<CallInst>(&Inst))
+            Called.push_back(Call->getCalledFunction());
+    }
+    ASSERT_EQ(Called.size(), 3);
+    ASSERT_EQ(Called[0], Called[1]);
+    ASSERT_NE(Called[0], Called[2]);
+}
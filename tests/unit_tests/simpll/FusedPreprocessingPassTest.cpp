@@ -0,0 +1,177 @@
+//===--------- FusedPreprocessingPassTest.cpp - Unit tests -----------------==//
+//
+//       SimpLL - Program simplifier for analysis of semantic difference      //
+//
+// This file is published under Apache 2.0 license. See LICENSE for details.
+// Author: Viktor Malik, vmalik@redhat.com
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains unit tests for the FusedPreprocessingPass which check
+/// that it gives the same result as the separate preprocessing passes.
+///
+//===----------------------------------------------------------------------===//
+
+#include <gtest/gtest.h>
+#include <llvm/AsmParser/Parser.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Transforms/Scalar/DCE.h>
+#include <llvm/Transforms/Scalar/LowerExpectIntrinsic.h>
+#include <passes/FusedPreprocessingPass.h>
+#include <passes/ReduceFunctionMetadataPass.h>
+#include <passes/SeparateCallsToBitcastPass.h>
+#include <passes/SimplifyKernelFunctionCallsPass.h>
+#include <passes/UnifyMemcpyPass.h>
+
+/// Module containing calls transformed by each of the fused passes.
+static const char *PreprocessedModule = R"(
+declare i32 @printk(i8*, ...)
+declare void @_dev_info(i8*, i8*, ...)
+declare void @warn_slowpath_null(i8*, i32)
+declare i8* @__memcpy(i8*, i8*, i64)
+declare i32 @callee(i32*)
+declare i1 @llvm.expect.i1(i1, i1)
+
+define internal i32 @test(i8* %dst, i8* %src, i1 %cond) section ".custom" {
+entry:
+  %0 = call i32 (i8*, ...) @printk(i8* %src, i32 1)
+  call void (i8*, i8*, ...) @_dev_info(i8* %dst, i8* %src, i32 2)
+  call void @warn_slowpath_null(i8* %src, i32 42)
+  %1 = call i8* @__memcpy(i8* %dst, i8* %src, i64 8)
+  %2 = call i32 bitcast (i32 (i32*)* @callee to i32 (i8*)*)(i8* %dst)
+  call void asm sideeffect ".pushsection __bug_table", "r,r"(i8* %src, i32 7)
+  %unused = add i32 %0, 1
+  %expect = call i1 @llvm.expect.i1(i1 %cond, i1 true)
+  br i1 %expect, label %then, label %else
+then:
+  ret i32 %2
+else:
+  ret i32 %0
+}
+)";
+
+/// Run the function passes on all functions of the module.
+static void runPasses(Module &Mod, FunctionPassManager &fpm) {
+    FunctionAnalysisManager fam(false);
+    PassBuilder pb;
+    pb.registerFunctionAnalyses(fam);
+    for (auto &Fun : Mod)
+        fpm.run(Fun, fam);
+}
+
+/// Print the module into a string.
+static std::string printModule(const Module &Mod) {
+    std::string Str;
+    raw_string_ostream Stream(Str);
+    Mod.print(Stream, nullptr);
+    return Stream.str();
+}
+
+/// Run the separate preprocessing passes on the module.
+static void runSeparatePasses(Module &Mod) {
+    FunctionPassManager fpm(false);
+    fpm.addPass(SimplifyKernelFunctionCallsPass{});
+    fpm.addPass(UnifyMemcpyPass{});
+    fpm.addPass(DCEPass{});
+    fpm.addPass(LowerExpectIntrinsicPass{});
+    fpm.addPass(ReduceFunctionMetadataPass{});
+    fpm.addPass(SeparateCallsToBitcastPass{});
+    runPasses(Mod, fpm);
+}
+
+/// Run the fused preprocessing on the module, followed by the passes that
+/// are not fused (in the same way as in preprocessModule).
+static void runFusedPasses(Module &Mod) {
+    FunctionPassManager fpm(false);
+    fpm.addPass(FusedPreprocessingPass{});
+    fpm.addPass(DCEPass{});
+    fpm.addPass(LowerExpectIntrinsicPass{});
+    fpm.addPass(SeparateCallsToBitcastPass{});
+    runPasses(Mod, fpm);
+}
+
+/// Test fixture parsing the same module twice, once for each way of the
+/// preprocessing.
+class FusedPreprocessingPassTest : public ::testing::Test {
+  public:
+    LLVMContext Ctx;
+    std::unique_ptr<Module> ModSeparate;
+    std::unique_ptr<Module> ModFused;
+
+    void parseModules(const char *Source) {
+        SMDiagnostic Err;
+        ModSeparate = parseAssemblyString(Source, Err, Ctx);
+        ModFused = parseAssemblyString(Source, Err, Ctx);
+        ASSERT_TRUE(ModSeparate && ModFused);
+        runSeparatePasses(*ModSeparate);
+        runFusedPasses(*ModFused);
+    }
+};
+
+/// Tests that the fused preprocessing followed by DCE and lowering of
+/// llvm.expect gives the same module as the separate passes.
+TEST_F(FusedPreprocessingPassTest, SameAsSeparatePasses) {
+    parseModules(PreprocessedModule);
+
+    // Check that the module was actually transformed.
+    Function *Test = ModFused->getFunction("test");
+    ASSERT_FALSE(Test->hasSection());
+    ASSERT_TRUE(ModFused->getFunction("__memcpy")->use_empty());
+    ASSERT_TRUE(ModFused->getFunction("llvm.expect.i1")->use_empty());
+
+    ASSERT_EQ(printModule(*ModFused), printModule(*ModSeparate));
+}
+
+/// Tests that the bitcast of the result of a call to a bitcast operator is
+/// kept even if the result is unused (DCE runs before the separation).
+TEST_F(FusedPreprocessingPassTest, UnusedBitcastCallResult) {
+    parseModules(R"(
+declare i32* @callee(i32*)
+
+define void @test(i8* %p) {
+  %1 = call i8* bitcast (i32* (i32*)* @callee to i8* (i8*)*)(i8* %p)
+  ret void
+}
+)");
+
+    Function *Test = ModFused->getFunction("test");
+    auto Call = dyn_cast<CallInst>(&*std::next(Test->front().begin()));
+    ASSERT_TRUE(Call);
+    ASSERT_EQ(Call->getCalledFunction(), ModFused->getFunction("callee"));
+    auto Result = dyn_cast<BitCastInst>(Call->getNextNode());
+    ASSERT_TRUE(Result);
+    ASSERT_TRUE(Result->use_empty());
+
+    ASSERT_EQ(printModule(*ModFused), printModule(*ModSeparate));
+}
+
+/// Tests that calls to bitcasts of printk and __memcpy are only separated from
+/// the bitcasts, the same as by the separate passes.
+TEST_F(FusedPreprocessingPassTest, BitcastKernelCalls) {
+    parseModules(R"(
+declare i32 @printk(i8*, ...)
+declare i8* @__memcpy(i8*, i8*, i64)
+
+define void @test(i32* %dst, i32* %src) {
+  %1 = call i32 (i32*, ...)
+       bitcast (i32 (i8*, ...)* @printk to i32 (i32*, ...)*)(i32* %src, i32 1)
+  %2 = call i32*
+       bitcast (i8* (i8*, i8*, i64)* @__memcpy to i32* (i32*, i32*, i64)*)
+       (i32* %dst, i32* %src, i64 8)
+  ret void
+}
+)");
+
+    ASSERT_FALSE(ModFused->getFunction("printk")->use_empty());
+    ASSERT_FALSE(ModFused->getFunction("__memcpy")->use_empty());
+    for (auto &Inst : ModFused->getFunction("test")->front())
+        if (auto Call = dyn_cast<CallInst>(&Inst))
+            ASSERT_TRUE(Call->getCalledFunction());
+
+    ASSERT_EQ(printModule(*ModFused), printModule(*ModSeparate));
+}
@@ -0,0 +1,116 @@
+//===------------- GlobalCorrespondenceTest.cpp - Unit tests ---------------==//
+//
+//       SimpLL - Program simplifier for analysis of semantic difference      //
+//
+// This file is published under Apache 2.0 license. See LICENSE for details.
+// Author: Viktor Malik, vmalik@redhat.com
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains unit tests for matching global values of the compared
+/// modules.
+///
+//===----------------------------------------------------------------------===//
+
+#include <GlobalCorrespondence.h>
+#include <gtest/gtest.h>
+#include <llvm/AsmParser/Parser.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/Support/SourceMgr.h>
+
+/// First module for the matching of globals.
+static const char *FirstModule = R"(
+@same = global i32 0
+@suffix.5 = global i32 0
+@prefer.3 = global i32 0
+@only_first = global i32 0
+
+define void @fun() {
+  ret void
+}
+
+define void @fun.1() {
+  ret void
+}
+)";
+
+/// Second module for the matching of globals.
+static const char *SecondModule = R"(
+@same = global i32 0
+@suffix = global i32 0
+@prefer.1 = global i32 0
+@prefer = global i32 0
+@only_second = global i32 0
+
+define void @fun() {
+  ret void
+}
+)";
+
+/// Test fixture providing the parsed modules.
+class GlobalCorrespondenceTest : public ::testing::Test {
+  public:
+    LLVMContext CtxFirst, CtxSecond;
+    std::unique_ptr<Module> First, Second;
+
+    void SetUp() override {
+        SMDiagnostic Err;
+        First = parseAssemblyString(FirstModule, Err, CtxFirst);
+        Second = parseAssemblyString(SecondModule, Err, CtxSecond);
+        ASSERT_TRUE(First && Second);
+    }
+};
+
+/// Tests that globals are matched by their names and, if there is no global
+/// of the same name, by their names without the .<NUMBER> suffix, preferring
+/// the global without the suffix.
+TEST_F(GlobalCorrespondenceTest, MatchByBaseName) {
+    GlobalCorrespondence Globals(*First, *Second);
+
+    ASSERT_EQ(Globals.getSecond(First->getNamedValue("same")),
+              Second->getNamedValue("same"));
+    ASSERT_EQ(Globals.getSecond(First->getNamedValue("suffix.5")),
+              Second->getNamedValue("suffix"));
+    ASSERT_EQ(Globals.getFirst(Second->getNamedValue("suffix")),
+              First->getNamedValue("suffix.5"));
+    ASSERT_EQ(Globals.getSecond(First->getNamedValue("prefer.3")),
+              Second->getNamedValue("prefer"));
+    ASSERT_EQ(Globals.getSecond(First->getNamedValue("only_first")), nullptr);
+    ASSERT_EQ(Globals.getFirst(Second->getNamedValue("only_second")),
+              nullptr);
+
+    // Multiple globals can correspond to the same global of the other module,
+    // the one of the same name is preferred in the opposite direction.
+    ASSERT_EQ(Globals.getSecondFunction(First->getFunction("fun")),
+              Second->getFunction("fun"));
+    ASSERT_EQ(Globals.getSecondFunction(First->getFunction("fun.1")),
+              Second->getFunction("fun"));
+    ASSERT_EQ(Globals.getFirst(Second->getFunction("fun")),
+              First->getFunction("fun"));
+}
+
+/// Tests that base names of globals stay valid when the globals are renamed
+/// or erased after the table is built.
+TEST_F(GlobalCorrespondenceTest, BaseNamesAfterRename) {
+    GlobalCorrespondence Globals(*First, *Second);
+    GlobalValue *Suffix = First->getNamedValue("suffix.5");
+    GlobalValue *Prefer = Second->getNamedValue("prefer.1");
+    StringRef SuffixBase = Globals.getBaseName(Suffix);
+    StringRef PreferBase = Globals.getBaseName(Prefer);
+    ASSERT_EQ(SuffixBase, "suffix");
+
+    Suffix->setName("renamed_global_with_a_long_name");
+    Prefer->eraseFromParent();
+    ASSERT_EQ(SuffixBase, "suffix");
+    ASSERT_EQ(PreferBase, "prefer");
+    ASSERT_EQ(Globals.getBaseName(Suffix), "suffix");
+
+    // Globals created after building the table get their current base name.
+    auto *Created = new GlobalVariable(*First,
+                                       Type::getInt32Ty(CtxFirst),
+                                       false,
+                                       GlobalValue::ExternalLinkage,
+                                       nullptr,
+                                       "created.2");
+    ASSERT_EQ(Globals.getBaseName(Created), "created");
+}
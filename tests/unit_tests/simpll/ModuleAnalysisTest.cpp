@@ -0,0 +1,293 @@
+//===------------- ModuleAnalysisTest.cpp - Unit tests ---------------------==//
+//
+//       SimpLL - Program simplifier for analysis of semantic difference      //
+//
+// This file is published under Apache 2.0 license. See LICENSE for details.
+// Author: Viktor Malik, vmalik@redhat.com
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains unit tests for the comparison of whole modules done by
+/// processAndCompare.
+///
+//===----------------------------------------------------------------------===//
+
+#include <Config.h>
+#include <ModuleAnalysis.h>
+#include <gtest/gtest.h>
+#include <llvm/AsmParser/Parser.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/raw_ostream.h>
+
+/// First module for the comparison w.r.t. variables. The function @test
+/// depends on the values of @a and @b.
+static const char *VariablesModuleFirst = R"(
+@a = global i32 0
+@b = global i32 0
+
+declare i32 @printk(i8*, ...)
+declare i1 @llvm.expect.i1(i1, i1)
+
+define i32 @test(i32 %x) {
+entry:
+  %va = load i32, i32* @a
+  %ca = icmp eq i32 %va, 0
+  %expect = call i1 @llvm.expect.i1(i1 %ca, i1 true)
+  br i1 %expect, label %then, label %next
+then:
+  %p = call i32 (i8*, ...) @printk(i8* null, i32 %va)
+  %dead = add i32 %x, 1
+  br label %next
+next:
+  %vb = load i32, i32* @b
+  %r = add i32 %vb, %x
+  ret i32 %r
+}
+)";
+
+/// Second module for the comparison w.r.t. variables. It differs from the
+/// first one in the computation using @b.
+static const char *VariablesModuleSecond = R"(
+@a = global i32 0
+@b = global i32 0
+
+declare i32 @printk(i8*, ...)
+declare i1 @llvm.expect.i1(i1, i1)
+
+define i32 @test(i32 %x) {
+entry:
+  %va = load i32, i32* @a
+  %ca = icmp eq i32 %va, 0
+  %expect = call i1 @llvm.expect.i1(i1 %ca, i1 true)
+  br i1 %expect, label %then, label %next
+then:
+  %p = call i32 (i8*, ...) @printk(i8* null, i32 %va)
+  %dead = add i32 %x, 1
+  br label %next
+next:
+  %vb = load i32, i32* @b
+  %r = sub i32 %vb, %x
+  ret i32 %r
+}
+)";
+
+/// First module for the bottom-up ordering. @a and @b are mutually recursive,
+/// @only_first is defined in this module only. Callees are defined after their
+/// callers so that the order does not follow the order of the module.
+static const char *CallGraphModuleFirst = R"(
+define void @only_first() {
+  call void @leaf()
+  ret void
+}
+
+define void @a() {
+  call void @b()
+  ret void
+}
+
+define void @b() {
+  call void @a()
+  call void @leaf()
+  ret void
+}
+
+define void @top() {
+  call void @a()
+  call void @only_first()
+  ret void
+}
+
+define void @called_second() {
+  ret void
+}
+
+define void @leaf() {
+  ret void
+}
+)";
+
+/// Second module for the bottom-up ordering. @leaf is not called from the
+/// recursive functions, @called_second is called from @top in this module
+/// only, and @only_second is defined in this module only.
+static const char *CallGraphModuleSecond = R"(
+define void @leaf() {
+  ret void
+}
+
+define void @a() {
+  call void @b()
+  ret void
+}
+
+define void @b() {
+  call void @a()
+  ret void
+}
+
+define void @called_second() {
+  ret void
+}
+
+define void @top() {
+  call void @a()
+  call void @called_second()
+  ret void
+}
+
+define void @only_second() {
+  call void @top()
+  ret void
+}
+)";
+
+/// Write LLVM IR into a temporary file and return its path.
+static std::string writeTempModule(StringRef IR) {
+    SmallString<128> Path;
+    int FD;
+    if (sys::fs::createTemporaryFile("simpll-test", "ll", FD, Path))
+        return "";
+    raw_fd_ostream Stream(FD, true);
+    Stream << IR;
+    return Path.str().str();
+}
+
+/// Read the contents of a file into a string.
+static std::string readFile(StringRef Path) {
+    auto Buffer = MemoryBuffer::getFile(Path);
+    return Buffer ? (*Buffer)->getBuffer().str() : "";
+}
+
+/// Tests that comparing modules w.r.t. multiple variables in a single run
+/// gives the same simplified modules and results for each variable as
+/// comparing them w.r.t. that variable only.
+TEST(ModuleAnalysisTest, MultipleVariablesSameAsSingle) {
+    std::string FirstFile = writeTempModule(VariablesModuleFirst);
+    std::string SecondFile = writeTempModule(VariablesModuleSecond);
+    std::string FirstOut = writeTempModule("");
+    std::string SecondOut = writeTempModule("");
+    ASSERT_FALSE(FirstFile.empty() || SecondFile.empty() || FirstOut.empty()
+                 || SecondOut.empty());
+
+    Config MultiConfig("test",
+                       "test",
+                       FirstFile,
+                       SecondFile,
+                       FirstOut,
+                       SecondOut,
+                       "",
+                       "a,b",
+                       true);
+    MultiVariableResult MultiResult;
+    processAndCompare(MultiConfig, MultiResult);
+    ASSERT_EQ(MultiResult.variableResults.size(), 2);
+
+    for (auto &VarResult : MultiResult.variableResults) {
+        Config SingleConfig("test",
+                            "test",
+                            FirstFile,
+                            SecondFile,
+                            FirstOut,
+                            SecondOut,
+                            "",
+                            VarResult.variable,
+                            true);
+        OverallResult SingleResult;
+        processAndCompare(SingleConfig, SingleResult);
+
+        // The simplified modules of each variable are written to the output
+        // files with the variable name as a suffix.
+        std::string FirstVarOut = addSuffix(FirstOut, VarResult.variable);
+        std::string SecondVarOut = addSuffix(SecondOut, VarResult.variable);
+        ASSERT_FALSE(readFile(FirstVarOut).empty());
+        ASSERT_EQ(readFile(FirstVarOut), readFile(FirstOut));
+        ASSERT_EQ(readFile(SecondVarOut), readFile(SecondOut));
+        sys::fs::remove(FirstVarOut);
+        sys::fs::remove(SecondVarOut);
+        ASSERT_EQ(VarResult.result.functionResults.size(),
+                  SingleResult.functionResults.size());
+        for (unsigned i = 0; i < SingleResult.functionResults.size(); i++) {
+            ASSERT_EQ(VarResult.result.functionResults[i].kind,
+                      SingleResult.functionResults[i].kind);
+        }
+    }
+
+    // The modules differ in the computation using @b only.
+    auto &ResultA = MultiResult.variableResults[0];
+    ASSERT_EQ(ResultA.variable, "a");
+    for (auto &FunResult : ResultA.result.functionResults)
+        ASSERT_NE(FunResult.kind, Result::Kind::NOT_EQUAL);
+    auto &ResultB = MultiResult.variableResults[1];
+    ASSERT_EQ(ResultB.variable, "b");
+    ASSERT_FALSE(ResultB.result.functionResults.empty());
+    ASSERT_EQ(ResultB.result.functionResults[0].kind,
+              Result::Kind::NOT_EQUAL);
+
+    sys::fs::remove(FirstFile);
+    sys::fs::remove(SecondFile);
+    sys::fs::remove(FirstOut);
+    sys::fs::remove(SecondOut);
+}
+
+/// Tests that exceeding the memory limit in the comparison w.r.t. one variable
+/// does not stop the comparison w.r.t. the following variables.
+TEST(ModuleAnalysisTest, MemoryLimitResetPerVariable) {
+    std::string FirstFile = writeTempModule(VariablesModuleFirst);
+    std::string SecondFile = writeTempModule(VariablesModuleSecond);
+    ASSERT_FALSE(FirstFile.empty() || SecondFile.empty());
+
+    Config Conf("test", "test", FirstFile, SecondFile, "", "", "", "a,b");
+    Conf.Memory.setLimit(1);
+    MultiVariableResult MultiResult;
+    processAndCompare(Conf, MultiResult);
+    ASSERT_EQ(MultiResult.variableResults.size(), 2);
+
+    // The limit is exceeded after comparing the main functions w.r.t. each
+    // of the variables.
+    for (auto &VarResult : MultiResult.variableResults)
+        ASSERT_TRUE(VarResult.result.stats.memory.limitExceeded);
+    auto &ResultB = MultiResult.variableResults[1];
+    ASSERT_EQ(ResultB.variable, "b");
+    ASSERT_FALSE(ResultB.result.functionResults.empty());
+    ASSERT_EQ(ResultB.result.functionResults[0].kind,
+              Result::Kind::NOT_EQUAL);
+
+    sys::fs::remove(FirstFile);
+    sys::fs::remove(SecondFile);
+}
+
+/// Tests that the pairs of corresponding functions are ordered bottom-up along
+/// the call graphs of both modules, that mutually recursive functions form a
+/// single component, and that functions without a counterpart are skipped.
+TEST(ModuleAnalysisTest, BottomUpOrder) {
+    LLVMContext CtxFirst, CtxSecond;
+    SMDiagnostic Err;
+    auto First = parseAssemblyString(CallGraphModuleFirst, Err, CtxFirst);
+    auto Second = parseAssemblyString(CallGraphModuleSecond, Err, CtxSecond);
+    ASSERT_TRUE(First && Second);
+    GlobalCorrespondence Globals(*First, *Second);
+
+    auto Order = getBottomUpOrder(*First, *Second, Globals);
+    std::map<StringRef, unsigned> Positions;
+    for (unsigned i = 0; i < Order.size(); i++) {
+        ASSERT_EQ(Order[i].first->getParent(), First.get());
+        ASSERT_EQ(Order[i].second->getParent(), Second.get());
+        ASSERT_EQ(Order[i].first->getName(), Order[i].second->getName());
+        Positions[Order[i].first->getName()] = i;
+    }
+    ASSERT_EQ(Order.size(), 5);
+    ASSERT_EQ(Positions.size(), 5);
+    ASSERT_EQ(Positions.count("only_first"), 0);
+    ASSERT_EQ(Positions.count("only_second"), 0);
+
+    // @a and @b form a single component, hence they are next to each other.
+    unsigned PosA = Positions["a"], PosB = Positions["b"];
+    ASSERT_EQ(std::max(PosA, PosB) - std::min(PosA, PosB), 1);
+    // @leaf is called by @b in the first module only.
+    ASSERT_LT(Positions["leaf"], std::min(PosA, PosB));
+    ASSERT_LT(std::max(PosA, PosB), Positions["top"]);
+    // @called_second is called by @top in the second module only.
+    ASSERT_LT(Positions["called_second"], Positions["top"]);
+}
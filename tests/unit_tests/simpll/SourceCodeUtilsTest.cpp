@@ -0,0 +1,186 @@
+//===------------ SourceCodeUtilsTest.cpp - Unit tests ---------------------==//
+//
+//       SimpLL - Program simplifier for analysis of semantic difference      //
+//
+// This file is published under Apache 2.0 license. See LICENSE for details.
+// Author: Tomas Glozar, tglozar@gmail.com
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains unit tests for the functions working with C sources of
+/// inline assembly and with macros used in the sources.
+///
+//===----------------------------------------------------------------------===//
+
+#include <SourceCodeUtils.h>
+#include <gtest/gtest.h>
+#include <llvm/BinaryFormat/Dwarf.h>
+#include <llvm/IR/DebugInfoMetadata.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+
+/// Multi-digit %cN operands are translated as a whole, not as %c1 followed
+/// by a digit.
+TEST(SourceCodeUtilsTest, InlineAsmMultiDigitOperands) {
+    auto Asm = convertInlineAsmToLLVMFormat(
+            "asm(\"mov %c1, %c10\\n\" \"nop\" : : \"i\" (a), \"i\" (b));");
+    ASSERT_EQ(Asm.first, "mov ${1:c}, ${10:c}\nnop");
+    ASSERT_EQ(Asm.second, ": : \"i\" (a), \"i\" (b)");
+}
+
+#if LLVM_VERSION_MAJOR > 7
+/// Test fixture providing a C source file whose second line uses two inline
+/// assembly macros (the first line of a file is never extracted), and debug
+/// metadata describing the file and the macros.
+class InlineAsmSourceTest : public ::testing::Test {
+  public:
+    LLVMContext Ctx;
+    SmallString<128> Dir;
+    DISubprogram *DSub;
+
+    void SetUp() override {
+        sys::fs::createUniqueDirectory("simpll-test", Dir);
+        writeSource("/* test */\nASM_LONG; ASM_SHORT;\n");
+
+        DIFile *DFile = DIFile::get(Ctx, "test.c", Dir);
+        auto *MacLong = DIMacro::get(
+                Ctx,
+                dwarf::DW_MACINFO_define,
+                1,
+                "ASM_LONG",
+                "asm(\"mov %c1, %c10\" : : \"i\" (a), \"i\" (b))");
+        auto *MacShort = DIMacro::get(Ctx,
+                                      dwarf::DW_MACINFO_define,
+                                      2,
+                                      "ASM_SHORT",
+                                      "asm(\"mov %c1, %c2\" : : \"i\" (c))");
+        auto *MacFile = DIMacroFile::get(
+                Ctx,
+                dwarf::DW_MACINFO_start_file,
+                0,
+                DFile,
+                DIMacroNodeArray(MDTuple::get(Ctx, {MacLong, MacShort})));
+        DICompileUnit *DCU = DICompileUnit::getDistinct(
+                Ctx,
+                0,
+                DFile,
+                "test",
+                false,
+                "",
+                0,
+                "test",
+                DICompileUnit::DebugEmissionKind::FullDebug,
+                DICompositeTypeArray{},
+                DIScopeArray{},
+                DIGlobalVariableExpressionArray{},
+                DIImportedEntityArray{},
+                DIMacroNodeArray(MDTuple::get(Ctx, {MacFile})),
+                0,
+                false,
+                false,
+                DICompileUnit::DebugNameTableKind::Default,
+                0);
+        DSub = DISubprogram::get(Ctx,
+                                 DFile,
+                                 "test",
+                                 "test",
+                                 DFile,
+                                 1,
+                                 nullptr,
+                                 1,
+                                 nullptr,
+                                 0,
+                                 0,
+                                 DINode::DIFlags{},
+                                 DISubprogram::DISPFlags{},
+                                 DCU);
+    }
+
+    void TearDown() override { sys::fs::remove_directories(Dir); }
+
+    void writeSource(StringRef Contents) {
+        SmallString<128> Path(Dir);
+        sys::path::append(Path, "test.c");
+        std::error_code EC;
+        raw_fd_ostream Source(Path, EC, sys::fs::F_None);
+        ASSERT_FALSE(EC);
+        Source << Contents;
+    }
+};
+
+/// The candidate whose body has the longest common prefix with the inline
+/// assembly from LLVM IR is chosen, %c10 is not confused with %c1.
+TEST_F(InlineAsmSourceTest, LongestPrefixChosen) {
+    MacroDiffAnalysis MacroDiffs;
+    DILocation *Loc = DILocation::get(Ctx, 2, 1, DSub);
+
+    ASSERT_EQ(MacroDiffs.getInlineAsmSourceArguments(Loc,
+                                                     "mov ${1:c}, ${10:c}"),
+              std::vector<std::string>({"a", "b"}));
+    ASSERT_EQ(
+            MacroDiffs.getInlineAsmSourceArguments(Loc, "mov ${1:c}, ${2:c}"),
+            std::vector<std::string>({"c"}));
+    // A common prefix of both candidates does not select any of them.
+    ASSERT_TRUE(MacroDiffs.getInlineAsmSourceArguments(Loc, "mov ${1:c}")
+                        .empty());
+}
+
+/// Arguments are cached per source line, hence they are reused for another
+/// DILocation at the same line and the source is not read again until the
+/// caches are cleared.
+TEST_F(InlineAsmSourceTest, CachedArgumentsReused) {
+    MacroDiffAnalysis MacroDiffs;
+    DILocation *Loc = DILocation::get(Ctx, 2, 1, DSub);
+    DILocation *OtherLoc = DILocation::get(Ctx, 2, 11, DSub);
+    std::string Asm = "mov ${1:c}, ${2:c}";
+
+    auto &Arguments = MacroDiffs.getInlineAsmSourceArguments(Loc, Asm);
+    ASSERT_EQ(Arguments, std::vector<std::string>({"c"}));
+
+    writeSource("/* test */\nasm(\"mov %c1, %c2\" : : \"i\" (d));\n");
+    ASSERT_EQ(&MacroDiffs.getInlineAsmSourceArguments(OtherLoc, Asm),
+              &Arguments);
+    ASSERT_EQ(Arguments, std::vector<std::string>({"c"}));
+
+    MacroDiffs.clearCaches();
+    ASSERT_EQ(MacroDiffs.getInlineAsmSourceArguments(OtherLoc, Asm),
+              std::vector<std::string>({"d"}));
+}
+
+/// Macro uses are cached per source line, hence distinct DILocations at the
+/// same line (and with the same line offset) get the same cached uses. This
+/// holds for the line offset -1 (used to look for macros on the previous
+/// line), too.
+TEST_F(InlineAsmSourceTest, MacroUsesCachedPerLine) {
+    writeSource("/* test */\nASM_LONG; ASM_SHORT;\nx = 1;\n");
+    MacroDiffAnalysis MacroDiffs;
+    DILocation *Loc = DILocation::get(Ctx, 2, 1, DSub);
+    DILocation *OtherLoc = DILocation::get(Ctx, 2, 11, DSub);
+    DILocation *NextLoc = DILocation::get(Ctx, 3, 1, DSub);
+    DILocation *OtherNextLoc = DILocation::get(Ctx, 3, 5, DSub);
+    ASSERT_NE(Loc, OtherLoc);
+    ASSERT_NE(NextLoc, OtherNextLoc);
+
+    auto &Uses = MacroDiffs.getAllMacroUsesAtLocation(Loc);
+    ASSERT_EQ(Uses.size(), 2);
+    ASSERT_EQ(Uses.count("ASM_LONG"), 1);
+    ASSERT_EQ(Uses.count("ASM_SHORT"), 1);
+    uint64_t Memory = MacroDiffs.getMemoryUsage();
+    ASSERT_EQ(&MacroDiffs.getAllMacroUsesAtLocation(OtherLoc), &Uses);
+    ASSERT_EQ(MacroDiffs.getMemoryUsage(), Memory);
+
+    // No macros are used on the third line, they are found with the line
+    // offset -1 only.
+    ASSERT_TRUE(MacroDiffs.getAllMacroUsesAtLocation(NextLoc).empty());
+    auto &PrevUses = MacroDiffs.getAllMacroUsesAtLocation(NextLoc, -1);
+    ASSERT_EQ(PrevUses.size(), 2);
+    ASSERT_EQ(PrevUses.count("ASM_LONG"), 1);
+    ASSERT_NE(&PrevUses, &Uses);
+    Memory = MacroDiffs.getMemoryUsage();
+    ASSERT_EQ(&MacroDiffs.getAllMacroUsesAtLocation(OtherNextLoc, -1),
+              &PrevUses);
+    ASSERT_EQ(MacroDiffs.getMemoryUsage(), Memory);
+}
+#endif
@@ -0,0 +1,140 @@
+//===---------------- SymbolIndexTest.cpp - Unit tests ---------------------==//
+//
+//       SimpLL - Program simplifier for analysis of semantic difference      //
+//
+// This file is published under Apache 2.0 license. See LICENSE for details.
+// Author: Viktor Malik, vmalik@redhat.com
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains unit tests for looking up symbols in the index of symbol
+/// definitions and for linking missing definitions.
+///
+//===----------------------------------------------------------------------===//
+
+#include <SymbolIndex.h>
+#include <Utils.h>
+#include <gtest/gtest.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/raw_ostream.h>
+
+/// Module with missing definitions of @f and @g.
+static const char *MainModule = R"(
+declare i32 @f(i32)
+declare i32 @g(i32)
+
+define i32 @main(i32 %x) {
+  %a = call i32 @f(i32 %x)
+  %b = call i32 @g(i32 %a)
+  ret i32 %b
+}
+)";
+
+/// Module defining @f (using an internal helper) and @g.
+static const char *DefsModule = R"(
+define internal i32 @helper(i32 %x) {
+  ret i32 %x
+}
+
+define i32 @f(i32 %x) {
+  %r = call i32 @helper(i32 %x)
+  ret i32 %r
+}
+
+define i32 @g(i32 %x) {
+  ret i32 %x
+}
+)";
+
+/// Test fixture providing a temporary directory into which the index and the
+/// modules are written.
+class SymbolIndexTest : public ::testing::Test {
+  public:
+    SmallString<128> Dir;
+    std::vector<std::string> Files;
+
+    void SetUp() override {
+        ASSERT_FALSE(sys::fs::createUniqueDirectory("simpll-test", Dir));
+    }
+
+    void TearDown() override {
+        for (auto &File : Files)
+            sys::fs::remove(File);
+        sys::fs::remove(joinPath(Dir, "sub"));
+        sys::fs::remove(Dir);
+    }
+
+    /// Write a file into the temporary directory and return its path.
+    std::string writeFile(StringRef Name, StringRef Contents) {
+        std::string Path = joinPath(Dir, Name);
+        sys::fs::create_directories(sys::path::parent_path(Path));
+        std::error_code EC;
+        raw_fd_ostream Stream(Path, EC, sys::fs::F_None);
+        Stream << Contents;
+        Files.push_back(Path);
+        return Path;
+    }
+};
+
+/// Tests looking up symbols in the index, including symbols that are not
+/// present and that are before the first or after the last one.
+TEST_F(SymbolIndexTest, Lookup) {
+    std::string IndexFile = writeFile("symbols.idx",
+                                      "a a.ll\n"
+                                      "b sub/b.ll\n"
+                                      "bb b.ll\n"
+                                      "c c.ll\n");
+    SymbolIndex Index(IndexFile);
+    ASSERT_EQ(Index.lookup("a"), joinPath(Dir, "a.ll"));
+    ASSERT_EQ(Index.lookup("b"), joinPath(Dir, "sub/b.ll"));
+    ASSERT_EQ(Index.lookup("bb"), joinPath(Dir, "b.ll"));
+    ASSERT_EQ(Index.lookup("c"), joinPath(Dir, "c.ll"));
+    ASSERT_EQ(Index.lookup("ba"), "");
+    ASSERT_EQ(Index.lookup("0"), "");
+    ASSERT_EQ(Index.lookup("d"), "");
+
+    SymbolIndex Missing(joinPath(Dir, "missing.idx"));
+    ASSERT_EQ(Missing.lookup("a"), "");
+}
+
+/// Tests that only the requested definition (with the internal globals that
+/// it uses) is linked and that each symbol is linked at most once.
+TEST_F(SymbolIndexTest, LinkDefinition) {
+    std::string MainFile = writeFile("main.ll", MainModule);
+    writeFile("sub/defs.ll", DefsModule);
+    std::string IndexFile = writeFile("symbols.idx",
+                                      "f sub/defs.ll\n"
+                                      "g sub/defs.ll\n");
+    LLVMContext Ctx;
+    SMDiagnostic Err;
+    auto Mod = parseIRFile(MainFile, Err, Ctx);
+    ASSERT_TRUE(Mod);
+
+    MissingDefsLinker Linker(*Mod, IndexFile);
+    ASSERT_FALSE(Linker.linkDefinition("unknown"));
+    ASSERT_FALSE(Linker.linkDefinition("main"));
+    ASSERT_TRUE(Linker.linkDefinition("f"));
+    ASSERT_FALSE(Linker.linkDefinition("f"));
+
+    auto Linked = Linker.getModuleCopy();
+    ASSERT_FALSE(Linked->getFunction("f")->isDeclaration());
+    ASSERT_FALSE(Linked->getFunction("main")->isDeclaration());
+    ASSERT_TRUE(Linked->getFunction("g")->isDeclaration());
+    // The helper called by @f is linked, too.
+    unsigned Defined = 0;
+    for (auto &Fun : *Linked) {
+        if (!Fun.isDeclaration())
+            Defined++;
+    }
+    ASSERT_EQ(Defined, 3);
+    // The module passed to the linker is not changed.
+    ASSERT_TRUE(Mod->getFunction("f")->isDeclaration());
+
+    // Definitions of renamed symbols are linked, too.
+    ASSERT_TRUE(Linker.linkDefinition("g.void"));
+    ASSERT_FALSE(Linker.getModuleCopy()->getFunction("g")->isDeclaration());
+}
@@ -0,0 +1,133 @@
+//===-------- SyntheticModuleGeneratorTest.cpp - Unit tests ----------------==//
+//
+//       SimpLL - Program simplifier for analysis of semantic difference      //
+//
+// This file is published under Apache 2.0 license. See LICENSE for details.
+// Author: Viktor Malik, vmalik@redhat.com
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains unit tests for the generator of synthetic module pairs.
+///
+//===----------------------------------------------------------------------===//
+
+#include <SyntheticModuleGenerator.h>
+#include <gtest/gtest.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+#include <set>
+
+/// Test fixture providing a temporary directory for the generated sources.
+class SyntheticModuleGeneratorTest : public ::testing::Test {
+  public:
+    SmallString<128> Dir;
+
+    void SetUp() override {
+        sys::fs::createUniqueDirectory("simpll-test", Dir);
+    }
+    void TearDown() override { sys::fs::remove_directories(Dir); }
+
+    static std::string print(Module &Mod) {
+        std::string Result;
+        raw_string_ostream Stream(Result);
+        Mod.print(Stream, nullptr);
+        return Stream.str();
+    }
+};
+
+/// The generated modules are valid, have the same functions, and their C
+/// sources are written. The roots are not called by other functions.
+TEST_F(SyntheticModuleGeneratorTest, GenerateModulePair) {
+    GeneratorParams Params;
+    Params.Functions = 20;
+    Params.Depth = 3;
+    Params.Macros = 10;
+    Params.Structs = 2;
+    SyntheticModuleGenerator Generator(Params);
+    LLVMContext CtxL, CtxR;
+    auto ModL = Generator.generate(CtxL, false, Dir.str().str());
+    auto ModR = Generator.generate(CtxR, true, Dir.str().str());
+    ASSERT_TRUE(ModL);
+    ASSERT_TRUE(ModR);
+    ASSERT_FALSE(verifyModule(*ModL, &errs()));
+    ASSERT_FALSE(verifyModule(*ModR, &errs()));
+
+    std::set<std::string> CalledL;
+    unsigned FunctionsL = 0;
+    for (auto &Fun : *ModL) {
+        ++FunctionsL;
+        ASSERT_TRUE(ModR->getFunction(Fun.getName()));
+        for (auto &BB : Fun)
+            for (auto &Inst : BB)
+                if (auto Call = dyn_cast<CallInst>(&Inst))
+                    if (auto Callee = Call->getCalledFunction())
+                        CalledL.insert(Callee->getName().str());
+    }
+    ASSERT_EQ(FunctionsL, Params.Functions);
+    ASSERT_EQ(ModR->size(), Params.Functions);
+
+    auto Roots = Generator.getRoots();
+    ASSERT_FALSE(Roots.empty());
+    for (auto &Root : Roots)
+        ASSERT_EQ(CalledL.count(Root), 0);
+
+    for (auto Name : {"first.c", "second.c"}) {
+        SmallString<128> Path(Dir);
+        sys::path::append(Path, Name);
+        ASSERT_TRUE(sys::fs::exists(Path));
+    }
+}
+
+/// The same parameters give the same modules, the differences are injected
+/// into the second module only.
+TEST_F(SyntheticModuleGeneratorTest, DeterministicDifferences) {
+    GeneratorParams Params;
+    Params.Functions = 20;
+    Params.DiffFraction = 1.0;
+    Params.DiffKinds = {DifferenceKind::Constant};
+    SyntheticModuleGenerator Generator(Params);
+    SyntheticModuleGenerator OtherGenerator(Params);
+
+    LLVMContext Ctx1, Ctx2, Ctx3;
+    auto First = Generator.generate(Ctx1, false, Dir.str().str());
+    auto OtherFirst = OtherGenerator.generate(Ctx2, false, Dir.str().str());
+    auto Second = Generator.generate(Ctx3, true, Dir.str().str());
+    ASSERT_EQ(print(*First), print(*OtherFirst));
+    ASSERT_NE(print(*First), print(*Second));
+
+    auto Differences = Generator.getDifferences();
+    ASSERT_EQ(Differences.size(), Params.Functions);
+    for (auto &Diff : Differences)
+        ASSERT_EQ(Diff.second, DifferenceKind::Constant);
+
+    Params.DiffFraction = 0.0;
+    SyntheticModuleGenerator SameGenerator(Params);
+    ASSERT_TRUE(SameGenerator.getDifferences().empty());
+}
+
+/// Generating into a non-existent directory fails.
+TEST_F(SyntheticModuleGeneratorTest, SourceNotWritable) {
+    SyntheticModuleGenerator Generator(GeneratorParams{});
+    SmallString<128> Missing(Dir);
+    sys::path::append(Missing, "missing");
+    LLVMContext Ctx;
+    ASSERT_FALSE(Generator.generate(Ctx, false, Missing.str().str()));
+}
+
+/// Difference kinds are parsed from their names.
+TEST(SyntheticModuleGeneratorKindTest, ParseDifferenceKind) {
+    for (auto Kind : {DifferenceKind::Constant,
+                      DifferenceKind::Macro,
+                      DifferenceKind::Call,
+                      DifferenceKind::Field,
+                      DifferenceKind::Asm}) {
+        DifferenceKind Parsed;
+        ASSERT_TRUE(parseDifferenceKind(getDifferenceKindName(Kind), Parsed));
+        ASSERT_EQ(Parsed, Kind);
+    }
+    DifferenceKind Parsed;
+    ASSERT_FALSE(parseDifferenceKind("unknown", Parsed));
+}
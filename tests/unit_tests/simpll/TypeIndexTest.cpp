@@ -0,0 +1,106 @@
+//===---------------- TypeIndexTest.cpp - Unit tests -----------------------==//
+//
+//       SimpLL - Program simplifier for analysis of semantic difference      //
+//
+// This file is published under Apache 2.0 license. See LICENSE for details.
+// Author: Viktor Malik, vmalik@redhat.com
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains unit tests for the index of types used in a module.
+///
+//===----------------------------------------------------------------------===//
+
+#include <gtest/gtest.h>
+#include <llvm/AsmParser/Parser.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/SourceMgr.h>
+#include <passes/TypeIndexAnalysis.h>
+
+/// Module with named structures, anonymous structures having the same
+/// contents, and mutually recursive anonymous structures.
+static const char *TypesModule = R"(
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+%struct.named = type { i32, i64 }
+%struct.other = type { i32, i64 }
+%struct.anon = type { i32, %struct.named* }
+%struct.anon.0 = type { i32, %struct.named* }
+%union.anon = type { i64 }
+%struct.anon.1 = type { i32, %struct.anon.2* }
+%struct.anon.2 = type { i64, %struct.anon.1* }
+
+@named = global %struct.named zeroinitializer
+@other = global %struct.other zeroinitializer
+@anon = global %struct.anon zeroinitializer
+@anon0 = global %struct.anon.0 zeroinitializer
+@union = global %union.anon zeroinitializer
+@rec = global %struct.anon.1 zeroinitializer
+)";
+
+/// Test fixture providing the parsed module.
+class TypeIndexTest : public ::testing::Test {
+  public:
+    LLVMContext Ctx;
+    std::unique_ptr<Module> Mod;
+
+    void SetUp() override {
+        SMDiagnostic Err;
+        Mod = parseAssemblyString(TypesModule, Err, Ctx);
+        ASSERT_TRUE(Mod);
+    }
+
+    StructType *getType(StringRef Name) {
+        return Mod->getTypeByName(Name);
+    }
+};
+
+/// Tests that all named structure types are collected and that anonymous
+/// structures and unions are recognised.
+TEST_F(TypeIndexTest, StructTypes) {
+    TypeIndex Index(*Mod);
+    ASSERT_EQ(Index.structTypes().size(), 7);
+    ASSERT_FALSE(isAnonStructType(getType("struct.named")));
+    ASSERT_TRUE(isAnonStructType(getType("struct.anon.0")));
+    ASSERT_TRUE(isAnonStructType(getType("union.anon")));
+}
+
+/// Tests that named structures are hashed by their names while anonymous
+/// structures are hashed by their contents.
+TEST_F(TypeIndexTest, StructuralHash) {
+    TypeIndex Index(*Mod);
+    ASSERT_NE(Index.structuralHash(getType("struct.named")),
+              Index.structuralHash(getType("struct.other")));
+    ASSERT_EQ(Index.structuralHash(getType("struct.anon")),
+              Index.structuralHash(getType("struct.anon.0")));
+    ASSERT_NE(Index.structuralHash(getType("struct.anon")),
+              Index.structuralHash(getType("struct.anon.1")));
+
+    // The hash does not depend on the name of an anonymous structure, hence it
+    // stays the same after renaming.
+    hash_code Hash = Index.structuralHash(getType("struct.anon"));
+    getType("struct.anon")->setName("struct.anon.renamed");
+    ASSERT_EQ(TypeIndex(*Mod).structuralHash(
+                      getType("struct.anon.renamed")),
+              Hash);
+
+    ASSERT_EQ(Index.allocSize(getType("struct.named")), 16);
+    ASSERT_EQ(Index.allocSize(getType("union.anon")), 8);
+}
+
+/// Tests that hashes of mutually recursive anonymous structures do not depend
+/// on the order in which they are computed.
+TEST_F(TypeIndexTest, RecursiveHashOrderIndependent) {
+    StructType *First = getType("struct.anon.1");
+    StructType *Second = getType("struct.anon.2");
+
+    TypeIndex FirstToSecond(*Mod);
+    hash_code FirstHash = FirstToSecond.structuralHash(First);
+    hash_code SecondHash = FirstToSecond.structuralHash(Second);
+
+    TypeIndex SecondToFirst(*Mod);
+    ASSERT_EQ(SecondToFirst.structuralHash(Second), SecondHash);
+    ASSERT_EQ(SecondToFirst.structuralHash(First), FirstHash);
+    ASSERT_NE(FirstHash, SecondHash);
+}
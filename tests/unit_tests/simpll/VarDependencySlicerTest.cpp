@@ -0,0 +1,84 @@
+//===---------- VarDependencySlicerTest.cpp - Unit tests -------------------==//
+//
+//       SimpLL - Program simplifier for analysis of semantic difference      //
+//
+// This file is published under Apache 2.0 license. See LICENSE for details.
+// Author: Tomas Glozar, tglozar@gmail.com
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains unit tests for the VarDependencySlicer pass.
+///
+//===----------------------------------------------------------------------===//
+
+#include <gtest/gtest.h>
+#include <llvm/AsmParser/Parser.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/SourceMgr.h>
+#include <passes/VarDependencySlicer.h>
+
+/// Create a module with a function whose branch depends on the value of @var.
+/// The true successor stores into @other and continues to a chain of
+/// ChainLength blocks, the false successor continues to the chain directly.
+static std::string createChainModule(unsigned ChainLength) {
+    std::string IR = "@var = global i32 0\n"
+                     "@other = global i32 0\n"
+                     "define void @test() {\n"
+                     "entry:\n"
+                     "  %v = load i32, i32* @var\n"
+                     "  %c = icmp eq i32 %v, 0\n"
+                     "  br i1 %c, label %then, label %chain0\n"
+                     "then:\n"
+                     "  store i32 1, i32* @other\n"
+                     "  br label %chain0\n";
+    for (unsigned i = 0; i < ChainLength; i++) {
+        IR += "chain" + std::to_string(i) + ":\n";
+        IR += "  br label %"
+              + (i + 1 < ChainLength ? "chain" + std::to_string(i + 1)
+                                     : std::string("exit"))
+              + "\n";
+    }
+    IR += "exit:\n"
+          "  ret void\n"
+          "}\n";
+    return IR;
+}
+
+/// Check whether the function contains a store into the global variable.
+static bool hasStoreTo(Function &Fun, GlobalVariable *Var) {
+    for (auto &Inst : instructions(Fun)) {
+        if (auto Store = dyn_cast<StoreInst>(&Inst))
+            if (Store->getPointerOperand() == Var)
+                return true;
+    }
+    return false;
+}
+
+/// Tests that a block whose execution depends on the variable is kept when
+/// the CFG has more than 32 blocks. Reachability is computed exactly, hence
+/// the block (which is not reachable from the false successor of the branch)
+/// is affected by the branch even though the search from the false successor
+/// visits more than 32 blocks. (isPotentiallyReachable, which was used
+/// previously, gives up after 32 blocks and treats the block as reachable.)
+TEST(VarDependencySlicerTest, LargeCFG) {
+    for (unsigned ChainLength : {4, 40}) {
+        LLVMContext Ctx;
+        SMDiagnostic Err;
+        auto Mod =
+                parseAssemblyString(createChainModule(ChainLength), Err, Ctx);
+        ASSERT_TRUE(Mod);
+        Function *Test = Mod->getFunction("test");
+
+        PassManager<Function, FunctionAnalysisManager, GlobalVariable *> fpm;
+        FunctionAnalysisManager fam(false);
+        PassBuilder pb;
+        pb.registerFunctionAnalyses(fam);
+        fpm.addPass(VarDependencySlicer{});
+        fpm.run(*Test, fam, Mod->getGlobalVariable("var"));
+
+        ASSERT_TRUE(hasStoreTo(*Test, Mod->getGlobalVariable("other")));
+    }
+}
@@ -0,0 +1,50 @@
+"""
+Unit tests for running SimpLL.
+Tests for helper functions located in simpll/simpll.py.
+"""
+
+from diffkemp.simpll import simpll
+from diffkemp.simpll.simpll import SimpLLException, SimpLLStats, \
+    _parse_result, _simpll_output
+import pytest
+
+
+def _simpll_result(peak, limit_exceeded):
+    """SimpLL output containing no results and the given memory stats."""
+    return {
+        "function-results": [],
+        "missing-defs": [],
+        "stats": {
+            "compared-functions": 1,
+            "inlined-calls": 0,
+            "memory": {"peak": peak, "limit-exceeded": limit_exceeded},
+        }
+    }
+
+
+def test_memory_limit_option(monkeypatch):
+    """Passing the memory limit to the SimpLL binary."""
+    commands = []
+
+    def check_output(command):
+        commands.append(command)
+        return b""
+
+    monkeypatch.setattr(simpll, "check_output", check_output)
+    for limit in [None, 512]:
+        _simpll_output("first.ll", "second.ll", "first.ll", "second.ll",
+                       "f", "f", None, None, None, False, False, False, False,
+                       False, None, None, limit, None)
+    assert "--memory-limit" not in commands[0]
+    index = commands[1].index("--memory-limit")
+    assert commands[1][index + 1] == "512"
+
+
+def test_memory_limit_exceeded():
+    """Raising SimpLLException when SimpLL exceeds the memory limit."""
+    SimpLLStats.reset()
+    _parse_result(_simpll_result(1024, False))
+    assert SimpLLStats.peak_memory == 1024
+    with pytest.raises(SimpLLException):
+        _parse_result(_simpll_result(2048, True))
+    assert SimpLLStats.peak_memory == 2048
@@ -376,3 +376,61 @@ def test_to_yaml_sysctls():
                 "glob_var": None,
                 "tag": "proc handler"
             }
+
+
+def test_load_snapshot_from_manifest():
+    """
+    Write an indexed manifest of a snapshot with multiple sysctl groups and
+    load the snapshot from it. Function descriptions should be created only
+    when they are looked up and their LLVM paths should contain the snapshot
+    root dir.
+    """
+    kernel_dir = "kernel/linux-3.10.0-957.el7"
+    output_dir = "snapshots-sysctl/linux-3.10.0-957.el7"
+    snap = Snapshot.create_from_source(kernel_dir, output_dir,
+                                       "sysctl", False)
+
+    snap.add_fun_group("kernel.sched_latency_ns")
+    snap.add_fun_group("kernel.timer_migration")
+    snap.add_fun("sched_proc_update_handler",
+                 LlvmKernelModule(
+                     "snapshots-sysctl/linux-3.10.0-957.el7/"
+                     "kernel/sched/fair.ll"),
+                 None, "proc handler", "kernel.sched_latency_ns")
+    snap.add_fun("proc_dointvec_minmax",
+                 LlvmKernelModule(
+                     "snapshots-sysctl/linux-3.10.0-957.el7/kernel/sysctl.ll"),
+                 None, "proc handler", "kernel.timer_migration")
+    snap.add_fun("sched_debug_header", None, "sysctl_sched_latency",
+                 "using data variable", "kernel.sched_latency_ns")
+
+    with TemporaryDirectory(prefix="test_snapshots_manifest_") as snap_dir:
+        open(os.path.join(snap_dir, "snapshot.yaml"), "w").close()
+        snap.to_manifest(os.path.join(snap_dir, "snapshot.idx"))
+        loaded = Snapshot.load_from_dir(snap_dir)
+
+        assert loaded.created_time is not None
+        assert set(loaded.fun_groups.keys()) == {"kernel.sched_latency_ns",
+                                                 "kernel.timer_migration"}
+        group = loaded.fun_groups["kernel.sched_latency_ns"].functions
+        assert len(group) == 2
+        assert not group.loaded
+
+        fun = loaded.get_by_name("sched_proc_update_handler",
+                                 "kernel.sched_latency_ns")
+        assert os.path.abspath(fun.mod.llvm) == snap_dir + \
+            "/kernel/sched/fair.ll"
+        assert fun.glob_var is None
+        assert fun.tag == "proc handler"
+        assert set(group.loaded.keys()) == {"sched_proc_update_handler"}
+
+        fun = loaded.get_by_name("sched_debug_header",
+                                 "kernel.sched_latency_ns")
+        assert fun.mod is None
+        assert fun.glob_var == "sysctl_sched_latency"
+        assert loaded.get_by_name("proc_dointvec_minmax",
+                                  "kernel.sched_latency_ns") is None
+
+        loaded.filter(["proc_dointvec_minmax"], "kernel.timer_migration")
+        assert loaded.fun_groups["kernel.timer_migration"].functions.keys() \
+            == {"proc_dointvec_minmax"}
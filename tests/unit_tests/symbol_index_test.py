@@ -0,0 +1,216 @@
+"""
+Unit tests for the index of symbol definitions.
+Tests for the SymbolIndex class located in llvm_ir/symbol_index.py.
+"""
+
+from diffkemp.llvm_ir.kernel_source import KernelSource, \
+    SourceNotFoundException
+from diffkemp.llvm_ir.symbol_index import SourceSymbolIndex, SymbolIndex
+import os
+import pytest
+
+
+@pytest.fixture
+def llvm_files(tmpdir):
+    """Create two simple LLVM IR files."""
+    first = tmpdir.join("first.ll")
+    first.write("@defined_var = dso_local global i32 0, align 4\n"
+                "@declared_var = external global i32, align 4\n"
+                "define dso_local i32 @first_fun(i32 %x) {\n"
+                "  ret i32 %x\n"
+                "}\n"
+                "declare i32 @second_fun(i32)\n")
+    second = tmpdir.join("sub", "second.ll")
+    second.write("@declared_var = internal constant i32 1, align 4\n"
+                 "define dso_local i32 @second_fun(i32 %x) {\n"
+                 "  ret i32 %x\n"
+                 "}\n", ensure=True)
+    return [str(first), str(second)]
+
+
+def test_get_definitions(llvm_files):
+    """Finding symbols defined in an LLVM IR file."""
+    assert SymbolIndex.get_definitions(llvm_files[0]) == {"defined_var",
+                                                          "first_fun"}
+    assert SymbolIndex.get_definitions(llvm_files[1]) == {"declared_var",
+                                                          "second_fun"}
+    assert SymbolIndex.get_definitions(llvm_files[1], exported_only=True) == \
+        {"second_fun"}
+
+
+def test_create_and_lookup(tmpdir, llvm_files):
+    """Creating an index file and looking up symbols in it."""
+    SymbolIndex.create(str(tmpdir), llvm_files)
+    index_file = os.path.join(str(tmpdir), SymbolIndex.file_name)
+    with open(index_file, "r") as index:
+        lines = index.read().splitlines()
+    assert lines == sorted(lines)
+
+    index = SymbolIndex(str(tmpdir))
+    assert index.mapped is not None
+    assert index.lookup("first_fun") == "first.ll"
+    assert index.lookup("defined_var") == "first.ll"
+    assert index.lookup("second_fun") == os.path.join("sub", "second.ll")
+    # Internal symbols are not indexed
+    assert index.lookup("declared_var") is None
+    assert index.lookup("unknown_fun") is None
+    assert index.lookup("a") is None
+    assert index.lookup("z") is None
+
+
+def test_get_declarations(llvm_files):
+    """Finding symbols declared in an LLVM IR file."""
+    assert SymbolIndex.get_declarations(llvm_files[0]) == {"declared_var",
+                                                           "second_fun"}
+    assert SymbolIndex.get_declarations(llvm_files[1]) == set()
+
+
+def test_add_module(tmpdir, llvm_files):
+    """Adding a module to a loaded index and writing the index."""
+    SymbolIndex.create(str(tmpdir), llvm_files[:1])
+    index = SymbolIndex(str(tmpdir))
+    assert index.lookup("second_fun") is None
+    index.add_module(llvm_files[1])
+    assert index.lookup("second_fun") == os.path.join("sub", "second.ll")
+    assert index.module_defines(llvm_files[0], "first_fun")
+    assert not index.module_defines(llvm_files[0], "second_fun")
+    assert index.module_defines(llvm_files[1], "declared_var")
+
+    index.write()
+    index = SymbolIndex(str(tmpdir))
+    assert index.lookup("first_fun") == "first.ll"
+    assert index.lookup("second_fun") == os.path.join("sub", "second.ll")
+
+
+def test_exported_definition_preferred(tmpdir, llvm_files):
+    """An internal definition does not hide an exported one."""
+    static = tmpdir.join("static.ll")
+    static.write("define internal i32 @first_fun(i32 %x) {\n"
+                 "  ret i32 %x\n"
+                 "}\n")
+    index = SymbolIndex.create(str(tmpdir), [str(static)] + llvm_files)
+    assert index.lookup("first_fun") == "first.ll"
+
+
+def test_outdated_entries(tmpdir, llvm_files):
+    """Entries of modified or removed LLVM IR files are not used."""
+    SymbolIndex.create(str(tmpdir), llvm_files)
+    index_file = os.path.join(str(tmpdir), SymbolIndex.file_name)
+    # Make the first file newer than the index
+    mtime = os.path.getmtime(llvm_files[0])
+    os.utime(index_file, (mtime - 10, mtime - 10))
+    os.remove(llvm_files[1])
+
+    index = SymbolIndex(str(tmpdir))
+    assert index.lookup("first_fun") is None
+    assert index.lookup("second_fun") is None
+    # Adding the modified module again makes its entries valid
+    index.add_module(llvm_files[0])
+    assert index.lookup("first_fun") == "first.ll"
+
+    index.write()
+    index = SymbolIndex(str(tmpdir))
+    assert index.lookup("first_fun") == "first.ll"
+    assert index.lookup("second_fun") is None
+
+
+def test_get_module_for_symbol_index(tmpdir, monkeypatch):
+    """
+    Index hits are only used if the module defines the symbol and it was
+    built from a source of the same name, CScope is used otherwise.
+    """
+    tmpdir.join("a.c").write("")
+    tmpdir.join("a.ll").write("define i32 @fun() {\n"
+                              "  ret i32 0\n"
+                              "}\n")
+    tmpdir.join("b.c").write("")
+    tmpdir.join("b.ll").write("define i32 @var_fun() {\n"
+                              "  ret i32 0\n"
+                              "}\n")
+    # Linked module having no source of the same name
+    tmpdir.join("linked.ll").write("define i32 @linked_fun() {\n"
+                                   "  ret i32 0\n"
+                                   "}\n")
+    index_file = tmpdir.join(SymbolIndex.file_name)
+    index_file.write("fun b.ll\n"
+                     "linked_fun linked.ll\n")
+    mtime = os.path.getmtime(str(index_file))
+    for llvm_file in ["a.ll", "b.ll", "linked.ll"]:
+        os.utime(str(tmpdir.join(llvm_file)), (mtime - 10, mtime - 10))
+
+    cscope = {"fun": ["a.c"], "linked_fun": ["b.c"]}
+    source = KernelSource(str(tmpdir))
+    monkeypatch.setattr(source, "find_srcs_with_symbol_def",
+                        lambda symbol: cscope[symbol])
+    mod = source.get_module_for_symbol("fun")
+    assert mod.llvm == str(tmpdir.join("a.ll"))
+    with pytest.raises(SourceNotFoundException):
+        source.get_module_for_symbol("linked_fun")
+    assert str(tmpdir.join("linked.ll")) not in \
+        [m.llvm for m in source.modules.values()]
+
+
+@pytest.fixture
+def fake_cscope(tmpdir, monkeypatch):
+    """
+    Create a fake cscope executable supporting the line-oriented mode and
+    put it into PATH. Every run of the executable is logged.
+    """
+    bin_dir = tmpdir.mkdir("bin")
+    log = tmpdir.join("cscope.log")
+    script = bin_dir.join("cscope")
+    script.write(
+        "#!/usr/bin/env python3\n"
+        "import sys\n"
+        "open('{}', 'a').write('run\\n')\n"
+        "results = {{\n"
+        "    '1fun': ['a.c fun 10 int fun(void)'],\n"
+        "    '0fun': ['b.c caller 5 fun();',\n"
+        "             'b.h <global> 3 int fun(void);'],\n"
+        "    '0var': ['c.c <global> 2 int *p = &var;'],\n"
+        "}}\n"
+        "while True:\n"
+        "    sys.stdout.write('>> ')\n"
+        "    sys.stdout.flush()\n"
+        "    line = sys.stdin.readline().rstrip('\\n')\n"
+        "    if not line or line == 'q':\n"
+        "        break\n"
+        "    result = results.get(line, [])\n"
+        "    print('cscope: {{}} lines'.format(len(result)))\n"
+        "    for entry in result:\n"
+        "        print(entry)\n"
+        "    sys.stdout.flush()\n".format(str(log)))
+    script.chmod(0o755)
+    monkeypatch.setenv("PATH", str(bin_dir) + os.pathsep +
+                       os.environ["PATH"])
+    return log
+
+
+def test_source_index(tmpdir, fake_cscope):
+    """
+    Indexing cscope results of multiple symbols by a single cscope run,
+    writing the index, and looking the symbols up in the written index.
+    """
+    index = SourceSymbolIndex(str(tmpdir))
+    assert index.lookup("fun", True) is None
+    index.add_symbols(["fun", "var", "unknown"])
+    assert fake_cscope.read() == "run\n"
+    assert index.lookup("fun", True) == ["a.c fun 10 int fun(void)"]
+    # Entries from headers are dropped
+    assert index.lookup("fun", False) == ["b.c caller 5 fun();"]
+    # Already indexed symbols are not searched again
+    index.add_symbols(["fun"])
+    assert fake_cscope.read() == "run\n"
+    index.write()
+
+    index = SourceSymbolIndex(str(tmpdir))
+    assert index.mapped is not None
+    assert index.lookup("fun", True) == ["a.c fun 10 int fun(void)"]
+    assert index.lookup("fun", False) == ["b.c caller 5 fun();"]
+    assert index.lookup("var", True) == []
+    assert index.lookup("var", False) == ["c.c <global> 2 int *p = &var;"]
+    assert index.lookup("unknown", True) == []
+    assert index.lookup("unknown", False) == []
+    assert index.lookup("other", True) is None
+    assert index.lookup("a", True) is None
+    assert index.lookup("z", False) is None